@@ -27,15 +27,15 @@
 #import "BFTask.h"
 
 @class BFExecutor;
+@class IMImojiExecutor;
 
 @interface BFTask (Utils)
 
-+ (BFTask *)im_concurrentBackgroundTaskWithBlock:(BFContinuationBlock)block;
+/**
+* @abstract Runs block on executor, see IMImojiExecutors for the kind of work each session executor runs
+*/
++ (BFTask *)im_taskWithExecutor:(IMImojiExecutor *)executor block:(BFContinuationBlock)block;
 
-+ (BFExecutor *)im_concurrentBackgroundExecutor;
-
-+ (BFTask *)im_serialBackgroundTaskWithBlock:(BFContinuationBlock)block;
-
-+ (BFExecutor *)im_serialBackgroundExecutor;
++ (BFExecutor *)im_executorWithImojiExecutor:(IMImojiExecutor *)executor;
 
 @end
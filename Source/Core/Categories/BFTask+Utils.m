@@ -27,60 +27,19 @@
 #import <Bolts/BFTaskCompletionSource.h>
 #import "BFTask+Utils.h"
 #import "BFExecutor.h"
+#import "IMImojiExecutor.h"
 
 
 @implementation BFTask (Utils)
 
-+ (BFTask *)im_concurrentBackgroundTaskWithBlock:(BFContinuationBlock)block {
-    return [[BFTask taskWithDelay:0] continueWithExecutor:[BFTask im_concurrentBackgroundExecutor] withBlock:block];
++ (BFTask *)im_taskWithExecutor:(IMImojiExecutor *)executor block:(BFContinuationBlock)block {
+    return [[BFTask taskWithDelay:0] continueWithExecutor:[BFTask im_executorWithImojiExecutor:executor] withBlock:block];
 }
 
-+ (BFExecutor *)im_concurrentBackgroundExecutor {
-    static BFExecutor *executor = nil;
-    static dispatch_once_t backgroundPredicate;
-
-    dispatch_once(&backgroundPredicate, ^{
-        executor = [BFExecutor executorWithDispatchQueue:[BFTask backgroundQueue]];
-    });
-
-    return executor;
-}
-
-+ (dispatch_queue_t)backgroundQueue {
-    static dispatch_queue_t queue;
-    static dispatch_once_t queuePredicate;
-
-    dispatch_once(&queuePredicate, ^{
-        queue = dispatch_queue_create("com.imoji.background.queue.concurrent", DISPATCH_QUEUE_CONCURRENT);
-    });
-
-    return queue;
-}
-
-+ (BFTask *)im_serialBackgroundTaskWithBlock:(BFContinuationBlock)block {
-    return [[BFTask taskWithDelay:0] continueWithExecutor:[BFTask im_serialBackgroundExecutor] withBlock:block];
-}
-
-+ (BFExecutor *)im_serialBackgroundExecutor {
-    static BFExecutor *executor = nil;
-    static dispatch_once_t serialBackgroundPredicate;
-
-    dispatch_once(&serialBackgroundPredicate, ^{
-        executor = [BFExecutor executorWithDispatchQueue:[BFTask serialBackgroundQueue]];
-    });
-
-    return executor;
-}
-
-+ (dispatch_queue_t)serialBackgroundQueue {
-    static dispatch_queue_t queue;
-    static dispatch_once_t serialQueuePredicate;
-
-    dispatch_once(&serialQueuePredicate, ^{
-        queue = dispatch_queue_create("com.imoji.background.queue.serial", DISPATCH_QUEUE_SERIAL);
-    });
-
-    return queue;
++ (BFExecutor *)im_executorWithImojiExecutor:(IMImojiExecutor *)executor {
+    return [BFExecutor executorWithBlock:^(void (^block)()) {
+        [executor execute:block];
+    }];
 }
 
 @end
@@ -0,0 +1,47 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+* @abstract userInfo key holding the HTTP status code of a failed response
+*/
+extern NSString *__nonnull const IMImojiSessionErrorHTTPStatusCodeKey;
+
+/**
+* @abstract userInfo key set to @YES on failures that may succeed when retried later, such as access token requests
+*/
+extern NSString *__nonnull const IMImojiSessionErrorTransientKey;
+
+@interface NSError (Utils)
+
+/**
+* @abstract YES when the request may succeed if sent again later: connectivity failures, server errors (5xx and 429),
+* errors marked with IMImojiSessionErrorTransientKey, or errors whose NSUnderlyingErrorKey is transient. Requests
+* rejected by the server (other 4xx or a failure status in the response) are not.
+*/
+- (BOOL)im_isTransient;
+
+@end
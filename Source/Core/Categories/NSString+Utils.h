@@ -37,4 +37,6 @@
 
 - (NSString *)im_md5;
 
+- (NSString *)im_sha256;
+
 @end
@@ -31,6 +31,8 @@
 
 - (UIImage *)im_resizedImageToSize:(CGSize)dstSize;
 
+- (UIImage *)im_redrawnImageToSize:(CGSize)dstSize;
+
 - (UIImage *)im_resizedImageToFitInSize:(CGSize)boundingSize
                          scaleIfSmaller:(BOOL)scale;
 
@@ -24,6 +24,7 @@
 //
 
 #import "UIImage+Extensions.h"
+#import "IMImageResampler.h"
 
 @implementation UIImage (UIImageExtensions)
 
@@ -68,6 +69,62 @@
 }
 
 
+- (UIImage *)im_resizedImageToSize:(CGSize)dstSize {
+    CGImageRef imgRef = self.CGImage;
+    size_t srcWidth = CGImageGetWidth(imgRef), srcHeight = CGImageGetHeight(imgRef);
+
+    if (CGSizeEqualToSize(CGSizeMake(srcWidth, srcHeight), dstSize)) {
+        return self;
+    }
+
+    // dstSize is expressed in the orientation of the backing CGImage, the result is always upright
+    UIImageOrientation orient = self.imageOrientation;
+    BOOL transposed = orient == UIImageOrientationLeft || orient == UIImageOrientationRight ||
+            orient == UIImageOrientationLeftMirrored || orient == UIImageOrientationRightMirrored;
+    size_t outputWidth = (size_t) (transposed ? dstSize.height : dstSize.width);
+    size_t outputHeight = (size_t) (transposed ? dstSize.width : dstSize.height);
+
+    if (outputWidth == 0 || outputHeight == 0) {
+        return [self im_redrawnImageToSize:dstSize];
+    }
+
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGBitmapInfo bitmapInfo = kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big;
+
+    // decode the source once at its native size, the resampler takes over from there
+    NSMutableData *srcPixels = [NSMutableData dataWithLength:srcWidth * srcHeight * 4];
+    CGContextRef srcContext = CGBitmapContextCreate(srcPixels.mutableBytes, srcWidth, srcHeight, 8, srcWidth * 4, colorSpace, bitmapInfo);
+
+    NSMutableData *dstPixels = [NSMutableData dataWithLength:outputWidth * outputHeight * 4];
+    CGContextRef dstContext = CGBitmapContextCreate(dstPixels.mutableBytes, outputWidth, outputHeight, 8, outputWidth * 4, colorSpace, bitmapInfo);
+    CGColorSpaceRelease(colorSpace);
+
+    BOOL resampled = NO;
+    if (srcContext && dstContext) {
+        CGContextDrawImage(srcContext, CGRectMake(0, 0, srcWidth, srcHeight), imgRef);
+
+        // area averaging is both faster and alias free for large reductions such as thumbnails
+        BOOL largeReduction = dstSize.width * 2 <= srcWidth && dstSize.height * 2 <= srcHeight;
+        resampled = IMImageResamplePremultipliedRGBA(srcPixels.bytes, srcWidth, srcHeight, srcWidth * 4,
+                dstPixels.mutableBytes, outputWidth, outputHeight, outputWidth * 4,
+                (IMImageResamplingOrientation) orient,
+                largeReduction ? IMImageResamplingFilterArea : IMImageResamplingFilterLanczos3);
+    }
+
+    CGImageRef resizedImageRef = resampled ? CGBitmapContextCreateImage(dstContext) : nil;
+    CGContextRelease(srcContext);
+    CGContextRelease(dstContext);
+
+    if (!resizedImageRef) {
+        return [self im_redrawnImageToSize:dstSize];
+    }
+
+    UIImage *resizedImage = [UIImage imageWithCGImage:resizedImageRef scale:1.0 orientation:UIImageOrientationUp];
+    CGImageRelease(resizedImageRef);
+
+    return resizedImage;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 /***********************************************************************************
@@ -101,7 +158,7 @@
 
 
 
-- (UIImage *)im_resizedImageToSize:(CGSize)dstSize {
+- (UIImage *)im_redrawnImageToSize:(CGSize)dstSize {
     CGImageRef imgRef = self.CGImage;
     // the below values are regardless of orientation : for UIImages from Camera, width>height (landscape)
     CGSize srcSize = CGSizeMake(CGImageGetWidth(imgRef), CGImageGetHeight(imgRef)); // not equivalent to self.size (which is dependant on the imageOrientation)!
@@ -0,0 +1,93 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+@class IMImojiObject;
+
+/**
+* @abstract A single bitmap holding the thumbnails of a page of imojis, filled by
+* renderImojis:intoAtlas:options:callback: of IMImojiSession. Cells are laid out in rows of equal size, each imoji is
+* scaled to fit its cell. The bitmap is 8 bit premultiplied RGBA with rows aligned for texture uploads. Grids draw every
+* cell from the same image, for instance by setting it as the contents of each cell's layer along with
+* contentsRectForImojiAtIndex:. Reusing an atlas for the next page reuses its memory.
+*/
+@interface IMImojiAtlas : NSObject
+
+/**
+* @abstract Size of each cell in pixels
+*/
+@property(nonatomic, readonly) CGSize cellSize;
+
+/**
+* @abstract Maximum number of imojis the atlas holds
+*/
+@property(nonatomic, readonly) NSUInteger capacity;
+
+/**
+* @abstract Number of cells in each row of the bitmap
+*/
+@property(nonatomic, readonly) NSUInteger columns;
+
+/**
+* @abstract Size of the bitmap in pixels
+*/
+@property(nonatomic, readonly) CGSize size;
+
+/**
+* @abstract Imojis of the page last rendered into the atlas, in cell order
+*/
+@property(readonly, nonnull) NSArray<IMImojiObject *> *imojis;
+
+/**
+* @abstract Indexes of the cells drawn so far for the current page
+*/
+@property(readonly, nonnull) NSIndexSet *drawnIndexes;
+
+/**
+* @abstract Creates an empty atlas.
+* @param cellSize Size of each cell in pixels, 150x150 fits IMImojiObjectRenderSizeThumbnail renditions
+* @param capacity Number of cells, the bitmap is laid out as close to a square as possible
+*/
++ (nonnull instancetype)atlasWithCellSize:(CGSize)cellSize capacity:(NSUInteger)capacity;
+
+/**
+* @abstract Frame of a cell in pixels with the origin at the top left of the bitmap
+*/
+- (CGRect)rectForImojiAtIndex:(NSUInteger)index;
+
+/**
+* @abstract Frame of a cell in the unit coordinate space used by CALayer's contentsRect
+*/
+- (CGRect)contentsRectForImojiAtIndex:(NSUInteger)index;
+
+/**
+* @abstract Snapshot of the bitmap. The pixels are only copied when the atlas is drawn to again while the snapshot is
+* still referenced.
+*/
+- (nullable UIImage *)image;
+
+@end
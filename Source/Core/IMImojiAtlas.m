@@ -0,0 +1,199 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import <YYImage_MagicNarwhal/YYImage.h>
+#import "IMImojiAtlas.h"
+#import "IMImojiAtlas+Private.h"
+
+// row alignment suited to texture uploads
+static const size_t IMImojiAtlasRowAlignment = 64;
+
+@implementation IMImojiAtlas {
+    dispatch_queue_t _queue;
+
+    // accessed on _queue
+    CGContextRef _context;
+    NSMutableIndexSet *_drawnIndexes;
+    NSArray<IMImojiObject *> *_imojis;
+    NSUInteger _generation;
+}
+
+- (instancetype)initWithCellSize:(CGSize)cellSize capacity:(NSUInteger)capacity {
+    self = [super init];
+    if (self) {
+        _cellSize = CGSizeMake(MAX(1, floor(cellSize.width)), MAX(1, floor(cellSize.height)));
+        _capacity = MAX(1, capacity);
+        _columns = (NSUInteger) ceil(sqrt(_capacity));
+        _size = CGSizeMake(_columns * _cellSize.width, ((_capacity + _columns - 1) / _columns) * _cellSize.height);
+        _queue = dispatch_queue_create("com.imoji.atlas", DISPATCH_QUEUE_SERIAL);
+        _drawnIndexes = [NSMutableIndexSet indexSet];
+        _imojis = @[];
+
+        size_t width = (size_t) _size.width, height = (size_t) _size.height;
+        size_t bytesPerRow = (width * 4 + IMImojiAtlasRowAlignment - 1) / IMImojiAtlasRowAlignment * IMImojiAtlasRowAlignment;
+        CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+        _context = CGBitmapContextCreate(NULL, width, height, 8, bytesPerRow, colorSpace,
+                kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big);
+        CGColorSpaceRelease(colorSpace);
+
+        CGContextSetInterpolationQuality(_context, kCGInterpolationMedium);
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    if (_context) {
+        CGContextRelease(_context);
+    }
+}
+
++ (instancetype)atlasWithCellSize:(CGSize)cellSize capacity:(NSUInteger)capacity {
+    return [[IMImojiAtlas alloc] initWithCellSize:cellSize capacity:capacity];
+}
+
+#pragma mark Layout
+
+- (CGRect)rectForImojiAtIndex:(NSUInteger)index {
+    return CGRectMake((index % self.columns) * self.cellSize.width,
+            (index / self.columns) * self.cellSize.height,
+            self.cellSize.width,
+            self.cellSize.height);
+}
+
+- (CGRect)contentsRectForImojiAtIndex:(NSUInteger)index {
+    CGRect rect = [self rectForImojiAtIndex:index];
+
+    return CGRectMake(rect.origin.x / self.size.width,
+            rect.origin.y / self.size.height,
+            rect.size.width / self.size.width,
+            rect.size.height / self.size.height);
+}
+
+#pragma mark Contents
+
+- (NSArray<IMImojiObject *> *)imojis {
+    __block NSArray<IMImojiObject *> *imojis;
+    dispatch_sync(_queue, ^{
+        imojis = self->_imojis;
+    });
+
+    return imojis;
+}
+
+- (NSIndexSet *)drawnIndexes {
+    __block NSIndexSet *drawnIndexes;
+    dispatch_sync(_queue, ^{
+        drawnIndexes = [self->_drawnIndexes copy];
+    });
+
+    return drawnIndexes;
+}
+
+- (UIImage *)image {
+    __block CGImageRef imageRef = NULL;
+    dispatch_sync(_queue, ^{
+        imageRef = self->_context ? CGBitmapContextCreateImage(self->_context) : NULL;
+    });
+
+    if (!imageRef) {
+        return nil;
+    }
+
+    UIImage *image = [UIImage imageWithCGImage:imageRef];
+    CGImageRelease(imageRef);
+
+    return image;
+}
+
+#pragma mark Drawing
+
+- (NSUInteger)resetWithImojis:(NSArray<IMImojiObject *> *)imojis {
+    __block NSUInteger generation;
+
+    dispatch_sync(_queue, ^{
+        // the bitmap is cleared in place so the next page reuses its memory
+        CGContextClearRect(self->_context, CGRectMake(0, 0, self.size.width, self.size.height));
+        [self->_drawnIndexes removeAllIndexes];
+        self->_imojis = [imojis copy];
+        generation = ++self->_generation;
+    });
+
+    return generation;
+}
+
+- (NSUInteger)generation {
+    __block NSUInteger generation;
+    dispatch_sync(_queue, ^{
+        generation = self->_generation;
+    });
+
+    return generation;
+}
+
+- (BOOL)drawImage:(UIImage *)image
+          atIndex:(NSUInteger)index
+       generation:(NSUInteger)generation {
+    __block BOOL drawn = NO;
+
+    dispatch_sync(_queue, ^{
+        CGImageRef imageRef = image.CGImage;
+        drawn = generation == self->_generation && index < self.capacity && imageRef && self->_context;
+
+        if (drawn) {
+            CGRect cellRect = [self rectForImojiAtIndex:index];
+            CGFloat imageWidth = CGImageGetWidth(imageRef), imageHeight = CGImageGetHeight(imageRef);
+            CGFloat scale = MIN(cellRect.size.width / imageWidth, cellRect.size.height / imageHeight);
+            CGSize fittedSize = CGSizeMake(floor(imageWidth * scale), floor(imageHeight * scale));
+
+            // the bitmap's origin is at the bottom left
+            CGRect contextCellRect = CGRectMake(cellRect.origin.x, self.size.height - CGRectGetMaxY(cellRect), cellRect.size.width, cellRect.size.height);
+            CGRect imageRect = CGRectMake(floor(CGRectGetMidX(contextCellRect) - fittedSize.width / 2),
+                    floor(CGRectGetMidY(contextCellRect) - fittedSize.height / 2),
+                    fittedSize.width,
+                    fittedSize.height);
+
+            CGContextClearRect(self->_context, contextCellRect);
+            CGContextDrawImage(self->_context, imageRect, imageRef);
+            [self->_drawnIndexes addIndex:index];
+        }
+    });
+
+    return drawn;
+}
+
+- (BOOL)drawImageData:(NSData *)data
+              atIndex:(NSUInteger)index
+           generation:(NSUInteger)generation {
+    if (generation != self.generation) {
+        return NO;
+    }
+
+    UIImage *image = [[YYImageDecoder decoderWithData:data scale:1.0f] frameAtIndex:0 decodeForDisplay:NO].image;
+
+    return image && [self drawImage:image atIndex:index generation:generation];
+}
+
+@end
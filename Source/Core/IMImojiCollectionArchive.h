@@ -0,0 +1,86 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+@class IMImojiObject;
+
+/**
+* @abstract Binary archive for large imoji collections such as favorites or recents, a faster alternative to archiving
+* IMImojiObjects with NSKeyedArchiver. The file is memory mapped when opened and imojis are only created when they are
+* accessed.
+* @discussion The file is a versioned header followed by segments. Every append writes a new segment at the end of the
+* file with its own fixed width record table, string pool and sorted identifier index, earlier segments are never
+* rewritten. Lookups by identifier binary search each segment, the segments are merged into one once there are more
+* than 16. URLs, dimensions and file sizes are kept for every combination of render size, border style and image
+* format, which covers all imojis returned by IMImojiSession. Safe to use from multiple threads.
+*/
+@interface IMImojiCollectionArchive : NSObject
+
+@property(nonatomic, readonly, nonnull) NSURL *fileURL;
+
+/**
+* @abstract Number of imojis in the archive, imojis appended more than once are counted every time
+*/
+@property(nonatomic, readonly) NSUInteger count;
+
+/**
+* @abstract Opens the archive at fileURL, creating an empty one if the file does not exist.
+* @param error Set to an NSCocoaErrorDomain error when the file is not an archive or was written by a newer version, or
+* to an NSPOSIXErrorDomain error when it can't be opened
+*/
++ (nullable instancetype)archiveWithFileURL:(nonnull NSURL *)fileURL
+                                      error:(NSError *__nullable *__nullable)error;
+
+/**
+* @abstract Creates the imoji at index, in the order the imojis were appended.
+* @return The imoji or nil if its record is damaged
+*/
+- (nullable IMImojiObject *)imojiAtIndex:(NSUInteger)index;
+
+/**
+* @abstract Creates the most recently appended imoji with the identifier, nil if there is none
+*/
+- (nullable IMImojiObject *)imojiWithIdentifier:(nonnull NSString *)identifier;
+
+/**
+* @abstract Appends imojis as a new segment at the end of the archive
+* @return NO with an NSPOSIXErrorDomain error if the segment could not be written, the archive is left unchanged
+*/
+- (BOOL)appendImojis:(nonnull NSArray<IMImojiObject *> *)imojis
+               error:(NSError *__nullable *__nullable)error;
+
+/**
+* @abstract Rewrites the archive as a single segment, replacing the file atomically
+*/
+- (BOOL)compactWithError:(NSError *__nullable *__nullable)error;
+
+/**
+* @abstract Replaces the contents of the archive with imojis as a single segment, replacing the file atomically
+*/
+- (BOOL)replaceImojis:(nonnull NSArray<IMImojiObject *> *)imojis
+                error:(NSError *__nullable *__nullable)error;
+
+@end
@@ -0,0 +1,690 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import <fcntl.h>
+#import <pthread.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <unistd.h>
+#import <UIKit/UIKit.h>
+#import "IMImojiCollectionArchive.h"
+#import "IMImojiObjectRenderingOptions.h"
+#import "IMMutableImojiObject.h"
+#import "IMImojiResponse.h"
+
+static const uint32_t IMImojiCollectionArchiveMagic = 0x494d4341; // IMCA
+static const uint32_t IMImojiCollectionArchiveVersion = 1;
+static const NSUInteger IMImojiCollectionArchiveMaximumSegmentCount = 16;
+
+enum {
+    // see +[IMImojiResponse renderingOptions]
+    IMImojiCollectionArchiveRenderingOptionsCount = 32
+};
+
+// all values are stored in the byte order of the device, every iOS device is little endian
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+
+    // bytes of complete segments including this header, anything past it was left by an interrupted append
+    uint64_t length;
+} IMImojiCollectionArchiveHeader;
+
+// followed by the rendition, record, tag and index tables and the string pool, in that order
+typedef struct {
+    uint32_t length;
+    uint32_t recordCount;
+    uint32_t renditionCount;
+    uint32_t tagCount;
+    uint32_t stringPoolLength;
+    uint32_t reserved;
+} IMImojiCollectionArchiveSegmentHeader;
+
+// UTF-8 bytes in the string pool of the segment
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+} IMImojiCollectionArchiveString;
+
+typedef NS_OPTIONS(uint8_t, IMImojiCollectionArchiveRecordFlags) {
+    IMImojiCollectionArchiveRecordHasImageDimensions = 1 << 0,
+    IMImojiCollectionArchiveRecordHasFileSizes = 1 << 1
+};
+
+typedef struct {
+    IMImojiCollectionArchiveString identifier;
+    uint32_t firstTag;
+    uint32_t firstRendition;
+    uint32_t licenseStyle;
+    uint16_t tagCount;
+    uint8_t renditionCount;
+    uint8_t flags;
+} IMImojiCollectionArchiveRecord;
+
+// the dictionaries of an imoji may leave out a rendering option, hold NSNull for it or hold a value
+typedef NS_OPTIONS(uint8_t, IMImojiCollectionArchiveRenditionFlags) {
+    IMImojiCollectionArchiveRenditionHasURLKey = 1 << 0,
+    IMImojiCollectionArchiveRenditionHasURL = 1 << 1,
+    IMImojiCollectionArchiveRenditionHasDimensionsKey = 1 << 2,
+    IMImojiCollectionArchiveRenditionHasDimensions = 1 << 3,
+    IMImojiCollectionArchiveRenditionHasFileSizeKey = 1 << 4,
+    IMImojiCollectionArchiveRenditionHasFileSize = 1 << 5
+};
+
+typedef struct {
+    int64_t fileSize;
+    IMImojiCollectionArchiveString url;
+    float width;
+    float height;
+    uint8_t renderingOptions;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t reserved2;
+} IMImojiCollectionArchiveRendition;
+
+typedef struct {
+    uint64_t offset;
+    NSUInteger firstIndex;
+    const IMImojiCollectionArchiveRendition *renditions;
+    const IMImojiCollectionArchiveRecord *records;
+    const IMImojiCollectionArchiveString *tags;
+    const uint32_t *index;
+    const char *stringPool;
+    IMImojiCollectionArchiveSegmentHeader header;
+} IMImojiCollectionArchiveSegment;
+
+static uint64_t IMImojiCollectionArchiveSegmentContentLength(const IMImojiCollectionArchiveSegmentHeader *header) {
+    return sizeof(IMImojiCollectionArchiveSegmentHeader) +
+            (uint64_t) header->renditionCount * sizeof(IMImojiCollectionArchiveRendition) +
+            (uint64_t) header->recordCount * (sizeof(IMImojiCollectionArchiveRecord) + sizeof(uint32_t)) +
+            (uint64_t) header->tagCount * sizeof(IMImojiCollectionArchiveString) +
+            header->stringPoolLength;
+}
+
+static BOOL IMImojiCollectionArchiveStringIsValid(const IMImojiCollectionArchiveSegment *segment, IMImojiCollectionArchiveString string) {
+    return (uint64_t) string.offset + string.length <= segment->header.stringPoolLength;
+}
+
+static NSComparisonResult IMImojiCollectionArchiveCompareBytes(const char *bytes, size_t length, const char *otherBytes, size_t otherLength) {
+    int result = memcmp(bytes, otherBytes, MIN(length, otherLength));
+    if (result != 0) {
+        return result < 0 ? NSOrderedAscending : NSOrderedDescending;
+    }
+
+    return length == otherLength ? NSOrderedSame : (length < otherLength ? NSOrderedAscending : NSOrderedDescending);
+}
+
+static IMImojiCollectionArchiveString IMImojiCollectionArchiveAppendString(NSMutableData *stringPool,
+                                                                           NSMutableDictionary<NSString *, NSNumber *> *offsets,
+                                                                           NSString *string) {
+    NSNumber *offset = offsets[string];
+    NSUInteger length = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+
+    if (!offset) {
+        offset = @(stringPool.length);
+        [stringPool appendBytes:string.UTF8String length:length];
+        offsets[string] = offset;
+    }
+
+    return (IMImojiCollectionArchiveString) {.offset = offset.unsignedIntValue, .length = (uint32_t) length};
+}
+
+static NSError *IMImojiCollectionArchivePOSIXError(void) {
+    return [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+}
+
+@implementation IMImojiCollectionArchive {
+    pthread_rwlock_t _lock;
+    int _fileDescriptor;
+    const uint8_t *_bytes;
+    size_t _mappedLength;
+    IMImojiCollectionArchiveHeader _header;
+    NSMutableData *_segments;
+    NSUInteger _count;
+}
+
+- (instancetype)initWithFileURL:(NSURL *)fileURL {
+    self = [super init];
+    if (self) {
+        _fileURL = fileURL;
+        _fileDescriptor = -1;
+        _segments = [NSMutableData data];
+        pthread_rwlock_init(&_lock, NULL);
+    }
+
+    return self;
+}
+
++ (instancetype)archiveWithFileURL:(NSURL *)fileURL error:(NSError **)error {
+    IMImojiCollectionArchive *archive = [[self alloc] initWithFileURL:fileURL];
+    return [archive openWithError:error] ? archive : nil;
+}
+
+- (void)dealloc {
+    [self closeFile];
+    pthread_rwlock_destroy(&_lock);
+}
+
+- (NSUInteger)count {
+    pthread_rwlock_rdlock(&_lock);
+    NSUInteger count = _count;
+    pthread_rwlock_unlock(&_lock);
+
+    return count;
+}
+
+#pragma mark Reading
+
+- (IMImojiObject *)imojiAtIndex:(NSUInteger)index {
+    IMImojiObject *imoji = nil;
+    pthread_rwlock_rdlock(&_lock);
+
+    if (index < _count) {
+        const IMImojiCollectionArchiveSegment *segments = _segments.bytes;
+        NSUInteger segmentIndex = _segments.length / sizeof(IMImojiCollectionArchiveSegment) - 1;
+        while (segments[segmentIndex].firstIndex > index) {
+            segmentIndex--;
+        }
+
+        imoji = [self imojiInSegment:&segments[segmentIndex] record:(uint32_t) (index - segments[segmentIndex].firstIndex)];
+    }
+
+    pthread_rwlock_unlock(&_lock);
+    return imoji;
+}
+
+- (IMImojiObject *)imojiWithIdentifier:(NSString *)identifier {
+    const char *identifierBytes = identifier.UTF8String;
+    size_t identifierLength = strlen(identifierBytes);
+    IMImojiObject *imoji = nil;
+
+    pthread_rwlock_rdlock(&_lock);
+
+    const IMImojiCollectionArchiveSegment *segments = _segments.bytes;
+    NSUInteger segmentCount = _segments.length / sizeof(IMImojiCollectionArchiveSegment);
+
+    // newer segments take precedence, within a segment equal identifiers are indexed in the order they were appended
+    for (NSUInteger s = segmentCount; s > 0 && !imoji; s--) {
+        const IMImojiCollectionArchiveSegment *segment = &segments[s - 1];
+        uint32_t low = 0, high = segment->header.recordCount;
+        BOOL damaged = NO;
+
+        while (low < high) {
+            uint32_t middle = low + (high - low) / 2;
+            const IMImojiCollectionArchiveRecord *record = [self recordInSegment:segment atIndexPosition:middle];
+            if (!record) {
+                damaged = YES;
+                break;
+            }
+
+            NSComparisonResult result = IMImojiCollectionArchiveCompareBytes(segment->stringPool + record->identifier.offset, record->identifier.length,
+                    identifierBytes, identifierLength);
+            if (result == NSOrderedDescending) {
+                high = middle;
+            } else {
+                low = middle + 1;
+            }
+        }
+
+        if (damaged || low == 0) {
+            continue;
+        }
+
+        const IMImojiCollectionArchiveRecord *record = [self recordInSegment:segment atIndexPosition:low - 1];
+        if (IMImojiCollectionArchiveCompareBytes(segment->stringPool + record->identifier.offset, record->identifier.length,
+                identifierBytes, identifierLength) == NSOrderedSame) {
+            imoji = [self imojiInSegment:segment record:segment->index[low - 1]];
+        }
+    }
+
+    pthread_rwlock_unlock(&_lock);
+    return imoji;
+}
+
+// the record the identifier index points to at position, NULL when the index or the identifier is out of bounds
+- (const IMImojiCollectionArchiveRecord *)recordInSegment:(const IMImojiCollectionArchiveSegment *)segment
+                                          atIndexPosition:(uint32_t)position {
+    uint32_t recordIndex = segment->index[position];
+    if (recordIndex >= segment->header.recordCount ||
+            !IMImojiCollectionArchiveStringIsValid(segment, segment->records[recordIndex].identifier)) {
+        return NULL;
+    }
+
+    return &segment->records[recordIndex];
+}
+
+- (NSString *)stringInSegment:(const IMImojiCollectionArchiveSegment *)segment string:(IMImojiCollectionArchiveString)string {
+    if (!IMImojiCollectionArchiveStringIsValid(segment, string)) {
+        return nil;
+    }
+
+    return [[NSString alloc] initWithBytes:segment->stringPool + string.offset length:string.length encoding:NSUTF8StringEncoding];
+}
+
+- (IMImojiObject *)imojiInSegment:(const IMImojiCollectionArchiveSegment *)segment record:(uint32_t)recordIndex {
+    const IMImojiCollectionArchiveRecord *record = &segment->records[recordIndex];
+    if ((uint64_t) record->firstTag + record->tagCount > segment->header.tagCount ||
+            (uint64_t) record->firstRendition + record->renditionCount > segment->header.renditionCount ||
+            record->renditionCount > IMImojiCollectionArchiveRenderingOptionsCount) {
+        return nil;
+    }
+
+    NSString *identifier = [self stringInSegment:segment string:record->identifier];
+    if (!identifier) {
+        return nil;
+    }
+
+    NSMutableArray *tags = [NSMutableArray arrayWithCapacity:record->tagCount];
+    for (uint32_t i = 0; i < record->tagCount; i++) {
+        NSString *tag = [self stringInSegment:segment string:segment->tags[record->firstTag + i]];
+        if (tag) {
+            [tags addObject:tag];
+        }
+    }
+
+    NSArray<IMImojiObjectRenderingOptions *> *renderingOptions = [IMImojiResponse renderingOptions];
+    NSNull *nullValue = [NSNull null];
+
+    __unsafe_unretained id urlKeys[IMImojiCollectionArchiveRenderingOptionsCount], dimensionKeys[IMImojiCollectionArchiveRenderingOptionsCount], fileSizeKeys[IMImojiCollectionArchiveRenderingOptionsCount];
+    id urls[IMImojiCollectionArchiveRenderingOptionsCount], dimensions[IMImojiCollectionArchiveRenderingOptionsCount], fileSizes[IMImojiCollectionArchiveRenderingOptionsCount];
+    NSUInteger urlCount = 0, dimensionCount = 0, fileSizeCount = 0;
+
+    for (uint32_t i = 0; i < record->renditionCount; i++) {
+        const IMImojiCollectionArchiveRendition *rendition = &segment->renditions[record->firstRendition + i];
+        if (rendition->renderingOptions >= renderingOptions.count) {
+            continue;
+        }
+
+        IMImojiObjectRenderingOptions *options = renderingOptions[rendition->renderingOptions];
+
+        if (rendition->flags & IMImojiCollectionArchiveRenditionHasURLKey) {
+            id url = nil;
+            if ((rendition->flags & IMImojiCollectionArchiveRenditionHasURL) && IMImojiCollectionArchiveStringIsValid(segment, rendition->url)) {
+                url = CFBridgingRelease(CFURLCreateWithBytes(kCFAllocatorDefault, (const UInt8 *) segment->stringPool + rendition->url.offset,
+                        rendition->url.length, kCFStringEncodingUTF8, NULL));
+            }
+
+            urlKeys[urlCount] = options;
+            urls[urlCount++] = url ?: nullValue;
+        }
+
+        if (rendition->flags & IMImojiCollectionArchiveRenditionHasDimensionsKey) {
+            dimensionKeys[dimensionCount] = options;
+            dimensions[dimensionCount++] = (rendition->flags & IMImojiCollectionArchiveRenditionHasDimensions) ?
+                    [NSValue valueWithCGSize:CGSizeMake(rendition->width, rendition->height)] : nullValue;
+        }
+
+        if (rendition->flags & IMImojiCollectionArchiveRenditionHasFileSizeKey) {
+            fileSizeKeys[fileSizeCount] = options;
+            fileSizes[fileSizeCount++] = (rendition->flags & IMImojiCollectionArchiveRenditionHasFileSize) ? @((long) rendition->fileSize) : nullValue;
+        }
+    }
+
+    return [IMMutableImojiObject imojiWithIdentifier:identifier
+                                                tags:tags
+                                                urls:[NSDictionary dictionaryWithObjects:urls forKeys:urlKeys count:urlCount]
+                                     imageDimensions:(record->flags & IMImojiCollectionArchiveRecordHasImageDimensions) ?
+                                             [NSDictionary dictionaryWithObjects:dimensions forKeys:dimensionKeys count:dimensionCount] : nil
+                                           fileSizes:(record->flags & IMImojiCollectionArchiveRecordHasFileSizes) ?
+                                                   [NSDictionary dictionaryWithObjects:fileSizes forKeys:fileSizeKeys count:fileSizeCount] : nil
+                                        licenseStyle:(IMImojiObjectLicenseStyle) record->licenseStyle];
+}
+
+#pragma mark Writing
+
+- (BOOL)appendImojis:(NSArray<IMImojiObject *> *)imojis error:(NSError **)error {
+    if (imojis.count == 0) {
+        return YES;
+    }
+
+    NSData *segment = [self segmentWithImojis:imojis error:error];
+    if (!segment) {
+        return NO;
+    }
+
+    pthread_rwlock_wrlock(&_lock);
+
+    // the segment is written past the end of the archive and only becomes part of it once the header is updated
+    IMImojiCollectionArchiveHeader header = _header;
+    header.length += segment.length;
+
+    BOOL appended = pwrite(_fileDescriptor, segment.bytes, segment.length, (off_t) _header.length) == (ssize_t) segment.length &&
+            pwrite(_fileDescriptor, &header, sizeof(header), 0) == sizeof(header);
+
+    if (!appended) {
+        if (error) {
+            *error = IMImojiCollectionArchivePOSIXError();
+        }
+    } else {
+        _header = header;
+        appended = [self mapWithError:error];
+
+        if (appended && _segments.length / sizeof(IMImojiCollectionArchiveSegment) > IMImojiCollectionArchiveMaximumSegmentCount) {
+            // lookups cost a binary search per segment, merging is best effort as the imojis are already stored
+            [self compactLockedWithError:nil];
+        }
+    }
+
+    pthread_rwlock_unlock(&_lock);
+    return appended;
+}
+
+- (BOOL)compactWithError:(NSError **)error {
+    pthread_rwlock_wrlock(&_lock);
+    BOOL compacted = [self compactLockedWithError:error];
+    pthread_rwlock_unlock(&_lock);
+
+    return compacted;
+}
+
+- (BOOL)compactLockedWithError:(NSError **)error {
+    const IMImojiCollectionArchiveSegment *segments = _segments.bytes;
+    NSUInteger segmentCount = _segments.length / sizeof(IMImojiCollectionArchiveSegment);
+    NSMutableArray<IMImojiObject *> *imojis = [NSMutableArray arrayWithCapacity:_count];
+
+    for (NSUInteger s = 0; s < segmentCount; s++) {
+        for (uint32_t i = 0; i < segments[s].header.recordCount; i++) {
+            IMImojiObject *imoji = [self imojiInSegment:&segments[s] record:i];
+            if (imoji) {
+                [imojis addObject:imoji];
+            }
+        }
+    }
+
+    return [self replaceLockedWithImojis:imojis error:error];
+}
+
+- (BOOL)replaceImojis:(NSArray<IMImojiObject *> *)imojis error:(NSError **)error {
+    pthread_rwlock_wrlock(&_lock);
+    BOOL replaced = [self replaceLockedWithImojis:imojis error:error];
+    pthread_rwlock_unlock(&_lock);
+
+    return replaced;
+}
+
+- (BOOL)replaceLockedWithImojis:(NSArray<IMImojiObject *> *)imojis error:(NSError **)error {
+    NSData *segment = imojis.count > 0 ? [self segmentWithImojis:imojis error:error] : [NSData data];
+    if (!segment) {
+        return NO;
+    }
+
+    IMImojiCollectionArchiveHeader header = {
+            .magic = IMImojiCollectionArchiveMagic,
+            .version = IMImojiCollectionArchiveVersion,
+            .length = sizeof(IMImojiCollectionArchiveHeader) + segment.length
+    };
+
+    NSMutableData *contents = [NSMutableData dataWithBytes:&header length:sizeof(header)];
+    [contents appendData:segment];
+
+    if (![contents writeToURL:self.fileURL options:NSDataWritingAtomic error:error]) {
+        return NO;
+    }
+
+    // the file was replaced, the descriptor still refers to the old one
+    return [self openWithError:error];
+}
+
+- (NSData *)segmentWithImojis:(NSArray<IMImojiObject *> *)imojis error:(NSError **)error {
+    NSArray<IMImojiObjectRenderingOptions *> *renderingOptions = [IMImojiResponse renderingOptions];
+    NSMutableData *renditions = [NSMutableData data];
+    NSMutableData *records = [NSMutableData dataWithCapacity:imojis.count * sizeof(IMImojiCollectionArchiveRecord)];
+    NSMutableData *tags = [NSMutableData data];
+    NSMutableData *stringPool = [NSMutableData data];
+    NSMutableDictionary<NSString *, NSNumber *> *stringOffsets = [NSMutableDictionary dictionary];
+
+    for (IMImojiObject *imoji in imojis) {
+        IMImojiCollectionArchiveRecord record = {
+                .identifier = IMImojiCollectionArchiveAppendString(stringPool, stringOffsets, imoji.identifier),
+                .firstTag = (uint32_t) (tags.length / sizeof(IMImojiCollectionArchiveString)),
+                .firstRendition = (uint32_t) (renditions.length / sizeof(IMImojiCollectionArchiveRendition)),
+                .licenseStyle = (uint32_t) imoji.licenseStyle,
+                .flags = (imoji.imageDimensions ? IMImojiCollectionArchiveRecordHasImageDimensions : 0) |
+                        (imoji.fileSizes ? IMImojiCollectionArchiveRecordHasFileSizes : 0)
+        };
+
+        for (id tag in imoji.tags) {
+            if ([tag isKindOfClass:[NSString class]] && record.tagCount < UINT16_MAX) {
+                IMImojiCollectionArchiveString string = IMImojiCollectionArchiveAppendString(stringPool, stringOffsets, tag);
+                [tags appendBytes:&string length:sizeof(string)];
+                record.tagCount++;
+            }
+        }
+
+        for (NSUInteger i = 0; i < renderingOptions.count; i++) {
+            IMImojiObjectRenderingOptions *options = renderingOptions[i];
+            id url = imoji.urls[options], dimensions = imoji.imageDimensions[options], fileSize = imoji.fileSizes[options];
+            if (!url && !dimensions && !fileSize) {
+                continue;
+            }
+
+            IMImojiCollectionArchiveRendition rendition = {.renderingOptions = (uint8_t) i};
+
+            if (url) {
+                rendition.flags |= IMImojiCollectionArchiveRenditionHasURLKey;
+                if ([url isKindOfClass:[NSURL class]]) {
+                    rendition.flags |= IMImojiCollectionArchiveRenditionHasURL;
+                    rendition.url = IMImojiCollectionArchiveAppendString(stringPool, stringOffsets, ((NSURL *) url).absoluteString);
+                }
+            }
+
+            if (dimensions) {
+                rendition.flags |= IMImojiCollectionArchiveRenditionHasDimensionsKey;
+                if ([dimensions isKindOfClass:[NSValue class]]) {
+                    CGSize size = [dimensions CGSizeValue];
+                    rendition.flags |= IMImojiCollectionArchiveRenditionHasDimensions;
+                    rendition.width = (float) size.width;
+                    rendition.height = (float) size.height;
+                }
+            }
+
+            if (fileSize) {
+                rendition.flags |= IMImojiCollectionArchiveRenditionHasFileSizeKey;
+                if ([fileSize isKindOfClass:[NSNumber class]]) {
+                    rendition.flags |= IMImojiCollectionArchiveRenditionHasFileSize;
+                    rendition.fileSize = [fileSize longLongValue];
+                }
+            }
+
+            [renditions appendBytes:&rendition length:sizeof(rendition)];
+            record.renditionCount++;
+        }
+
+        [records appendBytes:&record length:sizeof(record)];
+    }
+
+    // positions of the records ordered by identifier bytes, a stable sort keeps equal identifiers in append order
+    const IMImojiCollectionArchiveRecord *recordTable = records.bytes;
+    const char *stringBytes = stringPool.bytes;
+    NSMutableArray<NSNumber *> *positions = [NSMutableArray arrayWithCapacity:imojis.count];
+    for (uint32_t i = 0; i < imojis.count; i++) {
+        [positions addObject:@(i)];
+    }
+
+    [positions sortWithOptions:NSSortStable usingComparator:^NSComparisonResult(NSNumber *position, NSNumber *otherPosition) {
+        IMImojiCollectionArchiveString identifier = recordTable[position.unsignedIntValue].identifier;
+        IMImojiCollectionArchiveString otherIdentifier = recordTable[otherPosition.unsignedIntValue].identifier;
+
+        return IMImojiCollectionArchiveCompareBytes(stringBytes + identifier.offset, identifier.length,
+                stringBytes + otherIdentifier.offset, otherIdentifier.length);
+    }];
+
+    IMImojiCollectionArchiveSegmentHeader header = {
+            .recordCount = (uint32_t) imojis.count,
+            .renditionCount = (uint32_t) (renditions.length / sizeof(IMImojiCollectionArchiveRendition)),
+            .tagCount = (uint32_t) (tags.length / sizeof(IMImojiCollectionArchiveString)),
+            .stringPoolLength = (uint32_t) stringPool.length
+    };
+
+    // segments start at multiples of 8 so the tables are aligned when mapped
+    uint64_t contentLength = IMImojiCollectionArchiveSegmentContentLength(&header);
+    uint64_t length = (contentLength + 7) & ~(uint64_t) 7;
+    if (length > UINT32_MAX || stringPool.length > UINT32_MAX) {
+        if (error) {
+            *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EFBIG userInfo:nil];
+        }
+
+        return nil;
+    }
+
+    header.length = (uint32_t) length;
+
+    NSMutableData *segment = [NSMutableData dataWithCapacity:(NSUInteger) length];
+    [segment appendBytes:&header length:sizeof(header)];
+    [segment appendData:renditions];
+    [segment appendData:records];
+    [segment appendData:tags];
+    for (NSNumber *position in positions) {
+        uint32_t value = position.unsignedIntValue;
+        [segment appendBytes:&value length:sizeof(value)];
+    }
+    [segment appendData:stringPool];
+    [segment increaseLengthBy:(NSUInteger) (length - contentLength)];
+
+    return segment;
+}
+
+#pragma mark File
+
+- (BOOL)openWithError:(NSError **)error {
+    [self closeFile];
+
+    [[NSFileManager defaultManager] createDirectoryAtURL:[self.fileURL URLByDeletingLastPathComponent]
+                             withIntermediateDirectories:YES
+                                              attributes:nil
+                                                   error:nil];
+
+    _fileDescriptor = open(self.fileURL.fileSystemRepresentation, O_RDWR | O_CREAT, 0644);
+    struct stat fileStatus;
+    if (_fileDescriptor < 0 || fstat(_fileDescriptor, &fileStatus) != 0) {
+        if (error) {
+            *error = IMImojiCollectionArchivePOSIXError();
+        }
+
+        return NO;
+    }
+
+    if (fileStatus.st_size == 0) {
+        _header = (IMImojiCollectionArchiveHeader) {
+                .magic = IMImojiCollectionArchiveMagic,
+                .version = IMImojiCollectionArchiveVersion,
+                .length = sizeof(IMImojiCollectionArchiveHeader)
+        };
+
+        if (pwrite(_fileDescriptor, &_header, sizeof(_header), 0) != sizeof(_header)) {
+            if (error) {
+                *error = IMImojiCollectionArchivePOSIXError();
+            }
+
+            return NO;
+        }
+    } else if (pread(_fileDescriptor, &_header, sizeof(_header), 0) != sizeof(_header) ||
+            _header.magic != IMImojiCollectionArchiveMagic ||
+            _header.version != IMImojiCollectionArchiveVersion ||
+            _header.length < sizeof(_header) ||
+            _header.length > (uint64_t) fileStatus.st_size) {
+        if (error) {
+            *error = [NSError errorWithDomain:NSCocoaErrorDomain
+                                         code:NSFileReadCorruptFileError
+                                     userInfo:@{
+                                             NSURLErrorKey : self.fileURL,
+                                             NSLocalizedDescriptionKey : @"not an imoji collection archive or written by an unsupported version"
+                                     }];
+        }
+
+        return NO;
+    }
+
+    return [self mapWithError:error];
+}
+
+// maps the complete segments and reads their headers, a damaged segment ends the archive and is overwritten by the next append
+- (BOOL)mapWithError:(NSError **)error {
+    if (_bytes) {
+        munmap((void *) _bytes, _mappedLength);
+        _bytes = NULL;
+    }
+
+    void *bytes = mmap(NULL, (size_t) _header.length, PROT_READ, MAP_SHARED, _fileDescriptor, 0);
+    if (bytes == MAP_FAILED) {
+        if (error) {
+            *error = IMImojiCollectionArchivePOSIXError();
+        }
+
+        return NO;
+    }
+
+    _bytes = bytes;
+    _mappedLength = (size_t) _header.length;
+    _segments.length = 0;
+    _count = 0;
+
+    uint64_t offset = sizeof(IMImojiCollectionArchiveHeader);
+    while (offset + sizeof(IMImojiCollectionArchiveSegmentHeader) <= _header.length) {
+        IMImojiCollectionArchiveSegment segment = {.offset = offset, .firstIndex = _count};
+        memcpy(&segment.header, _bytes + offset, sizeof(segment.header));
+
+        if (segment.header.length < IMImojiCollectionArchiveSegmentContentLength(&segment.header) ||
+                segment.header.length % 8 != 0 ||
+                offset + segment.header.length > _header.length) {
+            break;
+        }
+
+        const uint8_t *table = _bytes + offset + sizeof(IMImojiCollectionArchiveSegmentHeader);
+        segment.renditions = (const IMImojiCollectionArchiveRendition *) table;
+        table += segment.header.renditionCount * sizeof(IMImojiCollectionArchiveRendition);
+        segment.records = (const IMImojiCollectionArchiveRecord *) table;
+        table += segment.header.recordCount * sizeof(IMImojiCollectionArchiveRecord);
+        segment.tags = (const IMImojiCollectionArchiveString *) table;
+        table += segment.header.tagCount * sizeof(IMImojiCollectionArchiveString);
+        segment.index = (const uint32_t *) table;
+        table += segment.header.recordCount * sizeof(uint32_t);
+        segment.stringPool = (const char *) table;
+
+        [_segments appendBytes:&segment length:sizeof(segment)];
+        _count += segment.header.recordCount;
+        offset += segment.header.length;
+    }
+
+    _header.length = offset;
+    return YES;
+}
+
+- (void)closeFile {
+    if (_bytes) {
+        munmap((void *) _bytes, _mappedLength);
+        _bytes = NULL;
+    }
+
+    if (_fileDescriptor >= 0) {
+        close(_fileDescriptor);
+        _fileDescriptor = -1;
+    }
+
+    _segments.length = 0;
+    _count = 0;
+}
+
+@end
@@ -0,0 +1,135 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+* @abstract Queue depth of an IMImojiExecutor at the time statistics was called
+*/
+@interface IMImojiExecutorStatistics : NSObject
+
+/**
+* @abstract Blocks waiting for one of the executor's slots
+*/
+@property(nonatomic, readonly) NSUInteger pendingCount;
+
+/**
+* @abstract Blocks currently running, at most the executor's width
+*/
+@property(nonatomic, readonly) NSUInteger runningCount;
+
+/**
+* @abstract Largest number of blocks that were waiting at once
+*/
+@property(nonatomic, readonly) NSUInteger peakPendingCount;
+
+@property(nonatomic, readonly) NSUInteger completedCount;
+
+/**
+* @abstract Average time in seconds completed blocks waited before they started
+*/
+@property(nonatomic, readonly) NSTimeInterval averageQueueWait;
+
+@end
+
+/**
+* @abstract Runs blocks at a fixed quality of service with at most width of them at a time, the others wait in the order
+* they were submitted. Waiting blocks do not hold a thread.
+*/
+@interface IMImojiExecutor : NSObject
+
+@property(nonatomic, readonly, nonnull) NSString *name;
+
+/**
+* @abstract Quality of service of the threads running the blocks. On iOS 7 it is mapped to the closest dispatch queue
+* priority.
+*/
+@property(nonatomic, readonly) NSQualityOfService qualityOfService;
+
+/**
+* @abstract Maximum number of blocks running at once
+*/
+@property(nonatomic, readonly) NSUInteger width;
+
+/**
+* @abstract Creates an executor
+* @param name Label of the underlying dispatch queue, shown in debuggers and crash reports
+* @param qualityOfService Quality of service to run blocks at
+* @param width Maximum number of blocks running at once, at least 1
+*/
++ (nonnull instancetype)executorWithName:(nonnull NSString *)name
+                        qualityOfService:(NSQualityOfService)qualityOfService
+                                   width:(NSUInteger)width;
+
+/**
+* @abstract Runs block asynchronously once a slot is free
+*/
+- (void)execute:(nonnull dispatch_block_t)block;
+
+- (nonnull IMImojiExecutorStatistics *)statistics;
+
+@end
+
+/**
+* @abstract The executors an IMImojiSession runs its background work on, separated by the kind of work so that a burst of
+* one does not delay the others
+*/
+@interface IMImojiExecutors : NSObject
+
+/**
+* @abstract Handles API responses, parsing their JSON and building models, and starts image downloads.
+* Defaults to 4 blocks at NSQualityOfServiceUserInitiated.
+*/
+@property(nonatomic, readonly, nonnull) IMImojiExecutor *networkExecutor;
+
+/**
+* @abstract Decodes downloaded images and encodes PNGs for local imojis and uploads. Defaults to one block per active
+* processor at NSQualityOfServiceUserInitiated.
+*/
+@property(nonatomic, readonly, nonnull) IMImojiExecutor *imageExecutor;
+
+/**
+* @abstract Writes upload files and sticker artifacts and reads them back. Defaults to 2 blocks at
+* NSQualityOfServiceUtility.
+*/
+@property(nonatomic, readonly, nonnull) IMImojiExecutor *diskExecutor;
+
+/**
+* @abstract Prepares sessions and validates or renews credentials. Runs one block at a time at
+* NSQualityOfServiceUserInitiated by default so that credential checks are never queued behind content work.
+*/
+@property(nonatomic, readonly, nonnull) IMImojiExecutor *controlExecutor;
+
+/**
+* @abstract Executors shared by every session that was not given its own
+*/
++ (nonnull instancetype)defaultExecutors;
+
+- (nonnull instancetype)initWithNetworkExecutor:(nonnull IMImojiExecutor *)networkExecutor
+                                  imageExecutor:(nonnull IMImojiExecutor *)imageExecutor
+                                   diskExecutor:(nonnull IMImojiExecutor *)diskExecutor
+                                controlExecutor:(nonnull IMImojiExecutor *)controlExecutor;
+
+@end
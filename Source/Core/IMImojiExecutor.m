@@ -0,0 +1,216 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import "IMImojiExecutor.h"
+#import "IMMetricsRecorder.h"
+
+static const NSUInteger IMImojiExecutorsNetworkWidth = 4;
+static const NSUInteger IMImojiExecutorsDiskWidth = 2;
+static const NSUInteger IMImojiExecutorsControlWidth = 1;
+
+static qos_class_t IMImojiExecutorQOSClass(NSQualityOfService qualityOfService) {
+    switch (qualityOfService) {
+        case NSQualityOfServiceUserInteractive:
+            return QOS_CLASS_USER_INTERACTIVE;
+        case NSQualityOfServiceUserInitiated:
+            return QOS_CLASS_USER_INITIATED;
+        case NSQualityOfServiceUtility:
+            return QOS_CLASS_UTILITY;
+        case NSQualityOfServiceBackground:
+            return QOS_CLASS_BACKGROUND;
+        default:
+            return QOS_CLASS_DEFAULT;
+    }
+}
+
+static long IMImojiExecutorQueuePriority(NSQualityOfService qualityOfService) {
+    switch (qualityOfService) {
+        case NSQualityOfServiceUserInteractive:
+        case NSQualityOfServiceUserInitiated:
+            return DISPATCH_QUEUE_PRIORITY_HIGH;
+        case NSQualityOfServiceUtility:
+            return DISPATCH_QUEUE_PRIORITY_LOW;
+        case NSQualityOfServiceBackground:
+            return DISPATCH_QUEUE_PRIORITY_BACKGROUND;
+        default:
+            return DISPATCH_QUEUE_PRIORITY_DEFAULT;
+    }
+}
+
+@interface IMImojiExecutorStatistics ()
+
+@property(nonatomic, readwrite) NSUInteger pendingCount;
+@property(nonatomic, readwrite) NSUInteger runningCount;
+@property(nonatomic, readwrite) NSUInteger peakPendingCount;
+@property(nonatomic, readwrite) NSUInteger completedCount;
+@property(nonatomic, readwrite) NSTimeInterval averageQueueWait;
+
+@end
+
+@implementation IMImojiExecutorStatistics
+@end
+
+@implementation IMImojiExecutor {
+    dispatch_queue_t _queue;
+
+    // blocks waiting for a slot, oldest first
+    NSMutableArray<dispatch_block_t> *_pendingBlocks;
+    NSUInteger _runningCount;
+    NSUInteger _peakPendingCount;
+    NSUInteger _completedCount;
+    uint64_t _totalQueueWait;
+}
+
+- (instancetype)initWithName:(NSString *)name qualityOfService:(NSQualityOfService)qualityOfService width:(NSUInteger)width {
+    self = [super init];
+    if (self) {
+        _name = [name copy];
+        _qualityOfService = qualityOfService;
+        _width = MAX(width, 1);
+        _pendingBlocks = [NSMutableArray array];
+
+        // quality of service classes are only available on iOS 8 and above
+        if (&dispatch_queue_attr_make_with_qos_class != NULL) {
+            _queue = dispatch_queue_create(name.UTF8String, dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_CONCURRENT, IMImojiExecutorQOSClass(qualityOfService), 0));
+        } else {
+            _queue = dispatch_queue_create(name.UTF8String, DISPATCH_QUEUE_CONCURRENT);
+            dispatch_set_target_queue(_queue, dispatch_get_global_queue(IMImojiExecutorQueuePriority(qualityOfService), 0));
+        }
+    }
+
+    return self;
+}
+
++ (instancetype)executorWithName:(NSString *)name qualityOfService:(NSQualityOfService)qualityOfService width:(NSUInteger)width {
+    return [[IMImojiExecutor alloc] initWithName:name qualityOfService:qualityOfService width:width];
+}
+
+- (void)execute:(dispatch_block_t)block {
+    uint64_t enqueueTime = IMMetricsTimestamp();
+    dispatch_block_t timedBlock = ^{
+        uint64_t queueWait = IMMetricsTimestamp() - enqueueTime;
+        @synchronized (self) {
+            self->_totalQueueWait += queueWait;
+        }
+
+        block();
+    };
+
+    BOOL startsRunner;
+    @synchronized (self) {
+        startsRunner = _runningCount < _width;
+
+        if (startsRunner) {
+            _runningCount++;
+        } else {
+            [_pendingBlocks addObject:timedBlock];
+            _peakPendingCount = MAX(_peakPendingCount, _pendingBlocks.count);
+        }
+    }
+
+    if (startsRunner) {
+        dispatch_async(_queue, ^{
+            [self runBlock:timedBlock];
+        });
+    }
+}
+
+// runs block then the pending ones on the same thread until none are left, each runner holds one of the width slots
+- (void)runBlock:(dispatch_block_t)block {
+    while (block) {
+        @autoreleasepool {
+            block();
+        }
+
+        @synchronized (self) {
+            _completedCount++;
+
+            if (_pendingBlocks.count > 0) {
+                block = _pendingBlocks.firstObject;
+                [_pendingBlocks removeObjectAtIndex:0];
+            } else {
+                block = nil;
+                _runningCount--;
+            }
+        }
+    }
+}
+
+- (IMImojiExecutorStatistics *)statistics {
+    IMImojiExecutorStatistics *statistics = [IMImojiExecutorStatistics new];
+
+    @synchronized (self) {
+        statistics.pendingCount = _pendingBlocks.count;
+        statistics.runningCount = _runningCount;
+        statistics.peakPendingCount = _peakPendingCount;
+        statistics.completedCount = _completedCount;
+        statistics.averageQueueWait = _completedCount > 0 ? _totalQueueWait / (double) _completedCount / USEC_PER_SEC : 0;
+    }
+
+    return statistics;
+}
+
+@end
+
+@implementation IMImojiExecutors
+
+- (instancetype)initWithNetworkExecutor:(IMImojiExecutor *)networkExecutor
+                          imageExecutor:(IMImojiExecutor *)imageExecutor
+                           diskExecutor:(IMImojiExecutor *)diskExecutor
+                        controlExecutor:(IMImojiExecutor *)controlExecutor {
+    self = [super init];
+    if (self) {
+        _networkExecutor = networkExecutor;
+        _imageExecutor = imageExecutor;
+        _diskExecutor = diskExecutor;
+        _controlExecutor = controlExecutor;
+    }
+
+    return self;
+}
+
++ (instancetype)defaultExecutors {
+    static IMImojiExecutors *defaultExecutors = nil;
+    static dispatch_once_t predicate;
+
+    dispatch_once(&predicate, ^{
+        defaultExecutors = [[IMImojiExecutors alloc] initWithNetworkExecutor:[IMImojiExecutor executorWithName:@"com.imoji.executor.network"
+                                                                                                qualityOfService:NSQualityOfServiceUserInitiated
+                                                                                                           width:IMImojiExecutorsNetworkWidth]
+                                                                imageExecutor:[IMImojiExecutor executorWithName:@"com.imoji.executor.image"
+                                                                                                qualityOfService:NSQualityOfServiceUserInitiated
+                                                                                                           width:[NSProcessInfo processInfo].activeProcessorCount]
+                                                                 diskExecutor:[IMImojiExecutor executorWithName:@"com.imoji.executor.disk"
+                                                                                                qualityOfService:NSQualityOfServiceUtility
+                                                                                                           width:IMImojiExecutorsDiskWidth]
+                                                              controlExecutor:[IMImojiExecutor executorWithName:@"com.imoji.executor.control"
+                                                                                                qualityOfService:NSQualityOfServiceUserInitiated
+                                                                                                           width:IMImojiExecutorsControlWidth]];
+    });
+
+    return defaultExecutors;
+}
+
+@end
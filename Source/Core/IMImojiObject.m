@@ -26,6 +26,7 @@
 #import <CoreGraphics/CoreGraphics.h>
 #import <UIKit/UIKit.h>
 #import "IMImojiObject.h"
+#import "ImojiSDKConstants.h"
 
 @implementation IMImojiObject {
 
@@ -197,7 +198,7 @@
 
 - (nonnull NSURL *)generateImageUrlWithRenderingOptions:(nonnull IMImojiObjectRenderingOptions *)renderingOptions {
     NSMutableString *urlString = [NSMutableString string];
-    [urlString appendFormat:@"https://render.imoji.io/%@/%@/", [self.identifier substringToIndex:3], self.identifier];
+    [urlString appendFormat:@"%@/%@/%@/", ImojiSDKRenderServerURL, [self.identifier substringToIndex:3], self.identifier];
     if (renderingOptions.renderAnimatedIfSupported && self.supportsAnimation) {
         [urlString appendString:@"animated-"];
     } else if (renderingOptions.borderStyle == IMImojiObjectBorderStyleNone) {
@@ -149,6 +149,14 @@ typedef NS_ENUM(NSUInteger, IMImojiObjectImageFormat) {
  */
 @property(nonatomic, strong, nullable) NSNumber *maximumFileSize;
 
+/**
+* @abstract When set, IMImojiSession adapts the rendition to the measured download speed of the render server. The
+* highest quality rendition expected to download within this many seconds is chosen, with renderSize, imageFormat and
+* renderAnimatedIfSupported as the upper bound. Smaller sizes, WebP and static renditions are used in that order as
+* the connection gets slower. Ignored when targetSize or aspectRatio are set.
+*/
+@property(nonatomic, strong, nullable) NSNumber *targetDownloadDuration;
+
 /**
  * @abstract Creates rendering options for animated content.
  * @return A rendering option instance suitable for displaying animated content.
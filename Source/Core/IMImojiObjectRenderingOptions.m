@@ -39,6 +39,7 @@
         self.imageFormat = (IMImojiObjectImageFormat) [coder decodeIntForKey:@"imageFormat"];
         self.renderAnimatedIfSupported = [coder decodeBoolForKey:@"renderAnimatedIfSupported"];
         self.maximumFileSize = [coder decodeObjectForKey:@"maximumFileSize"];
+        self.targetDownloadDuration = [coder decodeObjectForKey:@"targetDownloadDuration"];
     }
 
     return self;
@@ -52,6 +53,7 @@
     [coder encodeInt:self.imageFormat forKey:@"imageFormat"];
     [coder encodeBool:self.renderAnimatedIfSupported forKey:@"renderAnimatedIfSupported"];
     [coder encodeObject:self.maximumFileSize forKey:@"maximumFileSize"];
+    [coder encodeObject:self.targetDownloadDuration forKey:@"targetDownloadDuration"];
 }
 
 - (instancetype)init {
@@ -108,6 +110,8 @@
         return NO;
     if (self.maximumFileSize != options.maximumFileSize)
         return NO;
+    if (self.targetDownloadDuration != options.targetDownloadDuration && ![self.targetDownloadDuration isEqualToNumber:options.targetDownloadDuration])
+        return NO;
     return YES;
 }
 
@@ -119,6 +123,7 @@
     hash = hash * 31u + (NSUInteger) self.imageFormat;
     hash = hash * 31u + (NSUInteger) self.renderAnimatedIfSupported;
     hash = hash * 31u + [self.maximumFileSize hash];
+    hash = hash * 31u + [self.targetDownloadDuration hash];
     return hash;
 }
 
@@ -133,6 +138,7 @@
         copy.imageFormat = self.imageFormat;
         copy.renderAnimatedIfSupported = self.renderAnimatedIfSupported;
         copy.maximumFileSize = self.maximumFileSize;
+        copy.targetDownloadDuration = self.targetDownloadDuration;
     }
 
     return copy;
@@ -30,8 +30,22 @@
 #import "IMImojiResultSetMetadata.h"
 
 @class IMImojiObject, IMImojiSessionStoragePolicy;
+@class IMImojiAtlas;
 @protocol IMImojiSessionDelegate;
 @class IMCategoryFetchOptions;
+@class IMStickerArtifactStore;
+@class IMMutationOutbox;
+@class IMAnalyticsPipeline;
+@class IMMetricsRecorder;
+@class IMContentSnapshotStore;
+@class IMUserCollectionMirror;
+@class IMAttributionCache;
+@class IMSharedResources;
+@class IMSharedPersistentResources;
+@class IMImojiSessionMetrics;
+@class IMImojiExecutors;
+@class BFTask;
+@protocol IMImojiTransport;
 
 /**
 * @abstract The error domain used within NSError objects generated by IMImojiSession
@@ -92,7 +106,12 @@ typedef NS_ENUM(NSUInteger, IMImojiSessionErrorCode) {
     /**
     * @abstract Used when IMImojiSession is unable to render the IMImojiObject
     */
-            IMImojiSessionErrorCodeImojiRenderingUnavailable
+            IMImojiSessionErrorCodeImojiRenderingUnavailable,
+    /**
+    * @abstract Used when an Imoji creation failed with an error that may not happen again, such as a lost connection
+    * or a server error. The upload is completed in the background
+    */
+            IMImojiSessionErrorCodeCreationDeferred
 };
 
 /**
@@ -148,6 +167,26 @@ typedef NS_ENUM(NSUInteger, IMImojiCollectionType) {
             IMImojiCollectionTypeAll
 };
 
+/**
+* @abstract Content to load while prewarming a session
+*/
+typedef NS_OPTIONS(NSUInteger, IMImojiSessionPrewarmOptions) {
+    /**
+    * @abstract Only authenticate and open connections
+    */
+            IMImojiSessionPrewarmOptionsNone = 0,
+
+    /**
+    * @abstract Loads the featured imojis list
+    */
+            IMImojiSessionPrewarmOptionsFeatured = 1 << 0,
+
+    /**
+    * @abstract Loads the trending and generic category lists
+    */
+            IMImojiSessionPrewarmOptionsCategories = 1 << 1
+};
+
 /**
 * @abstract Callback used for triggering when the server has loaded a result set
 * @param metadata Result set metadata for the request.
@@ -213,11 +252,36 @@ typedef void (^IMImojiSessionMSStickerResponseCallback)(NSObject *__nullable msS
 */
 typedef void (^IMImojiSessionImojiAttributionResponseCallback)(NSDictionary *__nullable attribution, NSError *__nullable error);
 
+/**
+* @abstract Callback used for rendering imojis into an IMImojiAtlas.
+* @param atlas The atlas rendered into
+* @param drawnIndexes Indexes of the cells drawn since the previous callback
+* @param finished YES once every imoji was drawn or failed to render
+* @param error The last error of the imojis that failed to render since the previous callback, their cells are left empty
+*/
+typedef void (^IMImojiSessionAtlasResponseCallback)(IMImojiAtlas *__nonnull atlas, NSIndexSet *__nonnull drawnIndexes, BOOL finished, NSError *__nullable error);
+
 
 @interface IMImojiSession : NSObject {
 @private
     IMImojiSessionState _sessionState;
-    NSURLSession *_urlSession;
+    id <IMImojiTransport> _transport;
+    IMSharedResources *_sharedResources;
+    IMSharedPersistentResources *_persistentResources;
+    IMStickerArtifactStore *_stickerArtifactStore;
+    IMMutationOutbox *_mutationOutbox;
+    IMAnalyticsPipeline *_analyticsPipeline;
+    IMMetricsRecorder *_metricsRecorder;
+    BOOL _tracingEnabled;
+    uint32_t _traceIdentifier;
+    NSMutableDictionary *_requestTemplates;
+    IMContentSnapshotStore *_contentSnapshotStore;
+    BOOL _contentSnapshotsEnabled;
+    IMUserCollectionMirror *_collectionMirror;
+    BOOL _collectionMirrorEnabled;
+    IMAttributionCache *_attributionCache;
+    IMImojiExecutors *_executors;
+    BFTask *_readinessTask;
 }
 
 /**
@@ -226,6 +290,15 @@ typedef void (^IMImojiSessionImojiAttributionResponseCallback)(NSDictionary *__n
 */
 - (nonnull instancetype)initWithStoragePolicy:(nonnull IMImojiSessionStoragePolicy *)storagePolicy;
 
+/**
+* @abstract Creates a imoji session object that performs its requests with a custom transport.
+* @param storagePolicy The storage policy to use for persisting imojis.
+* @param transport Transport used for all API requests, image downloads and uploads. IMLoopbackTransport serves canned
+* responses without network access.
+*/
+- (nonnull instancetype)initWithStoragePolicy:(nonnull IMImojiSessionStoragePolicy *)storagePolicy
+                                    transport:(nonnull id <IMImojiTransport>)transport;
+
 /**
 * @abstract Creates a imoji session object with a default temporary file system storage policy.
 */
@@ -237,6 +310,14 @@ typedef void (^IMImojiSessionImojiAttributionResponseCallback)(NSDictionary *__n
 */
 + (nonnull instancetype)imojiSessionWithStoragePolicy:(nonnull IMImojiSessionStoragePolicy *)storagePolicy;
 
+/**
+* @abstract Creates a imoji session object that performs its requests with a custom transport.
+* @param storagePolicy The storage policy to use for persisting imojis.
+* @param transport Transport used for all API requests, image downloads and uploads.
+*/
++ (nonnull instancetype)imojiSessionWithStoragePolicy:(nonnull IMImojiSessionStoragePolicy *)storagePolicy
+                                            transport:(nonnull id <IMImojiTransport>)transport;
+
 /**
 * @abstract The current state of the session
 */
@@ -252,6 +333,17 @@ typedef void (^IMImojiSessionImojiAttributionResponseCallback)(NSDictionary *__n
  */
 @property(nonatomic, readonly, nonnull) IMImojiSessionStoragePolicy *storagePolicy;
 
+/**
+* @abstract Prepares the session ahead of its first request by loading and validating credentials (refreshing them if
+* needed) and opening connections to the API and image hosts. Optionally loads content into the content snapshots so the
+* first fetch is answered right away when contentSnapshotsEnabled is set. All requests run at low priority. Useful to call at launch or when a keyboard is presented.
+* @param options Content to load in addition to authenticating
+* @param callback Optional callback triggered on the main thread once prewarming is done. Not called if cancelled.
+* @return An operation reference that can be used to cancel prewarming.
+*/
+- (nonnull NSOperation *)prewarmWithOptions:(IMImojiSessionPrewarmOptions)options
+                                   callback:(nullable IMImojiSessionAsyncResponseCallback)callback;
+
 @end
 
 /**
@@ -388,6 +480,22 @@ typedef void (^IMImojiSessionImojiAttributionResponseCallback)(NSDictionary *__n
 - (nonnull NSOperation *)renderImojiAsMSSticker:(nonnull IMImojiObject *)imoji
                                         options:(nonnull IMImojiObjectRenderingOptions *)options
                                        callback:(nonnull IMImojiSessionMSStickerResponseCallback)callback;
+
+/**
+* @abstract Renders a page of imojis into the cells of an atlas, replacing the page it held. Imojis are downloaded in
+* parallel and decoded straight into their cell off the main thread as they arrive, cells drawn before the main thread
+* picks up the previous ones are reported in a single callback. Atlases hold still images, animations are not
+* downloaded.
+* @param imojis The imojis to render, at most atlas.capacity.
+* @param atlas The atlas to render into. Rendering another page into it drops the draws still pending for this one.
+* @param options Set of options to render the imojis with, typically IMImojiObjectRenderSizeThumbnail.
+* @param callback Called on the main thread whenever cells were drawn.
+* @return An operation reference that can be used to cancel the request.
+*/
+- (nonnull NSOperation *)renderImojis:(nonnull NSArray<IMImojiObject *> *)imojis
+                            intoAtlas:(nonnull IMImojiAtlas *)atlas
+                              options:(nonnull IMImojiObjectRenderingOptions *)options
+                             callback:(nonnull IMImojiSessionAtlasResponseCallback)callback;
 @end
 
 @interface IMImojiSession (CollectionManagement)
@@ -435,7 +543,9 @@ typedef void (^IMImojiSessionImojiAttributionResponseCallback)(NSDictionary *__n
  * @param tags An array of NSString tags or nil if there are none
  * @param beginUploadCallback Called once the uploading of the image has started. A temporary Imoji is passed back
  * to the caller which can be used as a filler while the upload is taking place.
- * @param finishUploadCallback Called once the save operation is complete
+ * @param finishUploadCallback Called once the save operation is complete. Called with an
+ * IMImojiSessionErrorCodeCreationDeferred error when the server could not be reached or failed, the upload is then completed in
+ * the background and the temporary Imoji remains valid. Not called when the operation is cancelled.
  * @return An operation reference that can be used to cancel the request.
  */
 - (nonnull NSOperation *)createImojiWithRawImage:(nonnull UIImage *)image
@@ -477,6 +587,7 @@ typedef void (^IMImojiSessionImojiAttributionResponseCallback)(NSDictionary *__n
  * @param imojiIdentifier ID of the Imoji object to register for usage
  * @param originIdentifier Optional arbitrary identifier which developers can supply describing the action that
  * triggered the usage. String must be less than or equal to 40 characters.
+ * @discussion Usage events are spooled to disk and sent in batches in the background.
  */
 - (void)markImojiUsageWithIdentifier:(nonnull NSString *)imojiIdentifier
                     originIdentifier:(nullable NSString *)originIdentifier;
@@ -487,6 +598,7 @@ typedef void (^IMImojiSessionImojiAttributionResponseCallback)(NSDictionary *__n
  * @param latitude Optional latitude value for the users location
  * @param longitude Optional longitude value for the users location
  * @param dateOfBirth Optional date of birth value for the user
+ * @discussion Repeated calls are merged, only the latest value of each field is sent.
  */
 - (void)setUserDemographicsData:(nullable NSString *)gender
                        latitute:(nullable NSNumber *)latitude
@@ -499,15 +611,99 @@ typedef void (^IMImojiSessionImojiAttributionResponseCallback)(NSDictionary *__n
 @interface IMImojiSession (Attribution)
 
 /**
-* @abstract Gets attribution information for a set of IMImoji identifiers.
+* @abstract Gets attribution information for a set of IMImoji identifiers. Attribution is cached for an hour, only
+* identifiers that are not cached are requested, in batches of 50 sent concurrently.
 * @param imojiObjectIdentifiers An array of NSString's representing the identifiers of the imojis to fetch.
-* @param callback Callback triggered with attribution results when available.
+* @param callback Callback triggered with attribution results when available, synchronously if every identifier was
+* cached and the call was made on the main thread.
 * @return An operation reference that can be used to cancel the request.
 */
 - (nonnull NSOperation *)fetchAttributionByImojiIdentifiers:(nonnull NSArray *)imojiObjectIdentifiers
                                                    callback:(nonnull IMImojiSessionImojiAttributionResponseCallback)callback;
 
 
+@end
+
+@interface IMImojiSession (Metrics)
+
+/**
+* @abstract Returns a copy of the metrics collected since the session was created or resetMetrics was last called:
+* request latency, errors, retries and bytes per endpoint, durations of processing phases and cache hit ratios.
+* @discussion Connection phase timings and URL cache usage are only collected on iOS 10 and above when the session
+* uses the default transport.
+*/
+- (nonnull IMImojiSessionMetrics *)metricsSnapshot;
+
+/**
+* @abstract Clears all collected metrics
+*/
+- (void)resetMetrics;
+
+@end
+
+@interface IMImojiSession (Tracing)
+
+/**
+* @abstract When enabled, fetch and render calls record when each of their stages was queued, started and finished,
+* including token validation, network requests, image decoding and main thread callbacks. Disabled by default.
+* @discussion Records are kept in fixed size per-thread buffers, the oldest are overwritten as new ones are written.
+*/
+@property(nonatomic, getter=isTracingEnabled) BOOL tracingEnabled;
+
+/**
+* @abstract Exports the recorded stages of this session in the Chrome trace event format, which can be loaded in
+* chrome://tracing or Perfetto. Each call is an async span with its stages and queue waits nested under it.
+*/
+- (nonnull NSData *)traceData;
+
+@end
+
+@interface IMImojiSession (ContentSnapshots)
+
+/**
+* @abstract When enabled, the last featured imojis and categories fetched with each set of parameters are kept on disk
+* under the storage policy's cache path. Later requests, including the first ones of a new session, are answered right
+* away from that snapshot (synchronously when made on the main thread) while the content is refreshed in the
+* background. Callbacks are triggered a second time only if the refreshed content differs from the snapshot, request
+* errors are not reported once a snapshot was served. Disabled by default.
+*/
+@property(nonatomic) BOOL contentSnapshotsEnabled;
+
+/**
+* @abstract Removes all stored snapshots
+*/
+- (void)removeContentSnapshots;
+
+@end
+
+@interface IMImojiSession (CollectionMirror)
+
+/**
+* @abstract When enabled, each IMImojiCollectionType fetched with fetchCollectedImojisWithType: is kept on disk under
+* the storage policy's persistent path. Later fetches, including the first ones of a new session, are answered right away
+* from that copy (synchronously when made on the main thread) while the collection is reconciled with the server in the
+* background, callbacks are triggered a second time only if an imoji was added, removed or moved. addImojiToUserCollection:
+* and removeImoji: update the copy before their requests are sent. Disabled by default.
+*/
+@property(nonatomic) BOOL collectionMirrorEnabled;
+
+/**
+* @abstract Removes the local copy of every collection
+*/
+- (void)removeCollectionMirror;
+
+@end
+
+@interface IMImojiSession (Executors)
+
+/**
+* @abstract Executors the session runs its background work on: network responses, image decoding and encoding, file
+* access and credential validation each have their own so that a burst of one does not delay the others. Defaults to
+* [IMImojiExecutors defaultExecutors], which is shared with the other sessions. Work already submitted completes on
+* the executors it was submitted to.
+*/
+@property(nonatomic, strong, nonnull) IMImojiExecutors *executors;
+
 @end
 
 /**
@@ -27,15 +27,29 @@
 #import <Bolts/BFTask.h>
 #import <Bolts/BFExecutor.h>
 #import <MobileCoreServices/MobileCoreServices.h>
-#import <ImageIO/ImageIO.h>
 #import <YYImage_MagicNarwhal/YYImage.h>
 #import "ImojiSDK.h"
 #import "NSDictionary+Utils.h"
+#import "NSError+Utils.h"
 #import "IMMutableImojiObject.h"
 #import "UIImage+Extensions.h"
 #import "IMImojiSession+Private.h"
 #import "IMMutableCategoryAttribution.h"
 #import "IMCategoryFetchOptions.h"
+#import "IMGIFEncoder.h"
+#import "IMStickerArtifactStore.h"
+#import "IMMutationOutbox.h"
+#import "IMAnalyticsPipeline.h"
+#import "IMMetricsRecorder.h"
+#import "IMImojiResponse.h"
+#import "IMContentSnapshotStore.h"
+#import "IMUserCollectionMirror.h"
+#import "IMAttributionCache.h"
+#import "IMRenditionSelector.h"
+#import "IMSharedResourceRegistry.h"
+#import "IMImageMemoryCache.h"
+#import "IMImojiAtlas+Private.h"
+#import "ImojiSDKConstants.h"
 
 #if IMMessagesFrameworkSupported
 #import <Messages/Messages.h>
@@ -44,6 +58,16 @@
 
 NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
 
+// exported sticker files kept on disk before the least recently used ones are evicted
+static const unsigned long long IMImojiSessionStickerArtifactMaximumSize = 50 * 1024 * 1024;
+
+// attribution of an imoji rarely changes, it is only requested again after this long
+static const NSTimeInterval IMImojiSessionAttributionTimeToLive = 60 * 60;
+static const NSUInteger IMImojiSessionAttributionCacheCountLimit = 5000;
+
+// identifiers per attribution request, longer lists are split and requested concurrently to keep URLs short
+static const NSUInteger IMImojiSessionAttributionRequestSize = 50;
+
 @implementation IMImojiSession
 
 @synthesize sessionState = _sessionState;
@@ -66,20 +90,54 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
     return self;
 }
 
+- (instancetype)initWithStoragePolicy:(IMImojiSessionStoragePolicy *)storagePolicy
+                            transport:(id <IMImojiTransport>)transport {
+    self = [super init];
+    if (self) {
+        _transport = transport;
+        [self setupWithStoragePolicy:storagePolicy];
+    }
+
+    return self;
+}
+
 - (void)setupWithStoragePolicy:(IMImojiSessionStoragePolicy *)storagePolicy {
     _sessionState = IMImojiSessionStateNotConnected;
     _storagePolicy = storagePolicy;
 
-    self->_urlSession = [NSURLSession sessionWithConfiguration:[_storagePolicy generateURLSessionConfiguration]];
-
-    [self readAuthenticationCredentials];
+    self->_metricsRecorder = [IMMetricsRecorder new];
+    self->_executors = [IMImojiExecutors defaultExecutors];
+    self->_requestTemplates = [NSMutableDictionary dictionary];
+    self->_attributionCache = [[IMAttributionCache alloc] initWithTimeToLive:IMImojiSessionAttributionTimeToLive
+                                                                  countLimit:IMImojiSessionAttributionCacheCountLimit];
+    self->_contentSnapshotStore = [[IMContentSnapshotStore alloc] initWithDirectoryURL:[_storagePolicy.cachePath URLByAppendingPathComponent:@"snapshots"]];
+    self->_collectionMirror = [[IMUserCollectionMirror alloc] initWithDirectoryURL:[_storagePolicy.persistentPath URLByAppendingPathComponent:@"collections"]];
+    self->_stickerArtifactStore = [[IMStickerArtifactStore alloc] initWithDirectoryURL:[_storagePolicy.cachePath URLByAppendingPathComponent:@"stickers"]
+                                                                           maximumSize:IMImojiSessionStickerArtifactMaximumSize];
+
+    // sessions sharing a persistent path share its outbox and analytics spool, a second writer would replay, compact
+    // or overwrite their files on its own
+    self->_persistentResources = [[IMSharedResourceRegistry sharedRegistry] persistentResourcesForStoragePolicy:_storagePolicy];
+    [self->_persistentResources attachSession:self];
+    self->_mutationOutbox = self->_persistentResources.mutationOutbox;
+    self->_analyticsPipeline = self->_persistentResources.analyticsPipeline;
+
+    // credentials, directories and the default transport are loaded in the background on first use, see readinessTask
 }
 
 - (BFTask *)downloadImojiContents:(IMMutableImojiObject *)imoji
                   renderingOtions:(IMImojiObjectRenderingOptions *)renderingOptions
                 cancellationToken:cancellationToken {
     __block BFTaskCompletionSource *taskCompletionSource = [BFTaskCompletionSource taskCompletionSource];
-    [[self validateSession] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *task) {
+
+    // analytics flushes hold off until rendering traffic is done
+    [self->_analyticsPipeline beginForegroundActivity];
+    [taskCompletionSource.task continueWithBlock:^id(BFTask *task) {
+        [self->_analyticsPipeline endForegroundActivity];
+        return nil;
+    }];
+
+    [[self validateSession] continueWithExecutor:[IMTracer executor:[BFExecutor mainThreadExecutor] stage:"downloadImojiContents"] withBlock:^id(BFTask *task) {
         if (task.error) {
             taskCompletionSource.error = task.error;
         } else {
@@ -93,7 +151,7 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
                 [[self downloadImojiImageAsync:imoji
                               renderingOptions:renderingOptions
                                     imojiIndex:0
-                             cancellationToken:cancellationToken] continueWithExecutor:[BFExecutor mainThreadExecutor]
+                             cancellationToken:cancellationToken] continueWithExecutor:[IMTracer executor:[BFExecutor mainThreadExecutor] stage:"renderCallback"]
                                                                              withBlock:^id(BFTask *downloadTask) {
                                                                                  if (downloadTask.error) {
                                                                                      taskCompletionSource.error = downloadTask.error;
@@ -112,6 +170,65 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
     return taskCompletionSource.task;
 }
 
+#pragma mark Prewarming
+
+- (nonnull NSOperation *)prewarmWithOptions:(IMImojiSessionPrewarmOptions)options
+                                   callback:(nullable IMImojiSessionAsyncResponseCallback)callback {
+    NSOperation *cancellationToken = self.cancellationTokenOperation;
+
+    // TLS setup to both hosts overlaps with loading and validating credentials
+    BFTask *connectionsTask = [[self readinessTask] continueWithSuccessBlock:^id(BFTask *task) {
+        if (cancellationToken.cancelled) {
+            return [BFTask cancelledTask];
+        }
+
+        return [BFTask taskForCompletionOfAllTasks:@[
+                [self openConnectionToURL:[NSURL URLWithString:ImojiSDKServerURL]],
+                [self openConnectionToURL:[NSURL URLWithString:ImojiSDKRenderServerURL]]
+        ]];
+    }];
+
+    BFTask *contentTask = [[self validateSession] continueWithSuccessBlock:^id(BFTask *task) {
+        if (cancellationToken.cancelled) {
+            return [BFTask cancelledTask];
+        }
+
+        // parameters match the public fetch methods so their first requests are answered from the content snapshots
+        // when enabled, and find warm connections and credentials otherwise
+        void (^ignoreSnapshot)(IMImojiResponse *) = ^(IMImojiResponse *snapshot) {
+        };
+
+        NSMutableArray *tasks = [NSMutableArray array];
+        if (options & IMImojiSessionPrewarmOptionsFeatured) {
+            [tasks addObject:[self runSnapshotImojiResponseTaskWithPath:@"/imoji/featured/fetch"
+                                                             parameters:@{@"numResults" : [NSNull null]}
+                                                               priority:NSURLSessionTaskPriorityLow
+                                                        snapshotHandler:ignoreSnapshot]];
+        }
+
+        if (options & IMImojiSessionPrewarmOptionsCategories) {
+            for (NSNumber *classification in @[@(IMImojiSessionCategoryClassificationTrending), @(IMImojiSessionCategoryClassificationGeneric)]) {
+                [tasks addObject:[self runSnapshotImojiResponseTaskWithPath:@"/imoji/categories/fetch"
+                                                                 parameters:@{@"classification" : [IMImojiSession categoryClassifications][classification]}
+                                                                   priority:NSURLSessionTaskPriorityLow
+                                                            snapshotHandler:ignoreSnapshot]];
+            }
+        }
+
+        return [BFTask taskForCompletionOfAllTasks:tasks];
+    }];
+
+    [[BFTask taskForCompletionOfAllTasks:@[connectionsTask, contentTask]] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *task) {
+        if (callback && !cancellationToken.cancelled) {
+            callback(contentTask.error == nil, contentTask.error);
+        }
+
+        return nil;
+    }];
+
+    return cancellationToken;
+}
+
 #pragma mark Public Methods
 
 - (nonnull NSOperation *)getImojiCategoriesWithClassification:(IMImojiSessionCategoryClassification)classification
@@ -139,29 +256,38 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
         parameters[@"licenseStyles"] = options.licenseStyles;
     }
 
-    [[self runValidatedGetTaskWithPath:@"/imoji/categories/fetch"
-                         andParameters:parameters]
-            continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *getTask) {
-        NSDictionary *results = getTask.result;
+    IMTraceSpan span = [self beginTraceSpan:"getImojiCategories"];
+    IMTraceSpan previousSpan = [IMTracer setCurrentSpan:span];
+    BFTask *callbackTask = [[self runSnapshotImojiResponseTaskWithPath:@"/imoji/categories/fetch"
+                                                            parameters:parameters
+                                                       snapshotHandler:^(IMImojiResponse *snapshot) {
+                                                           callback(snapshot.categories, nil);
+                                                       }]
+            continueWithExecutor:[IMTracer executor:[BFExecutor mainThreadExecutor] stage:"resultCallback"] withBlock:^id(BFTask *getTask) {
+        // the snapshot already delivered is still current
+        if (getTask.cancelled) {
+            return nil;
+        }
+
+        IMImojiResponse *results = getTask.result;
 
         __block NSError *error;
-        [self validateServerResponse:results error:&error];
+        [self validateImojiResponse:results error:&error];
         if (error) {
             callback(nil, error);
         } else {
-            NSArray *categories = results[@"categories"];
             if (callback) {
-                if ([categories isEqual:[NSNull null]]) {
-                    callback(nil, nil);
-                } else {
-                    callback([self readCategories:categories], nil);
-                }
+                // categories is nil when the server returned null
+                callback(results.categories, nil);
             }
         }
 
         return nil;
     }];
 
+    [IMTracer setCurrentSpan:previousSpan];
+    [IMTracer endSpan:span afterTask:callbackTask];
+
     return cancellationToken;
 }
 
@@ -199,17 +325,19 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
         parameters[@"contributingImojiId"] = contributingImojiId;
     }
 
-    [[self runValidatedGetTaskWithPath:@"/imoji/search" andParameters:parameters] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *getTask) {
-        NSDictionary *results = getTask.result;
+    IMTraceSpan span = [self beginTraceSpan:"searchImojis"];
+    IMTraceSpan previousSpan = [IMTracer setCurrentSpan:span];
+    BFTask *callbackTask = [[self runValidatedImojiResponseTaskWithPath:@"/imoji/search" method:@"GET" parameters:parameters] continueWithExecutor:[IMTracer executor:[BFExecutor mainThreadExecutor] stage:"resultCallback"] withBlock:^id(BFTask *getTask) {
+        IMImojiResponse *results = getTask.result;
 
         NSError *error;
-        [self validateServerResponse:results error:&error];
+        [self validateImojiResponse:results error:&error];
         if (error) {
             resultSetResponseCallback(nil, error);
         } else {
-            [self handleImojiFetchResponse:[self convertServerDataSetToImojiArray:results]
-                         relatedSearchTerm:[results im_checkedStringForKey:@"followupSearchTerm"]
-                         relatedCategories:[self readCategories:[results im_checkedArrayForKey:@"relatedCategories" defaultValue:@[]]]
+            [self handleImojiFetchResponse:results.imojis
+                         relatedSearchTerm:results.followupSearchTerm
+                         relatedCategories:results.relatedCategories
                          cancellationToken:cancellationToken
                     searchResponseCallback:resultSetResponseCallback
                      imojiResponseCallback:imojiResponseCallback];
@@ -218,6 +346,9 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
         return nil;
     }];
 
+    [IMTracer setCurrentSpan:previousSpan];
+    [IMTracer endSpan:span afterTask:callbackTask];
+
     return cancellationToken;
 }
 
@@ -237,8 +368,20 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
             @"numResults" : numResultsValue
     }];
 
-    [[self runValidatedGetTaskWithPath:@"/imoji/featured/fetch" andParameters:parameters] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *getTask) {
-        if (cancellationToken.cancelled) {
+    IMTraceSpan span = [self beginTraceSpan:"getFeaturedImojis"];
+    IMTraceSpan previousSpan = [IMTracer setCurrentSpan:span];
+    BFTask *callbackTask = [[self runSnapshotImojiResponseTaskWithPath:@"/imoji/featured/fetch"
+                                                            parameters:parameters
+                                                       snapshotHandler:^(IMImojiResponse *snapshot) {
+                                                           [self handleImojiFetchResponse:snapshot.imojis
+                                                                        relatedSearchTerm:snapshot.followupSearchTerm
+                                                                        relatedCategories:snapshot.relatedCategories
+                                                                        cancellationToken:cancellationToken
+                                                                   searchResponseCallback:resultSetResponseCallback
+                                                                    imojiResponseCallback:imojiResponseCallback];
+                                                       }]
+            continueWithExecutor:[IMTracer executor:[BFExecutor mainThreadExecutor] stage:"resultCallback"] withBlock:^id(BFTask *getTask) {
+        if (cancellationToken.cancelled || getTask.cancelled) {
             return [BFTask cancelledTask];
         }
 
@@ -247,16 +390,16 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
             return nil;
         }
 
-        NSDictionary *results = getTask.result;
+        IMImojiResponse *results = getTask.result;
         NSError *error;
-        [self validateServerResponse:results error:&error];
+        [self validateImojiResponse:results error:&error];
 
         if (error) {
             resultSetResponseCallback(nil, error);
         } else {
-            [self handleImojiFetchResponse:[self convertServerDataSetToImojiArray:results]
-                         relatedSearchTerm:[results im_checkedStringForKey:@"followupSearchTerm"]
-                         relatedCategories:[self readCategories:[results im_checkedArrayForKey:@"relatedCategories" defaultValue:@[]]]
+            [self handleImojiFetchResponse:results.imojis
+                         relatedSearchTerm:results.followupSearchTerm
+                         relatedCategories:results.relatedCategories
                          cancellationToken:cancellationToken
                     searchResponseCallback:resultSetResponseCallback
                      imojiResponseCallback:imojiResponseCallback];
@@ -265,6 +408,9 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
         return nil;
     }];
 
+    [IMTracer setCurrentSpan:previousSpan];
+    [IMTracer endSpan:span afterTask:callbackTask];
+
     return cancellationToken;
 }
 
@@ -300,23 +446,21 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
             @"ids" : [imojiObjectIdentifiers componentsJoinedByString:@","]
     }];
 
-    [[self runValidatedPostTaskWithPath:@"/imoji/fetchMultiple" andParameters:parameters] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *getTask) {
+    [[self runValidatedImojiResponseTaskWithPath:@"/imoji/fetchMultiple" method:@"POST" parameters:parameters] continueWithExecutor:[IMTracer executor:[BFExecutor mainThreadExecutor] stage:"resultCallback"] withBlock:^id(BFTask *getTask) {
         if (cancellationToken.cancelled) {
             return [BFTask cancelledTask];
         }
 
-        NSDictionary *results = getTask.result;
+        IMImojiResponse *results = getTask.result;
         NSError *error;
-        [self validateServerResponse:results error:&error];
+        [self validateImojiResponse:results error:&error];
 
         if (error) {
             fetchedResponseCallback(nil, NSUIntegerMax, error);
         } else {
-            NSMutableArray *imojiObjects = [NSMutableArray arrayWithArray:[self convertServerDataSetToImojiArray:results]];
-
-            [self handleImojiFetchResponse:imojiObjects
-                         relatedSearchTerm:[results im_checkedStringForKey:@"followupSearchTerm"]
-                         relatedCategories:[self readCategories:[results im_checkedArrayForKey:@"relatedCategories" defaultValue:@[]]]
+            [self handleImojiFetchResponse:results.imojis
+                         relatedSearchTerm:results.followupSearchTerm
+                         relatedCategories:results.relatedCategories
                          cancellationToken:cancellationToken
                     searchResponseCallback:nil
                      imojiResponseCallback:fetchedResponseCallback];
@@ -343,17 +487,17 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
             @"numResults" : numberOfResults != nil ? numberOfResults : [NSNull null]
     }];
 
-    [[self runValidatedGetTaskWithPath:@"/imoji/search" andParameters:parameters] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *getTask) {
-        NSDictionary *results = getTask.result;
+    [[self runValidatedImojiResponseTaskWithPath:@"/imoji/search" method:@"GET" parameters:parameters] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *getTask) {
+        IMImojiResponse *results = getTask.result;
 
         NSError *error;
-        [self validateServerResponse:results error:&error];
+        [self validateImojiResponse:results error:&error];
         if (error) {
             resultSetResponseCallback(nil, error);
         } else {
-            [self handleImojiFetchResponse:[self convertServerDataSetToImojiArray:results]
-                         relatedSearchTerm:[results im_checkedStringForKey:@"followupSearchTerm"]
-                         relatedCategories:[self readCategories:[results im_checkedArrayForKey:@"relatedCategories" defaultValue:@[]]]
+            [self handleImojiFetchResponse:results.imojis
+                         relatedSearchTerm:results.followupSearchTerm
+                         relatedCategories:results.relatedCategories
                          cancellationToken:cancellationToken
                     searchResponseCallback:resultSetResponseCallback
                      imojiResponseCallback:imojiResponseCallback];
@@ -369,23 +513,22 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
                                  callback:(IMImojiSessionAsyncResponseCallback)callback {
     __block NSOperation *cancellationToken = self.cancellationTokenOperation;
 
-    [[self runValidatedPostTaskWithPath:@"/user/imoji/collection/add" andParameters:@{
-            @"imojiId" : imojiObject.identifier
-    }] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *getTask) {
-        if (cancellationToken.cancelled) {
-            return [BFTask cancelledTask];
-        }
+    if (self->_collectionMirrorEnabled) {
+        [self->_collectionMirror addImoji:imojiObject];
+    }
 
-        NSDictionary *results = getTask.result;
-        NSError *error;
-        [self validateServerResponse:results error:&error];
+    // acknowledged as soon as the mutation is recorded, the outbox sends it in the background
+    [[self->_mutationOutbox enqueueMutationWithKind:IMMutationKindCollectionAdd
+                                    imojiIdentifier:imojiObject.identifier
+                                         parameters:@{@"imojiId" : imojiObject.identifier}
+                                           retained:NO] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *task) {
+        [self settleCollectionMirrorChangesForEnqueueTask:task imojiIdentifier:imojiObject.identifier];
 
-        if (error) {
-            callback(NO, error);
-        } else {
-            callback(YES, nil);
+        if (cancellationToken.cancelled) {
+            return [BFTask cancelledTask];
         }
 
+        callback(task.error == nil, task.error);
         return nil;
     }];
 
@@ -418,21 +561,58 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
             break;
     }
 
-    [[self runValidatedGetTaskWithPath:@"/user/imoji/fetch" andParameters:params] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *getTask) {
+    IMUserCollectionMirror *collectionMirror = self->_collectionMirrorEnabled ? self->_collectionMirror : nil;
+    NSArray<IMImojiObject *> *mirroredImojis = [collectionMirror imojisForCollectionType:collectionType];
+    if (collectionMirror) {
+        [self->_metricsRecorder recordCacheTier:IMMetricsCacheTierCollectionMirror hit:mirroredImojis != nil];
+    }
+
+    if (mirroredImojis) {
+        void (^mirrorHandler)(void) = ^{
+            [self handleImojiFetchResponse:mirroredImojis
+                         relatedSearchTerm:nil
+                         relatedCategories:nil
+                         cancellationToken:cancellationToken
+                    searchResponseCallback:resultSetResponseCallback
+                     imojiResponseCallback:imojiResponseCallback];
+        };
+
+        if ([NSThread isMainThread]) {
+            mirrorHandler();
+        } else {
+            dispatch_async(dispatch_get_main_queue(), mirrorHandler);
+        }
+    }
+
+    [[self runValidatedImojiResponseTaskWithPath:@"/user/imoji/fetch" method:@"GET" parameters:params] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *getTask) {
         if (cancellationToken.cancelled) {
             return [BFTask cancelledTask];
         }
 
-        NSDictionary *results = getTask.result;
+        IMImojiResponse *results = getTask.result;
         NSError *error;
-        [self validateServerResponse:results error:&error];
+        [self validateImojiResponse:results error:&error];
 
         if (error) {
-            resultSetResponseCallback(nil, error);
+            // callers keep showing the mirrored collection, failures only reach those who had nothing to show
+            if (!mirroredImojis) {
+                resultSetResponseCallback(nil, error);
+            }
         } else {
-            [self handleImojiFetchResponse:[self convertServerDataSetToImojiArray:results]
-                         relatedSearchTerm:[results im_checkedStringForKey:@"followupSearchTerm"]
-                         relatedCategories:[self readCategories:[results im_checkedArrayForKey:@"relatedCategories" defaultValue:@[]]]
+            NSArray<IMImojiObject *> *imojis = results.imojis;
+            if (collectionMirror) {
+                NSArray<IMImojiObject *> *reconciledImojis = [collectionMirror reconcileCollectionType:collectionType withImojis:imojis];
+                if (!reconciledImojis && mirroredImojis) {
+                    // the mirrored collection already delivered is still current
+                    return nil;
+                }
+
+                imojis = reconciledImojis ?: [collectionMirror imojisForCollectionType:collectionType];
+            }
+
+            [self handleImojiFetchResponse:imojis
+                         relatedSearchTerm:results.followupSearchTerm
+                         relatedCategories:results.relatedCategories
                          cancellationToken:cancellationToken
                     searchResponseCallback:resultSetResponseCallback
                      imojiResponseCallback:imojiResponseCallback];
@@ -455,6 +635,8 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
 
     __block NSString *imojiId;
     __block IMImojiObject *localImoji;
+    __block BFTask *mutationTask;
+    __block BOOL reported = NO;
     [[[[[self createLocalImojiWithRawImage:image
                              borderedImage:borderedImage
                                       tags:tags]
@@ -472,6 +654,12 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
                 // trigger completion of the temporary imoji
                 beginUploadCallback(localImoji, nil);
 
+                // record the creation so it can be replayed from the local copy if this process ends before it's done
+                mutationTask = [self->_mutationOutbox enqueueMutationWithKind:IMMutationKindCreate
+                                                              imojiIdentifier:localImoji.identifier
+                                                                   parameters:@{@"tags" : tags != nil ? tags : @[]}
+                                                                     retained:YES];
+
                 // call the server to create a new imoji
                 return [self runValidatedPostTaskWithPath:@"/imoji/create" andParameters:@{
                         @"tags" : tags != nil ? tags : [NSNull null]
@@ -491,6 +679,7 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
                 [self validateServerResponse:results error:&error];
 
                 if (error) {
+                    reported = YES;
                     dispatch_async(dispatch_get_main_queue(), ^{
                         finishUploadCallback(nil, error);
                     });
@@ -502,22 +691,52 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
             }]
             continueWithSuccessBlock:^id(BFTask *task) {
                 NSDictionary *response = (NSDictionary *) task.result;
-                NSString *fullImageUrl = response[@"fullImageUrl"];
-
                 imojiId = response[@"imojiId"];
 
-                CGSize maxDimensions = CGSizeMake(
-                        [(NSNumber *) response[@"fullImageResizeWidth"] floatValue],
-                        [(NSNumber *) response[@"fullImageResizeHeight"] floatValue]
-                );
+                // /imoji/create isn't idempotent, a replay uploads to the imoji created here instead of creating another
+                BFTask *updateTask = [mutationTask continueWithSuccessBlock:^id(BFTask *enqueueTask) {
+                    return enqueueTask.result ? [self->_mutationOutbox updateMutation:enqueueTask.result parameters:@{
+                            @"tags" : tags != nil ? tags : @[],
+                            @"createResponse" : response
+                    }] : nil;
+                }];
 
-                // start the upload
-                return [self uploadImageInBackgroundWithRetries:[image im_resizedImageToFitInSize:maxDimensions scaleIfSmaller:NO]
-                                                      uploadUrl:[NSURL URLWithString:fullImageUrl]
-                                                     retryCount:3];
+                return [updateTask continueWithBlock:^id(BFTask *ignored) {
+                    return [self uploadImojiImage:image localImoji:localImoji createResponse:response];
+                }];
             }]
             continueWithBlock:
                     ^id(BFTask *task) {
+                        BOOL cancelled = task.cancelled || (task.error && cancellationToken.cancelled);
+
+                        // transient failures (connectivity, token requests, server errors) are completed by the outbox,
+                        // cancellations and failures already reported to the caller are final
+                        BOOL deferred = !cancelled && !reported && task.error.im_isTransient;
+                        [mutationTask continueWithSuccessBlock:^id(BFTask *enqueueTask) {
+                            if (enqueueTask.result) {
+                                [self->_mutationOutbox finishMutation:enqueueTask.result retrying:deferred];
+                            }
+
+                            return nil;
+                        }];
+
+                        if (cancelled || reported) {
+                            return task.error;
+                        }
+
+                        if (deferred) {
+                            dispatch_async(dispatch_get_main_queue(), ^{
+                                finishUploadCallback(nil, [NSError errorWithDomain:IMImojiSessionErrorDomain
+                                                                              code:IMImojiSessionErrorCodeCreationDeferred
+                                                                          userInfo:@{
+                                                                                  NSLocalizedDescriptionKey : @"Imoji creation will be completed in the background",
+                                                                                  NSUnderlyingErrorKey : task.error
+                                                                          }]);
+                            });
+
+                            return task.error;
+                        }
+
                         if (task.error) {
                             dispatch_async(dispatch_get_main_queue(), ^{
                                 finishUploadCallback(nil, [NSError errorWithDomain:IMImojiSessionErrorDomain
@@ -546,26 +765,23 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
 
 - (NSOperation *)removeImoji:(IMImojiObject *)imojiObject
                     callback:(IMImojiSessionAsyncResponseCallback)callback {
-
     __block NSOperation *cancellationToken = self.cancellationTokenOperation;
 
-    [[self runValidatedDeleteTaskWithPath:@"/imoji/remove" andParameters:@{
-            @"imojiId" : imojiObject.identifier
-    }] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *getTask) {
-        if (cancellationToken.cancelled) {
-            return [BFTask cancelledTask];
-        }
+    if (self->_collectionMirrorEnabled) {
+        [self->_collectionMirror removeImojiWithIdentifier:imojiObject.identifier];
+    }
 
-        NSDictionary *results = getTask.result;
-        NSError *error;
-        [self validateServerResponse:results error:&error];
+    [[self->_mutationOutbox enqueueMutationWithKind:IMMutationKindRemove
+                                    imojiIdentifier:imojiObject.identifier
+                                         parameters:@{@"imojiId" : imojiObject.identifier}
+                                           retained:NO] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *task) {
+        [self settleCollectionMirrorChangesForEnqueueTask:task imojiIdentifier:imojiObject.identifier];
 
-        if (error) {
-            callback(NO, error);
-        } else {
-            callback(YES, nil);
+        if (cancellationToken.cancelled) {
+            return [BFTask cancelledTask];
         }
 
+        callback(task.error == nil, task.error);
         return nil;
     }];
 
@@ -577,24 +793,18 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
                                                    callback:(nonnull IMImojiSessionAsyncResponseCallback)callback {
     __block NSOperation *cancellationToken = self.cancellationTokenOperation;
 
-    [[self runValidatedPostTaskWithPath:@"/imoji/reportAbusive" andParameters:@{
-            @"imojiId" : imojiIdentifier,
-            @"reason" : reason
-    }] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *getTask) {
+    [[self->_mutationOutbox enqueueMutationWithKind:IMMutationKindReport
+                                    imojiIdentifier:imojiIdentifier
+                                         parameters:@{
+                                                 @"imojiId" : imojiIdentifier,
+                                                 @"reason" : reason != nil ? reason : [NSNull null]
+                                         }
+                                           retained:NO] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *task) {
         if (cancellationToken.cancelled) {
             return [BFTask cancelledTask];
         }
 
-        NSDictionary *results = getTask.result;
-        NSError *error;
-        [self validateServerResponse:results error:&error];
-
-        if (error) {
-            callback(NO, error);
-        } else {
-            callback(YES, nil);
-        }
-
+        callback(task.error == nil, task.error);
         return nil;
     }];
 
@@ -610,14 +820,10 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
         originIdentifier = [originIdentifier substringToIndex:40];
     }
 
-    [[self runValidatedGetTaskWithPath:@"/analytics/imoji/sent" andParameters:@{
+    [self->_analyticsPipeline recordEventWithMethod:@"GET" path:@"/analytics/imoji/sent" parameters:@{
             @"imojiId" : imojiIdentifier,
             @"originIdentifier" : originIdentifier ? originIdentifier : [NSNull null]
-    }]
-            continueWithExecutor:[BFExecutor mainThreadExecutor]
-                       withBlock:^id(BFTask *task) {
-                           return nil;
-                       }];
+    }];
 }
 
 - (void)setUserDemographicsData:(nullable NSString *)gender
@@ -646,11 +852,7 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
     }
 
     if (values.count > 0) {
-        [[self runValidatedPostTaskWithPath:@"/analytics/demographics" andParameters:values]
-                continueWithExecutor:[BFExecutor mainThreadExecutor]
-                           withBlock:^id(BFTask *task) {
-                               return nil;
-                           }];
+        [self->_analyticsPipeline mergeDemographics:values path:@"/analytics/demographics"];
     }
 }
 
@@ -685,37 +887,59 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
         return cancellationToken;
     }
 
-    NSMutableDictionary *parameters = [NSMutableDictionary dictionaryWithDictionary:@{
-            @"imojiIds" : [imojiObjectIdentifiers componentsJoinedByString:@","]
-    }];
+    NSMutableDictionary<NSString *, IMCategoryAttribution *> *attribution = [NSMutableDictionary dictionaryWithCapacity:imojiObjectIdentifiers.count];
+    NSArray<NSString *> *missingIdentifiers = [self->_attributionCache missingIdentifiersForIdentifiers:imojiObjectIdentifiers
+                                                                                            attribution:attribution];
+    [self->_metricsRecorder recordCacheTier:IMMetricsCacheTierAttribution hit:missingIdentifiers.count == 0];
 
-    [[self runValidatedGetTaskWithPath:@"/imoji/attribution" andParameters:parameters]
-            continueWithExecutor:[BFExecutor mainThreadExecutor]
-                       withBlock:^id(BFTask *getTask) {
-                           if (cancellationToken.cancelled) {
-                               return [BFTask cancelledTask];
-                           }
-
-                           NSDictionary *results = getTask.result;
-                           NSError *error;
-                           [self validateServerResponse:results error:&error];
-
-                           NSMutableDictionary *converted = [NSMutableDictionary dictionary];
-                           if ([results[@"attribution"] isKindOfClass:[NSDictionary class]]) {
-                               NSDictionary *attributionMap = results[@"attribution"];
-                               for (NSString *imojiId in [attributionMap allKeys]) {
-                                   converted[imojiId] = [self readAttribution:attributionMap[imojiId]];
-                               }
-                           }
-
-                           if (error) {
-                               callback(nil, error);
-                           } else {
-                               callback([NSDictionary dictionaryWithDictionary:converted], nil);
-                           }
-
-                           return nil;
-                       }];
+    if (missingIdentifiers.count == 0) {
+        if ([NSThread isMainThread]) {
+            callback(attribution, nil);
+        } else {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                callback(attribution, nil);
+            });
+        }
+
+        return cancellationToken;
+    }
+
+    NSMutableArray<BFTask *> *requestTasks = [NSMutableArray array];
+    for (NSUInteger offset = 0; offset < missingIdentifiers.count; offset += IMImojiSessionAttributionRequestSize) {
+        NSArray<NSString *> *requestIdentifiers = [missingIdentifiers subarrayWithRange:NSMakeRange(offset, MIN(IMImojiSessionAttributionRequestSize, missingIdentifiers.count - offset))];
+
+        [requestTasks addObject:[[self runValidatedImojiResponseTaskWithPath:@"/imoji/attribution" method:@"GET" parameters:@{
+                @"imojiIds" : [requestIdentifiers componentsJoinedByString:@","]
+        }] continueWithBlock:^id(BFTask *getTask) {
+            IMImojiResponse *results = getTask.result;
+            NSError *error;
+            if (![self validateImojiResponse:results error:&error]) {
+                return [BFTask taskWithError:error];
+            }
+
+            [self->_attributionCache storeAttribution:results.attribution forIdentifiers:requestIdentifiers];
+            return results.attribution;
+        }]];
+    }
+
+    [[BFTask taskForCompletionOfAllTasks:requestTasks] continueWithExecutor:[BFExecutor mainThreadExecutor] withBlock:^id(BFTask *task) {
+        if (cancellationToken.cancelled) {
+            return [BFTask cancelledTask];
+        }
+
+        // a single failed request fails the call, the attribution of the others is cached for the next one
+        for (BFTask *requestTask in requestTasks) {
+            if (requestTask.error) {
+                callback(nil, requestTask.error);
+                return nil;
+            }
+
+            [attribution addEntriesFromDictionary:requestTask.result];
+        }
+
+        callback(attribution, nil);
+        return nil;
+    }];
 
     return cancellationToken;
 }
@@ -726,8 +950,17 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
 - (NSOperation *)renderImoji:(IMImojiObject *)imoji
                      options:(IMImojiObjectRenderingOptions *)options
                     callback:(IMImojiSessionImojiRenderResponseCallback)callback {
-    __block NSOperation *cancellationToken = self.cancellationTokenOperation;
+    NSOperation *cancellationToken = self.cancellationTokenOperation;
+
+    [self fetchAndRenderImoji:imoji options:options callback:callback cancellationToken:cancellationToken];
 
+    return cancellationToken;
+}
+
+- (void)fetchAndRenderImoji:(IMImojiObject *)imoji
+                    options:(IMImojiObjectRenderingOptions *)options
+                   callback:(IMImojiSessionImojiRenderResponseCallback)callback
+          cancellationToken:(NSOperation *)cancellationToken {
     if (!imoji || !imoji.identifier) {
         NSError *error = [NSError errorWithDomain:IMImojiSessionErrorDomain
                                              code:IMImojiSessionErrorCodeImojiDoesNotExist
@@ -737,8 +970,20 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
 
         callback(nil, error);
 
-        return cancellationToken;
-    } else if (![imoji isKindOfClass:[IMMutableImojiObject class]]) {
+        return;
+    }
+
+    IMTraceSpan span = [self beginTraceSpan:"renderImoji"];
+    if (span != 0) {
+        IMImojiSessionImojiRenderResponseCallback renderCallback = callback;
+        callback = ^(UIImage *image, NSError *error) {
+            renderCallback(image, error);
+            [IMTracer endSpan:span];
+        };
+    }
+
+    IMTraceSpan previousSpan = [IMTracer setCurrentSpan:span];
+    if (![imoji isKindOfClass:[IMMutableImojiObject class]]) {
         [self fetchImojisByIdentifiers:@[imoji.identifier]
                fetchedResponseCallback:^(IMImojiObject *internalImoji, NSUInteger index, NSError *error) {
                    if (cancellationToken.cancelled) {
@@ -756,13 +1001,24 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
         cancellationToken:cancellationToken];
     }
 
-    return cancellationToken;
+    [IMTracer setCurrentSpan:previousSpan];
 }
 
 - (nonnull NSOperation *)renderImojiForExport:(nonnull IMImojiObject *)imoji
                                       options:(nonnull IMImojiObjectRenderingOptions *)options
                                      callback:(nonnull IMImojiSessionExportedImageResponseCallback)callback {
-    return [self renderImoji:imoji options:options callback:^(UIImage *image, NSError *error) {
+    NSOperation *cancellationToken = self.cancellationTokenOperation;
+
+    [self exportImoji:imoji options:options callback:callback cancellationToken:cancellationToken];
+
+    return cancellationToken;
+}
+
+- (void)exportImoji:(IMImojiObject *)imoji
+            options:(IMImojiObjectRenderingOptions *)options
+           callback:(IMImojiSessionExportedImageResponseCallback)callback
+  cancellationToken:(NSOperation *)cancellationToken {
+    [self fetchAndRenderImoji:imoji options:options callback:^(UIImage *image, NSError *error) {
 
         if (error) {
             callback(nil, nil, nil, error);
@@ -770,8 +1026,14 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
             NSData *attachmentData = nil;
             NSError *exportError = nil;
             NSString *typeIdentifier = nil;
+            BOOL animated = imoji.supportsAnimation && options.renderAnimatedIfSupported;
+
+            // adaptive renditions fall back to a static image on slow connections
+            if (animated && options.targetDownloadDuration && [image isKindOfClass:[YYImage class]]) {
+                animated = ((YYImage *) image).animatedImageFrameCount > 1;
+            }
 
-            if (imoji.supportsAnimation && options.renderAnimatedIfSupported) {
+            if (animated) {
                 if ([image isKindOfClass:[YYImage class]]) {
                     YYImage *yyImage = (YYImage *) image;
 
@@ -780,30 +1042,27 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
                         typeIdentifier = (NSString *) kUTTypeGIF;
                     } else if (yyImage.animatedImageType == YYImageTypeWebP) {
                         // YYImage animatedImageData gives back the full webp data which is unusable for exporting
-                        // manually convert it here using a simple method to convert animated frames to NSData adapted from:
-                        // https://github.com/mattt/AnimatedGIFImageSerialization/blob/master/AnimatedGIFImageSerialization/AnimatedGIFImageSerialization.m
-
+                        // re-encode the decoded frames with IMGIFEncoder which only writes the changed region of each
+                        // frame using its own palette, resulting in much smaller attachments than ImageIO
                         NSUInteger frameCount = yyImage.animatedImageFrameCount;
-                        NSMutableData *mutableData = [NSMutableData data];
-                        CGImageDestinationRef destination =
-                                CGImageDestinationCreateWithData((__bridge CFMutableDataRef) mutableData, kUTTypeGIF, frameCount, NULL);
-
-                        NSDictionary *imageProperties = @{(__bridge NSString *) kCGImagePropertyGIFDictionary : @{
-                                (__bridge NSString *) kCGImagePropertyGIFLoopCount : @(yyImage.animatedImageLoopCount)
-                        }};
-                        CGImageDestinationSetProperties(destination, (__bridge CFDictionaryRef) imageProperties);
-
-                        for (NSUInteger i = 0; i < frameCount; i++) {
-                            NSDictionary *frameProperties = @{(__bridge NSString *) kCGImagePropertyGIFDictionary : @{
-                                    (__bridge NSString *) kCGImagePropertyGIFUnclampedDelayTime : @([yyImage animatedImageDurationAtIndex:i]),
-                                    (__bridge NSString *) kCGImagePropertyGIFDelayTime : @([yyImage animatedImageDurationAtIndex:i])
-                            }};
-                            CGImageDestinationAddImage(destination, [[yyImage animatedImageFrameAtIndex:i] CGImage], (__bridge CFDictionaryRef) frameProperties);
+                        UIImage *firstFrame = [yyImage animatedImageFrameAtIndex:0];
+                        BOOL success = firstFrame.CGImage != nil;
+                        NSData *gifData = nil;
+
+                        if (success) {
+                            IMGIFEncoder *encoder = [[IMGIFEncoder alloc] initWithWidth:CGImageGetWidth(firstFrame.CGImage)
+                                                                                 height:CGImageGetHeight(firstFrame.CGImage)
+                                                                              loopCount:yyImage.animatedImageLoopCount];
+
+                            for (NSUInteger i = 0; i < frameCount && success; i++) {
+                                success = [encoder appendFrameWithCGImage:[yyImage animatedImageFrameAtIndex:i].CGImage
+                                                                    delay:[yyImage animatedImageDurationAtIndex:i]];
+                            }
+
+                            gifData = success ? [encoder finish] : nil;
+                            success = gifData != nil;
                         }
 
-                        BOOL success = CGImageDestinationFinalize(destination);
-                        CFRelease(destination);
-
                         if (!success) {
                             exportError = [NSError errorWithDomain:IMImojiSessionErrorDomain
                                                               code:IMImojiSessionErrorCodeImojiRenderingUnavailable
@@ -811,7 +1070,7 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
                                                                   NSLocalizedDescriptionKey : @"Unable to export WEBP to GIF"
                                                           }];
                         } else {
-                            attachmentData = mutableData;
+                            attachmentData = gifData;
                             typeIdentifier = (NSString *) kUTTypeGIF;
                         }
 
@@ -836,7 +1095,7 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
 
             callback(image, attachmentData, typeIdentifier, exportError);
         }
-    }];
+    } cancellationToken:cancellationToken];
 }
 
 - (nonnull NSOperation *)renderImojiAsMSSticker:(nonnull IMImojiObject *)imoji
@@ -851,50 +1110,63 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
         return self.cancellationTokenOperation;
     }
 
-    __block NSURL *url = [NSURL fileURLWithPath:[NSString stringWithFormat:@"%@%@-%@.%@",
-                                                                   NSTemporaryDirectory(),
-                                                                   imoji.identifier,
-                                                                   @(options.hash),
-                                                                   imoji.supportsAnimation ? @"gif" : @"png"
-    ]];
-    __block void (^stickerCallback)() = ^{
-        NSError *stickerError;
-        MSSticker *sticker = [[MSSticker alloc] initWithContentsOfFileURL:url
-                                                     localizedDescription:imoji.identifier
-                                                                    error:&stickerError];
-        dispatch_async(dispatch_get_main_queue(), ^{
-            if (stickerError) {
-                callback(nil, stickerError);
-            } else {
-                callback(sticker, nil);
-            }
-        });
+    IMStickerArtifactStore *artifactStore = self->_stickerArtifactStore;
+    NSString *artifactKey = [IMStickerArtifactStore artifactKeyForImoji:imoji renderingOptions:options];
+    NSOperation *cancellationToken = self.cancellationTokenOperation;
+    IMImojiExecutors *executors = self.executors;
+
+    MSSticker *(^createSticker)(NSURL *, NSError **) = ^MSSticker *(NSURL *url, NSError **error) {
+        return [[MSSticker alloc] initWithContentsOfFileURL:url
+                                       localizedDescription:imoji.identifier
+                                                      error:error];
     };
 
-    if ([[NSFileManager defaultManager] fileExistsAtPath:url.path]) {
-        [BFTask im_concurrentBackgroundTaskWithBlock:^id(BFTask *task) {
-            stickerCallback();
+    // the artifact index is loaded from disk on first use, lookups stay off the main thread
+    [[BFTask im_taskWithExecutor:executors.diskExecutor block:^id(BFTask *task) {
+        NSURL *artifactURL = [artifactStore artifactURLForKey:artifactKey];
+        MSSticker *sticker = artifactURL ? createSticker(artifactURL, nil) : nil;
+        [self->_metricsRecorder recordCacheTier:IMMetricsCacheTierStickerArtifacts hit:sticker != nil];
+
+        // the file was removed or damaged outside of the store, render it again
+        if (artifactURL && !sticker) {
+            [artifactStore removeArtifactForKey:artifactKey];
+        }
+
+        return sticker;
+    }] continueWithExecutor:[BFExecutor mainThreadExecutor] withSuccessBlock:^id(BFTask *task) {
+        if (task.result) {
+            callback(task.result, nil);
             return nil;
-        }];
-        
-        return self.cancellationTokenOperation;
-    }
+        }
+
+        if (cancellationToken.cancelled) {
+            return nil;
+        }
+
+        [self exportImoji:imoji
+                  options:options
+                 callback:^(UIImage *image, NSData *data, NSString *typeIdentifier, NSError *error) {
+                     [BFTask im_taskWithExecutor:executors.diskExecutor block:^id(BFTask *storeTask) {
+                         NSError *stickerError = error;
+                         NSURL *url = stickerError ? nil : [artifactStore storeArtifactData:data
+                                                                                     forKey:artifactKey
+                                                                              fileExtension:[typeIdentifier isEqualToString:(NSString *) kUTTypeGIF] ? @"gif" : @"png"
+                                                                                      error:&stickerError];
+                         MSSticker *sticker = url ? createSticker(url, &stickerError) : nil;
+
+                         dispatch_async(dispatch_get_main_queue(), ^{
+                             callback(sticker, sticker ? nil : stickerError);
+                         });
+
+                         return nil;
+                     }];
+                 }
+        cancellationToken:cancellationToken];
 
+        return nil;
+    }];
 
-    return [self renderImojiForExport:imoji
-                              options:options
-                             callback:^(UIImage *image, NSData *data, NSString *typeIdentifier, NSError *error) {
-                                 [BFTask im_concurrentBackgroundTaskWithBlock:^id(BFTask *task) {
-                                     if (error) {
-                                         callback(nil, error);
-                                     } else {
-                                         [data writeToURL:url atomically:YES];
-                                         stickerCallback();
-                                     }
-                                     
-                                     return nil;
-                                 }];
-                             }];
+    return cancellationToken;
 #else
     [[NSException exceptionWithName:@"imoji runtime exception"
                             reason:@"MSSticker rendering only supported with iOS 10 SDK and higher"
@@ -910,7 +1182,9 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
   cancellationToken:(NSOperation *)cancellationToken {
 
     IMImojiObjectRenderingOptions *requestedRenderingOptions = options;
-    if (imoji.supportsAnimation && options.renderAnimatedIfSupported) {
+    if (options.targetDownloadDuration && !options.targetSize && !options.aspectRatio) {
+        requestedRenderingOptions = [[IMRenditionSelector sharedSelector] renderingOptionsForImoji:imoji options:options];
+    } else if (imoji.supportsAnimation && options.renderAnimatedIfSupported) {
         requestedRenderingOptions = [imoji supportedAnimatedRenderingOptionFromOption:options];
     }
 
@@ -932,6 +1206,259 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
             }];
 }
 
+#pragma mark Atlas
+
+- (NSOperation *)renderImojis:(NSArray<IMImojiObject *> *)imojis
+                    intoAtlas:(IMImojiAtlas *)atlas
+                      options:(IMImojiObjectRenderingOptions *)options
+                     callback:(IMImojiSessionAtlasResponseCallback)callback {
+    NSOperation *cancellationToken = self.cancellationTokenOperation;
+
+    if (imojis.count > atlas.capacity) {
+        callback(atlas, [NSIndexSet indexSet], YES, [NSError errorWithDomain:IMImojiSessionErrorDomain
+                                                                        code:IMImojiSessionErrorCodeInvalidArgument
+                                                                    userInfo:@{
+                                                                            NSLocalizedDescriptionKey : [NSString stringWithFormat:@"%@ imojis do not fit an atlas of %@", @(imojis.count), @(atlas.capacity)]
+                                                                    }]);
+
+        return cancellationToken;
+    }
+
+    IMImojiObjectRenderingOptions *stillOptions = [options copy];
+    stillOptions.renderAnimatedIfSupported = NO;
+
+    NSUInteger generation = [atlas resetWithImojis:imojis];
+
+    // cells are drawn on the image executor and delivered to the main thread in batches, the state below is guarded
+    // by drawnIndexes
+    NSMutableIndexSet *drawnIndexes = [NSMutableIndexSet indexSet];
+    __block NSUInteger remaining = imojis.count;
+    __block NSError *lastError = nil;
+    __block BOOL deliveryScheduled = NO;
+
+    dispatch_block_t deliver = ^{
+        NSIndexSet *indexes;
+        NSError *error;
+        BOOL finished;
+
+        @synchronized (drawnIndexes) {
+            deliveryScheduled = NO;
+            indexes = [drawnIndexes copy];
+            error = lastError;
+            finished = remaining == 0;
+            [drawnIndexes removeAllIndexes];
+            lastError = nil;
+        }
+
+        if (cancellationToken.cancelled || atlas.generation != generation) {
+            return;
+        }
+
+        callback(atlas, indexes, finished, error);
+    };
+
+    void (^completeCell)(NSUInteger, BOOL, NSError *) = ^(NSUInteger index, BOOL drawn, NSError *error) {
+        @synchronized (drawnIndexes) {
+            if (drawn) {
+                [drawnIndexes addIndex:index];
+            } else if (error) {
+                lastError = error;
+            }
+
+            remaining--;
+            if (deliveryScheduled) {
+                return;
+            }
+            deliveryScheduled = YES;
+        }
+
+        dispatch_async(dispatch_get_main_queue(), deliver);
+    };
+
+    if (imojis.count == 0) {
+        dispatch_async(dispatch_get_main_queue(), deliver);
+        return cancellationToken;
+    }
+
+    // imojis that did not come from a session are fetched with a single request
+    NSMutableArray<NSString *> *unresolvedIdentifiers = [NSMutableArray array];
+    for (IMImojiObject *imoji in imojis) {
+        if (![imoji isKindOfClass:[IMMutableImojiObject class]] && imoji.identifier) {
+            [unresolvedIdentifiers addObject:imoji.identifier];
+        }
+    }
+
+    BFTask *resolveTask = unresolvedIdentifiers.count == 0 ? [BFTask taskWithResult:nil] :
+            [self runValidatedImojiResponseTaskWithPath:@"/imoji/fetchMultiple"
+                                                 method:@"POST"
+                                             parameters:@{@"ids" : [unresolvedIdentifiers componentsJoinedByString:@","]}];
+
+    // analytics flushes hold off until rendering traffic is done
+    [self->_analyticsPipeline beginForegroundActivity];
+
+    [[resolveTask continueWithExecutor:[BFTask im_executorWithImojiExecutor:self.executors.networkExecutor] withBlock:^id(BFTask *fetchTask) {
+        IMImojiResponse *response = fetchTask.result;
+        NSError *fetchError = fetchTask.error;
+        if (response) {
+            [self validateImojiResponse:response error:&fetchError];
+        }
+
+        NSMutableDictionary<NSString *, IMMutableImojiObject *> *fetchedImojis = [NSMutableDictionary dictionary];
+        for (IMMutableImojiObject *imoji in response.imojis) {
+            fetchedImojis[imoji.identifier] = imoji;
+        }
+
+        NSMutableArray<BFTask *> *cellTasks = [NSMutableArray arrayWithCapacity:imojis.count];
+        [imojis enumerateObjectsUsingBlock:^(IMImojiObject *imoji, NSUInteger index, BOOL *stop) {
+            IMMutableImojiObject *mutableImoji = [imoji isKindOfClass:[IMMutableImojiObject class]] ?
+                    (IMMutableImojiObject *) imoji : (imoji.identifier ? fetchedImojis[imoji.identifier] : nil);
+
+            BFTask *cellTask = fetchError && !mutableImoji ? [BFTask taskWithError:fetchError] :
+                    [self drawImoji:mutableImoji intoAtlas:atlas atIndex:index generation:generation options:stillOptions cancellationToken:cancellationToken];
+
+            [cellTasks addObject:[cellTask continueWithBlock:^id(BFTask *task) {
+                completeCell(index, [task.result boolValue], task.error);
+                return nil;
+            }]];
+        }];
+
+        return [BFTask taskForCompletionOfAllTasks:cellTasks];
+    }] continueWithBlock:^id(BFTask *task) {
+        [self->_analyticsPipeline endForegroundActivity];
+        return nil;
+    }];
+
+    return cancellationToken;
+}
+
+// fetches the still rendition of imoji and decodes it straight into its cell on the image executor, skipping the
+// UIImage rendering path used by renderImoji
+- (BFTask *)drawImoji:(IMMutableImojiObject *)imoji
+            intoAtlas:(IMImojiAtlas *)atlas
+              atIndex:(NSUInteger)index
+           generation:(NSUInteger)generation
+              options:(IMImojiObjectRenderingOptions *)options
+    cancellationToken:(NSOperation *)cancellationToken {
+    if (!imoji.urls) {
+        return [BFTask taskWithError:[NSError errorWithDomain:IMImojiSessionErrorDomain
+                                                         code:IMImojiSessionErrorCodeImojiDoesNotExist
+                                                     userInfo:@{
+                                                             NSLocalizedDescriptionKey : [NSString stringWithFormat:@"unable to download imoji %@", imoji.identifier]
+                                                     }]];
+    }
+
+    IMImojiObjectRenderingOptions *renderingOptions = options;
+    if (options.targetDownloadDuration && !options.targetSize && !options.aspectRatio) {
+        renderingOptions = [[IMRenditionSelector sharedSelector] renderingOptionsForImoji:imoji options:options];
+    }
+
+    NSURL *url = [imoji getUrlForRenderingOptions:renderingOptions];
+    BFExecutor *imageExecutor = [IMTracer executor:[BFTask im_executorWithImojiExecutor:self.executors.imageExecutor] stage:"drawAtlasCell"];
+
+    // renditions decoded by renderImoji are drawn from memory
+    UIImage *cachedImage = url.isFileURL ? nil : [self->_sharedResources.imageMemoryCache imageForKey:url.absoluteString];
+    if (!url.isFileURL) {
+        [self->_metricsRecorder recordCacheTier:IMMetricsCacheTierDecodedImages hit:cachedImage != nil];
+    }
+
+    if (cachedImage) {
+        return [[BFTask taskWithResult:nil] continueWithExecutor:imageExecutor withBlock:^id(BFTask *task) {
+            return @([atlas drawImage:cachedImage atIndex:index generation:generation]);
+        }];
+    }
+
+    return [[self downloadImageDataAsync:url cancellationToken:cancellationToken] continueWithExecutor:imageExecutor withSuccessBlock:^id(BFTask *dataTask) {
+        if (cancellationToken.cancelled) {
+            return [BFTask cancelledTask];
+        }
+
+        NSData *data = dataTask.result;
+        uint64_t startTime = IMMetricsTimestamp();
+        BOOL drawn = data && [atlas drawImageData:data atIndex:index generation:generation];
+        [self->_metricsRecorder recordPhase:IMMetricsPhaseImageDecoding startTime:startTime];
+
+        if (!drawn && atlas.generation == generation) {
+            return [NSError errorWithDomain:IMImojiSessionErrorDomain
+                                       code:IMImojiSessionErrorCodeInvalidImage
+                                   userInfo:@{
+                                           NSLocalizedDescriptionKey : [NSString stringWithFormat:@"unable to decode imoji %@", imoji.identifier]
+                                   }];
+        }
+
+        return @(drawn);
+    }];
+}
+
+#pragma mark Metrics
+
+- (IMImojiSessionMetrics *)metricsSnapshot {
+    return [self->_metricsRecorder snapshot];
+}
+
+- (void)resetMetrics {
+    [self->_metricsRecorder reset];
+}
+
+#pragma mark Tracing
+
+- (BOOL)isTracingEnabled {
+    return self->_tracingEnabled;
+}
+
+- (void)setTracingEnabled:(BOOL)tracingEnabled {
+    if (tracingEnabled && self->_traceIdentifier == 0) {
+        self->_traceIdentifier = [IMTracer newTraceIdentifier];
+    }
+
+    self->_tracingEnabled = tracingEnabled;
+}
+
+- (NSData *)traceData {
+    return [IMTracer chromeTraceDataWithTraceIdentifier:self->_traceIdentifier];
+}
+
+#pragma mark Content Snapshots
+
+- (BOOL)contentSnapshotsEnabled {
+    return self->_contentSnapshotsEnabled;
+}
+
+- (void)setContentSnapshotsEnabled:(BOOL)contentSnapshotsEnabled {
+    self->_contentSnapshotsEnabled = contentSnapshotsEnabled;
+}
+
+- (void)removeContentSnapshots {
+    [self->_contentSnapshotStore removeAllSnapshots];
+}
+
+#pragma mark Collection Mirror
+
+- (BOOL)collectionMirrorEnabled {
+    return self->_collectionMirrorEnabled;
+}
+
+- (void)setCollectionMirrorEnabled:(BOOL)collectionMirrorEnabled {
+    self->_collectionMirrorEnabled = collectionMirrorEnabled;
+}
+
+- (void)removeCollectionMirror {
+    [self->_collectionMirror removeAllCollections];
+}
+
+#pragma mark Executors
+
+- (IMImojiExecutors *)executors {
+    @synchronized (self) {
+        return self->_executors;
+    }
+}
+
+- (void)setExecutors:(IMImojiExecutors *)executors {
+    @synchronized (self) {
+        self->_executors = executors;
+    }
+}
+
 #pragma mark Static
 
 + (NSDictionary *)categoryClassifications {
@@ -960,4 +1487,9 @@ NSString *const IMImojiSessionErrorDomain = @"IMImojiSessionErrorDomain";
     return [[IMImojiSession alloc] initWithStoragePolicy:storagePolicy];
 }
 
++ (instancetype)imojiSessionWithStoragePolicy:(IMImojiSessionStoragePolicy *)storagePolicy
+                                    transport:(id <IMImojiTransport>)transport {
+    return [[IMImojiSession alloc] initWithStoragePolicy:storagePolicy transport:transport];
+}
+
 @end
@@ -0,0 +1,119 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+* @abstract Number of buckets in IMImojiTimingMetrics histograms. Bucket 0 counts durations under 1ms, bucket i counts
+* durations in [2^(i-1), 2^i) milliseconds and the last bucket counts everything above.
+*/
+extern const NSUInteger IMImojiTimingMetricsBucketCount;
+
+/**
+* @abstract Duration distribution for a request type or processing phase
+*/
+@interface IMImojiTimingMetrics : NSObject
+
+@property(nonatomic, readonly) NSUInteger count;
+
+/**
+* @abstract Sum of all recorded durations in seconds
+*/
+@property(nonatomic, readonly) NSTimeInterval totalDuration;
+
+/**
+* @abstract IMImojiTimingMetricsBucketCount counts, see IMImojiTimingMetricsBucketCount for bucket bounds
+*/
+@property(nonatomic, readonly, nonnull) NSArray<NSNumber *> *histogram;
+
+@property(nonatomic, readonly) NSTimeInterval averageDuration;
+
+/**
+* @abstract Upper bound in seconds of the histogram bucket containing the given percentile (0 to 100)
+*/
+- (NSTimeInterval)durationAtPercentile:(double)percentile;
+
+@end
+
+/**
+* @abstract Metrics for requests to a single endpoint, an API path such as /imoji/search or a host for image requests
+*/
+@interface IMImojiEndpointMetrics : NSObject
+
+@property(nonatomic, readonly, nonnull) IMImojiTimingMetrics *latency;
+
+@property(nonatomic, readonly) NSUInteger errorCount;
+
+@property(nonatomic, readonly) NSUInteger retryCount;
+
+@property(nonatomic, readonly) unsigned long long bytesSent;
+
+@property(nonatomic, readonly) unsigned long long bytesReceived;
+
+@end
+
+/**
+* @abstract Hit and miss counts for a cache tier
+*/
+@interface IMImojiCacheMetrics : NSObject
+
+@property(nonatomic, readonly) NSUInteger hits;
+
+@property(nonatomic, readonly) NSUInteger misses;
+
+/**
+* @abstract hits / (hits + misses), 0 when the cache has not been used
+*/
+@property(nonatomic, readonly) double hitRatio;
+
+@end
+
+/**
+* @abstract Point in time copy of the metrics collected by an IMImojiSession, see metricsSnapshot
+*/
+@interface IMImojiSessionMetrics : NSObject
+
+/**
+* @abstract Request metrics keyed by endpoint
+*/
+@property(nonatomic, readonly, nonnull) NSDictionary<NSString *, IMImojiEndpointMetrics *> *endpoints;
+
+/**
+* @abstract Durations of request and processing phases: tokenValidation, domainLookup, connect, secureConnection and
+* timeToFirstByte (from NSURLSessionTaskMetrics, iOS 10 and above), jsonParsing, modelBuilding and imageDecoding
+*/
+@property(nonatomic, readonly, nonnull) NSDictionary<NSString *, IMImojiTimingMetrics *> *phases;
+
+/**
+* @abstract Cache usage keyed by cache tier
+*/
+@property(nonatomic, readonly, nonnull) NSDictionary<NSString *, IMImojiCacheMetrics *> *caches;
+
+/**
+* @abstract A JSON serializable representation of the snapshot
+*/
+- (nonnull NSDictionary *)dictionaryRepresentation;
+
+@end
@@ -0,0 +1,171 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import "IMImojiSessionMetrics.h"
+#import "IMMetricsRecorder.h"
+
+const NSUInteger IMImojiTimingMetricsBucketCount = IMMetricsHistogramBucketCount;
+
+@implementation IMImojiTimingMetrics
+
+- (instancetype)initWithCount:(NSUInteger)count
+                totalDuration:(NSTimeInterval)totalDuration
+                    histogram:(NSArray<NSNumber *> *)histogram {
+    self = [super init];
+    if (self) {
+        _count = count;
+        _totalDuration = totalDuration;
+        _histogram = histogram;
+    }
+
+    return self;
+}
+
+- (NSTimeInterval)averageDuration {
+    return self.count > 0 ? self.totalDuration / self.count : 0;
+}
+
+- (NSTimeInterval)durationAtPercentile:(double)percentile {
+    if (self.count == 0) {
+        return 0;
+    }
+
+    NSUInteger target = (NSUInteger) ceil(MIN(MAX(percentile, 0.0), 100.0) / 100.0 * self.count);
+    NSUInteger seen = 0;
+
+    for (NSUInteger bucket = 0; bucket < self.histogram.count; ++bucket) {
+        seen += self.histogram[bucket].unsignedIntegerValue;
+        if (seen >= MAX(target, 1)) {
+            return ldexp(1.0, (int) bucket) / 1000.0;
+        }
+    }
+
+    return ldexp(1.0, (int) self.histogram.count - 1) / 1000.0;
+}
+
+- (NSDictionary *)dictionaryRepresentation {
+    return @{
+            @"count" : @(self.count),
+            @"totalDuration" : @(self.totalDuration),
+            @"histogram" : self.histogram
+    };
+}
+
+@end
+
+@implementation IMImojiEndpointMetrics
+
+- (instancetype)initWithLatency:(IMImojiTimingMetrics *)latency
+                     errorCount:(NSUInteger)errorCount
+                     retryCount:(NSUInteger)retryCount
+                      bytesSent:(unsigned long long)bytesSent
+                  bytesReceived:(unsigned long long)bytesReceived {
+    self = [super init];
+    if (self) {
+        _latency = latency;
+        _errorCount = errorCount;
+        _retryCount = retryCount;
+        _bytesSent = bytesSent;
+        _bytesReceived = bytesReceived;
+    }
+
+    return self;
+}
+
+- (NSDictionary *)dictionaryRepresentation {
+    return @{
+            @"latency" : [self.latency dictionaryRepresentation],
+            @"errors" : @(self.errorCount),
+            @"retries" : @(self.retryCount),
+            @"bytesSent" : @(self.bytesSent),
+            @"bytesReceived" : @(self.bytesReceived)
+    };
+}
+
+@end
+
+@implementation IMImojiCacheMetrics
+
+- (instancetype)initWithHits:(NSUInteger)hits misses:(NSUInteger)misses {
+    self = [super init];
+    if (self) {
+        _hits = hits;
+        _misses = misses;
+    }
+
+    return self;
+}
+
+- (double)hitRatio {
+    return self.hits + self.misses > 0 ? (double) self.hits / (self.hits + self.misses) : 0;
+}
+
+- (NSDictionary *)dictionaryRepresentation {
+    return @{
+            @"hits" : @(self.hits),
+            @"misses" : @(self.misses)
+    };
+}
+
+@end
+
+@implementation IMImojiSessionMetrics
+
+- (instancetype)initWithEndpoints:(NSDictionary<NSString *, IMImojiEndpointMetrics *> *)endpoints
+                           phases:(NSDictionary<NSString *, IMImojiTimingMetrics *> *)phases
+                           caches:(NSDictionary<NSString *, IMImojiCacheMetrics *> *)caches {
+    self = [super init];
+    if (self) {
+        _endpoints = endpoints;
+        _phases = phases;
+        _caches = caches;
+    }
+
+    return self;
+}
+
+- (NSDictionary *)dictionaryRepresentation {
+    NSMutableDictionary *endpoints = [NSMutableDictionary dictionaryWithCapacity:self.endpoints.count];
+    NSMutableDictionary *phases = [NSMutableDictionary dictionaryWithCapacity:self.phases.count];
+    NSMutableDictionary *caches = [NSMutableDictionary dictionaryWithCapacity:self.caches.count];
+
+    [self.endpoints enumerateKeysAndObjectsUsingBlock:^(NSString *key, IMImojiEndpointMetrics *metrics, BOOL *stop) {
+        endpoints[key] = [metrics dictionaryRepresentation];
+    }];
+    [self.phases enumerateKeysAndObjectsUsingBlock:^(NSString *key, IMImojiTimingMetrics *metrics, BOOL *stop) {
+        phases[key] = [metrics dictionaryRepresentation];
+    }];
+    [self.caches enumerateKeysAndObjectsUsingBlock:^(NSString *key, IMImojiCacheMetrics *metrics, BOOL *stop) {
+        caches[key] = [metrics dictionaryRepresentation];
+    }];
+
+    return @{
+            @"endpoints" : endpoints,
+            @"phases" : phases,
+            @"caches" : caches
+    };
+}
+
+@end
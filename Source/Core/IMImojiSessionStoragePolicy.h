@@ -75,4 +75,21 @@
  */
 - (nonnull NSURLSessionConfiguration *)generateURLSessionConfiguration;
 
+/**
+ * Creates the session configuration for API requests, with fewer connections per host and its own smaller NSURLCache
+ * under cachePath for responses.
+ */
+- (nonnull NSURLSessionConfiguration *)generateAPIURLSessionConfiguration;
+
+/**
+ * Creates the session configuration for image downloads and uploads, cached in the NSURLCache at cachePath.
+ */
+- (nonnull NSURLSessionConfiguration *)generateImageURLSessionConfiguration;
+
+/**
+ * Creates cachePath and persistentPath if they don't exist. Called by IMImojiSession in the background before its
+ * first request rather than when the policy is created.
+ */
+- (void)createDirectoriesIfNeeded;
+
 @end
@@ -28,6 +28,10 @@
 const NSUInteger IMImojiSessionStoragePolicyMemoryCacheSize = 0;
 const NSUInteger IMImojiSessionStoragePolicyDiskCacheSize = 15 * 1024 * 1024;
 
+// API responses are small and requested again as users move between screens
+const NSUInteger IMImojiSessionStoragePolicyMetadataMemoryCacheSize = 512 * 1024;
+const NSUInteger IMImojiSessionStoragePolicyMetadataDiskCacheSize = 5 * 1024 * 1024;
+
 @interface IMImojiSessionStoragePolicy ()
 @end
 
@@ -40,8 +44,6 @@ const NSUInteger IMImojiSessionStoragePolicyDiskCacheSize = 15 * 1024 * 1024;
     if (self) {
         _cachePath = cachePath;
         _persistentPath = persistentPath;
-
-        [self createDirectoriesIfNeeded];
     }
 
     return self;
@@ -79,6 +81,27 @@ const NSUInteger IMImojiSessionStoragePolicyDiskCacheSize = 15 * 1024 * 1024;
     return sessionConfiguration;
 }
 
+- (nonnull NSURLSessionConfiguration *)generateAPIURLSessionConfiguration {
+    NSURLSessionConfiguration *sessionConfiguration = [NSURLSessionConfiguration defaultSessionConfiguration];
+    sessionConfiguration.HTTPMaximumConnectionsPerHost = 4;
+    sessionConfiguration.networkServiceType = NSURLNetworkServiceTypeDefault;
+    sessionConfiguration.timeoutIntervalForRequest = 20;
+    sessionConfiguration.URLCache = [[NSURLCache alloc] initWithMemoryCapacity:IMImojiSessionStoragePolicyMetadataMemoryCacheSize
+                                                                  diskCapacity:IMImojiSessionStoragePolicyMetadataDiskCacheSize
+                                                                      diskPath:[self.cachePath.path stringByAppendingPathComponent:@"metadata"]];
+    sessionConfiguration.HTTPShouldUsePipelining = YES;
+    sessionConfiguration.requestCachePolicy = NSURLRequestUseProtocolCachePolicy;
+
+    return sessionConfiguration;
+}
+
+- (nonnull NSURLSessionConfiguration *)generateImageURLSessionConfiguration {
+    NSURLSessionConfiguration *sessionConfiguration = [self generateURLSessionConfiguration];
+    sessionConfiguration.timeoutIntervalForRequest = 30;
+
+    return sessionConfiguration;
+}
+
 + (instancetype)storagePolicyWithCachePath:(nonnull NSURL *)cachePath persistentPath:(nonnull NSURL *)persistentPath {
     return [[IMImojiSessionStoragePolicy alloc] initWithCachePath:cachePath
                                                    persistentPath:persistentPath];
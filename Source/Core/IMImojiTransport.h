@@ -0,0 +1,59 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+* @abstract Callback triggered when a transport request completes.
+* @param data The response body
+* @param response The response, an NSHTTPURLResponse for HTTP requests
+* @param error A transport level error (ex: NSURLErrorDomain) or nil if a response was received
+*/
+typedef void (^IMImojiTransportCompletionHandler)(NSData *__nullable data, NSURLResponse *__nullable response, NSError *__nullable error);
+
+/**
+* @abstract Performs the HTTP requests made by an IMImojiSession, API calls, image downloads and uploads alike.
+* Completion handlers may be called on any thread.
+*/
+@protocol IMImojiTransport <NSObject>
+
+/**
+* @abstract Runs a request, sending its HTTPBody if one is set.
+* @param priority A value between NSURLSessionTaskPriorityLow and NSURLSessionTaskPriorityHigh
+*/
+- (void)runDataTaskWithRequest:(nonnull NSURLRequest *)request
+                      priority:(float)priority
+             completionHandler:(nonnull IMImojiTransportCompletionHandler)completionHandler;
+
+/**
+* @abstract Runs a request, streaming its body from fileURL.
+* @param priority A value between NSURLSessionTaskPriorityLow and NSURLSessionTaskPriorityHigh
+*/
+- (void)runUploadTaskWithRequest:(nonnull NSURLRequest *)request
+                        fromFile:(nonnull NSURL *)fileURL
+                        priority:(float)priority
+               completionHandler:(nonnull IMImojiTransportCompletionHandler)completionHandler;
+
+@end
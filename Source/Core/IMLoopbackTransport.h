@@ -0,0 +1,97 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "IMImojiTransport.h"
+
+/**
+* @abstract A canned response served by IMLoopbackTransport
+*/
+@interface IMLoopbackResponse : NSObject
+
+@property(nonatomic, readonly) NSInteger statusCode;
+
+@property(nonatomic, readonly, nonnull) NSDictionary<NSString *, NSString *> *headerFields;
+
+@property(nonatomic, readonly, nonnull) NSData *body;
+
++ (nonnull instancetype)responseWithStatusCode:(NSInteger)statusCode
+                                  headerFields:(nullable NSDictionary<NSString *, NSString *> *)headerFields
+                                          body:(nullable NSData *)body;
+
+/**
+* @abstract A 200 response with a JSON body
+*/
++ (nonnull instancetype)responseWithJSONObject:(nonnull id)jsonObject;
+
+@end
+
+/**
+* @abstract Builds the response for a request. The request body (HTTPBody or the uploaded file contents) is passed
+* separately. Returning nil results in a 404 response.
+*/
+typedef IMLoopbackResponse *__nullable (^IMLoopbackTransportHandler)(NSURLRequest *__nonnull request, NSData *__nullable body);
+
+/**
+* @abstract In-process transport serving canned responses without touching the network, useful for tests and
+* benchmarks. Simulated latency and bandwidth are applied to every request.
+*/
+@interface IMLoopbackTransport : NSObject <IMImojiTransport>
+
+/**
+* @abstract Delay before every response. Defaults to 0.
+*/
+@property(atomic) NSTimeInterval latency;
+
+/**
+* @abstract Simulated bandwidth in bytes per second applied to request and response bodies. 0 (the default) means
+* unlimited.
+*/
+@property(atomic) double bandwidth;
+
+@property(nonatomic, readonly) NSUInteger requestCount;
+
+@property(nonatomic, readonly) unsigned long long bytesSent;
+
+@property(nonatomic, readonly) unsigned long long bytesReceived;
+
+/**
+* @abstract Registers a handler for requests to host (or any host if nil) whose URL path equals path. A path ending
+* with * matches any path with that prefix. Routes registered later take precedence.
+*/
+- (void)setHandler:(nonnull IMLoopbackTransportHandler)handler
+           forHost:(nullable NSString *)host
+              path:(nonnull NSString *)path;
+
+/**
+* @abstract Registers a fixed response, see setHandler:forHost:path:
+*/
+- (void)setResponse:(nonnull IMLoopbackResponse *)response
+            forHost:(nullable NSString *)host
+               path:(nonnull NSString *)path;
+
+- (void)resetCounters;
+
+@end
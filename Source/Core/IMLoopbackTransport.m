@@ -0,0 +1,220 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import "IMLoopbackTransport.h"
+
+@implementation IMLoopbackResponse
+
+- (instancetype)initWithStatusCode:(NSInteger)statusCode
+                      headerFields:(NSDictionary<NSString *, NSString *> *)headerFields
+                              body:(NSData *)body {
+    self = [super init];
+    if (self) {
+        _statusCode = statusCode;
+        _headerFields = headerFields ? [headerFields copy] : @{};
+        _body = body ? body : [NSData data];
+    }
+
+    return self;
+}
+
++ (instancetype)responseWithStatusCode:(NSInteger)statusCode
+                          headerFields:(NSDictionary<NSString *, NSString *> *)headerFields
+                                  body:(NSData *)body {
+    return [[IMLoopbackResponse alloc] initWithStatusCode:statusCode headerFields:headerFields body:body];
+}
+
++ (instancetype)responseWithJSONObject:(id)jsonObject {
+    return [[IMLoopbackResponse alloc] initWithStatusCode:200
+                                             headerFields:@{@"Content-Type" : @"application/json"}
+                                                     body:[NSJSONSerialization dataWithJSONObject:jsonObject options:0 error:nil]];
+}
+
+@end
+
+@interface IMLoopbackRoute : NSObject
+
+@property(nonatomic, copy) NSString *host;
+@property(nonatomic, copy) NSString *path;
+@property(nonatomic, copy) IMLoopbackTransportHandler handler;
+
+@end
+
+@implementation IMLoopbackRoute
+
+- (BOOL)matchesURL:(NSURL *)url {
+    if (self.host && ![self.host isEqualToString:url.host]) {
+        return NO;
+    }
+
+    NSString *path = url.path.length > 0 ? url.path : @"/";
+    if ([self.path hasSuffix:@"*"]) {
+        return [path hasPrefix:[self.path substringToIndex:self.path.length - 1]];
+    }
+
+    return [path isEqualToString:self.path];
+}
+
+@end
+
+@implementation IMLoopbackTransport {
+    NSMutableArray<IMLoopbackRoute *> *_routes;
+    dispatch_queue_t _responseQueue;
+
+    NSUInteger _requestCount;
+    unsigned long long _bytesSent;
+    unsigned long long _bytesReceived;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _routes = [NSMutableArray array];
+        _responseQueue = dispatch_queue_create("com.imoji.transport.loopback", DISPATCH_QUEUE_CONCURRENT);
+    }
+
+    return self;
+}
+
+- (void)setHandler:(IMLoopbackTransportHandler)handler
+           forHost:(NSString *)host
+              path:(NSString *)path {
+    IMLoopbackRoute *route = [IMLoopbackRoute new];
+    route.host = host;
+    route.path = path;
+    route.handler = handler;
+
+    @synchronized (self) {
+        [_routes insertObject:route atIndex:0];
+    }
+}
+
+- (void)setResponse:(IMLoopbackResponse *)response
+            forHost:(NSString *)host
+               path:(NSString *)path {
+    [self setHandler:^IMLoopbackResponse *(NSURLRequest *request, NSData *body) {
+        return response;
+    }        forHost:host path:path];
+}
+
+- (NSUInteger)requestCount {
+    @synchronized (self) {
+        return _requestCount;
+    }
+}
+
+- (unsigned long long)bytesSent {
+    @synchronized (self) {
+        return _bytesSent;
+    }
+}
+
+- (unsigned long long)bytesReceived {
+    @synchronized (self) {
+        return _bytesReceived;
+    }
+}
+
+- (void)resetCounters {
+    @synchronized (self) {
+        _requestCount = 0;
+        _bytesSent = 0;
+        _bytesReceived = 0;
+    }
+}
+
+#pragma mark IMImojiTransport
+
+- (void)runDataTaskWithRequest:(NSURLRequest *)request
+                      priority:(float)priority
+             completionHandler:(IMImojiTransportCompletionHandler)completionHandler {
+    [self respondToRequest:request body:request.HTTPBody completionHandler:completionHandler];
+}
+
+- (void)runUploadTaskWithRequest:(NSURLRequest *)request
+                        fromFile:(NSURL *)fileURL
+                        priority:(float)priority
+               completionHandler:(IMImojiTransportCompletionHandler)completionHandler {
+    NSError *error;
+    NSData *body = [NSData dataWithContentsOfURL:fileURL options:NSDataReadingMappedIfSafe error:&error];
+
+    if (!body) {
+        dispatch_async(_responseQueue, ^{
+            completionHandler(nil, nil, error);
+        });
+        return;
+    }
+
+    [self respondToRequest:request body:body completionHandler:completionHandler];
+}
+
+#pragma mark Responses
+
+- (void)respondToRequest:(NSURLRequest *)request
+                    body:(NSData *)body
+       completionHandler:(IMImojiTransportCompletionHandler)completionHandler {
+    IMLoopbackTransportHandler handler = nil;
+
+    @synchronized (self) {
+        for (IMLoopbackRoute *route in _routes) {
+            if ([route matchesURL:request.URL]) {
+                handler = route.handler;
+                break;
+            }
+        }
+    }
+
+    IMLoopbackResponse *loopbackResponse = handler ? handler(request, body) : nil;
+    if (!loopbackResponse) {
+        loopbackResponse = [IMLoopbackResponse responseWithStatusCode:404 headerFields:nil body:nil];
+    }
+
+    NSMutableDictionary *headerFields = [loopbackResponse.headerFields mutableCopy];
+    headerFields[@"Content-Length"] = [NSString stringWithFormat:@"%@", @(loopbackResponse.body.length)];
+
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:request.URL
+                                                              statusCode:loopbackResponse.statusCode
+                                                             HTTPVersion:@"HTTP/1.1"
+                                                            headerFields:headerFields];
+
+    @synchronized (self) {
+        _requestCount++;
+        _bytesSent += body.length;
+        _bytesReceived += loopbackResponse.body.length;
+    }
+
+    double bandwidth = self.bandwidth;
+    NSTimeInterval delay = self.latency;
+    if (bandwidth > 0) {
+        delay += (body.length + loopbackResponse.body.length) / bandwidth;
+    }
+
+    NSData *responseBody = loopbackResponse.body;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t) (delay * NSEC_PER_SEC)), _responseQueue, ^{
+        completionHandler(responseBody, response, nil);
+    });
+}
+
+@end
@@ -0,0 +1,107 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+* @abstract Tiers of memory released by IMMemoryGovernor, each level also releases the ones before it
+*/
+typedef NS_ENUM(NSUInteger, IMMemoryTrimLevel) {
+    /**
+    * @abstract Animated images kept in memory, the most expensive to hold and cheapest to decode again
+    */
+            IMMemoryTrimLevelAnimationFrames = 1,
+
+    /**
+    * @abstract Decoded still images
+    */
+            IMMemoryTrimLevelDecodedImages,
+
+    /**
+    * @abstract Parsed responses, collections, attribution and URL cache memory, all of which are reloaded from disk or
+    * the network when needed again
+    */
+            IMMemoryTrimLevelMetadata
+};
+
+/**
+* @abstract Object holding memory on behalf of the SDK. Must be safe to call from any thread and must not call back into
+* the governor while holding its own locks.
+*/
+@protocol IMMemoryConsumer <NSObject>
+
+/**
+* @abstract Approximate number of bytes held at level, not including the other levels
+*/
+- (NSUInteger)memoryCostAtLevel:(IMMemoryTrimLevel)level;
+
+/**
+* @abstract Releases memory held at level, least recently used first, until at most cost bytes remain at that level
+*/
+- (void)trimLevel:(IMMemoryTrimLevel)level toCost:(NSUInteger)cost;
+
+@end
+
+/**
+* @abstract Accounts for the memory held by every IMImojiSession cache in the process and keeps it within a budget.
+* When the budget is exceeded memory is released a level at a time, animated images first, then decoded images, then
+* metadata. Everything down to IMMemoryTrimLevelMetadata is released when the application receives a memory warning.
+*/
+@interface IMMemoryGovernor : NSObject
+
+/**
+* @abstract Maximum number of bytes the SDK keeps in memory. Defaults to 20MB, suited to keyboard and iMessage
+* extensions.
+*/
+@property(atomic) NSUInteger budget;
+
+/**
+* @abstract Number of bytes currently held across all levels
+*/
+@property(nonatomic, readonly) NSUInteger currentUsage;
+
++ (nonnull instancetype)sharedGovernor;
+
+/**
+* @abstract Number of bytes currently held at level, not including the other levels
+*/
+- (NSUInteger)usageAtLevel:(IMMemoryTrimLevel)level;
+
+/**
+* @abstract Releases all memory held at level and the levels before it
+*/
+- (void)trimToLevel:(IMMemoryTrimLevel)level;
+
+/**
+* @abstract Adds consumer to the accounting. Consumers are held weakly and removed once deallocated.
+*/
+- (void)registerConsumer:(nonnull id <IMMemoryConsumer>)consumer;
+
+/**
+* @abstract Releases memory if the budget is exceeded. Called by consumers after they grew.
+*/
+- (void)enforceBudget;
+
+@end
@@ -0,0 +1,142 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import <UIKit/UIKit.h>
+#import "IMMemoryGovernor.h"
+
+static const NSUInteger IMMemoryGovernorDefaultBudget = 20 * 1024 * 1024;
+
+@implementation IMMemoryGovernor {
+    NSHashTable<id <IMMemoryConsumer>> *_consumers;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _budget = IMMemoryGovernorDefaultBudget;
+        _consumers = [NSHashTable weakObjectsHashTable];
+
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(didReceiveMemoryWarning:)
+                                                     name:UIApplicationDidReceiveMemoryWarningNotification
+                                                   object:nil];
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
++ (instancetype)sharedGovernor {
+    static IMMemoryGovernor *sharedGovernor = nil;
+    static dispatch_once_t predicate;
+
+    dispatch_once(&predicate, ^{
+        sharedGovernor = [IMMemoryGovernor new];
+    });
+
+    return sharedGovernor;
+}
+
+- (void)registerConsumer:(id <IMMemoryConsumer>)consumer {
+    @synchronized (_consumers) {
+        [_consumers addObject:consumer];
+    }
+}
+
+- (NSArray<id <IMMemoryConsumer>> *)consumers {
+    @synchronized (_consumers) {
+        return _consumers.allObjects;
+    }
+}
+
+#pragma mark Usage
+
+- (NSUInteger)currentUsage {
+    NSUInteger usage = 0;
+    for (IMMemoryTrimLevel level = IMMemoryTrimLevelAnimationFrames; level <= IMMemoryTrimLevelMetadata; level++) {
+        usage += [self usageAtLevel:level];
+    }
+
+    return usage;
+}
+
+- (NSUInteger)usageAtLevel:(IMMemoryTrimLevel)level {
+    NSUInteger usage = 0;
+    for (id <IMMemoryConsumer> consumer in self.consumers) {
+        usage += [consumer memoryCostAtLevel:level];
+    }
+
+    return usage;
+}
+
+#pragma mark Trimming
+
+- (void)trimToLevel:(IMMemoryTrimLevel)level {
+    NSArray<id <IMMemoryConsumer>> *consumers = self.consumers;
+
+    for (IMMemoryTrimLevel trimmedLevel = IMMemoryTrimLevelAnimationFrames; trimmedLevel <= level; trimmedLevel++) {
+        for (id <IMMemoryConsumer> consumer in consumers) {
+            [consumer trimLevel:trimmedLevel toCost:0];
+        }
+    }
+}
+
+- (void)enforceBudget {
+    NSUInteger usage = self.currentUsage;
+    NSUInteger budget = self.budget;
+    if (usage <= budget) {
+        return;
+    }
+
+    // cheaper levels are emptied before anything is released from the next one
+    NSUInteger excess = usage - budget;
+    NSArray<id <IMMemoryConsumer>> *consumers = self.consumers;
+
+    for (IMMemoryTrimLevel level = IMMemoryTrimLevelAnimationFrames; level <= IMMemoryTrimLevelMetadata && excess > 0; level++) {
+        for (id <IMMemoryConsumer> consumer in consumers) {
+            NSUInteger cost = [consumer memoryCostAtLevel:level];
+            NSUInteger released = MIN(cost, excess);
+            if (released == 0) {
+                continue;
+            }
+
+            [consumer trimLevel:level toCost:cost - released];
+            excess -= released;
+
+            if (excess == 0) {
+                break;
+            }
+        }
+    }
+}
+
+- (void)didReceiveMemoryWarning:(NSNotification *)notification {
+    [self trimToLevel:IMMemoryTrimLevelMetadata];
+}
+
+@end
@@ -0,0 +1,63 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "IMImojiTransport.h"
+
+#if __IPHONE_OS_VERSION_MAX_ALLOWED >= 100000
+/**
+* @abstract Called with the metrics NSURLSession collected for each finished task. Only called on iOS 10 and above.
+*/
+typedef void (^IMURLSessionTransportMetricsHandler)(NSURLSessionTask *__nonnull task, NSURLSessionTaskMetrics *__nonnull metrics) NS_AVAILABLE_IOS(10_0);
+#endif
+
+/**
+* @abstract Default transport backed by an NSURLSession. Requests to the same host share connections, which are
+* multiplexed over HTTP/2 when the server supports it. Sessions created by IMImojiSession share their connections and
+* caches with every other IMImojiSession using the same cache path, with separate NSURLSessions for API and image
+* requests.
+*/
+@interface IMURLSessionTransport : NSObject <IMImojiTransport>
+
+/**
+* @abstract Session used for API requests
+*/
+@property(nonatomic, readonly, nonnull) NSURLSession *urlSession;
+
+/**
+* @abstract Session used for requests to any other host, such as image downloads and uploads. Same as urlSession for
+* transports created with a configuration.
+*/
+@property(nonatomic, readonly, nonnull) NSURLSession *imageURLSession;
+
+#if __IPHONE_OS_VERSION_MAX_ALLOWED >= 100000
+@property(atomic, copy, nullable) IMURLSessionTransportMetricsHandler metricsHandler NS_AVAILABLE_IOS(10_0);
+#endif
+
+- (nonnull instancetype)initWithConfiguration:(nonnull NSURLSessionConfiguration *)configuration;
+
++ (nonnull instancetype)transportWithConfiguration:(nonnull NSURLSessionConfiguration *)configuration;
+
+@end
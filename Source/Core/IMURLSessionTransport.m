@@ -0,0 +1,147 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import "IMURLSessionTransport.h"
+#import "IMURLSessionTransport+Private.h"
+#import "ImojiSDKConstants.h"
+
+@implementation IMURLSessionTransportDelegate {
+#if __IPHONE_OS_VERSION_MAX_ALLOWED >= 100000
+    // tasks of transports sharing the NSURLSession report to their own transport's handler
+    NSMapTable<NSURLSessionTask *, IMURLSessionTransportMetricsHandler> *_metricsHandlers;
+#endif
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+#if __IPHONE_OS_VERSION_MAX_ALLOWED >= 100000
+        _metricsHandlers = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality
+                                                 valueOptions:NSPointerFunctionsStrongMemory];
+#endif
+    }
+
+    return self;
+}
+
+#if __IPHONE_OS_VERSION_MAX_ALLOWED >= 100000
+- (void)setMetricsHandler:(IMURLSessionTransportMetricsHandler)metricsHandler forTask:(NSURLSessionTask *)task {
+    @synchronized (_metricsHandlers) {
+        [_metricsHandlers setObject:metricsHandler forKey:task];
+    }
+}
+
+- (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didFinishCollectingMetrics:(NSURLSessionTaskMetrics *)metrics {
+    IMURLSessionTransportMetricsHandler metricsHandler;
+    @synchronized (_metricsHandlers) {
+        metricsHandler = [_metricsHandlers objectForKey:task];
+        [_metricsHandlers removeObjectForKey:task];
+    }
+
+    if (metricsHandler) {
+        metricsHandler(task, metrics);
+    }
+}
+#endif
+
+@end
+
+@implementation IMURLSessionTransport {
+    IMURLSessionTransportDelegate *_delegate;
+    NSString *_apiHost;
+
+    // sessions from IMSharedResources outlive the transports using them
+    BOOL _ownsURLSessions;
+}
+
+- (instancetype)initWithConfiguration:(NSURLSessionConfiguration *)configuration {
+    IMURLSessionTransportDelegate *delegate = [IMURLSessionTransportDelegate new];
+    NSURLSession *urlSession = [NSURLSession sessionWithConfiguration:configuration delegate:delegate delegateQueue:nil];
+
+    self = [self initWithURLSession:urlSession imageURLSession:urlSession delegate:delegate];
+    if (self) {
+        _ownsURLSessions = YES;
+    }
+
+    return self;
+}
+
+- (instancetype)initWithURLSession:(NSURLSession *)urlSession
+                   imageURLSession:(NSURLSession *)imageURLSession
+                          delegate:(IMURLSessionTransportDelegate *)delegate {
+    self = [super init];
+    if (self) {
+        _urlSession = urlSession;
+        _imageURLSession = imageURLSession;
+        _delegate = delegate;
+        _apiHost = [NSURL URLWithString:ImojiSDKServerURL].host;
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    if (_ownsURLSessions) {
+        [_urlSession finishTasksAndInvalidate];
+    }
+}
+
++ (instancetype)transportWithConfiguration:(NSURLSessionConfiguration *)configuration {
+    return [[IMURLSessionTransport alloc] initWithConfiguration:configuration];
+}
+
+- (NSURLSession *)urlSessionForRequest:(NSURLRequest *)request {
+    return [request.URL.host isEqualToString:_apiHost] ? self.urlSession : self.imageURLSession;
+}
+
+- (void)resumeTask:(NSURLSessionTask *)task priority:(float)priority {
+    task.priority = priority;
+
+#if __IPHONE_OS_VERSION_MAX_ALLOWED >= 100000
+    IMURLSessionTransportMetricsHandler metricsHandler = self.metricsHandler;
+    if (metricsHandler) {
+        [_delegate setMetricsHandler:metricsHandler forTask:task];
+    }
+#endif
+
+    [task resume];
+}
+
+- (void)runDataTaskWithRequest:(NSURLRequest *)request
+                      priority:(float)priority
+             completionHandler:(IMImojiTransportCompletionHandler)completionHandler {
+    [self resumeTask:[[self urlSessionForRequest:request] dataTaskWithRequest:request completionHandler:completionHandler]
+            priority:priority];
+}
+
+- (void)runUploadTaskWithRequest:(NSURLRequest *)request
+                        fromFile:(NSURL *)fileURL
+                        priority:(float)priority
+               completionHandler:(IMImojiTransportCompletionHandler)completionHandler {
+    [self resumeTask:[[self urlSessionForRequest:request] uploadTaskWithRequest:request fromFile:fileURL completionHandler:completionHandler]
+            priority:priority];
+}
+
+@end
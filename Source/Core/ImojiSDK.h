@@ -28,12 +28,20 @@
 #import "IMArtist.h"
 #import "IMCategoryAttribution.h"
 #import "IMCategoryFetchOptions.h"
+#import "IMImojiAtlas.h"
+#import "IMImojiCollectionArchive.h"
 #import "IMImojiCategoryObject.h"
+#import "IMImojiExecutor.h"
 #import "IMImojiObject.h"
 #import "IMImojiObjectRenderingOptions.h"
 #import "IMImojiResultSetMetadata.h"
 #import "IMImojiSession.h"
+#import "IMImojiSessionMetrics.h"
 #import "IMImojiSessionStoragePolicy.h"
+#import "IMImojiTransport.h"
+#import "IMLoopbackTransport.h"
+#import "IMMemoryGovernor.h"
+#import "IMURLSessionTransport.h"
 
 #if __has_include(<Messages/Messages.h>)
 #define IMMessagesFrameworkSupported 1
@@ -0,0 +1,61 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class BFTask;
+
+/**
+* @abstract Sends a single analytics request. Cancelled tasks and transient failures (see im_isTransient of NSError)
+* stop the flush and are retried later, any other failure drops the record.
+*/
+typedef BFTask *__nonnull (^IMAnalyticsPipelineHandler)(NSString *__nonnull method, NSString *__nonnull path, NSDictionary *__nonnull parameters);
+
+/**
+* @abstract Spools analytics events to an on-disk ring buffer and flushes them in batches, either once batchSize events
+* are pending or flushInterval seconds after the first unsent event. Demographics updates are merged into a single
+* pending record. Flushing is paused while foreground activity (rendering) is in progress and pending events survive
+* relaunches.
+*/
+@interface IMAnalyticsPipeline : NSObject
+
+/**
+* @abstract Number of pending events that triggers an immediate flush. Defaults to 20.
+*/
+@property(nonatomic) NSUInteger batchSize;
+
+/**
+* @abstract Maximum time an event waits before being flushed. Defaults to 30 seconds.
+*/
+@property(nonatomic) NSTimeInterval flushInterval;
+
+- (nonnull instancetype)initWithDirectoryURL:(nonnull NSURL *)directoryURL
+                                     handler:(nonnull IMAnalyticsPipelineHandler)handler;
+
+/**
+* @abstract Opens the spool in the background and schedules a flush for events left by a previous launch
+*/
+- (void)resume;
+
+- (void)recordEventWithMethod:(nonnull NSString *)method
+                         path:(nonnull NSString *)path
+                   parameters:(nonnull NSDictionary *)parameters;
+
+/**
+* @abstract Merges values into the pending demographics record, replacing previously set keys.
+*/
+- (void)mergeDemographics:(nonnull NSDictionary *)values
+                     path:(nonnull NSString *)path;
+
+- (void)beginForegroundActivity;
+
+- (void)endForegroundActivity;
+
+/**
+* @abstract Flushes pending events now unless foreground activity is in progress
+*/
+- (void)flush;
+
+@end
@@ -0,0 +1,273 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Bolts/BFExecutor.h>
+#import <Bolts/BFTask.h>
+#import "IMAnalyticsPipeline.h"
+#import "IMAnalyticsSpool.h"
+#import "NSError+Utils.h"
+
+static const NSUInteger IMAnalyticsPipelineSpoolCapacity = 2048;
+static const NSUInteger IMAnalyticsPipelineSpoolSlotSize = 256;
+static const NSTimeInterval IMAnalyticsPipelineMaximumBackoff = 600.0;
+
+@implementation IMAnalyticsPipeline {
+    NSURL *_directoryURL;
+    IMAnalyticsPipelineHandler _handler;
+
+    dispatch_queue_t _queue;
+    BFExecutor *_executor;
+
+    IMAnalyticsSpool *_spool;
+    NSMutableDictionary *_demographics;
+    NSString *_demographicsPath;
+
+    NSUInteger _foregroundActivityCount;
+    BOOL _flushing;
+    BOOL _flushDeferred;
+    NSUInteger _failedFlushes;
+    NSUInteger _scheduleGeneration;
+    BOOL _flushScheduled;
+}
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL
+                             handler:(IMAnalyticsPipelineHandler)handler {
+    self = [super init];
+    if (self) {
+        _directoryURL = directoryURL;
+        _handler = [handler copy];
+        _batchSize = 20;
+        _flushInterval = 30.0;
+        _queue = dispatch_queue_create("com.imoji.analytics", DISPATCH_QUEUE_SERIAL);
+        dispatch_set_target_queue(_queue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0));
+        _executor = [BFExecutor executorWithDispatchQueue:_queue];
+    }
+
+    return self;
+}
+
+- (void)resume {
+    dispatch_async(_queue, ^{
+        [self loadIfNeeded];
+
+        if (self->_spool.count > 0 || self->_demographics) {
+            [self scheduleFlushAfter:self.flushInterval];
+        }
+    });
+}
+
+- (void)recordEventWithMethod:(NSString *)method
+                         path:(NSString *)path
+                   parameters:(NSDictionary *)parameters {
+    dispatch_async(_queue, ^{
+        [self loadIfNeeded];
+
+        if (![self->_spool appendRecord:@{@"m" : method, @"p" : path, @"q" : parameters}]) {
+            NSLog(@"WARNING: unable to record analytics event for %@", path);
+            return;
+        }
+
+        if (self->_spool.count >= self.batchSize) {
+            [self flushOnQueue];
+        } else if (!self->_flushScheduled) {
+            [self scheduleFlushAfter:self.flushInterval];
+        }
+    });
+}
+
+- (void)mergeDemographics:(NSDictionary *)values
+                     path:(NSString *)path {
+    dispatch_async(_queue, ^{
+        [self loadIfNeeded];
+
+        if (!self->_demographics) {
+            self->_demographics = [NSMutableDictionary dictionary];
+        }
+
+        [self->_demographics addEntriesFromDictionary:values];
+        self->_demographicsPath = path;
+        [self writeDemographics];
+
+        if (!self->_flushScheduled) {
+            [self scheduleFlushAfter:self.flushInterval];
+        }
+    });
+}
+
+- (void)beginForegroundActivity {
+    dispatch_async(_queue, ^{
+        self->_foregroundActivityCount++;
+    });
+}
+
+- (void)endForegroundActivity {
+    dispatch_async(_queue, ^{
+        if (self->_foregroundActivityCount > 0 && --self->_foregroundActivityCount == 0 && self->_flushDeferred) {
+            self->_flushDeferred = NO;
+            [self flushOnQueue];
+        }
+    });
+}
+
+- (void)flush {
+    dispatch_async(_queue, ^{
+        [self loadIfNeeded];
+        [self flushOnQueue];
+    });
+}
+
+#pragma mark Flushing
+
+- (void)scheduleFlushAfter:(NSTimeInterval)delay {
+    NSUInteger generation = ++_scheduleGeneration;
+    _flushScheduled = YES;
+
+    __weak IMAnalyticsPipeline *weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t) (delay * NSEC_PER_SEC)), _queue, ^{
+        IMAnalyticsPipeline *pipeline = weakSelf;
+        if (pipeline && pipeline->_scheduleGeneration == generation) {
+            pipeline->_flushScheduled = NO;
+            [pipeline flushOnQueue];
+        }
+    });
+}
+
+- (void)flushOnQueue {
+    if (_flushing) {
+        return;
+    }
+
+    if (_foregroundActivityCount > 0) {
+        _flushDeferred = YES;
+        return;
+    }
+
+    // invalidate any pending timer, the flush reschedules itself if events remain
+    _scheduleGeneration++;
+    _flushScheduled = NO;
+
+    if (_demographics) {
+        _flushing = YES;
+        NSDictionary *demographics = [_demographics copy];
+
+        [[self sendRecord:@{@"m" : @"POST", @"p" : _demographicsPath, @"q" : demographics}] continueWithExecutor:_executor withBlock:^id(BFTask *task) {
+            self->_flushing = NO;
+
+            if ([task.result boolValue]) {
+                // only clear what was sent, values merged during the request stay pending
+                if ([self->_demographics isEqualToDictionary:demographics]) {
+                    self->_demographics = nil;
+                }
+                [self writeDemographics];
+                [self flushOnQueue];
+            } else {
+                [self backOff];
+            }
+
+            return nil;
+        }];
+
+        return;
+    }
+
+    NSArray<NSDictionary *> *batch = [_spool peekRecords:self.batchSize];
+    if (batch.count == 0) {
+        _failedFlushes = 0;
+        return;
+    }
+
+    _flushing = YES;
+    [self sendBatch:batch index:0];
+}
+
+- (void)sendBatch:(NSArray<NSDictionary *> *)batch index:(NSUInteger)index {
+    if (index == batch.count || _foregroundActivityCount > 0) {
+        _flushing = NO;
+
+        if (index < batch.count) {
+            _flushDeferred = YES;
+        } else if (_spool.count >= self.batchSize) {
+            [self flushOnQueue];
+        } else if (_spool.count > 0) {
+            [self scheduleFlushAfter:self.flushInterval];
+        } else {
+            _failedFlushes = 0;
+        }
+
+        return;
+    }
+
+    [[self sendRecord:batch[index]] continueWithExecutor:_executor withBlock:^id(BFTask *task) {
+        if ([task.result boolValue]) {
+            [self->_spool consumeRecords:1];
+            [self sendBatch:batch index:index + 1];
+        } else {
+            self->_flushing = NO;
+            [self backOff];
+        }
+
+        return nil;
+    }];
+}
+
+// results in @YES when the record is done with (sent or permanently rejected), @NO when it should be retried
+- (BFTask *)sendRecord:(NSDictionary *)record {
+    NSString *method = record[@"m"], *path = record[@"p"];
+    NSDictionary *parameters = record[@"q"];
+
+    if (![method isKindOfClass:[NSString class]] || ![path isKindOfClass:[NSString class]] || ![parameters isKindOfClass:[NSDictionary class]]) {
+        return [BFTask taskWithResult:@YES];
+    }
+
+    return [_handler(method, path, parameters) continueWithExecutor:_executor withBlock:^id(BFTask *task) {
+        if (task.cancelled || task.error.im_isTransient) {
+            return @NO;
+        }
+
+        if (task.error) {
+            NSLog(@"WARNING: dropping analytics event for %@: %@", path, task.error);
+        }
+
+        self->_failedFlushes = 0;
+        return @YES;
+    }];
+}
+
+- (void)backOff {
+    _failedFlushes++;
+    [self scheduleFlushAfter:MIN(IMAnalyticsPipelineMaximumBackoff, self.flushInterval * pow(2.0, _failedFlushes - 1))];
+}
+
+#pragma mark Storage
+
+- (NSURL *)demographicsURL {
+    return [_directoryURL URLByAppendingPathComponent:@"demographics.plist"];
+}
+
+- (void)loadIfNeeded {
+    if (_spool) {
+        return;
+    }
+
+    _spool = [[IMAnalyticsSpool alloc] initWithFileURL:[_directoryURL URLByAppendingPathComponent:@"events.spool"]
+                                              capacity:IMAnalyticsPipelineSpoolCapacity
+                                              slotSize:IMAnalyticsPipelineSpoolSlotSize];
+
+    NSDictionary *stored = [NSDictionary dictionaryWithContentsOfURL:[self demographicsURL]];
+    if ([stored[@"values"] isKindOfClass:[NSDictionary class]] && [stored[@"path"] isKindOfClass:[NSString class]]) {
+        _demographics = [stored[@"values"] mutableCopy];
+        _demographicsPath = stored[@"path"];
+    }
+}
+
+- (void)writeDemographics {
+    if (_demographics) {
+        [@{@"values" : _demographics, @"path" : _demographicsPath} writeToURL:[self demographicsURL] atomically:YES];
+    } else {
+        [[NSFileManager defaultManager] removeItemAtURL:[self demographicsURL] error:nil];
+    }
+}
+
+@end
@@ -0,0 +1,49 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+* @abstract Fixed size on-disk ring buffer of JSON records. The file holds a small header followed by capacity slots
+* of slotSize bytes. Once full, appending overwrites the oldest record. Not thread safe, callers serialize access.
+*/
+@interface IMAnalyticsSpool : NSObject
+
+@property(nonatomic, readonly, nonnull) NSURL *fileURL;
+
+@property(nonatomic, readonly) NSUInteger capacity;
+
+@property(nonatomic, readonly) NSUInteger slotSize;
+
+/**
+* @abstract Number of records currently stored
+*/
+@property(nonatomic, readonly) NSUInteger count;
+
+/**
+* @abstract Opens the spool at fileURL, keeping the records of a previous launch if the file was written with the same
+* capacity and slot size. Otherwise the file is reset.
+*/
+- (nonnull instancetype)initWithFileURL:(nonnull NSURL *)fileURL
+                               capacity:(NSUInteger)capacity
+                               slotSize:(NSUInteger)slotSize;
+
+/**
+* @abstract Appends a record, overwriting the oldest one when the spool is full.
+* @return NO if the record does not fit in a slot or could not be written
+*/
+- (BOOL)appendRecord:(nonnull NSDictionary *)record;
+
+/**
+* @abstract Reads up to maximumCount of the oldest records without removing them.
+*/
+- (nonnull NSArray<NSDictionary *> *)peekRecords:(NSUInteger)maximumCount;
+
+/**
+* @abstract Removes the count oldest records.
+*/
+- (void)consumeRecords:(NSUInteger)count;
+
+@end
@@ -0,0 +1,175 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <fcntl.h>
+#import <unistd.h>
+#import "IMAnalyticsSpool.h"
+
+static const uint32_t IMAnalyticsSpoolMagic = 0x494d4153; // IMAS
+static const uint32_t IMAnalyticsSpoolVersion = 1;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t slotSize;
+    uint32_t head;
+    uint32_t count;
+} IMAnalyticsSpoolHeader;
+
+// each slot starts with the length of the JSON record stored in it
+typedef uint16_t IMAnalyticsSpoolSlotLength;
+
+@implementation IMAnalyticsSpool {
+    int _fileDescriptor;
+    IMAnalyticsSpoolHeader _header;
+}
+
+- (instancetype)initWithFileURL:(NSURL *)fileURL
+                       capacity:(NSUInteger)capacity
+                       slotSize:(NSUInteger)slotSize {
+    self = [super init];
+    if (self) {
+        _fileURL = fileURL;
+        _capacity = MAX(capacity, 1);
+        _slotSize = MIN(MAX(slotSize, sizeof(IMAnalyticsSpoolSlotLength) + 2), UINT16_MAX);
+
+        [[NSFileManager defaultManager] createDirectoryAtURL:[fileURL URLByDeletingLastPathComponent]
+                                 withIntermediateDirectories:YES
+                                                  attributes:nil
+                                                       error:nil];
+
+        _fileDescriptor = open(fileURL.fileSystemRepresentation, O_RDWR | O_CREAT, 0644);
+        [self readHeader];
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    if (_fileDescriptor >= 0) {
+        close(_fileDescriptor);
+    }
+}
+
+- (NSUInteger)count {
+    return _header.count;
+}
+
+- (BOOL)appendRecord:(NSDictionary *)record {
+    NSData *data = [NSJSONSerialization dataWithJSONObject:record options:0 error:nil];
+    if (!data || data.length + sizeof(IMAnalyticsSpoolSlotLength) > self.slotSize || _fileDescriptor < 0) {
+        return NO;
+    }
+
+    NSMutableData *slot = [NSMutableData dataWithLength:self.slotSize];
+    IMAnalyticsSpoolSlotLength length = (IMAnalyticsSpoolSlotLength) data.length;
+    [slot replaceBytesInRange:NSMakeRange(0, sizeof(length)) withBytes:&length];
+    [slot replaceBytesInRange:NSMakeRange(sizeof(length), data.length) withBytes:data.bytes];
+
+    uint32_t index = (_header.head + _header.count) % _header.capacity;
+    if (pwrite(_fileDescriptor, slot.bytes, slot.length, [self offsetOfSlot:index]) != (ssize_t) slot.length) {
+        return NO;
+    }
+
+    if (_header.count == _header.capacity) {
+        // full, the oldest record was just overwritten
+        _header.head = (_header.head + 1) % _header.capacity;
+    } else {
+        _header.count++;
+    }
+
+    [self writeHeader];
+    return YES;
+}
+
+- (NSArray<NSDictionary *> *)peekRecords:(NSUInteger)maximumCount {
+    NSUInteger count = MIN(maximumCount, _header.count);
+    NSMutableArray *records = [NSMutableArray arrayWithCapacity:count];
+    NSMutableData *slot = [NSMutableData dataWithLength:self.slotSize];
+
+    for (NSUInteger i = 0; i < count; ++i) {
+        uint32_t index = (uint32_t) ((_header.head + i) % _header.capacity);
+        if (pread(_fileDescriptor, slot.mutableBytes, slot.length, [self offsetOfSlot:index]) != (ssize_t) slot.length) {
+            break;
+        }
+
+        IMAnalyticsSpoolSlotLength length;
+        [slot getBytes:&length length:sizeof(length)];
+
+        NSDictionary *record = nil;
+        if (length > 0 && length + sizeof(length) <= slot.length) {
+            record = [NSJSONSerialization JSONObjectWithData:[slot subdataWithRange:NSMakeRange(sizeof(length), length)]
+                                                     options:0
+                                                       error:nil];
+        }
+
+        // keep positions aligned with the ring so consumeRecords: removes the right number of slots
+        [records addObject:[record isKindOfClass:[NSDictionary class]] ? record : @{}];
+    }
+
+    return records;
+}
+
+- (void)consumeRecords:(NSUInteger)count {
+    count = MIN(count, _header.count);
+    if (count == 0) {
+        return;
+    }
+
+    _header.head = (uint32_t) ((_header.head + count) % _header.capacity);
+    _header.count -= count;
+
+    if (_header.count == 0) {
+        _header.head = 0;
+    }
+
+    [self writeHeader];
+}
+
+#pragma mark Header
+
+- (off_t)offsetOfSlot:(uint32_t)index {
+    return (off_t) sizeof(IMAnalyticsSpoolHeader) + (off_t) index * (off_t) self.slotSize;
+}
+
+- (void)readHeader {
+    IMAnalyticsSpoolHeader header;
+
+    BOOL valid = _fileDescriptor >= 0 &&
+            pread(_fileDescriptor, &header, sizeof(header), 0) == sizeof(header) &&
+            header.magic == IMAnalyticsSpoolMagic &&
+            header.version == IMAnalyticsSpoolVersion &&
+            header.capacity == self.capacity &&
+            header.slotSize == self.slotSize &&
+            header.head < header.capacity &&
+            header.count <= header.capacity;
+
+    if (valid) {
+        _header = header;
+    } else {
+        _header = (IMAnalyticsSpoolHeader) {
+                .magic = IMAnalyticsSpoolMagic,
+                .version = IMAnalyticsSpoolVersion,
+                .capacity = (uint32_t) self.capacity,
+                .slotSize = (uint32_t) self.slotSize,
+                .head = 0,
+                .count = 0
+        };
+
+        if (_fileDescriptor >= 0) {
+            ftruncate(_fileDescriptor, [self offsetOfSlot:(uint32_t) self.capacity]);
+            [self writeHeader];
+        }
+    }
+}
+
+- (void)writeHeader {
+    if (_fileDescriptor >= 0) {
+        pwrite(_fileDescriptor, &_header, sizeof(_header), 0);
+    }
+}
+
+@end
@@ -0,0 +1,40 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "IMMemoryGovernor.h"
+
+@class IMCategoryAttribution;
+
+/**
+* @abstract In-memory attribution of imojis keyed by identifier. Entries expire after timeToLive and may be evicted
+* earlier under memory pressure. Imojis the server returned no attribution for are remembered as well so they are not
+* requested again. Accounted for by IMMemoryGovernor as metadata, trimming it drops every entry. Safe to use from
+* multiple threads.
+*/
+@interface IMAttributionCache : NSObject <IMMemoryConsumer>
+
+@property(nonatomic, readonly) NSTimeInterval timeToLive;
+
+- (nonnull instancetype)initWithTimeToLive:(NSTimeInterval)timeToLive
+                                countLimit:(NSUInteger)countLimit;
+
+/**
+* @abstract Copies the cached attribution of imojiIdentifiers into attribution.
+* @return The identifiers that are not cached or have expired, without duplicates
+*/
+- (nonnull NSArray<NSString *> *)missingIdentifiersForIdentifiers:(nonnull NSArray<NSString *> *)imojiIdentifiers
+                                                      attribution:(nonnull NSMutableDictionary<NSString *, IMCategoryAttribution *> *)attribution;
+
+/**
+* @abstract Caches the attribution returned for a request of imojiIdentifiers, identifiers missing from attribution
+* are cached as having none
+*/
+- (void)storeAttribution:(nonnull NSDictionary<NSString *, IMCategoryAttribution *> *)attribution
+          forIdentifiers:(nonnull NSArray<NSString *> *)imojiIdentifiers;
+
+- (void)removeAllAttribution;
+
+@end
@@ -0,0 +1,126 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import "IMAttributionCache.h"
+#import "IMCategoryAttribution.h"
+
+@interface IMAttributionCacheEntry : NSObject
+
+// nil for imojis without attribution
+@property(nonatomic, strong) IMCategoryAttribution *attribution;
+@property(nonatomic) CFAbsoluteTime expirationTime;
+
+@end
+
+@implementation IMAttributionCacheEntry
+@end
+
+// approximate size of an entry along with its attribution, which is often shared between imojis of the same artist
+static const NSUInteger IMAttributionCacheEntryCost = 512;
+
+@interface IMAttributionCache () <NSCacheDelegate>
+@end
+
+@implementation IMAttributionCache {
+    NSCache<NSString *, IMAttributionCacheEntry *> *_entries;
+
+    // number of entries held by _entries, NSCache does not expose it
+    NSUInteger _entryCount;
+}
+
+- (instancetype)initWithTimeToLive:(NSTimeInterval)timeToLive countLimit:(NSUInteger)countLimit {
+    self = [super init];
+    if (self) {
+        _timeToLive = timeToLive;
+        _entries = [NSCache new];
+        _entries.countLimit = countLimit;
+        _entries.delegate = self;
+
+        [[IMMemoryGovernor sharedGovernor] registerConsumer:self];
+    }
+
+    return self;
+}
+
+- (NSArray<NSString *> *)missingIdentifiersForIdentifiers:(NSArray<NSString *> *)imojiIdentifiers
+                                             attribution:(NSMutableDictionary<NSString *, IMCategoryAttribution *> *)attribution {
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    NSMutableOrderedSet<NSString *> *missingIdentifiers = [NSMutableOrderedSet orderedSet];
+
+    for (NSString *imojiIdentifier in imojiIdentifiers) {
+        IMAttributionCacheEntry *entry = [_entries objectForKey:imojiIdentifier];
+
+        if (!entry || entry.expirationTime <= now) {
+            [missingIdentifiers addObject:imojiIdentifier];
+        } else if (entry.attribution) {
+            attribution[imojiIdentifier] = entry.attribution;
+        }
+    }
+
+    return missingIdentifiers.array;
+}
+
+- (void)storeAttribution:(NSDictionary<NSString *, IMCategoryAttribution *> *)attribution
+          forIdentifiers:(NSArray<NSString *> *)imojiIdentifiers {
+    CFAbsoluteTime expirationTime = CFAbsoluteTimeGetCurrent() + self.timeToLive;
+    NSUInteger addedCount = 0;
+
+    for (NSString *imojiIdentifier in imojiIdentifiers) {
+        IMAttributionCacheEntry *entry = [IMAttributionCacheEntry new];
+        entry.attribution = attribution[imojiIdentifier];
+        entry.expirationTime = expirationTime;
+
+        if (![_entries objectForKey:imojiIdentifier]) {
+            addedCount++;
+        }
+
+        [_entries setObject:entry forKey:imojiIdentifier];
+    }
+
+    if (addedCount > 0) {
+        @synchronized (self) {
+            _entryCount += addedCount;
+        }
+
+        [[IMMemoryGovernor sharedGovernor] enforceBudget];
+    }
+}
+
+- (void)removeAllAttribution {
+    [_entries removeAllObjects];
+
+    @synchronized (self) {
+        _entryCount = 0;
+    }
+}
+
+#pragma mark NSCacheDelegate
+
+- (void)cache:(NSCache *)cache willEvictObject:(id)obj {
+    @synchronized (self) {
+        _entryCount = _entryCount > 0 ? _entryCount - 1 : 0;
+    }
+}
+
+#pragma mark IMMemoryConsumer
+
+- (NSUInteger)memoryCostAtLevel:(IMMemoryTrimLevel)level {
+    if (level != IMMemoryTrimLevelMetadata) {
+        return 0;
+    }
+
+    @synchronized (self) {
+        return _entryCount * IMAttributionCacheEntryCost;
+    }
+}
+
+- (void)trimLevel:(IMMemoryTrimLevel)level toCost:(NSUInteger)cost {
+    // NSCache does not expose the order of use, attribution is requested again in batches anyway
+    if (level == IMMemoryTrimLevelMetadata) {
+        [self removeAllAttribution];
+    }
+}
+
+@end
@@ -0,0 +1,37 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "IMMemoryGovernor.h"
+
+@class IMImojiResponse;
+
+/**
+* @abstract Keeps the last response of an endpoint on disk so a new session can show content before its first request
+* completes. Snapshots are stored as the response body, named by the SHA-256 of their key, and decoded with
+* IMImojiResponse the first time they are read. The decoded models keep their image URLs, which are the keys of the
+* rendition cache, so their thumbnails load from disk as well. Decoded snapshots stay in memory until IMMemoryGovernor
+* trims metadata, they are then read from disk again.
+*/
+@interface IMContentSnapshotStore : NSObject <IMMemoryConsumer>
+
+@property(nonatomic, readonly, nonnull) NSURL *directoryURL;
+
+- (nonnull instancetype)initWithDirectoryURL:(nonnull NSURL *)directoryURL;
+
+/**
+* @abstract Returns the snapshot stored for key, reading it from disk on first access. nil when none was stored.
+*/
+- (nullable IMImojiResponse *)responseForKey:(nonnull NSString *)key;
+
+/**
+* @abstract Replaces the snapshot for key. The file is written in the background by IMWriteBehindQueue.
+* @return NO when the response body is identical to the stored snapshot, in which case nothing is written
+*/
+- (BOOL)storeResponse:(nonnull IMImojiResponse *)response forKey:(nonnull NSString *)key;
+
+- (void)removeAllSnapshots;
+
+@end
@@ -0,0 +1,137 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import "IMContentSnapshotStore.h"
+#import "IMImojiResponse.h"
+#import "NSString+Utils.h"
+#import "IMWriteBehindQueue.h"
+
+@implementation IMContentSnapshotStore {
+    dispatch_queue_t _queue;
+
+    // decoded snapshots keyed by digest, NSNull for keys known to have none on disk
+    NSMutableDictionary<NSString *, id> *_responses;
+
+    // body bytes of the decoded snapshots, accounted for as their size in memory
+    NSUInteger _memoryCost;
+}
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL {
+    self = [super init];
+    if (self) {
+        _directoryURL = directoryURL;
+        _queue = dispatch_queue_create("com.imoji.snapshots", DISPATCH_QUEUE_SERIAL);
+        _responses = [NSMutableDictionary dictionary];
+
+        [[IMMemoryGovernor sharedGovernor] registerConsumer:self];
+    }
+
+    return self;
+}
+
+- (NSURL *)fileURLForDigest:(NSString *)digest {
+    return [self.directoryURL URLByAppendingPathComponent:[digest stringByAppendingPathExtension:@"json"]];
+}
+
+- (IMImojiResponse *)responseForKey:(NSString *)key {
+    NSString *digest = key.im_sha256;
+    __block id response;
+    __block BOOL loaded = NO;
+
+    dispatch_sync(_queue, ^{
+        response = self->_responses[digest];
+        if (response) {
+            return;
+        }
+
+        NSURL *fileURL = [self fileURLForDigest:digest];
+        NSData *data = [[IMWriteBehindQueue sharedQueue] contentsOfURL:fileURL];
+        response = data ? [IMImojiResponse responseWithData:data error:nil] : nil;
+
+        if (!response && data) {
+            [[NSFileManager defaultManager] removeItemAtURL:fileURL error:nil];
+        }
+
+        self->_responses[digest] = response ?: [NSNull null];
+        self->_memoryCost += ((IMImojiResponse *) response).data.length;
+        loaded = response != nil;
+    });
+
+    if (loaded) {
+        [[IMMemoryGovernor sharedGovernor] enforceBudget];
+    }
+
+    return response != [NSNull null] ? response : nil;
+}
+
+- (BOOL)storeResponse:(IMImojiResponse *)response forKey:(NSString *)key {
+    NSString *digest = key.im_sha256;
+    __block BOOL changed;
+
+    dispatch_sync(_queue, ^{
+        id previous = self->_responses[digest];
+        if (!previous) {
+            // compare against the snapshot on disk when it was never read by this session
+            NSData *data = [[IMWriteBehindQueue sharedQueue] contentsOfURL:[self fileURLForDigest:digest]];
+            changed = ![data isEqualToData:response.data];
+        } else {
+            changed = previous == [NSNull null] || ![((IMImojiResponse *) previous).data isEqualToData:response.data];
+        }
+
+        if (previous != [NSNull null]) {
+            self->_memoryCost -= ((IMImojiResponse *) previous).data.length;
+        }
+
+        self->_responses[digest] = response;
+        self->_memoryCost += response.data.length;
+    });
+
+    [[IMMemoryGovernor sharedGovernor] enforceBudget];
+
+    // snapshots are refetched when lost, consecutive refreshes of the same key only write the last one
+    if (changed) {
+        [[IMWriteBehindQueue sharedQueue] writeData:response.data toURL:[self fileURLForDigest:digest] durable:NO];
+    }
+
+    return changed;
+}
+
+- (void)removeAllSnapshots {
+    dispatch_sync(_queue, ^{
+        [self->_responses removeAllObjects];
+        self->_memoryCost = 0;
+    });
+
+    [[IMWriteBehindQueue sharedQueue] removeItemAtURL:self.directoryURL];
+    [[IMWriteBehindQueue sharedQueue] flush];
+}
+
+#pragma mark IMMemoryConsumer
+
+- (NSUInteger)memoryCostAtLevel:(IMMemoryTrimLevel)level {
+    __block NSUInteger cost = 0;
+
+    if (level == IMMemoryTrimLevelMetadata) {
+        dispatch_sync(_queue, ^{
+            cost = self->_memoryCost;
+        });
+    }
+
+    return cost;
+}
+
+- (void)trimLevel:(IMMemoryTrimLevel)level toCost:(NSUInteger)cost {
+    if (level != IMMemoryTrimLevelMetadata) {
+        return;
+    }
+
+    // snapshots are not ordered by use, all of them are read from disk again
+    dispatch_sync(_queue, ^{
+        [self->_responses removeAllObjects];
+        self->_memoryCost = 0;
+    });
+}
+
+@end
@@ -0,0 +1,22 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import "IMMemoryGovernor.h"
+
+/**
+* @abstract Decoded images keyed by URL so renders of the same rendition skip the download and decoding. Accounted for
+* by IMMemoryGovernor, animated images at IMMemoryTrimLevelAnimationFrames and still images at
+* IMMemoryTrimLevelDecodedImages, and evicted least recently used first. Safe to use from multiple threads.
+*/
+@interface IMImageMemoryCache : NSObject <IMMemoryConsumer>
+
+- (nullable UIImage *)imageForKey:(nonnull NSString *)key;
+
+- (void)setImage:(nonnull UIImage *)image forKey:(nonnull NSString *)key;
+
+- (void)removeAllImages;
+
+@end
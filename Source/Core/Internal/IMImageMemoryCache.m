@@ -0,0 +1,145 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <YYImage_MagicNarwhal/YYImage.h>
+#import "IMImageMemoryCache.h"
+
+@interface IMImageMemoryCacheEntry : NSObject
+
+@property(nonatomic, strong) UIImage *image;
+@property(nonatomic) NSUInteger cost;
+@property(nonatomic) IMMemoryTrimLevel level;
+
+@end
+
+@implementation IMImageMemoryCacheEntry
+@end
+
+@implementation IMImageMemoryCache {
+    NSMutableDictionary<NSString *, IMImageMemoryCacheEntry *> *_entries;
+
+    // least recently used keys first
+    NSMutableOrderedSet<NSString *> *_recentKeys;
+    NSUInteger _animatedCost;
+    NSUInteger _stillCost;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _entries = [NSMutableDictionary dictionary];
+        _recentKeys = [NSMutableOrderedSet orderedSet];
+
+        [[IMMemoryGovernor sharedGovernor] registerConsumer:self];
+    }
+
+    return self;
+}
+
+- (UIImage *)imageForKey:(NSString *)key {
+    @synchronized (self) {
+        IMImageMemoryCacheEntry *entry = _entries[key];
+        if (entry) {
+            [_recentKeys removeObject:key];
+            [_recentKeys addObject:key];
+        }
+
+        return entry.image;
+    }
+}
+
+- (void)setImage:(UIImage *)image forKey:(NSString *)key {
+    IMImageMemoryCacheEntry *entry = [IMImageMemoryCacheEntry new];
+    entry.image = image;
+
+    // the decoded first frame, animated images also hold their encoded data to decode the other frames from
+    CGImageRef cgImage = image.CGImage;
+    entry.cost = cgImage ? CGImageGetBytesPerRow(cgImage) * CGImageGetHeight(cgImage) : 0;
+    entry.level = IMMemoryTrimLevelDecodedImages;
+
+    if ([image isKindOfClass:[YYImage class]] && ((YYImage *) image).animatedImageFrameCount > 1) {
+        entry.cost += ((YYImage *) image).animatedImageData.length;
+        entry.level = IMMemoryTrimLevelAnimationFrames;
+    }
+
+    @synchronized (self) {
+        [self removeEntryForKey:key];
+
+        _entries[key] = entry;
+        [_recentKeys addObject:key];
+        if (entry.level == IMMemoryTrimLevelAnimationFrames) {
+            _animatedCost += entry.cost;
+        } else {
+            _stillCost += entry.cost;
+        }
+    }
+
+    [[IMMemoryGovernor sharedGovernor] enforceBudget];
+}
+
+- (void)removeAllImages {
+    @synchronized (self) {
+        [_entries removeAllObjects];
+        [_recentKeys removeAllObjects];
+        _animatedCost = 0;
+        _stillCost = 0;
+    }
+}
+
+// called while synchronized
+- (void)removeEntryForKey:(NSString *)key {
+    IMImageMemoryCacheEntry *entry = _entries[key];
+    if (!entry) {
+        return;
+    }
+
+    if (entry.level == IMMemoryTrimLevelAnimationFrames) {
+        _animatedCost -= entry.cost;
+    } else {
+        _stillCost -= entry.cost;
+    }
+
+    [_entries removeObjectForKey:key];
+    [_recentKeys removeObject:key];
+}
+
+#pragma mark IMMemoryConsumer
+
+- (NSUInteger)memoryCostAtLevel:(IMMemoryTrimLevel)level {
+    @synchronized (self) {
+        switch (level) {
+            case IMMemoryTrimLevelAnimationFrames:
+                return _animatedCost;
+            case IMMemoryTrimLevelDecodedImages:
+                return _stillCost;
+            case IMMemoryTrimLevelMetadata:
+                return 0;
+        }
+    }
+
+    return 0;
+}
+
+- (void)trimLevel:(IMMemoryTrimLevel)level toCost:(NSUInteger)cost {
+    if (level == IMMemoryTrimLevelMetadata) {
+        return;
+    }
+
+    @synchronized (self) {
+        NSUInteger *levelCost = level == IMMemoryTrimLevelAnimationFrames ? &_animatedCost : &_stillCost;
+
+        for (NSString *key in [_recentKeys copy]) {
+            if (*levelCost <= cost) {
+                break;
+            }
+
+            if (_entries[key].level == level) {
+                [self removeEntryForKey:key];
+            }
+        }
+    }
+}
+
+@end
@@ -0,0 +1,59 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "IMImojiTransport.h"
+
+@class BFTask;
+
+/**
+* @abstract Uploads an encoded image file with PUT, streaming it from disk. Retries reuse the same file. Files larger
+* than resumableThreshold are sent whole with a Content-Range header, when the endpoint answers with 308 (Resume
+* Incomplete) the rest is sent in chunks and failed attempts query the acknowledged offset to continue from the last
+* byte it kept. Endpoints that never answer with 308 only ever receive the whole file in a single request.
+*/
+@interface IMImageUploadTask : NSObject
+
+@property(nonatomic, readonly, nonnull) NSURL *fileURL;
+
+@property(nonatomic, readonly, nonnull) NSURL *uploadURL;
+
+/**
+* @abstract Size of the file being uploaded, set once uploadWithRetries: starts
+*/
+@property(nonatomic, readonly) unsigned long long fileSize;
+
+/**
+* @abstract Number of attempts made so far, including the first one
+*/
+@property(nonatomic, readonly) NSUInteger attemptCount;
+
+/**
+* @abstract Files of at least this size can continue in chunks when the endpoint supports it. Defaults to 8MB.
+*/
+@property(nonatomic) unsigned long long resumableThreshold;
+
+/**
+* @abstract Size of each chunk for resumable uploads. Defaults to 2MB.
+*/
+@property(nonatomic) unsigned long long chunkSize;
+
+/**
+* @abstract Delay before the first retry, doubled for every following one up to 30 seconds. Defaults to 1 second.
+*/
+@property(nonatomic) NSTimeInterval retryDelay;
+
+- (nonnull instancetype)initWithTransport:(nonnull id <IMImojiTransport>)transport
+                                  fileURL:(nonnull NSURL *)fileURL
+                                uploadURL:(nonnull NSURL *)uploadURL
+                              contentType:(nonnull NSString *)contentType;
+
+/**
+* @abstract Runs the upload, retrying up to retryCount times on failure with an exponential backoff.
+* @return A task with a result of @YES when the upload completes, or the error of the final attempt
+*/
+- (nonnull BFTask *)uploadWithRetries:(int)retryCount;
+
+@end
@@ -0,0 +1,262 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Bolts/BFTask.h>
+#import <Bolts/BFTaskCompletionSource.h>
+#import "IMImageUploadTask.h"
+#import "IMImojiSession.h"
+#import "NSError+Utils.h"
+
+static const NSInteger IMImageUploadTaskResumeIncompleteStatusCode = 308;
+static const NSTimeInterval IMImageUploadTaskMaximumRetryDelay = 30.0;
+
+@implementation IMImageUploadTask {
+    id <IMImojiTransport> _transport;
+    NSString *_contentType;
+    unsigned long long _acknowledgedOffset;
+    BOOL _resumable;
+    NSData *_mappedContents;
+}
+
+- (instancetype)initWithTransport:(id <IMImojiTransport>)transport
+                          fileURL:(NSURL *)fileURL
+                        uploadURL:(NSURL *)uploadURL
+                      contentType:(NSString *)contentType {
+    self = [super init];
+    if (self) {
+        _transport = transport;
+        _fileURL = fileURL;
+        _uploadURL = uploadURL;
+        _contentType = contentType;
+        _resumableThreshold = 8 * 1024 * 1024;
+        _chunkSize = 2 * 1024 * 1024;
+        _retryDelay = 1.0;
+    }
+
+    return self;
+}
+
+- (BFTask *)uploadWithRetries:(int)retryCount {
+    NSNumber *fileSize;
+    NSError *error;
+    [self.fileURL getResourceValue:&fileSize forKey:NSURLFileSizeKey error:&error];
+
+    if (!fileSize) {
+        return [BFTask taskWithError:error ? error : [self errorWithDescription:@"Unable to read upload file"]];
+    }
+
+    _fileSize = fileSize.unsignedLongLongValue;
+
+    BFTaskCompletionSource *taskCompletionSource = [BFTaskCompletionSource taskCompletionSource];
+    [self runAttemptWithRetries:retryCount taskCompletionSource:taskCompletionSource];
+
+    return taskCompletionSource.task;
+}
+
+- (void)runAttemptWithRetries:(int)retryCount taskCompletionSource:(BFTaskCompletionSource *)taskCompletionSource {
+    BFTask *attempt;
+    _attemptCount++;
+
+    if (_resumable) {
+        // an earlier chunk was answered with 308, ask the endpoint how much it kept before continuing from there
+        attempt = [[self queryAcknowledgedOffset] continueWithSuccessBlock:^id(BFTask *task) {
+            return [task.result boolValue] ? @YES : [self uploadChunks];
+        }];
+    } else {
+        // large files declare their range so a resumable endpoint can answer with 308 when it only kept part of the
+        // file, plain endpoints ignore the header and store the whole file
+        attempt = [self uploadEntireFileWithContentRange:_fileSize > 0 && _fileSize >= self.resumableThreshold];
+    }
+
+    [attempt continueWithBlock:^id(BFTask *task) {
+        if (!task.error) {
+            taskCompletionSource.result = @YES;
+        } else if (retryCount <= 0) {
+            taskCompletionSource.error = task.error;
+        } else {
+            NSTimeInterval delay = MIN(self.retryDelay * pow(2.0, self->_attemptCount - 1), IMImageUploadTaskMaximumRetryDelay);
+
+            [[BFTask taskWithDelay:(int) (delay * 1000)] continueWithBlock:^id(BFTask *delayTask) {
+                [self runAttemptWithRetries:retryCount - 1 taskCompletionSource:taskCompletionSource];
+                return nil;
+            }];
+        }
+
+        return nil;
+    }];
+}
+
+#pragma mark Requests
+
+- (NSMutableURLRequest *)uploadRequest {
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:self.uploadURL];
+
+    request.timeoutInterval = 15.0;
+    request.HTTPMethod = @"PUT";
+    [request addValue:_contentType forHTTPHeaderField:@"Content-Type"];
+
+    return request;
+}
+
+- (BFTask *)uploadEntireFileWithContentRange:(BOOL)declareRange {
+    BFTaskCompletionSource *taskCompletionSource = [BFTaskCompletionSource taskCompletionSource];
+
+    NSMutableURLRequest *request = [self uploadRequest];
+    if (declareRange) {
+        [request setValue:[NSString stringWithFormat:@"bytes 0-%llu/%llu", _fileSize - 1, _fileSize] forHTTPHeaderField:@"Content-Range"];
+    }
+
+    [_transport runUploadTaskWithRequest:request
+                                fromFile:self.fileURL
+                                priority:NSURLSessionTaskPriorityDefault
+                       completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+                           NSInteger statusCode = [response isKindOfClass:[NSHTTPURLResponse class]] ? ((NSHTTPURLResponse *) response).statusCode : 200;
+
+                           if (error) {
+                               taskCompletionSource.error = error;
+                           } else if (declareRange && statusCode == IMImageUploadTaskResumeIncompleteStatusCode) {
+                               // the endpoint is resumable and kept only part of the file, send the rest in chunks
+                               self->_resumable = YES;
+                               self->_acknowledgedOffset = [self offsetFromResponse:(NSHTTPURLResponse *) response];
+
+                               [[self uploadChunks] continueWithBlock:^id(BFTask *task) {
+                                   if (task.error) {
+                                       taskCompletionSource.error = task.error;
+                                   } else {
+                                       taskCompletionSource.result = task.result;
+                                   }
+
+                                   return nil;
+                               }];
+                           } else if (statusCode < 200 || statusCode >= 300) {
+                               taskCompletionSource.error = [self errorWithStatusCode:statusCode];
+                           } else {
+                               taskCompletionSource.result = @YES;
+                           }
+                       }];
+
+    return taskCompletionSource.task;
+}
+
+// only sent once the endpoint has answered a chunk with 308, results in @YES when it reports the upload as already complete
+- (BFTask *)queryAcknowledgedOffset {
+    BFTaskCompletionSource *taskCompletionSource = [BFTaskCompletionSource taskCompletionSource];
+
+    NSMutableURLRequest *request = [self uploadRequest];
+    [request setValue:[NSString stringWithFormat:@"bytes */%llu", _fileSize] forHTTPHeaderField:@"Content-Range"];
+    request.HTTPBody = [NSData data];
+
+    [_transport runDataTaskWithRequest:request
+                              priority:NSURLSessionTaskPriorityDefault
+                     completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+                         if (error) {
+                             taskCompletionSource.error = error;
+                             return;
+                         }
+
+                         NSHTTPURLResponse *httpResponse = [response isKindOfClass:[NSHTTPURLResponse class]] ? (NSHTTPURLResponse *) response : nil;
+
+                         if (httpResponse.statusCode == IMImageUploadTaskResumeIncompleteStatusCode) {
+                             self->_acknowledgedOffset = [self offsetFromResponse:httpResponse];
+                             taskCompletionSource.result = @NO;
+                         } else if (httpResponse.statusCode >= 200 && httpResponse.statusCode < 300) {
+                             taskCompletionSource.result = @YES;
+                         } else {
+                             taskCompletionSource.error = [self errorWithStatusCode:httpResponse.statusCode];
+                         }
+                     }];
+
+    return taskCompletionSource.task;
+}
+
+- (BFTask *)uploadChunks {
+    if (!_mappedContents) {
+        NSError *error;
+        _mappedContents = [NSData dataWithContentsOfURL:self.fileURL options:NSDataReadingMappedIfSafe error:&error];
+
+        if (!_mappedContents) {
+            return [BFTask taskWithError:error];
+        }
+    }
+
+    unsigned long long offset = _acknowledgedOffset;
+    if (offset >= _fileSize) {
+        return [BFTask taskWithResult:@YES];
+    }
+
+    unsigned long long length = MIN(self.chunkSize, _fileSize - offset);
+
+    NSMutableURLRequest *request = [self uploadRequest];
+    [request setValue:[NSString stringWithFormat:@"bytes %llu-%llu/%llu", offset, offset + length - 1, _fileSize]
+   forHTTPHeaderField:@"Content-Range"];
+
+    request.HTTPBody = [_mappedContents subdataWithRange:NSMakeRange((NSUInteger) offset, (NSUInteger) length)];
+
+    BFTaskCompletionSource *taskCompletionSource = [BFTaskCompletionSource taskCompletionSource];
+
+    [_transport runDataTaskWithRequest:request
+                              priority:NSURLSessionTaskPriorityDefault
+                     completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+                         NSHTTPURLResponse *httpResponse = [response isKindOfClass:[NSHTTPURLResponse class]] ? (NSHTTPURLResponse *) response : nil;
+
+                         if (error) {
+                             taskCompletionSource.error = error;
+                         } else if (httpResponse.statusCode == IMImageUploadTaskResumeIncompleteStatusCode) {
+                             NSString *range = httpResponse.allHeaderFields[@"Range"];
+                             self->_acknowledgedOffset = range ? [self offsetFromResponse:httpResponse] : offset + length;
+
+                             [[self uploadChunks] continueWithBlock:^id(BFTask *task) {
+                                 if (task.error) {
+                                     taskCompletionSource.error = task.error;
+                                 } else {
+                                     taskCompletionSource.result = task.result;
+                                 }
+
+                                 return nil;
+                             }];
+                         } else if (httpResponse.statusCode >= 200 && httpResponse.statusCode < 300) {
+                             self->_acknowledgedOffset = self->_fileSize;
+                             taskCompletionSource.result = @YES;
+                         } else {
+                             taskCompletionSource.error = [self errorWithStatusCode:httpResponse.statusCode];
+                         }
+                     }];
+
+    return taskCompletionSource.task;
+}
+
+#pragma mark Utilities
+
+- (unsigned long long)offsetFromResponse:(NSHTTPURLResponse *)response {
+    // Range: bytes=0-<last byte received>
+    NSString *range = response.allHeaderFields[@"Range"];
+    NSRange separator = range ? [range rangeOfString:@"-"] : NSMakeRange(NSNotFound, 0);
+
+    if (separator.location == NSNotFound) {
+        return 0;
+    }
+
+    unsigned long long lastByte = strtoull([range substringFromIndex:separator.location + 1].UTF8String, NULL, 10);
+    return MIN(lastByte + 1, _fileSize);
+}
+
+- (NSError *)errorWithStatusCode:(NSInteger)statusCode {
+    return [NSError errorWithDomain:IMImojiSessionErrorDomain
+                               code:IMImojiSessionErrorCodeServerError
+                           userInfo:@{
+                                   NSLocalizedDescriptionKey : [NSString stringWithFormat:@"Upload failed with status %@", @(statusCode)],
+                                   IMImojiSessionErrorHTTPStatusCodeKey : @(statusCode)
+                           }];
+}
+
+- (NSError *)errorWithDescription:(NSString *)description {
+    return [NSError errorWithDomain:IMImojiSessionErrorDomain
+                               code:IMImojiSessionErrorCodeServerError
+                           userInfo:@{
+                                   NSLocalizedDescriptionKey : description
+                           }];
+}
+
+@end
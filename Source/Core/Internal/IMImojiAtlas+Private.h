@@ -0,0 +1,39 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import "IMImojiAtlas.h"
+
+@interface IMImojiAtlas ()
+
+/**
+* @abstract Clears the bitmap and assigns imojis to its cells. Draws for the previous page are dropped.
+* @return The generation of the new page, passed back to drawImage:atIndex:generation:
+*/
+- (NSUInteger)resetWithImojis:(nonnull NSArray<IMImojiObject *> *)imojis;
+
+/**
+* @abstract Generation of the page currently in the atlas
+*/
+- (NSUInteger)generation;
+
+/**
+* @abstract Scales image to fit the cell at index. Runs on the calling thread, drawing is serialized with the atlas'
+* other changes.
+* @return NO if the atlas moved to another page in the meantime
+*/
+- (BOOL)drawImage:(nonnull UIImage *)image
+          atIndex:(NSUInteger)index
+       generation:(NSUInteger)generation;
+
+/**
+* @abstract Decodes the first frame of data and draws it into the cell at index like drawImage:atIndex:generation:.
+* The frame isn't decoded ahead of drawing, decompression and scaling happen in one pass into the cell.
+* @return NO if data could not be decoded or the atlas moved to another page in the meantime
+*/
+- (BOOL)drawImageData:(nonnull NSData *)data
+              atIndex:(NSUInteger)index
+           generation:(NSUInteger)generation;
+
+@end
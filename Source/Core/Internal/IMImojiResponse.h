@@ -0,0 +1,55 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class IMMutableImojiObject, IMImojiCategoryObject, IMCategoryAttribution, IMImojiObjectRenderingOptions;
+
+/**
+* @abstract Imoji API response decoded straight from the response bytes into model objects, without building the
+* NSJSONSerialization tree first. Understands the fields of the imoji, category and attribution endpoints and reads
+* images from both the current images format and the legacy urls format. Results match readImojiObject:,
+* readCategories: and readAttribution: of IMImojiSession.
+*/
+@interface IMImojiResponse : NSObject
+
+/**
+* @abstract The response body the models were decoded from
+*/
+@property(nonatomic, readonly, nonnull) NSData *data;
+
+@property(nonatomic, readonly, nullable) NSString *status;
+
+/**
+* @abstract Imojis from the results field
+*/
+@property(nonatomic, readonly, nonnull) NSArray<IMMutableImojiObject *> *imojis;
+
+@property(nonatomic, readonly, nullable) NSString *followupSearchTerm;
+
+@property(nonatomic, readonly, nonnull) NSArray<IMImojiCategoryObject *> *relatedCategories;
+
+/**
+* @abstract Categories from the categories field, nil when the server sent null
+*/
+@property(nonatomic, readonly, nullable) NSArray<IMImojiCategoryObject *> *categories;
+
+/**
+* @abstract Attribution keyed by imoji identifier from the attribution field
+*/
+@property(nonatomic, readonly, nonnull) NSDictionary<NSString *, IMCategoryAttribution *> *attribution;
+
+/**
+* @abstract Decodes a response body. Fails with an NSCocoaErrorDomain error for malformed JSON, like NSJSONSerialization.
+*/
++ (nullable instancetype)responseWithData:(nonnull NSData *)data error:(NSError *__nullable *__nullable)error;
+
+/**
+* @abstract Every combination of render size, border style and image format, at index
+* (renderSize * 2 + borderStyle) * 4 + imageFormat. Decoded imojis share these as their dictionary keys.
+*/
++ (nonnull NSArray<IMImojiObjectRenderingOptions *> *)renderingOptions;
+
+@end
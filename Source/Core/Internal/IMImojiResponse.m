@@ -0,0 +1,913 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import "IMImojiResponse.h"
+#import "IMJSONScanner.h"
+#import "IMMutableImojiObject.h"
+#import "IMMutableCategoryObject.h"
+#import "IMMutableCategoryAttribution.h"
+#import "IMMutableArtist.h"
+#import "IMImojiObjectRenderingOptions.h"
+
+// URLs up to this size are unescaped on the stack
+static const size_t IMImojiResponseStackURLLength = 512;
+
+typedef NS_ENUM(uint8_t, IMImojiResponseKey) {
+    IMImojiResponseKeyUnknown = 0,
+
+    // response
+    IMImojiResponseKeyStatus,
+    IMImojiResponseKeyResults,
+    IMImojiResponseKeyFollowupSearchTerm,
+    IMImojiResponseKeyRelatedCategories,
+    IMImojiResponseKeyCategories,
+    IMImojiResponseKeyAttribution,
+
+    // imoji, category and attribution objects
+    IMImojiResponseKeyImojiId,
+    IMImojiResponseKeyId,
+    IMImojiResponseKeyTags,
+    IMImojiResponseKeyLicenseStyle,
+    IMImojiResponseKeyURLs,
+    IMImojiResponseKeyImages,
+    IMImojiResponseKeyAnimated,
+    IMImojiResponseKeySearchText,
+    IMImojiResponseKeyTitle,
+    IMImojiResponseKeyPriority,
+    IMImojiResponseKeyArtist,
+    IMImojiResponseKeyImojis,
+    IMImojiResponseKeyPackURLCategory,
+    IMImojiResponseKeyPackId,
+    IMImojiResponseKeyRelatedTags,
+    IMImojiResponseKeyName,
+    IMImojiResponseKeyDescription,
+    IMImojiResponseKeyPackURL,
+
+    // images
+    IMImojiResponseKeyBordered,
+    IMImojiResponseKeyUnbordered,
+    IMImojiResponseKeyPNG,
+    IMImojiResponseKeyWebP,
+    IMImojiResponseKeyGIF,
+    IMImojiResponseKeyRaw,
+    IMImojiResponseKeyThumb,
+    IMImojiResponseKeyFull,
+    IMImojiResponseKey150,
+    IMImojiResponseKey1200,
+    IMImojiResponseKey320,
+    IMImojiResponseKey512,
+    IMImojiResponseKeyURL,
+    IMImojiResponseKeyWidth,
+    IMImojiResponseKeyHeight,
+    IMImojiResponseKeyFileSize
+};
+
+typedef struct {
+    const char *name;
+    size_t length;
+    IMImojiResponseKey key;
+} IMImojiResponseKeyEntry;
+
+#define IMImojiResponseKeyEntryMake(name, key) { name, sizeof(name) - 1, key }
+
+// keys are matched against the raw response bytes, so only the values that are kept get turned into objects
+static const IMImojiResponseKeyEntry IMImojiResponseKeys[] = {
+        IMImojiResponseKeyEntryMake("status", IMImojiResponseKeyStatus),
+        IMImojiResponseKeyEntryMake("results", IMImojiResponseKeyResults),
+        IMImojiResponseKeyEntryMake("followupSearchTerm", IMImojiResponseKeyFollowupSearchTerm),
+        IMImojiResponseKeyEntryMake("relatedCategories", IMImojiResponseKeyRelatedCategories),
+        IMImojiResponseKeyEntryMake("categories", IMImojiResponseKeyCategories),
+        IMImojiResponseKeyEntryMake("attribution", IMImojiResponseKeyAttribution)
+};
+
+static const IMImojiResponseKeyEntry IMImojiResponseObjectKeys[] = {
+        IMImojiResponseKeyEntryMake("imojiId", IMImojiResponseKeyImojiId),
+        IMImojiResponseKeyEntryMake("id", IMImojiResponseKeyId),
+        IMImojiResponseKeyEntryMake("tags", IMImojiResponseKeyTags),
+        IMImojiResponseKeyEntryMake("images", IMImojiResponseKeyImages),
+        IMImojiResponseKeyEntryMake("urls", IMImojiResponseKeyURLs),
+        IMImojiResponseKeyEntryMake("animated", IMImojiResponseKeyAnimated),
+        IMImojiResponseKeyEntryMake("licenseStyle", IMImojiResponseKeyLicenseStyle),
+        IMImojiResponseKeyEntryMake("searchText", IMImojiResponseKeySearchText),
+        IMImojiResponseKeyEntryMake("title", IMImojiResponseKeyTitle),
+        IMImojiResponseKeyEntryMake("priority", IMImojiResponseKeyPriority),
+        IMImojiResponseKeyEntryMake("artist", IMImojiResponseKeyArtist),
+        IMImojiResponseKeyEntryMake("imojis", IMImojiResponseKeyImojis),
+        IMImojiResponseKeyEntryMake("packURLCategory", IMImojiResponseKeyPackURLCategory),
+        IMImojiResponseKeyEntryMake("packId", IMImojiResponseKeyPackId),
+        IMImojiResponseKeyEntryMake("relatedTags", IMImojiResponseKeyRelatedTags),
+        IMImojiResponseKeyEntryMake("name", IMImojiResponseKeyName),
+        IMImojiResponseKeyEntryMake("description", IMImojiResponseKeyDescription),
+        IMImojiResponseKeyEntryMake("packURL", IMImojiResponseKeyPackURL)
+};
+
+static const IMImojiResponseKeyEntry IMImojiResponseImageGroupKeys[] = {
+        IMImojiResponseKeyEntryMake("bordered", IMImojiResponseKeyBordered),
+        IMImojiResponseKeyEntryMake("unbordered", IMImojiResponseKeyUnbordered),
+        IMImojiResponseKeyEntryMake("animated", IMImojiResponseKeyAnimated)
+};
+
+static const IMImojiResponseKeyEntry IMImojiResponseImageFormatKeys[] = {
+        IMImojiResponseKeyEntryMake("png", IMImojiResponseKeyPNG),
+        IMImojiResponseKeyEntryMake("webp", IMImojiResponseKeyWebP),
+        IMImojiResponseKeyEntryMake("gif", IMImojiResponseKeyGIF)
+};
+
+static const IMImojiResponseKeyEntry IMImojiResponseImageSizeKeys[] = {
+        IMImojiResponseKeyEntryMake("150", IMImojiResponseKey150),
+        IMImojiResponseKeyEntryMake("320", IMImojiResponseKey320),
+        IMImojiResponseKeyEntryMake("512", IMImojiResponseKey512),
+        IMImojiResponseKeyEntryMake("1200", IMImojiResponseKey1200)
+};
+
+static const IMImojiResponseKeyEntry IMImojiResponseImageKeys[] = {
+        IMImojiResponseKeyEntryMake("url", IMImojiResponseKeyURL),
+        IMImojiResponseKeyEntryMake("width", IMImojiResponseKeyWidth),
+        IMImojiResponseKeyEntryMake("height", IMImojiResponseKeyHeight),
+        IMImojiResponseKeyEntryMake("fileSize", IMImojiResponseKeyFileSize)
+};
+
+static const IMImojiResponseKeyEntry IMImojiResponseLegacySizeKeys[] = {
+        IMImojiResponseKeyEntryMake("thumb", IMImojiResponseKeyThumb),
+        IMImojiResponseKeyEntryMake("full", IMImojiResponseKeyFull),
+        IMImojiResponseKeyEntryMake("320", IMImojiResponseKey320),
+        IMImojiResponseKeyEntryMake("512", IMImojiResponseKey512),
+        IMImojiResponseKeyEntryMake("raw", IMImojiResponseKeyRaw)
+};
+
+#define IMImojiResponseKeyLookup(scanner, table) IMImojiResponseKeyInTable(scanner, table, sizeof(table) / sizeof(table[0]))
+
+static IMImojiResponseKey IMImojiResponseKeyInTable(const IMJSONScanner *scanner, const IMImojiResponseKeyEntry *table, size_t count) {
+    IMJSONString key = scanner->string;
+
+    for (size_t i = 0; i < count; i++) {
+        if ((key.escaped || key.length == table[i].length) && IMJSONScannerStringEquals(scanner, key, table[i].name)) {
+            return table[i].key;
+        }
+    }
+
+    return IMImojiResponseKeyUnknown;
+}
+
+// index of a size key, in IMImojiObjectRenderSize order
+static NSInteger IMImojiResponseSizeIndex(IMImojiResponseKey key) {
+    switch (key) {
+        case IMImojiResponseKey150:
+        case IMImojiResponseKeyThumb:
+            return IMImojiObjectRenderSizeThumbnail;
+        case IMImojiResponseKey1200:
+        case IMImojiResponseKeyFull:
+            return IMImojiObjectRenderSizeFullResolution;
+        case IMImojiResponseKey320:
+            return IMImojiObjectRenderSize320;
+        case IMImojiResponseKey512:
+            return IMImojiObjectRenderSize512;
+        default:
+            return -1;
+    }
+}
+
+static NSInteger IMImojiResponseFormatIndex(IMImojiResponseKey key) {
+    switch (key) {
+        case IMImojiResponseKeyPNG:
+            return 0;
+        case IMImojiResponseKeyWebP:
+            return 1;
+        case IMImojiResponseKeyGIF:
+            return 2;
+        default:
+            return -1;
+    }
+}
+
+static NSInteger IMImojiResponseFormatIndexForImageFormat(IMImojiObjectImageFormat imageFormat) {
+    switch (imageFormat) {
+        case IMImojiObjectImageFormatPNG:
+            return 0;
+        case IMImojiObjectImageFormatWebP:
+        case IMImojiObjectImageFormatAnimatedWebp:
+            return 1;
+        case IMImojiObjectImageFormatAnimatedGif:
+            return 2;
+    }
+
+    return 0;
+}
+
+enum {
+    IMImojiResponseFormatCount = 3,
+    IMImojiResponseSizeCount = 4,
+
+    // every combination of render size, border style and image format
+    IMImojiResponseRenderingOptionsCount = IMImojiResponseSizeCount * 2 * 4
+};
+
+typedef struct {
+    IMJSONString url;
+    double width;
+    double height;
+    double fileSize;
+    BOOL present;
+    BOOL hasURL;
+    BOOL hasWidth;
+    BOOL hasHeight;
+    BOOL hasFileSize;
+} IMImojiResponseImage;
+
+// everything readImojiObject: looks at, filled while scanning since either format may come first
+typedef struct {
+    // images: bordered/unbordered/animated, png/webp/gif, sizes
+    IMImojiResponseImage images[3][IMImojiResponseFormatCount][IMImojiResponseSizeCount];
+
+    // urls: png/webp, bordered/raw, sizes
+    BOOL hasLegacyURLs;
+    BOOL legacyStaticPresent[2][2];
+    IMImojiResponseImage legacyStatic[2][2][IMImojiResponseSizeCount];
+
+    // animated: png/webp/gif, sizes
+    BOOL legacyAnimatedPresent[IMImojiResponseFormatCount];
+    IMImojiResponseImage legacyAnimated[IMImojiResponseFormatCount][IMImojiResponseSizeCount];
+} IMImojiResponseImages;
+
+typedef NS_ENUM(NSUInteger, IMImojiResponseObjectKind) {
+    IMImojiResponseObjectKindImoji,
+    IMImojiResponseObjectKindCategory,
+    IMImojiResponseObjectKindAttribution
+};
+
+@interface IMImojiResponse ()
+
+@property(nonatomic, readwrite) NSData *data;
+@property(nonatomic, readwrite) NSString *status;
+@property(nonatomic, readwrite) NSArray<IMMutableImojiObject *> *imojis;
+@property(nonatomic, readwrite) NSString *followupSearchTerm;
+@property(nonatomic, readwrite) NSArray<IMImojiCategoryObject *> *relatedCategories;
+@property(nonatomic, readwrite) NSArray<IMImojiCategoryObject *> *categories;
+@property(nonatomic, readwrite) NSDictionary<NSString *, IMCategoryAttribution *> *attribution;
+
+@end
+
+@interface IMImojiResponseDecoder : NSObject {
+@public
+    IMJSONScanner _scanner;
+}
+
+@end
+
+@implementation IMImojiResponse
+
++ (instancetype)responseWithData:(NSData *)data error:(NSError **)error {
+    IMImojiResponseDecoder *decoder = [IMImojiResponseDecoder new];
+    IMJSONScannerInit(&decoder->_scanner, data.bytes, data.length);
+
+    IMImojiResponse *response = [decoder decodeResponse];
+
+    if (!IMJSONScannerFinish(&decoder->_scanner)) {
+        if (error) {
+            *error = [NSError errorWithDomain:NSCocoaErrorDomain
+                                         code:NSPropertyListReadCorruptError
+                                     userInfo:@{
+                                             NSDebugDescriptionErrorKey : [NSString stringWithFormat:@"Invalid JSON around character %lu.", (unsigned long) decoder->_scanner.position]
+                                     }];
+        }
+
+        return nil;
+    }
+
+    response.data = [data copy];
+    return response;
+}
+
++ (NSArray<IMImojiObjectRenderingOptions *> *)renderingOptions {
+    static NSArray *renderingOptions;
+    static dispatch_once_t onceToken;
+
+    // dictionaries copy their keys, so one set of options is shared by every decoded imoji
+    dispatch_once(&onceToken, ^{
+        NSMutableArray *options = [NSMutableArray array];
+        for (NSUInteger renderSize = IMImojiObjectRenderSizeThumbnail; renderSize <= IMImojiObjectRenderSize512; renderSize++) {
+            for (NSUInteger borderStyle = IMImojiObjectBorderStyleSticker; borderStyle <= IMImojiObjectBorderStyleNone; borderStyle++) {
+                for (NSUInteger imageFormat = IMImojiObjectImageFormatPNG; imageFormat <= IMImojiObjectImageFormatAnimatedWebp; imageFormat++) {
+                    [options addObject:[IMImojiObjectRenderingOptions optionsWithRenderSize:(IMImojiObjectRenderSize) renderSize
+                                                                                borderStyle:(IMImojiObjectBorderStyle) borderStyle
+                                                                                imageFormat:(IMImojiObjectImageFormat) imageFormat]];
+                }
+            }
+        }
+
+        renderingOptions = [options copy];
+    });
+
+    return renderingOptions;
+}
+
+@end
+
+@implementation IMImojiResponseDecoder
+
+#pragma mark Values
+
+- (void)skipValue {
+    IMJSONScannerSkipValue(&_scanner, IMJSONScannerReadValue(&_scanner));
+}
+
+- (NSString *)readString {
+    IMJSONToken token = IMJSONScannerReadValue(&_scanner);
+    if (token == IMJSONTokenString) {
+        return IMJSONScannerCopyString(&_scanner, _scanner.string);
+    }
+
+    IMJSONScannerSkipValue(&_scanner, token);
+    return nil;
+}
+
+- (BOOL)readStringLocation:(IMJSONString *)string {
+    IMJSONToken token = IMJSONScannerReadValue(&_scanner);
+    if (token == IMJSONTokenString) {
+        *string = _scanner.string;
+        return YES;
+    }
+
+    IMJSONScannerSkipValue(&_scanner, token);
+    return NO;
+}
+
+// booleans count as numbers, like the NSNumbers NSJSONSerialization returns for them
+- (BOOL)readNumber:(double *)number {
+    IMJSONToken token = IMJSONScannerReadValue(&_scanner);
+    switch (token) {
+        case IMJSONTokenNumber:
+            *number = _scanner.number;
+            return YES;
+        case IMJSONTokenTrue:
+            *number = 1;
+            return YES;
+        case IMJSONTokenFalse:
+            *number = 0;
+            return YES;
+        default:
+            IMJSONScannerSkipValue(&_scanner, token);
+            return NO;
+    }
+}
+
+- (BOOL)readObjectStart {
+    IMJSONToken token = IMJSONScannerReadValue(&_scanner);
+    if (token == IMJSONTokenObject) {
+        return YES;
+    }
+
+    IMJSONScannerSkipValue(&_scanner, token);
+    return NO;
+}
+
+- (NSArray *)readStringArray {
+    IMJSONToken token = IMJSONScannerReadValue(&_scanner);
+    if (token != IMJSONTokenArray) {
+        IMJSONScannerSkipValue(&_scanner, token);
+        return nil;
+    }
+
+    NSMutableArray *strings = [NSMutableArray array];
+    for (BOOL more = IMJSONScannerFirstElement(&_scanner); more; more = IMJSONScannerNextElement(&_scanner)) {
+        NSString *string = [self readString];
+        if (string) {
+            [strings addObject:string];
+        }
+    }
+
+    return strings;
+}
+
+- (NSArray *)readObjectArrayOfKind:(IMImojiResponseObjectKind)kind {
+    IMJSONToken token = IMJSONScannerReadValue(&_scanner);
+    if (token != IMJSONTokenArray) {
+        IMJSONScannerSkipValue(&_scanner, token);
+        return nil;
+    }
+
+    return [self readElementsOfKind:kind];
+}
+
+// reads the elements of an array that was just opened, anything but objects is skipped
+- (NSArray *)readElementsOfKind:(IMImojiResponseObjectKind)kind {
+    NSMutableArray *objects = [NSMutableArray array];
+    for (BOOL more = IMJSONScannerFirstElement(&_scanner); more; more = IMJSONScannerNextElement(&_scanner)) {
+        if ([self readObjectStart]) {
+            id object = [self readObjectOfKind:kind order:objects.count];
+            if (object) {
+                [objects addObject:object];
+            }
+        }
+    }
+
+    return objects;
+}
+
+- (id)URLWithString:(IMJSONString)string {
+    static BOOL URLBytes[256];
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        const char *allowed = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-._~:/?#[]@!$&'()*+,;=%";
+        for (const char *c = allowed; *c; c++) {
+            URLBytes[(uint8_t) *c] = YES;
+        }
+    });
+
+    if (string.length > IMImojiResponseStackURLLength) {
+        NSURL *url = [NSURL URLWithString:IMJSONScannerCopyString(&_scanner, string)];
+        return url ?: [NSNull null];
+    }
+
+    uint8_t buffer[IMImojiResponseStackURLLength];
+    size_t length = IMJSONScannerUnescapeString(&_scanner, string, buffer);
+
+    BOOL plain = length > 0;
+    for (size_t i = 0; i < length && plain; i++) {
+        plain = URLBytes[buffer[i]];
+    }
+
+    NSURL *url;
+    if (plain) {
+        url = CFBridgingRelease(CFURLCreateWithBytes(kCFAllocatorDefault, buffer, (CFIndex) length, kCFStringEncodingUTF8, NULL));
+    } else {
+        // let NSURL reject or accept anything unusual exactly as it always has
+        NSString *urlString = [[NSString alloc] initWithBytes:buffer length:length encoding:NSUTF8StringEncoding];
+        url = urlString ? [NSURL URLWithString:urlString] : nil;
+    }
+
+    return url ?: [NSNull null];
+}
+
+#pragma mark Response
+
+- (IMImojiResponse *)decodeResponse {
+    IMImojiResponse *response = [IMImojiResponse new];
+    response.imojis = @[];
+    response.relatedCategories = @[];
+    response.categories = @[];
+    response.attribution = @{};
+
+    if (![self readObjectStart]) {
+        return response;
+    }
+
+    for (BOOL more = IMJSONScannerFirstMember(&_scanner); more; more = IMJSONScannerNextMember(&_scanner)) {
+        switch (IMImojiResponseKeyLookup(&_scanner, IMImojiResponseKeys)) {
+            case IMImojiResponseKeyStatus:
+                response.status = [self readString];
+                break;
+
+            case IMImojiResponseKeyResults:
+                response.imojis = [self readObjectArrayOfKind:IMImojiResponseObjectKindImoji] ?: @[];
+                break;
+
+            case IMImojiResponseKeyFollowupSearchTerm:
+                response.followupSearchTerm = [self readString];
+                break;
+
+            case IMImojiResponseKeyRelatedCategories:
+                response.relatedCategories = [self readObjectArrayOfKind:IMImojiResponseObjectKindCategory] ?: @[];
+                break;
+
+            case IMImojiResponseKeyCategories: {
+                IMJSONToken token = IMJSONScannerReadValue(&_scanner);
+                if (token == IMJSONTokenNull) {
+                    response.categories = nil;
+                } else if (token == IMJSONTokenArray) {
+                    response.categories = [self readElementsOfKind:IMImojiResponseObjectKindCategory];
+                } else {
+                    IMJSONScannerSkipValue(&_scanner, token);
+                }
+                break;
+            }
+
+            case IMImojiResponseKeyAttribution:
+                response.attribution = [self readAttributionMap];
+                break;
+
+            default:
+                [self skipValue];
+                break;
+        }
+    }
+
+    return response;
+}
+
+- (NSDictionary *)readAttributionMap {
+    NSMutableDictionary *attribution = [NSMutableDictionary dictionary];
+    if (![self readObjectStart]) {
+        return attribution;
+    }
+
+    for (BOOL more = IMJSONScannerFirstMember(&_scanner); more; more = IMJSONScannerNextMember(&_scanner)) {
+        NSString *imojiId = IMJSONScannerCopyString(&_scanner, _scanner.string);
+
+        if ([self readObjectStart]) {
+            IMCategoryAttribution *value = [self readObjectOfKind:IMImojiResponseObjectKindAttribution order:0];
+            if (imojiId && value) {
+                attribution[imojiId] = value;
+            }
+        }
+    }
+
+    return attribution;
+}
+
+#pragma mark Objects
+
+// reads the members of an object that was just opened, imojis, categories and attribution share most of their fields
+- (id)readObjectOfKind:(IMImojiResponseObjectKind)kind order:(NSUInteger)order {
+    IMImojiResponseImages images;
+    memset(&images, 0, sizeof(images));
+
+    NSString *imojiId, *identifier, *searchText, *title, *packId, *name, *summary;
+    NSArray *tags, *previewImojis, *relatedTags;
+    NSURL *packURL;
+    IMCategoryAttribution *attribution;
+    IMImojiObjectLicenseStyle licenseStyle = IMImojiObjectLicenseStyleNonCommercial;
+    IMAttributionURLCategory urlCategory = IMAttributionURLCategoryWebsite;
+    double priority = 0;
+    BOOL hasIdentifier = NO, hasImages = NO, hasArtist = NO;
+
+    for (BOOL more = IMJSONScannerFirstMember(&_scanner); more; more = IMJSONScannerNextMember(&_scanner)) {
+        IMJSONString string;
+
+        switch (IMImojiResponseKeyLookup(&_scanner, IMImojiResponseObjectKeys)) {
+            case IMImojiResponseKeyImojiId:
+                imojiId = [self readString];
+                break;
+
+            case IMImojiResponseKeyId:
+                hasIdentifier = YES;
+                identifier = [self readString];
+                break;
+
+            case IMImojiResponseKeyTags:
+                tags = [self readStringArray];
+                break;
+
+            case IMImojiResponseKeyImages:
+                hasImages = YES;
+                [self readImages:&images];
+                break;
+
+            case IMImojiResponseKeyURLs:
+                [self readLegacyURLs:&images];
+                break;
+
+            case IMImojiResponseKeyAnimated:
+                [self readLegacyAnimated:&images];
+                break;
+
+            case IMImojiResponseKeyLicenseStyle:
+                if ([self readStringLocation:&string] && IMJSONScannerStringEquals(&_scanner, string, "commercialPrint")) {
+                    licenseStyle = IMImojiObjectLicenseStyleCommercialPrint;
+                }
+                break;
+
+            case IMImojiResponseKeySearchText:
+                searchText = [self readString];
+                break;
+
+            case IMImojiResponseKeyTitle:
+                title = [self readString];
+                break;
+
+            case IMImojiResponseKeyPriority:
+                [self readNumber:&priority];
+                break;
+
+            case IMImojiResponseKeyArtist: {
+                IMJSONToken token = IMJSONScannerReadValue(&_scanner);
+                if (token == IMJSONTokenObject) {
+                    hasArtist = YES;
+                    attribution = [self readObjectOfKind:IMImojiResponseObjectKindAttribution order:0];
+                } else if (token == IMJSONTokenNull) {
+                    hasArtist = YES;
+                } else {
+                    IMJSONScannerSkipValue(&_scanner, token);
+                }
+                break;
+            }
+
+            case IMImojiResponseKeyImojis:
+                previewImojis = [self readObjectArrayOfKind:IMImojiResponseObjectKindImoji];
+                break;
+
+            case IMImojiResponseKeyPackURLCategory:
+                if ([self readStringLocation:&string]) {
+                    urlCategory = [self attributionURLCategoryForString:string defaultCategory:urlCategory];
+                }
+                break;
+
+            case IMImojiResponseKeyPackId:
+                packId = [self readString];
+                break;
+
+            case IMImojiResponseKeyRelatedTags:
+                relatedTags = [self readStringArray];
+                break;
+
+            case IMImojiResponseKeyName:
+                name = [self readString];
+                break;
+
+            case IMImojiResponseKeyDescription:
+                summary = [self readString];
+                break;
+
+            case IMImojiResponseKeyPackURL: {
+                NSString *urlString = [self readString];
+                packURL = urlString ? [[NSURL alloc] initWithString:urlString] : nil;
+                break;
+            }
+
+            default:
+                [self skipValue];
+                break;
+        }
+    }
+
+    switch (kind) {
+        case IMImojiResponseObjectKindImoji:
+            return [self imojiWithIdentifier:imojiId ?: identifier tags:tags licenseStyle:licenseStyle images:&images];
+
+        case IMImojiResponseObjectKindCategory:
+            if (!previewImojis) {
+                // legacy support, pre server version v2.1
+                previewImojis = hasImages ? @[[self imojiWithIdentifier:imojiId ?: identifier tags:tags licenseStyle:licenseStyle images:&images]] : @[];
+            }
+
+            // readCategories: attributes categories without an artist field with an empty attribution
+            if (!hasArtist) {
+                attribution = [IMMutableCategoryAttribution attributionWithIdentifier:nil
+                                                                               artist:nil
+                                                                                  URL:nil
+                                                                          urlCategory:IMAttributionURLCategoryWebsite
+                                                                          relatedTags:nil
+                                                                         licenseStyle:IMImojiObjectLicenseStyleNonCommercial];
+            }
+
+            return [IMMutableCategoryObject objectWithIdentifier:searchText
+                                                           order:order
+                                                   previewImojis:previewImojis
+                                                        priority:(NSUInteger) priority
+                                                           title:title
+                                                     attribution:attribution];
+
+        case IMImojiResponseObjectKindAttribution: {
+            IMArtist *artist = nil;
+            if (hasIdentifier) {
+                artist = [IMMutableArtist artistWithIdentifier:identifier
+                                                          name:name
+                                                       summary:summary
+                                                  previewImoji:[self imojiWithIdentifier:imojiId ?: identifier tags:tags licenseStyle:licenseStyle images:&images]];
+            }
+
+            return [IMMutableCategoryAttribution attributionWithIdentifier:packId
+                                                                    artist:artist
+                                                                       URL:packURL
+                                                               urlCategory:urlCategory
+                                                               relatedTags:relatedTags ?: @[]
+                                                              licenseStyle:licenseStyle];
+        }
+    }
+
+    return nil;
+}
+
+- (IMAttributionURLCategory)attributionURLCategoryForString:(IMJSONString)string defaultCategory:(IMAttributionURLCategory)defaultCategory {
+    if (IMJSONScannerStringEquals(&_scanner, string, "website")) {
+        return IMAttributionURLCategoryWebsite;
+    } else if (IMJSONScannerStringEquals(&_scanner, string, "video")) {
+        return IMAttributionURLCategoryVideo;
+    } else if (IMJSONScannerStringEquals(&_scanner, string, "instagram")) {
+        return IMAttributionURLCategoryInstagram;
+    } else if (IMJSONScannerStringEquals(&_scanner, string, "twitter")) {
+        return IMAttributionURLCategoryTwitter;
+    } else if (IMJSONScannerStringEquals(&_scanner, string, "app store")) {
+        return IMAttributionURLCategoryAppStore;
+    }
+
+    return defaultCategory;
+}
+
+#pragma mark Images
+
+- (void)readImages:(IMImojiResponseImages *)images {
+    if (![self readObjectStart]) {
+        return;
+    }
+
+    for (BOOL more = IMJSONScannerFirstMember(&_scanner); more; more = IMJSONScannerNextMember(&_scanner)) {
+        NSInteger group;
+        switch (IMImojiResponseKeyLookup(&_scanner, IMImojiResponseImageGroupKeys)) {
+            case IMImojiResponseKeyBordered:
+                group = 0;
+                break;
+            case IMImojiResponseKeyUnbordered:
+                group = 1;
+                break;
+            case IMImojiResponseKeyAnimated:
+                group = 2;
+                break;
+            default:
+                group = -1;
+                break;
+        }
+
+        if (group < 0 || ![self readObjectStart]) {
+            if (group < 0) {
+                [self skipValue];
+            }
+            continue;
+        }
+
+        for (BOOL formats = IMJSONScannerFirstMember(&_scanner); formats; formats = IMJSONScannerNextMember(&_scanner)) {
+            NSInteger format = IMImojiResponseFormatIndex(IMImojiResponseKeyLookup(&_scanner, IMImojiResponseImageFormatKeys));
+            if (format < 0) {
+                [self skipValue];
+            } else if ([self readObjectStart]) {
+                [self readImageSizes:images->images[group][format]];
+            }
+        }
+    }
+}
+
+// members of an object that was just opened holding url, width, height and fileSize objects by size
+- (void)readImageSizes:(IMImojiResponseImage *)sizes {
+    for (BOOL more = IMJSONScannerFirstMember(&_scanner); more; more = IMJSONScannerNextMember(&_scanner)) {
+        NSInteger size = IMImojiResponseSizeIndex(IMImojiResponseKeyLookup(&_scanner, IMImojiResponseImageSizeKeys));
+        if (size < 0 || ![self readObjectStart]) {
+            if (size < 0) {
+                [self skipValue];
+            }
+            continue;
+        }
+
+        IMImojiResponseImage *image = &sizes[size];
+        image->present = YES;
+
+        for (BOOL fields = IMJSONScannerFirstMember(&_scanner); fields; fields = IMJSONScannerNextMember(&_scanner)) {
+            switch (IMImojiResponseKeyLookup(&_scanner, IMImojiResponseImageKeys)) {
+                case IMImojiResponseKeyURL:
+                    image->hasURL = [self readStringLocation:&image->url];
+                    break;
+                case IMImojiResponseKeyWidth:
+                    image->hasWidth = [self readNumber:&image->width];
+                    break;
+                case IMImojiResponseKeyHeight:
+                    image->hasHeight = [self readNumber:&image->height];
+                    break;
+                case IMImojiResponseKeyFileSize:
+                    image->hasFileSize = [self readNumber:&image->fileSize];
+                    break;
+                default:
+                    [self skipValue];
+                    break;
+            }
+        }
+    }
+}
+
+// urls: {png: {thumb: "", full: "", 320: "", 512: "", raw: {...}}, webp: {...}}
+- (void)readLegacyURLs:(IMImojiResponseImages *)images {
+    if (![self readObjectStart]) {
+        return;
+    }
+
+    images->hasLegacyURLs = YES;
+
+    for (BOOL more = IMJSONScannerFirstMember(&_scanner); more; more = IMJSONScannerNextMember(&_scanner)) {
+        NSInteger format = IMImojiResponseFormatIndex(IMImojiResponseKeyLookup(&_scanner, IMImojiResponseImageFormatKeys));
+        if (format < 0 || format > 1 || ![self readObjectStart]) {
+            if (format < 0 || format > 1) {
+                [self skipValue];
+            }
+            continue;
+        }
+
+        images->legacyStaticPresent[format][0] = YES;
+        for (BOOL sizes = IMJSONScannerFirstMember(&_scanner); sizes; sizes = IMJSONScannerNextMember(&_scanner)) {
+            IMImojiResponseKey key = IMImojiResponseKeyLookup(&_scanner, IMImojiResponseLegacySizeKeys);
+
+            if (key == IMImojiResponseKeyRaw) {
+                if ([self readObjectStart]) {
+                    images->legacyStaticPresent[format][1] = YES;
+                    [self readLegacyStaticSizes:images->legacyStatic[format][1]];
+                }
+                continue;
+            }
+
+            NSInteger size = IMImojiResponseSizeIndex(key);
+            if (size < 0) {
+                [self skipValue];
+            } else {
+                IMImojiResponseImage *image = &images->legacyStatic[format][0][size];
+                image->hasURL = [self readStringLocation:&image->url];
+            }
+        }
+    }
+}
+
+// members of an object that was just opened holding thumb, full, 320 and 512 URL strings
+- (void)readLegacyStaticSizes:(IMImojiResponseImage *)sizes {
+    for (BOOL more = IMJSONScannerFirstMember(&_scanner); more; more = IMJSONScannerNextMember(&_scanner)) {
+        NSInteger size = IMImojiResponseSizeIndex(IMImojiResponseKeyLookup(&_scanner, IMImojiResponseLegacySizeKeys));
+        if (size < 0) {
+            [self skipValue];
+        } else {
+            sizes[size].hasURL = [self readStringLocation:&sizes[size].url];
+        }
+    }
+}
+
+// animated: {gif: {150: {url: ""}, ...}, webp: {...}}
+- (void)readLegacyAnimated:(IMImojiResponseImages *)images {
+    if (![self readObjectStart]) {
+        return;
+    }
+
+    for (BOOL more = IMJSONScannerFirstMember(&_scanner); more; more = IMJSONScannerNextMember(&_scanner)) {
+        NSInteger format = IMImojiResponseFormatIndex(IMImojiResponseKeyLookup(&_scanner, IMImojiResponseImageFormatKeys));
+        if (format < 1 || ![self readObjectStart]) {
+            if (format < 1) {
+                [self skipValue];
+            }
+            continue;
+        }
+
+        images->legacyAnimatedPresent[format] = YES;
+        [self readImageSizes:images->legacyAnimated[format]];
+    }
+}
+
+#pragma mark Models
+
+- (IMMutableImojiObject *)imojiWithIdentifier:(NSString *)identifier
+                                         tags:(NSArray *)tags
+                                 licenseStyle:(IMImojiObjectLicenseStyle)licenseStyle
+                                       images:(const IMImojiResponseImages *)images {
+    NSArray<IMImojiObjectRenderingOptions *> *renderingOptions = [IMImojiResponse renderingOptions];
+    NSNull *nullValue = [NSNull null];
+
+    __unsafe_unretained id urlKeys[IMImojiResponseRenderingOptionsCount], dimensionKeys[IMImojiResponseRenderingOptionsCount];
+    id urls[IMImojiResponseRenderingOptionsCount], dimensions[IMImojiResponseRenderingOptionsCount], fileSizes[IMImojiResponseRenderingOptionsCount];
+    NSUInteger urlCount = 0, dimensionCount = 0;
+
+    for (IMImojiObjectRenderingOptions *options in renderingOptions) {
+        BOOL animated = options.imageFormat == IMImojiObjectImageFormatAnimatedGif || options.imageFormat == IMImojiObjectImageFormatAnimatedWebp;
+        NSInteger format = IMImojiResponseFormatIndexForImageFormat(options.imageFormat);
+        const IMImojiResponseImage *image;
+        BOOL legacy = images->hasLegacyURLs;
+
+        if (legacy) {
+            NSUInteger border = options.borderStyle == IMImojiObjectBorderStyleNone ? 1 : 0;
+            BOOL present = animated ? images->legacyAnimatedPresent[format] : images->legacyStaticPresent[format][border];
+
+            // readImojiObject: leaves out dimensions and file sizes of formats missing from legacy responses
+            if (!present) {
+                urlKeys[urlCount] = options;
+                urls[urlCount++] = nullValue;
+                continue;
+            }
+
+            image = animated ? &images->legacyAnimated[format][options.renderSize] : &images->legacyStatic[format][border][options.renderSize];
+        } else {
+            NSUInteger group = animated ? 2 : (options.borderStyle == IMImojiObjectBorderStyleNone ? 1 : 0);
+            image = &images->images[group][format][options.renderSize];
+        }
+
+        urlKeys[urlCount] = dimensionKeys[dimensionCount] = options;
+        urls[urlCount++] = image->hasURL ? [self URLWithString:image->url] : nullValue;
+
+        // legacy responses only carry URLs
+        if (!legacy && image->hasWidth && image->hasHeight && (float) image->width > 0 && (float) image->height > 0) {
+            dimensions[dimensionCount] = [NSValue valueWithCGSize:CGSizeMake((float) image->width, (float) image->height)];
+        } else {
+            dimensions[dimensionCount] = nullValue;
+        }
+
+        if (!legacy && image->hasFileSize && (long) image->fileSize > 0) {
+            fileSizes[dimensionCount] = @((long) image->fileSize);
+        } else {
+            fileSizes[dimensionCount] = nullValue;
+        }
+
+        dimensionCount++;
+    }
+
+    return [IMMutableImojiObject imojiWithIdentifier:identifier
+                                                tags:tags ?: @[]
+                                                urls:[NSDictionary dictionaryWithObjects:urls forKeys:urlKeys count:urlCount]
+                                     imageDimensions:[NSDictionary dictionaryWithObjects:dimensions forKeys:dimensionKeys count:dimensionCount]
+                                           fileSizes:[NSDictionary dictionaryWithObjects:fileSizes forKeys:dimensionKeys count:dimensionCount]
+                                        licenseStyle:licenseStyle];
+}
+
+@end
@@ -6,12 +6,15 @@
 #import <Foundation/Foundation.h>
 #import "IMImojiSession.h"
 #import "IMImojiObject.h"
+#import "IMTracer.h"
 
 @class IMImojiSessionCredentials;
 @class IMMutableImojiObject;
 @class BFTask;
 @class IMImojiSessionStoragePolicy;
 @class IMCategoryAttribution;
+@class IMMutation;
+@class IMImojiResponse;
 
 @interface IMImojiSession (Private)
 
@@ -19,6 +22,19 @@
 
 + (nonnull IMImojiSessionCredentials *)credentials;
 
+/**
+* @abstract Replaces the credentials shared by every session, readers see either the previous snapshot or this one
+*/
++ (void)setCredentials:(nonnull IMImojiSessionCredentials *)credentials;
+
+#pragma mark Startup
+
+/**
+* @abstract Loads credentials, creates the storage directories and the default transport in the background. Started on first
+* use and shared by every caller, requests made before it completes wait on it.
+*/
+- (nonnull BFTask *)readinessTask;
+
 #pragma mark Auth
 
 - (void)renewCredentials:(nonnull IMImojiSessionAsyncResponseCallback)callback;
@@ -43,12 +59,50 @@
 
 - (nonnull BFTask *)runValidatedDeleteTaskWithPath:(nonnull NSString *)path andParameters:(nonnull NSDictionary *)parameters;
 
+- (nonnull BFTask *)runValidatedTaskWithPath:(nonnull NSString *)path
+                                      method:(nonnull NSString *)method
+                                  parameters:(nonnull NSDictionary *)parameters
+                                    priority:(float)priority;
+
+/**
+* @abstract Runs a validated request whose successful response is decoded straight into an IMImojiResponse
+*/
+- (nonnull BFTask *)runValidatedImojiResponseTaskWithPath:(nonnull NSString *)path
+                                                   method:(nonnull NSString *)method
+                                               parameters:(nonnull NSDictionary *)parameters;
+
+/**
+* @abstract Runs a GET request for content kept in a snapshot when contentSnapshotsEnabled is set. A stored snapshot is
+* passed to snapshotHandler on the main thread, synchronously when called from it, and refreshed by the request. The
+* task then results in the fresh response, or is cancelled if the response matches the snapshot or failed after the
+* snapshot was served.
+*/
+- (nonnull BFTask *)runSnapshotImojiResponseTaskWithPath:(nonnull NSString *)path
+                                              parameters:(nonnull NSDictionary *)parameters
+                                         snapshotHandler:(nonnull void (^)(IMImojiResponse *__nonnull snapshot))snapshotHandler;
+
+/**
+* @abstract Same as runSnapshotImojiResponseTaskWithPath:parameters:snapshotHandler: with the request at priority
+*/
+- (nonnull BFTask *)runSnapshotImojiResponseTaskWithPath:(nonnull NSString *)path
+                                              parameters:(nonnull NSDictionary *)parameters
+                                                priority:(float)priority
+                                         snapshotHandler:(nonnull void (^)(IMImojiResponse *__nonnull snapshot))snapshotHandler;
+
 - (nonnull BFTask *)validateSession;
 
+/**
+* @abstract Issues a low priority HEAD request to url so that a connection to its host is open for later requests.
+* Always succeeds, failures are ignored.
+*/
+- (nonnull BFTask *)openConnectionToURL:(nonnull NSURL *)url;
+
 #pragma mark Network Responses
 
 - (BOOL)validateServerResponse:(nonnull NSDictionary *)results error:(NSError *__nullable *__nullable)error;
 
+- (BOOL)validateImojiResponse:(nullable IMImojiResponse *)response error:(NSError *__nullable *__nullable)error;
+
 - (nonnull NSArray *)convertServerDataSetToImojiArray:(nonnull NSDictionary *)serverResponse;
 
 - (void)handleImojiFetchResponse:(nonnull NSArray *)imojiObjects
@@ -63,6 +117,13 @@
                                  imojiIndex:(NSUInteger)imojiIndex
                           cancellationToken:(nonnull NSOperation *)cancellationToken;
 
+/**
+* @abstract Downloads the image at url, retrying failed transfers. Local files are read from disk.
+* @return A task resulting in the undecoded image data
+*/
+- (nonnull BFTask *)downloadImageDataAsync:(nonnull NSURL *)url
+                         cancellationToken:(nonnull NSOperation *)cancellationToken;
+
 - (nonnull IMMutableImojiObject *)readImojiObject:(nonnull NSDictionary *)result;
 
 - (nonnull IMCategoryAttribution *)readAttribution:(nonnull NSDictionary *)attributionDictionary;
@@ -70,9 +131,34 @@
 - (nonnull NSArray<IMImojiCategoryObject *> *)readCategories:(nonnull NSArray *)categories;
 
 - (nonnull BFTask *)uploadImageInBackgroundWithRetries:(nonnull UIImage *)image
+                                        encodedFileURL:(nullable NSURL *)encodedFileURL
                                              uploadUrl:(nonnull NSURL *)uploadUrl
                                             retryCount:(int)retryCount;
 
+- (nonnull BFTask *)uploadImojiImage:(nonnull UIImage *)image
+                          localImoji:(nonnull IMImojiObject *)localImoji
+                      createResponse:(nonnull NSDictionary *)createResponse;
+
+#pragma mark Mutations
+
+- (nonnull BFTask *)sendMutation:(nonnull IMMutation *)mutation;
+
+/**
+* @abstract Drops the collection mirror's pending changes for an imoji whose mutation will not be sent, either because
+* recording it failed or because it cancelled out a previous one
+*/
+- (void)settleCollectionMirrorChangesForEnqueueTask:(nonnull BFTask *)enqueueTask
+                                    imojiIdentifier:(nonnull NSString *)imojiIdentifier;
+
+#pragma mark Tracing
+
+/**
+* @abstract Begins a span for a public call when tracing is enabled. Callers make it the current span while issuing
+* the call's requests and end it once the call's callbacks have run.
+* @return The span, 0 when tracing is disabled
+*/
+- (IMTraceSpan)beginTraceSpan:(nonnull const char *)name;
+
 #pragma mark Session State Management
 
 - (void)updateImojiState:(IMImojiSessionState)newState;
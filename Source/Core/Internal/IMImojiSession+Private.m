@@ -7,6 +7,7 @@
 #import <YYImage_MagicNarwhal/YYImage.h>
 #import "IMImojiSession+Private.h"
 #import "IMImojiSessionCredentials.h"
+#import "NSError+Utils.h"
 #import "ImojiSDK.h"
 #import "BFTask+Utils.h"
 #import "RequestUtils.h"
@@ -18,6 +19,19 @@
 #import "IMMutableCategoryAttribution.h"
 #import "IMMutableArtist.h"
 #import "IMMutableCategoryObject.h"
+#import "IMImageUploadTask.h"
+#import "IMMutationOutbox.h"
+#import "IMAnalyticsPipeline.h"
+#import "IMURLSessionTransport.h"
+#import "IMSharedResourceRegistry.h"
+#import "IMMetricsRecorder.h"
+#import "IMRequestTemplate.h"
+#import "IMImojiResponse.h"
+#import "IMContentSnapshotStore.h"
+#import "IMUserCollectionMirror.h"
+#import "IMImageMemoryCache.h"
+#import "IMRenditionSelector.h"
+#import "IMWriteBehindQueue.h"
 
 NSString *const IMImojiSessionFileAccessTokenKey = @"at";
 NSString *const IMImojiSessionFileRefreshTokenKey = @"rt";
@@ -28,14 +42,48 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
 
 @implementation IMImojiSession (Private)
 
+#pragma mark Startup
+
+- (BFTask *)readinessTask {
+    @synchronized (self) {
+        if (!self->_readinessTask) {
+            self->_readinessTask = [BFTask im_taskWithExecutor:self.executors.controlExecutor block:^id(BFTask *task) {
+                [self.storagePolicy createDirectoriesIfNeeded];
+
+                // connections and caches are shared with the other sessions using the same cache path
+                self->_sharedResources = [[IMSharedResourceRegistry sharedRegistry] resourcesForStoragePolicy:self.storagePolicy];
+                if (!self->_transport) {
+                    IMURLSessionTransport *transport = [self->_sharedResources createTransport];
+#if __IPHONE_OS_VERSION_MAX_ALLOWED >= 100000
+                    IMMetricsRecorder *metricsRecorder = self->_metricsRecorder;
+                    transport.metricsHandler = ^(NSURLSessionTask *sessionTask, NSURLSessionTaskMetrics *metrics) {
+                        [metricsRecorder recordTaskMetrics:metrics];
+                    };
+#endif
+
+                    self->_transport = transport;
+                }
+                [self readAuthenticationCredentials];
+
+                [self->_mutationOutbox resume];
+                [self->_analyticsPipeline resume];
+
+                return nil;
+            }];
+        }
+
+        return self->_readinessTask;
+    }
+}
+
 #pragma mark Authentication Serialization/Deserialization
 
 - (void)readAuthenticationFromDictionary:(NSDictionary *)authenticationInfo {
-    [IMImojiSession credentials].accessToken = authenticationInfo[IMImojiSessionFileAccessTokenKey];
-    [IMImojiSession credentials].refreshToken = authenticationInfo[IMImojiSessionFileRefreshTokenKey];
-    [IMImojiSession credentials].expirationDate = [NSDate dateWithTimeIntervalSince1970:((NSNumber *) authenticationInfo[IMImojiSessionFileExpirationKey]).doubleValue];
-    [IMImojiSession credentials].accountSynchronized = authenticationInfo[IMImojiSessionFileUserSynchronizedKey] && ((NSNumber *) authenticationInfo[IMImojiSessionFileUserSynchronizedKey]).boolValue;
-    [IMImojiSession credentials].clientId = authenticationInfo[IMImojiSessionFileClientIdKey];
+    [IMImojiSession setCredentials:[[IMImojiSessionCredentials alloc] initWithAccessToken:authenticationInfo[IMImojiSessionFileAccessTokenKey]
+                                                                             refreshToken:authenticationInfo[IMImojiSessionFileRefreshTokenKey]
+                                                                           expirationDate:[NSDate dateWithTimeIntervalSince1970:((NSNumber *) authenticationInfo[IMImojiSessionFileExpirationKey]).doubleValue]
+                                                                                 clientId:authenticationInfo[IMImojiSessionFileClientIdKey]
+                                                                      accountSynchronized:authenticationInfo[IMImojiSessionFileUserSynchronizedKey] && ((NSNumber *) authenticationInfo[IMImojiSessionFileUserSynchronizedKey]).boolValue]];
 
     [self updateImojiState:IMImojiSessionStateConnected];
 }
@@ -60,15 +108,17 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
 }
 
 - (BFTask *)writeAuthenticationCredentials {
+    IMImojiSessionCredentials *credentials = [IMImojiSession credentials];
     NSMutableDictionary *authenticationInfo = [NSMutableDictionary dictionaryWithCapacity:4];
 
-    authenticationInfo[IMImojiSessionFileAccessTokenKey] = [IMImojiSession credentials].accessToken;
-    authenticationInfo[IMImojiSessionFileRefreshTokenKey] = [IMImojiSession credentials].refreshToken;
-    authenticationInfo[IMImojiSessionFileExpirationKey] = @([IMImojiSession credentials].expirationDate.timeIntervalSince1970);
-    authenticationInfo[IMImojiSessionFileUserSynchronizedKey] = @([IMImojiSession credentials].accountSynchronized);
-    authenticationInfo[IMImojiSessionFileClientIdKey] = [IMImojiSession credentials].clientId;
+    authenticationInfo[IMImojiSessionFileAccessTokenKey] = credentials.accessToken;
+    authenticationInfo[IMImojiSessionFileRefreshTokenKey] = credentials.refreshToken;
+    authenticationInfo[IMImojiSessionFileExpirationKey] = @(credentials.expirationDate.timeIntervalSince1970);
+    authenticationInfo[IMImojiSessionFileUserSynchronizedKey] = @(credentials.accountSynchronized);
+    authenticationInfo[IMImojiSessionFileClientIdKey] = credentials.clientId;
 
-    return [BFTask im_serialBackgroundTaskWithBlock:^id(BFTask *task) {
+    NSString *sessionFile = self.sessionFilePath;
+    BFContinuationBlock writeBlock = ^id(BFTask *task) {
         NSError *error;
         NSData *jsonData = [NSJSONSerialization dataWithJSONObject:authenticationInfo
                                                            options:0
@@ -78,7 +128,6 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
             return nil;
         }
 
-        NSString *sessionFile = self.sessionFilePath;
         [jsonData writeToFile:sessionFile options:NSDataWritingAtomic error:&error];
 
         if (error) {
@@ -86,7 +135,15 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
         }
 
         return nil;
-    }];
+    };
+
+    // credentials are shared by every session, writes are chained so that the last one made is the one left on disk
+    static BFTask *lastWriteTask = nil;
+    @synchronized ([IMImojiSession class]) {
+        lastWriteTask = [(lastWriteTask ?: [BFTask taskWithResult:nil]) continueWithExecutor:[BFTask im_executorWithImojiExecutor:self.executors.diskExecutor]
+                                                                                    withBlock:writeBlock];
+        return lastWriteTask;
+    }
 }
 
 #pragma mark Utilities
@@ -96,99 +153,159 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
     }];
 }
 
+- (IMRequestTemplate *)requestTemplateWithPath:(NSString *)path
+                                        method:(NSString *)method {
+    NSString *key = [method stringByAppendingString:path];
+    NSUInteger localeGeneration = [IMRequestTemplate currentLocaleGeneration];
+
+    @synchronized (self->_requestTemplates) {
+        IMRequestTemplate *template = self->_requestTemplates[key];
+        if (!template || template.localeGeneration != localeGeneration) {
+            template = [[IMRequestTemplate alloc] initWithURLString:[ImojiSDKServerURL stringByAppendingString:path] method:method];
+            self->_requestTemplates[key] = template;
+        }
+
+        return template;
+    }
+}
+
 - (BFTask *)runPostTaskWithPath:(NSString *)path
                         headers:(NSDictionary *)headers
                   andParameters:(NSDictionary *)parameters {
-    return [self runImojiURLRequest:[NSMutableURLRequest POSTRequestWithURL:[NSURL URLWithString:[NSString stringWithFormat:@"%@%@", ImojiSDKServerURL, path]]
-                                                                 parameters:parameters]
-                            headers:headers];
+    return [self runImojiURLRequest:[[self requestTemplateWithPath:path method:@"POST"] requestWithParameters:parameters additionalHeaders:headers]
+                           priority:NSURLSessionTaskPriorityDefault];
 }
 
 - (BFTask *)runValidatedGetTaskWithPath:(NSString *)path
                           andParameters:(NSDictionary *)parameters {
-    return [self runValidatedImojiURLRequest:[NSURL URLWithString:[NSString stringWithFormat:@"%@%@", ImojiSDKServerURL, path]]
-                                  parameters:parameters
-                                      method:@"GET"
-                                     headers:@{}];
+    return [self runValidatedRequestWithTemplate:[self requestTemplateWithPath:path method:@"GET"]
+                                      parameters:parameters
+                                        priority:NSURLSessionTaskPriorityDefault];
 }
 
 - (BFTask *)runValidatedPutTaskWithPath:(NSString *)path
                           andParameters:(NSDictionary *)parameters {
-    return [self runValidatedImojiURLRequest:[NSURL URLWithString:[NSString stringWithFormat:@"%@%@", ImojiSDKServerURL, path]]
-                                  parameters:parameters
-                                      method:@"PUT"
-                                     headers:@{}];
+    return [self runValidatedRequestWithTemplate:[self requestTemplateWithPath:path method:@"PUT"]
+                                      parameters:parameters
+                                        priority:NSURLSessionTaskPriorityDefault];
 }
 
 - (BFTask *)runValidatedPostTaskWithPath:(NSString *)path
                            andParameters:(NSDictionary *)parameters {
-    return [self runValidatedImojiURLRequest:[NSURL URLWithString:[NSString stringWithFormat:@"%@%@", ImojiSDKServerURL, path]]
-                                  parameters:parameters
-                                      method:@"POST"
-                                     headers:@{}];
+    return [self runValidatedRequestWithTemplate:[self requestTemplateWithPath:path method:@"POST"]
+                                      parameters:parameters
+                                        priority:NSURLSessionTaskPriorityDefault];
 }
 
 - (BFTask *)runValidatedDeleteTaskWithPath:(NSString *)path
                              andParameters:(NSDictionary *)parameters {
-    return [self runValidatedImojiURLRequest:[NSURL URLWithString:[NSString stringWithFormat:@"%@%@", ImojiSDKServerURL, path]]
-                                  parameters:parameters
-                                      method:@"DELETE"
-                                     headers:@{}];
+    return [self runValidatedRequestWithTemplate:[self requestTemplateWithPath:path method:@"DELETE"]
+                                      parameters:parameters
+                                        priority:NSURLSessionTaskPriorityDefault];
 }
 
-- (NSDictionary *)getRequestHeaders:(NSDictionary *)additionalHeaders {
-    NSMutableDictionary *headers = [NSMutableDictionary dictionary];
+- (BFTask *)runValidatedTaskWithPath:(NSString *)path
+                              method:(NSString *)method
+                          parameters:(NSDictionary *)parameters
+                            priority:(float)priority {
+    return [self runValidatedRequestWithTemplate:[self requestTemplateWithPath:path method:method]
+                                      parameters:parameters
+                                        priority:priority];
+}
 
-    NSString *locale = [[NSLocale currentLocale] localeIdentifier];
-    NSRange startRange = [locale rangeOfString:@"_"];
-    NSString *language = [locale stringByReplacingCharactersInRange:NSMakeRange(0, startRange.length + 1)
-                                                         withString:[NSLocale preferredLanguages][0]];
+- (BFTask *)runValidatedImojiResponseTaskWithPath:(NSString *)path
+                                           method:(NSString *)method
+                                       parameters:(NSDictionary *)parameters {
+    return [self runValidatedRequestWithTemplate:[self requestTemplateWithPath:path method:method]
+                                      parameters:parameters
+                                        priority:NSURLSessionTaskPriorityDefault
+                            decodesImojiResponse:YES];
+}
 
-    headers[@"Imoji-SDK-Version"] = [ImojiSDK sharedInstance].sdkVersion;
+- (BFTask *)runSnapshotImojiResponseTaskWithPath:(NSString *)path
+                                      parameters:(NSDictionary *)parameters
+                                 snapshotHandler:(void (^)(IMImojiResponse *snapshot))snapshotHandler {
+    return [self runSnapshotImojiResponseTaskWithPath:path
+                                           parameters:parameters
+                                             priority:NSURLSessionTaskPriorityDefault
+                                      snapshotHandler:snapshotHandler];
+}
 
-    if (language != nil) {
-        headers[@"User-Locale"] = language;
+- (BFTask *)runSnapshotImojiResponseTaskWithPath:(NSString *)path
+                                      parameters:(NSDictionary *)parameters
+                                        priority:(float)priority
+                                 snapshotHandler:(void (^)(IMImojiResponse *snapshot))snapshotHandler {
+    BFTask *responseTask = [self runValidatedRequestWithTemplate:[self requestTemplateWithPath:path method:@"GET"]
+                                                      parameters:parameters
+                                                        priority:priority
+                                            decodesImojiResponse:YES];
+    if (!self->_contentSnapshotsEnabled) {
+        return responseTask;
     }
 
-    if (additionalHeaders) {
-        [headers addEntriesFromDictionary:additionalHeaders];
+    // category titles are localized, snapshots taken under another locale are not reused
+    IMContentSnapshotStore *snapshotStore = self->_contentSnapshotStore;
+    NSString *key = [NSString stringWithFormat:@"%@?%@|%@",
+                                               path,
+                                               [NSString URLQueryWithParameters:parameters options:URLQueryOptionSortKeys],
+                                               [self requestTemplateWithPath:path method:@"GET"].headers[@"User-Locale"] ?: @""];
+
+    IMImojiResponse *snapshot = [snapshotStore responseForKey:key];
+    [self->_metricsRecorder recordCacheTier:IMMetricsCacheTierContentSnapshots hit:snapshot != nil];
+
+    if (snapshot) {
+        if ([NSThread isMainThread]) {
+            snapshotHandler(snapshot);
+        } else {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                snapshotHandler(snapshot);
+            });
+        }
     }
 
-    return headers;
+    return [responseTask continueWithBlock:^id(BFTask *task) {
+        if (task.error || task.cancelled || ![self validateImojiResponse:task.result error:nil]) {
+            // callers keep showing the snapshot, failures only reach those who had nothing to show
+            return snapshot ? [BFTask cancelledTask] : task;
+        }
+
+        return [snapshotStore storeResponse:task.result forKey:key] ? task : [BFTask cancelledTask];
+    }];
+}
+
+- (BFTask *)runValidatedRequestWithTemplate:(IMRequestTemplate *)template
+                                 parameters:(NSDictionary *)parameters
+                                   priority:(float)priority {
+    return [self runValidatedRequestWithTemplate:template
+                                      parameters:parameters
+                                        priority:priority
+                            decodesImojiResponse:NO];
 }
 
-- (BFTask *)runValidatedImojiURLRequest:(NSURL *)url
-                             parameters:(NSDictionary *)parameters
-                                 method:(NSString *)method
-                                headers:(NSDictionary *)headers {
+- (BFTask *)runValidatedRequestWithTemplate:(IMRequestTemplate *)template
+                                 parameters:(NSDictionary *)parameters
+                                   priority:(float)priority
+                       decodesImojiResponse:(BOOL)decodesImojiResponse {
     BFTaskCompletionSource *taskCompletionSource = [BFTaskCompletionSource taskCompletionSource];
 
     [[self validateSession] continueWithBlock:^id(BFTask *task) {
         if (task.error) {
             taskCompletionSource.error = task.error;
         } else {
-            NSMutableURLRequest *request;
             NSMutableDictionary *parametersWithAuth = [NSMutableDictionary dictionaryWithDictionary:parameters];
             parametersWithAuth[@"access_token"] = task.result;
 
-            if ([@"GET" isEqualToString:method]) {
-                request = [NSMutableURLRequest GETRequestWithURL:url parameters:parametersWithAuth];
-            } else if ([@"DELETE" isEqualToString:method]) {
-                request = [NSMutableURLRequest DELETERequestWithURL:url parameters:parametersWithAuth];
-            } else if ([@"POST" isEqualToString:method]) {
-                request = [NSMutableURLRequest POSTRequestWithURL:url parameters:parametersWithAuth];
-            } else if ([@"PUT" isEqualToString:method]) {
-                request = [NSMutableURLRequest PUTRequestWithURL:url parameters:parametersWithAuth];
-            }
+            NSMutableURLRequest *request = [template requestWithParameters:parametersWithAuth additionalHeaders:nil];
 
-            [[self runImojiURLRequest:request headers:headers] continueWithBlock:^id(BFTask *imojiRequest) {
+            [[self runImojiURLRequest:request priority:priority decodesImojiResponse:decodesImojiResponse] continueWithBlock:^id(BFTask *imojiRequest) {
                 if (imojiRequest.error) {
                     if (imojiRequest.error.userInfo && [@"invalid_token" isEqualToString:imojiRequest.error.userInfo[@"status"]]) {
+                        [self->_metricsRecorder recordRetryForURL:template.URL];
                         [self renewCredentials:^(BOOL successful, NSError *error) {
-                            [[self runValidatedImojiURLRequest:url
-                                                    parameters:parameters
-                                                        method:method
-                                                       headers:headers] continueWithBlock:^id(BFTask *validationTask) {
+                            [[self runValidatedRequestWithTemplate:template
+                                                        parameters:parameters
+                                                          priority:priority
+                                              decodesImojiResponse:decodesImojiResponse] continueWithBlock:^id(BFTask *validationTask) {
                                 if (validationTask.error) {
                                     taskCompletionSource.error = validationTask.error;
                                 } else {
@@ -216,10 +333,11 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
 }
 
 - (void)renewCredentials:(IMImojiSessionAsyncResponseCallback)callback {
-    [IMImojiSession credentials].accessToken = nil;
-    [IMImojiSession credentials].refreshToken = nil;
-    [IMImojiSession credentials].expirationDate = nil;
-    [IMImojiSession credentials].accountSynchronized = NO;
+    [IMImojiSession setCredentials:[[IMImojiSessionCredentials alloc] initWithAccessToken:nil
+                                                                             refreshToken:nil
+                                                                           expirationDate:nil
+                                                                                 clientId:[IMImojiSession credentials].clientId
+                                                                      accountSynchronized:NO]];
 
     [[self validateSession] continueWithBlock:^id(BFTask *task) {
         if (callback) {
@@ -236,41 +354,82 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
 
 
 - (BFTask *)runImojiURLRequest:(NSMutableURLRequest *)request
-                       headers:(NSDictionary *)headers {
+                      priority:(float)priority {
+    return [self runImojiURLRequest:request priority:priority decodesImojiResponse:NO];
+}
 
-    [request setAllHTTPHeaderFields:[self getRequestHeaders:headers]];
-    BFTaskCompletionSource *taskCompletionSource = [BFTaskCompletionSource taskCompletionSource];
+// successful responses result in an IMImojiResponse when decodesImojiResponse is set, in the JSON object otherwise
+- (BFTask *)runImojiURLRequest:(NSMutableURLRequest *)request
+                      priority:(float)priority
+          decodesImojiResponse:(BOOL)decodesImojiResponse {
+    if (priority < NSURLSessionTaskPriorityDefault) {
+        request.networkServiceType = NSURLNetworkServiceTypeBackground;
+    }
 
-    [[self->_urlSession dataTaskWithRequest:request
-                          completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
-                              if (error) {
-                                  taskCompletionSource.error = error;
-                              } else {
-                                  NSError *jsonError;
-                                  NSDictionary *jsonInfo;
-
-                                  if (data.length > 0) {
-                                      jsonInfo = [NSJSONSerialization JSONObjectWithData:data
-                                                                                 options:NSJSONReadingAllowFragments
-                                                                                   error:&jsonError];
-                                  } else {
-                                      jsonInfo = nil;
-                                  }
-
-                                  if (jsonError) {
-                                      taskCompletionSource.error = jsonError;
-                                  } else {
-                                      if ([response isKindOfClass:[NSHTTPURLResponse class]] &&
-                                              ((NSHTTPURLResponse *) response).statusCode != 200) {
-                                          taskCompletionSource.error = [NSError errorWithDomain:IMImojiSessionErrorDomain
-                                                                                           code:IMImojiSessionErrorCodeServerError
-                                                                                       userInfo:jsonInfo];
-                                      } else {
-                                          taskCompletionSource.result = jsonInfo;
-                                      }
-                                  }
-                              }
-                          }] resume];
+    BFTaskCompletionSource *taskCompletionSource = [BFTaskCompletionSource taskCompletionSource];
+    IMMetricsRecorder *metricsRecorder = self->_metricsRecorder;
+    IMImojiExecutor *networkExecutor = self.executors.networkExecutor;
+    IMTraceSpan span = [IMTracer currentSpan];
+    uint64_t startTime = IMMetricsTimestamp();
+
+    [self->_transport runDataTaskWithRequest:request
+                                    priority:priority
+                           completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+                               BOOL failed = error != nil ||
+                                       ([response isKindOfClass:[NSHTTPURLResponse class]] && ((NSHTTPURLResponse *) response).statusCode != 200);
+                               [metricsRecorder recordRequestToURL:request.URL
+                                                         startTime:startTime
+                                                         bytesSent:request.HTTPBody.length
+                                                     bytesReceived:data.length
+                                                            failed:failed];
+                               [IMTracer recordStage:"apiRequest" span:span enqueueTime:startTime startTime:startTime];
+
+                               // parsed off the URL session's delegate queue, which is shared by every request of the session
+                               [networkExecutor execute:^{
+                                   // continuations run inline when the result is set, attribute them to the same span
+                                   IMTraceSpan previousSpan = [IMTracer setCurrentSpan:span];
+
+                                   if (error) {
+                                       taskCompletionSource.error = error;
+                                   } else {
+                                       NSError *jsonError;
+                                       id jsonInfo;
+                                       BOOL successful = !([response isKindOfClass:[NSHTTPURLResponse class]] &&
+                                               ((NSHTTPURLResponse *) response).statusCode != 200);
+
+                                       if (data.length > 0) {
+                                           uint64_t parseStartTime = IMMetricsTimestamp();
+                                           if (decodesImojiResponse && successful) {
+                                               // models are built while scanning, error bodies still go through NSJSONSerialization for their userInfo
+                                               jsonInfo = [IMImojiResponse responseWithData:data error:&jsonError];
+                                           } else {
+                                               jsonInfo = [NSJSONSerialization JSONObjectWithData:data
+                                                                                          options:NSJSONReadingAllowFragments
+                                                                                            error:&jsonError];
+                                           }
+                                           [metricsRecorder recordPhase:IMMetricsPhaseJSONParsing startTime:parseStartTime];
+                                       } else {
+                                           jsonInfo = nil;
+                                       }
+
+                                       if (!successful) {
+                                           // the status decides whether the request is retried, error pages aren't always JSON
+                                           NSMutableDictionary *userInfo = [jsonInfo isKindOfClass:[NSDictionary class]] ? [jsonInfo mutableCopy] : [NSMutableDictionary dictionary];
+                                           userInfo[IMImojiSessionErrorHTTPStatusCodeKey] = @(((NSHTTPURLResponse *) response).statusCode);
+
+                                           taskCompletionSource.error = [NSError errorWithDomain:IMImojiSessionErrorDomain
+                                                                                            code:IMImojiSessionErrorCodeServerError
+                                                                                        userInfo:userInfo];
+                                       } else if (jsonError) {
+                                           taskCompletionSource.error = jsonError;
+                                       } else {
+                                           taskCompletionSource.result = jsonInfo;
+                                       }
+                                   }
+
+                                   [IMTracer setCurrentSpan:previousSpan];
+                               }];
+                           }];
 
     return taskCompletionSource.task;
 }
@@ -279,22 +438,68 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
                           headers:(NSDictionary *)headers {
 
     BFTaskCompletionSource *taskCompletionSource = [BFTaskCompletionSource taskCompletionSource];
-
-    [[self->_urlSession dataTaskWithRequest:request completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+    IMMetricsRecorder *metricsRecorder = self->_metricsRecorder;
+    IMTraceSpan span = [IMTracer currentSpan];
+    uint64_t startTime = IMMetricsTimestamp();
+
+    [self->_transport runDataTaskWithRequest:request priority:NSURLSessionTaskPriorityDefault completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+        [metricsRecorder recordRequestToURL:request.URL
+                                  startTime:startTime
+                                  bytesSent:request.HTTPBody.length
+                              bytesReceived:data.length
+                                     failed:error != nil];
+        [IMTracer recordStage:"imageRequest" span:span enqueueTime:startTime startTime:startTime];
+
+        IMTraceSpan previousSpan = [IMTracer setCurrentSpan:span];
         if (error) {
             taskCompletionSource.error = error;
         } else {
             taskCompletionSource.result = data;
         }
-    }] resume];
+        [IMTracer setCurrentSpan:previousSpan];
+    }];
+
+    return taskCompletionSource.task;
+}
+
+- (BFTask *)openConnectionToURL:(NSURL *)url {
+    BFTaskCompletionSource *taskCompletionSource = [BFTaskCompletionSource taskCompletionSource];
+
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:url
+                                                           cachePolicy:NSURLRequestReloadIgnoringLocalCacheData
+                                                       timeoutInterval:10.0];
+    request.HTTPMethod = @"HEAD";
+    request.networkServiceType = NSURLNetworkServiceTypeBackground;
+
+    [self->_transport runDataTaskWithRequest:request
+                                    priority:NSURLSessionTaskPriorityLow
+                           completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+                               taskCompletionSource.result = @(error == nil);
+                           }];
 
     return taskCompletionSource.task;
 }
 
 - (BFTask *)validateSession {
+    // a valid token is returned right away, only renewals go through the control executor. The session is connected
+    // once readinessTask created its transport and loaded the credentials
+    IMImojiSessionCredentials *credentials = [IMImojiSession credentials];
+    ImojiSDK *sdk = [ImojiSDK sharedInstance];
+    if (credentials.accessTokenTask && sdk.clientId && sdk.apiToken && self->_sessionState == IMImojiSessionStateConnected &&
+            [credentials isValidForClientId:sdk.clientId]) {
+        return credentials.accessTokenTask;
+    }
+
     BFTaskCompletionSource *taskCompletionSource = [BFTaskCompletionSource taskCompletionSource];
+    IMMetricsRecorder *metricsRecorder = self->_metricsRecorder;
+    uint64_t startTime = IMMetricsTimestamp();
 
-    [BFTask im_serialBackgroundTaskWithBlock:^id(BFTask *task) {
+    [taskCompletionSource.task continueWithBlock:^id(BFTask *task) {
+        [metricsRecorder recordPhase:IMMetricsPhaseTokenValidation startTime:startTime];
+        return nil;
+    }];
+
+    [[self readinessTask] continueWithExecutor:[IMTracer executor:[BFTask im_executorWithImojiExecutor:self.executors.controlExecutor] stage:"validateSession"] withBlock:^id(BFTask *task) {
         if (![ImojiSDK sharedInstance].clientId) {
             NSError *apiError = [NSError errorWithDomain:IMImojiSessionErrorDomain
                                                     code:IMImojiSessionErrorCodeInvalidCredentials
@@ -312,25 +517,30 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
             taskCompletionSource.error = apiError;
         }
 
-        if ([IMImojiSession credentials].accessToken) {
+        // loaded by readinessTask or published by another session in the meantime
+        IMImojiSessionCredentials *currentCredentials = [IMImojiSession credentials];
+
+        if (currentCredentials.accessToken) {
             // refresh
-            if ([IMImojiSession credentials].expirationDate && [[IMImojiSession credentials].expirationDate compare:[NSDate date]] != NSOrderedDescending) {
+            if (currentCredentials.expirationDate && [currentCredentials.expirationDate compare:[NSDate date]] != NSOrderedDescending) {
                 [[self runPostTaskWithPath:@"/oauth/token"
                                    headers:self.getOAuthBearerHeaders
-                             andParameters:@{@"grant_type" : @"refresh_token", @"refresh_token" : [IMImojiSession credentials].refreshToken}]
+                             andParameters:@{@"grant_type" : @"refresh_token", @"refresh_token" : currentCredentials.refreshToken}]
                         continueWithBlock:^id(BFTask *postTask) {
 
                             if ([postTask.result isKindOfClass:[NSDictionary class]]) {
                                 NSDictionary *results = postTask.result;
 
-                                [IMImojiSession credentials].clientId = [ImojiSDK sharedInstance].clientId.UUIDString;
-                                [IMImojiSession credentials].accessToken = results[@"access_token"];
-                                [IMImojiSession credentials].refreshToken = results[@"refresh_token"];
-                                [IMImojiSession credentials].expirationDate = [NSDate dateWithTimeIntervalSinceNow:((NSNumber *) results[@"expires_in"]).integerValue];
+                                IMImojiSessionCredentials *refreshedCredentials = [[IMImojiSessionCredentials alloc] initWithAccessToken:results[@"access_token"]
+                                                                                                                            refreshToken:results[@"refresh_token"]
+                                                                                                                          expirationDate:[NSDate dateWithTimeIntervalSinceNow:((NSNumber *) results[@"expires_in"]).integerValue]
+                                                                                                                                clientId:[ImojiSDK sharedInstance].clientId.UUIDString
+                                                                                                                     accountSynchronized:currentCredentials.accountSynchronized];
+                                [IMImojiSession setCredentials:refreshedCredentials];
 
                                 [self writeAuthenticationCredentials];
                                 [self updateImojiState:IMImojiSessionStateConnected];
-                                taskCompletionSource.result = [IMImojiSession credentials].accessToken;
+                                taskCompletionSource.result = refreshedCredentials.accessToken;
 
                             } else {
                                 // get a new access token if the refresh token is invalid
@@ -341,10 +551,10 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
                         }];
             } else {
                 // if the client id's changed, generate a new access token
-                if ([IMImojiSession credentials].clientId && ![[IMImojiSession credentials].clientId isEqualToString:[ImojiSDK sharedInstance].clientId.UUIDString]) {
+                if (currentCredentials.clientId && ![currentCredentials.clientId isEqualToString:[ImojiSDK sharedInstance].clientId.UUIDString]) {
                     [self getNewAccessTokenWithCompletionSource:taskCompletionSource];
                 } else {
-                    taskCompletionSource.result = [IMImojiSession credentials].accessToken;
+                    taskCompletionSource.result = currentCredentials.accessToken;
                     [self updateImojiState:IMImojiSessionStateConnected];
                 }
             }
@@ -367,22 +577,27 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
                 if ([postTask.result isKindOfClass:[NSDictionary class]]) {
                     NSDictionary *results = postTask.result;
 
-                    [IMImojiSession credentials].accessToken = results[@"access_token"];
-                    [IMImojiSession credentials].refreshToken = results[@"refresh_token"];
-                    [IMImojiSession credentials].clientId = [ImojiSDK sharedInstance].clientId.UUIDString;
-                    [IMImojiSession credentials].expirationDate = [NSDate dateWithTimeIntervalSinceNow:((NSNumber *) results[@"expires_in"]).integerValue];
-                    [IMImojiSession credentials].accountSynchronized = NO;
+                    IMImojiSessionCredentials *credentials = [[IMImojiSessionCredentials alloc] initWithAccessToken:results[@"access_token"]
+                                                                                                       refreshToken:results[@"refresh_token"]
+                                                                                                     expirationDate:[NSDate dateWithTimeIntervalSinceNow:((NSNumber *) results[@"expires_in"]).integerValue]
+                                                                                                           clientId:[ImojiSDK sharedInstance].clientId.UUIDString
+                                                                                                accountSynchronized:NO];
+                    [IMImojiSession setCredentials:credentials];
 
                     [self writeAuthenticationCredentials];
                     [self updateImojiState:IMImojiSessionStateConnected];
 
-                    taskCompletionSource.result = [IMImojiSession credentials].accessToken;
+                    taskCompletionSource.result = credentials.accessToken;
                 } else {
+                    // requests waiting on a token are retried later, the failure usually means the device is offline
+                    NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
+                    userInfo[NSLocalizedDescriptionKey] = [NSString stringWithFormat:@"Server error: %@", postTask.error];
+                    userInfo[NSUnderlyingErrorKey] = postTask.error;
+                    userInfo[IMImojiSessionErrorTransientKey] = @YES;
+
                     taskCompletionSource.error = [NSError errorWithDomain:IMImojiSessionErrorDomain
                                                                      code:IMImojiSessionErrorCodeServerError
-                                                                 userInfo:@{
-                                                                         NSLocalizedDescriptionKey : [NSString stringWithFormat:@"Server error: %@", postTask.error]
-                                                                 }];
+                                                                 userInfo:userInfo];
 
                     [self updateImojiState:IMImojiSessionStateNotConnected];
                 }
@@ -480,10 +695,15 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
         urls[renderingOption] = [NSURL URLWithString:[NSString stringWithFormat:@"file://%@", [self filePathFromImoji:imojiObject
                                                                                                      renderingOptions:renderingOption]]];
 
-        [tasks addObject:[self writeImoji:imojiObject
-                         renderingOptions:renderingOption
-                            imageContents:UIImagePNGRepresentation(renderingOptions[renderingOption])
-                              synchronous:NO]];
+        UIImage *image = renderingOptions[renderingOption];
+        [tasks addObject:[[BFTask im_taskWithExecutor:self.executors.imageExecutor block:^id(BFTask *task) {
+            return UIImagePNGRepresentation(image);
+        }] continueWithSuccessBlock:^id(BFTask *task) {
+            return [self writeImoji:imojiObject
+                   renderingOptions:renderingOption
+                      imageContents:task.result
+                        synchronous:NO];
+        }]];
     }
 
     return [[BFTask taskForCompletionOfAllTasks:tasks] continueWithBlock:^id(BFTask *task) {
@@ -520,19 +740,35 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
 }
 
 
+// current snapshot, replaced as a whole and never modified in place
+static IMImojiSessionCredentials *IMImojiSessionCurrentCredentials = nil;
+
 + (IMImojiSessionCredentials *)credentials {
-    static IMImojiSessionCredentials *authInfo = nil;
-    static dispatch_once_t predicate;
+    // only the pointer is copied under the lock, readers never wait on a renewal
+    @synchronized ([IMImojiSessionCredentials class]) {
+        if (!IMImojiSessionCurrentCredentials) {
+            IMImojiSessionCurrentCredentials = [IMImojiSessionCredentials new];
+        }
 
-    dispatch_once(&predicate, ^{
-        authInfo = [IMImojiSessionCredentials new];
-    });
+        return IMImojiSessionCurrentCredentials;
+    }
+}
 
-    return authInfo;
++ (void)setCredentials:(IMImojiSessionCredentials *)credentials {
+    @synchronized ([IMImojiSessionCredentials class]) {
+        IMImojiSessionCurrentCredentials = credentials;
+    }
 }
 
 - (BOOL)validateServerResponse:(NSDictionary *)results error:(NSError **)error {
-    NSString *status = [results im_checkedStringForKey:@"status"];
+    return [self validateServerStatus:[results im_checkedStringForKey:@"status"] error:error];
+}
+
+- (BOOL)validateImojiResponse:(IMImojiResponse *)response error:(NSError **)error {
+    return [self validateServerStatus:response.status error:error];
+}
+
+- (BOOL)validateServerStatus:(NSString *)status error:(NSError **)error {
     if (![@"SUCCESS" isEqualToString:status]) {
         if (error) {
             *error = [NSError errorWithDomain:IMImojiSessionErrorDomain
@@ -551,11 +787,13 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
 - (NSArray *)convertServerDataSetToImojiArray:(NSDictionary *)serverResponse {
     NSArray *results = serverResponse[@"results"];
     if (results.count != 0) {
+        uint64_t startTime = IMMetricsTimestamp();
         NSMutableArray *imojiObjectsArray = [NSMutableArray arrayWithCapacity:results.count];
         for (NSDictionary *result in results) {
             [imojiObjectsArray addObject:[self readImojiObject:result]];
         }
 
+        [self->_metricsRecorder recordPhase:IMMetricsPhaseModelBuilding startTime:startTime];
         return imojiObjectsArray;
     }
 
@@ -591,57 +829,44 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
                    renderingOptions:(IMImojiObjectRenderingOptions *)renderingOptions
                          imojiIndex:(NSUInteger)imojiIndex
                   cancellationToken:(NSOperation *)cancellationToken {
-    return [self downloadImojiImageAsync:imoji
-                        renderingOptions:renderingOptions
-                             retriesLeft:IMImojiSessionNumberOfRetriesForImojiDownload
-                              imojiIndex:imojiIndex
-                       cancellationToken:cancellationToken];
-}
-
-- (BFTask *)downloadImojiImageAsync:(IMMutableImojiObject *)imoji
-                   renderingOptions:(IMImojiObjectRenderingOptions *)renderingOptions
-                        retriesLeft:(NSUInteger)retriesLeft
-                         imojiIndex:(NSUInteger)imojiIndex
-                  cancellationToken:(NSOperation *)cancellationToken {
     BFTaskCompletionSource *taskCompletionSource = [BFTaskCompletionSource taskCompletionSource];
     NSURL *url = [imoji getUrlForRenderingOptions:renderingOptions];
+    IMImojiExecutors *executors = self.executors;
 
-    [BFTask im_concurrentBackgroundTaskWithBlock:^id(BFTask *task) {
+    [[BFTask taskWithDelay:0] continueWithExecutor:[IMTracer executor:[BFTask im_executorWithImojiExecutor:executors.networkExecutor] stage:"downloadImojiImage"] withBlock:^id(BFTask *task) {
         if (cancellationToken.isCancelled) {
             return [BFTask cancelledTask];
         }
 
         // local files are stored as PNGs. Used in creation process for temporary Imojis
         if (url.isFileURL) {
-            taskCompletionSource.result = [YYImage imageWithData:[NSData dataWithContentsOfURL:url] scale:[UIScreen mainScreen].scale];
+            [executors.imageExecutor execute:^{
+                taskCompletionSource.result = [self decodeImageData:[[IMWriteBehindQueue sharedQueue] contentsOfURL:url]];
+            }];
             return nil;
         }
 
-        [[self runExternalURLRequest:[NSMutableURLRequest GETRequestWithURL:url
-                                                                 parameters:@{}]
-                             headers:@{}] continueWithBlock:^id(BFTask *urlTask) {
+        IMImageMemoryCache *imageMemoryCache = self->_sharedResources.imageMemoryCache;
+        UIImage *cachedImage = [imageMemoryCache imageForKey:url.absoluteString];
+        [self->_metricsRecorder recordCacheTier:IMMetricsCacheTierDecodedImages hit:cachedImage != nil];
 
-            if (urlTask.error) {
+        if (cachedImage) {
+            taskCompletionSource.result = cachedImage;
+            return nil;
+        }
+
+        [[self downloadImageDataAsync:url cancellationToken:cancellationToken] continueWithExecutor:[IMTracer executor:[BFTask im_executorWithImojiExecutor:executors.imageExecutor] stage:"decodeImojiImage"] withBlock:^id(BFTask *dataTask) {
+            if (dataTask.error) {
                 if (!cancellationToken.isCancelled) {
-                    dispatch_async(dispatch_get_main_queue(), ^{
-                        if (retriesLeft > 0) {
-                            [self downloadImojiImageAsync:imoji
-                                         renderingOptions:renderingOptions
-                                              retriesLeft:retriesLeft - 1
-                                               imojiIndex:imojiIndex
-                                        cancellationToken:cancellationToken
-                            ];
-                        } else {
-                            taskCompletionSource.error = [NSError errorWithDomain:IMImojiSessionErrorDomain
-                                                                             code:IMImojiSessionErrorCodeServerError
-                                                                         userInfo:@{
-                                                                                 NSLocalizedDescriptionKey : [NSString stringWithFormat:@"Unable to download %@ error code: %@", url, @(urlTask.error.code)]
-                                                                         }];
-                        }
-                    });
+                    taskCompletionSource.error = dataTask.error;
                 }
-            } else {
-                taskCompletionSource.result = [YYImage imageWithData:(NSData *) urlTask.result scale:[UIScreen mainScreen].scale];
+            } else if (!dataTask.cancelled) {
+                UIImage *image = [self decodeImageData:(NSData *) dataTask.result];
+                if (image) {
+                    [imageMemoryCache setImage:image forKey:url.absoluteString];
+                }
+
+                taskCompletionSource.result = image;
             }
 
             return nil;
@@ -653,7 +878,66 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
     return taskCompletionSource.task;
 }
 
+- (BFTask *)downloadImageDataAsync:(NSURL *)url
+                 cancellationToken:(NSOperation *)cancellationToken {
+    return [self downloadImageDataAsync:url
+                            retriesLeft:IMImojiSessionNumberOfRetriesForImojiDownload
+                      cancellationToken:cancellationToken];
+}
+
+- (BFTask *)downloadImageDataAsync:(NSURL *)url
+                       retriesLeft:(NSUInteger)retriesLeft
+                 cancellationToken:(NSOperation *)cancellationToken {
+    if (cancellationToken.isCancelled) {
+        return [BFTask cancelledTask];
+    }
+
+    if (url.isFileURL) {
+        return [BFTask im_taskWithExecutor:self.executors.diskExecutor block:^id(BFTask *task) {
+            return [[IMWriteBehindQueue sharedQueue] contentsOfURL:url];
+        }];
+    }
+
+    // measured for renditions chosen by download speed, see targetDownloadDuration. Recorded as the transfer
+    // completes, waits for the image executor aren't counted
+    IMRenditionSelector *renditionSelector = [IMRenditionSelector sharedSelector];
+    NSString *host = url.host ?: @"";
+    [renditionSelector beginTransferFromHost:host];
+
+    return [[self runExternalURLRequest:[NSMutableURLRequest GETRequestWithURL:url
+                                                                    parameters:@{}]
+                                headers:@{}] continueWithBlock:^id(BFTask *urlTask) {
+        [renditionSelector endTransferFromHost:host length:((NSData *) urlTask.result).length];
+
+        if (!urlTask.error || cancellationToken.isCancelled) {
+            return urlTask;
+        }
+
+        if (retriesLeft > 0) {
+            [self->_metricsRecorder recordRetryForURL:url];
+            return [self downloadImageDataAsync:url retriesLeft:retriesLeft - 1 cancellationToken:cancellationToken];
+        }
+
+        return [NSError errorWithDomain:IMImojiSessionErrorDomain
+                                   code:IMImojiSessionErrorCodeServerError
+                               userInfo:@{
+                                       NSLocalizedDescriptionKey : [NSString stringWithFormat:@"Unable to download %@ error code: %@", url, @(urlTask.error.code)],
+                                       NSUnderlyingErrorKey : urlTask.error
+                               }];
+    }];
+}
+
+- (UIImage *)decodeImageData:(NSData *)data {
+    uint64_t startTime = IMMetricsTimestamp();
+    UIImage *image = [YYImage imageWithData:data scale:[UIScreen mainScreen].scale];
+    [self->_metricsRecorder recordPhase:IMMetricsPhaseImageDecoding startTime:startTime];
+    [IMTracer recordStage:"decodeImage" span:[IMTracer currentSpan] enqueueTime:startTime startTime:startTime];
+
+    return image;
+}
+
 - (NSArray *)readCategories:(NSArray *)categories {
+    uint64_t startTime = IMMetricsTimestamp();
     NSMutableArray *imojiCategories = [NSMutableArray arrayWithCapacity:categories.count > 0 ? categories.count : 1];
     NSUInteger order = 0;
 
@@ -682,47 +966,191 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
                                                                      attribution:attribution]];
     }
 
+    [self->_metricsRecorder recordPhase:IMMetricsPhaseModelBuilding startTime:startTime];
     return imojiCategories;
 }
 
 - (BFTask *)uploadImageInBackgroundWithRetries:(UIImage *)image
+                                encodedFileURL:(NSURL *)encodedFileURL
                                      uploadUrl:(NSURL *)uploadUrl
                                     retryCount:(int)retryCount {
-    BFTaskCompletionSource *taskCompletionSource = [BFTaskCompletionSource taskCompletionSource];
+    // the image is encoded at most once, every attempt streams the same file from disk
+    if (encodedFileURL && ![[NSFileManager defaultManager] fileExistsAtPath:encodedFileURL.path]) {
+        encodedFileURL = nil;
+    }
 
-    [self uploadImageInBackgroundWithRetries:image uploadUrl:uploadUrl retryCount:retryCount taskCompletionSource:taskCompletionSource];
+    BFTask *encodeTask = encodedFileURL ? [BFTask taskWithResult:encodedFileURL] : [self spoolImageForUpload:image];
+
+    return [encodeTask continueWithSuccessBlock:^id(BFTask *task) {
+        NSURL *fileURL = task.result;
+        IMImageUploadTask *uploadTask = [[IMImageUploadTask alloc] initWithTransport:self->_transport
+                                                                             fileURL:fileURL
+                                                                           uploadURL:uploadUrl
+                                                                         contentType:@"image/png"];
+
+        uint64_t startTime = IMMetricsTimestamp();
+        return [[uploadTask uploadWithRetries:retryCount] continueWithBlock:^id(BFTask *uploadResult) {
+            [self->_metricsRecorder recordRequestToURL:uploadUrl
+                                             startTime:startTime
+                                             bytesSent:uploadTask.fileSize
+                                         bytesReceived:0
+                                                failed:uploadResult.error != nil];
+            for (NSUInteger attempt = 1; attempt < uploadTask.attemptCount; ++attempt) {
+                [self->_metricsRecorder recordRetryForURL:uploadUrl];
+            }
 
-    return taskCompletionSource.task;
+            if (!encodedFileURL) {
+                [self removeFile:fileURL.path];
+            }
+
+            return uploadResult;
+        }];
+    }];
 }
 
-- (void)uploadImageInBackgroundWithRetries:(UIImage *)image
-                                 uploadUrl:(NSURL *)uploadUrl
-                                retryCount:(int)retryCount
-                      taskCompletionSource:(BFTaskCompletionSource *)taskCompletionSource {
-    [BFTask im_concurrentBackgroundTaskWithBlock:^id(BFTask *task) {
-        NSMutableURLRequest *request = [NSMutableURLRequest new];
-
-        request.timeoutInterval = 15.0;
-        request.HTTPMethod = @"PUT";
-        request.URL = uploadUrl;
-
-        [request addValue:@"image/png" forHTTPHeaderField:@"Content-Type"];
-
-        [[self->_urlSession uploadTaskWithRequest:request
-                                         fromData:UIImagePNGRepresentation(image)
-                                completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
-                                    if (error) {
-                                        if (retryCount == 0) {
-                                            taskCompletionSource.error = error;
-                                        } else {
-                                            [self uploadImageInBackgroundWithRetries:image uploadUrl:uploadUrl retryCount:retryCount - 1 taskCompletionSource:taskCompletionSource];
-                                        }
-                                    } else {
-                                        taskCompletionSource.result = @YES;
-                                    }
-                                }] resume];
+- (BFTask *)uploadImojiImage:(UIImage *)image
+                  localImoji:(IMImojiObject *)localImoji
+              createResponse:(NSDictionary *)createResponse {
+    CGSize maxDimensions = CGSizeMake(
+            [(NSNumber *) createResponse[@"fullImageResizeWidth"] floatValue],
+            [(NSNumber *) createResponse[@"fullImageResizeHeight"] floatValue]
+    );
+
+    // when no resize is needed the PNG written for the local copy is uploaded as is
+    UIImage *uploadImage = [image im_resizedImageToFitInSize:maxDimensions scaleIfSmaller:NO];
+    NSURL *encodedFileURL = nil;
+    if (uploadImage == image) {
+        encodedFileURL = [NSURL fileURLWithPath:[self filePathFromImoji:localImoji
+                                                       renderingOptions:[IMImojiObjectRenderingOptions optionsWithRenderSize:IMImojiObjectRenderSizeFullResolution
+                                                                                                                 borderStyle:IMImojiObjectBorderStyleNone
+                                                                                                                 imageFormat:IMImojiObjectImageFormatPNG]]];
+    }
 
-        return nil;
+    return [self uploadImageInBackgroundWithRetries:uploadImage
+                                     encodedFileURL:encodedFileURL
+                                          uploadUrl:[NSURL URLWithString:createResponse[@"fullImageUrl"]]
+                                         retryCount:3];
+}
+
+- (BFTask *)spoolImageForUpload:(UIImage *)image {
+    IMImojiExecutors *executors = self.executors;
+
+    return [[BFTask im_taskWithExecutor:executors.imageExecutor block:^id(BFTask *task) {
+        NSData *imageContents = UIImagePNGRepresentation(image);
+
+        if (!imageContents) {
+            return [NSError errorWithDomain:IMImojiSessionErrorDomain
+                                       code:IMImojiSessionErrorCodeInvalidImage
+                                   userInfo:@{
+                                           NSLocalizedDescriptionKey : @"Unable to encode image for upload"
+                                   }];
+        }
+
+        return imageContents;
+    }] continueWithExecutor:[BFTask im_executorWithImojiExecutor:executors.diskExecutor] withSuccessBlock:^id(BFTask *task) {
+        NSString *spoolDirectory = [self.storagePolicy.cachePath.path stringByAppendingPathComponent:@"uploads"];
+        NSString *spoolPath = [spoolDirectory stringByAppendingPathComponent:[NSString stringWithFormat:@"%@.png", [NSString im_stringWithRandomUUID]]];
+        NSData *imageContents = task.result;
+        NSError *error;
+
+        [[NSFileManager defaultManager] createDirectoryAtPath:spoolDirectory withIntermediateDirectories:YES attributes:nil error:nil];
+        if (![imageContents writeToFile:spoolPath options:NSDataWritingAtomic error:&error]) {
+            return error;
+        }
+
+        return [NSURL fileURLWithPath:spoolPath];
+    }];
+}
+
+#pragma mark Tracing
+
+- (IMTraceSpan)beginTraceSpan:(const char *)name {
+    return [IMTracer beginSpanWithName:name traceIdentifier:self->_tracingEnabled ? self->_traceIdentifier : 0];
+}
+
+#pragma mark Mutations
+
+- (BFTask *)sendMutation:(IMMutation *)mutation {
+    BFTask *requestTask;
+
+    if ([mutation.kind isEqualToString:IMMutationKindCollectionAdd]) {
+        requestTask = [self runValidatedPostTaskWithPath:@"/user/imoji/collection/add" andParameters:mutation.parameters];
+    } else if ([mutation.kind isEqualToString:IMMutationKindRemove]) {
+        requestTask = [self runValidatedDeleteTaskWithPath:@"/imoji/remove" andParameters:mutation.parameters];
+    } else if ([mutation.kind isEqualToString:IMMutationKindReport]) {
+        requestTask = [self runValidatedPostTaskWithPath:@"/imoji/reportAbusive" andParameters:mutation.parameters];
+    } else if ([mutation.kind isEqualToString:IMMutationKindCreate]) {
+        return [self resumeImojiCreation:mutation];
+    } else {
+        return [BFTask taskWithError:[NSError errorWithDomain:IMImojiSessionErrorDomain
+                                                         code:IMImojiSessionErrorCodeInvalidArgument
+                                                     userInfo:@{
+                                                             NSLocalizedDescriptionKey : [NSString stringWithFormat:@"Unknown mutation %@", mutation.kind]
+                                                     }]];
+    }
+
+    BFTask *mutationTask = [requestTask continueWithSuccessBlock:^id(BFTask *task) {
+        NSError *error;
+        [self validateServerResponse:task.result error:&error];
+
+        return error ? [BFTask taskWithError:error] : task;
+    }];
+
+    if ([mutation.kind isEqualToString:IMMutationKindReport]) {
+        return mutationTask;
+    }
+
+    return [mutationTask continueWithBlock:^id(BFTask *task) {
+        // transient failures are retried by the outbox, anything else is final and the next reconciliation of the
+        // collection mirror reflects the server's state
+        if (!task.error.im_isTransient) {
+            [self->_collectionMirror settleChangesForImojiIdentifier:mutation.imojiIdentifier];
+        }
+
+        return task;
+    }];
+}
+
+- (void)settleCollectionMirrorChangesForEnqueueTask:(BFTask *)enqueueTask imojiIdentifier:(NSString *)imojiIdentifier {
+    if (enqueueTask.error || !enqueueTask.result) {
+        [self->_collectionMirror settleChangesForImojiIdentifier:imojiIdentifier];
+    }
+}
+
+// uploads an imoji created in a previous launch from its local full resolution copy
+- (BFTask *)resumeImojiCreation:(IMMutation *)mutation {
+    IMImojiObject *localImoji = [IMMutableImojiObject imojiWithIdentifier:mutation.imojiIdentifier tags:@[] urls:@{}];
+    NSString *imagePath = [self filePathFromImoji:localImoji
+                                 renderingOptions:[IMImojiObjectRenderingOptions optionsWithRenderSize:IMImojiObjectRenderSizeFullResolution
+                                                                                           borderStyle:IMImojiObjectBorderStyleNone
+                                                                                           imageFormat:IMImojiObjectImageFormatPNG]];
+    UIImage *image = [UIImage imageWithContentsOfFile:imagePath];
+
+    if (!image) {
+        return [BFTask taskWithError:[NSError errorWithDomain:IMImojiSessionErrorDomain
+                                                         code:IMImojiSessionErrorCodeInvalidImage
+                                                     userInfo:@{
+                                                             NSLocalizedDescriptionKey : @"Local copy of the created imoji is no longer available"
+                                                     }]];
+    }
+
+    // the imoji was already created on the server when the previous launch recorded the response
+    NSDictionary *createResponse = mutation.parameters[@"createResponse"];
+    if ([createResponse isKindOfClass:[NSDictionary class]]) {
+        return [self uploadImojiImage:image localImoji:localImoji createResponse:createResponse];
+    }
+
+    NSArray *tags = [mutation.parameters[@"tags"] isKindOfClass:[NSArray class]] ? mutation.parameters[@"tags"] : @[];
+
+    return [[self runValidatedPostTaskWithPath:@"/imoji/create" andParameters:@{
+            @"tags" : tags
+    }] continueWithSuccessBlock:^id(BFTask *task) {
+        NSError *error;
+        if (![self validateServerResponse:task.result error:&error]) {
+            return [BFTask taskWithError:error];
+        }
+
+        return [self uploadImojiImage:image localImoji:localImoji createResponse:task.result];
     }];
 }
 
@@ -983,26 +1411,21 @@ NSUInteger const IMImojiSessionNumberOfRetriesForImojiDownload = 3;
          imageContents:(NSData *)imageContents
            synchronous:(BOOL)synchronous {
 
-    return [[BFTask taskWithDelay:0] continueWithExecutor:synchronous ? [BFExecutor mainThreadExecutor] : [BFTask im_concurrentBackgroundExecutor]
-                                                withBlock:^id(BFTask *task) {
-                                                    NSString *fullImojiPath = [self filePathFromImoji:imoji renderingOptions:renderingOptions];
-                                                    NSError *error;
-
-                                                    [imageContents writeToFile:fullImojiPath options:NSDataWritingAtomic error:&error];
+    // local imojis are the only copy until their creation is replayed, so their files are synced
+    NSURL *fileURL = [NSURL fileURLWithPath:[self filePathFromImoji:imoji renderingOptions:renderingOptions]];
+    BFTask *writeTask = [[IMWriteBehindQueue sharedQueue] writeData:imageContents toURL:fileURL durable:YES];
 
-                                                    NSURL *pathUrl = [NSURL fileURLWithPath:fullImojiPath];
-                                                    [pathUrl setResourceValue:@YES
-                                                                       forKey:NSURLIsExcludedFromBackupKey
-                                                                        error:&error];
+    if (synchronous) {
+        [[IMWriteBehindQueue sharedQueue] flush];
+    }
 
-                                                    return nil;
-                                                }];
+    return writeTask;
 }
 
 - (void)removeImoji:(IMImojiObject *)imoji
    renderingOptions:(IMImojiObjectRenderingOptions *)renderingOptions {
     NSString *fullImojiPath = [self filePathFromImoji:imoji renderingOptions:renderingOptions];
-    [self removeFile:fullImojiPath];
+    [[IMWriteBehindQueue sharedQueue] removeItemAtURL:[NSURL fileURLWithPath:fullImojiPath]];
 }
 
 - (NSString *)filePathFromImoji:(IMImojiObject *)imoji renderingOptions:(IMImojiObjectRenderingOptions *)renderingOptions {
@@ -15,8 +15,15 @@
 #pragma mark Testing
 
 - (BFTask *)randomAuthToken {
-    [IMImojiSession credentials].accessToken = [NSString im_stringWithRandomUUID];
-    return [self writeAuthenticationCredentials];
+    return [[self readinessTask] continueWithSuccessBlock:^id(BFTask *task) {
+        IMImojiSessionCredentials *credentials = [IMImojiSession credentials];
+        [IMImojiSession setCredentials:[[IMImojiSessionCredentials alloc] initWithAccessToken:[NSString im_stringWithRandomUUID]
+                                                                                 refreshToken:credentials.refreshToken
+                                                                               expirationDate:credentials.expirationDate
+                                                                                     clientId:credentials.clientId
+                                                                          accountSynchronized:credentials.accountSynchronized]];
+        return [self writeAuthenticationCredentials];
+    }];
 }
 
 @end
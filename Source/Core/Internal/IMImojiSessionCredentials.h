@@ -5,12 +5,36 @@
 
 #import <Foundation/Foundation.h>
 
+@class BFTask;
+
+/**
+* @abstract Immutable snapshot of the OAuth credentials shared by every session. Changes are made by publishing a new
+* snapshot with [IMImojiSession setCredentials:], readers holding the previous one keep a consistent set of values.
+*/
 @interface IMImojiSessionCredentials : NSObject
 
-@property(nonatomic, copy) NSString *accessToken;
-@property(nonatomic, copy) NSString *refreshToken;
-@property(nonatomic, copy) NSDate *expirationDate;
-@property(nonatomic, copy) NSString *clientId;
-@property(nonatomic) BOOL accountSynchronized;
+@property(nonatomic, readonly, copy) NSString *accessToken;
+@property(nonatomic, readonly, copy) NSString *refreshToken;
+@property(nonatomic, readonly, copy) NSDate *expirationDate;
+@property(nonatomic, readonly, copy) NSString *clientId;
+@property(nonatomic, readonly) BOOL accountSynchronized;
+
+/**
+* @abstract Completed task resulting in accessToken, created once per snapshot so that validated requests do not
+* allocate one each. nil when there is no access token.
+*/
+@property(nonatomic, readonly, strong) BFTask *accessTokenTask;
+
+- (instancetype)initWithAccessToken:(NSString *)accessToken
+                       refreshToken:(NSString *)refreshToken
+                     expirationDate:(NSDate *)expirationDate
+                           clientId:(NSString *)clientId
+                accountSynchronized:(BOOL)accountSynchronized;
+
+/**
+* @abstract YES when accessToken is set, has not expired and was issued to clientId. Credentials without an expiration
+* date or client id are not checked against them.
+*/
+- (BOOL)isValidForClientId:(NSUUID *)clientId;
 
 @end
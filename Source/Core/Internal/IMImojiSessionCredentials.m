@@ -3,10 +3,48 @@
 // Copyright (c) 2015 Imoji. All rights reserved.
 //
 
+#import <Bolts/BFTask.h>
 #import "IMImojiSessionCredentials.h"
 
 
 @implementation IMImojiSessionCredentials {
+    // parsed once, clientId is compared with the SDK's on every validated request
+    NSUUID *_clientUUID;
+}
 
+- (instancetype)init {
+    return [self initWithAccessToken:nil refreshToken:nil expirationDate:nil clientId:nil accountSynchronized:NO];
 }
+
+- (instancetype)initWithAccessToken:(NSString *)accessToken
+                       refreshToken:(NSString *)refreshToken
+                     expirationDate:(NSDate *)expirationDate
+                           clientId:(NSString *)clientId
+                accountSynchronized:(BOOL)accountSynchronized {
+    self = [super init];
+    if (self) {
+        _accessToken = [accessToken copy];
+        _refreshToken = [refreshToken copy];
+        _expirationDate = [expirationDate copy];
+        _clientId = [clientId copy];
+        _accountSynchronized = accountSynchronized;
+        _clientUUID = clientId ? [[NSUUID alloc] initWithUUIDString:clientId] : nil;
+        _accessTokenTask = accessToken ? [BFTask taskWithResult:_accessToken] : nil;
+    }
+
+    return self;
+}
+
+- (BOOL)isValidForClientId:(NSUUID *)clientId {
+    if (!self.accessToken) {
+        return NO;
+    }
+
+    if (self.expirationDate && self.expirationDate.timeIntervalSinceNow <= 0) {
+        return NO;
+    }
+
+    return !self.clientId || [_clientUUID isEqual:clientId];
+}
+
 @end
@@ -0,0 +1,105 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+typedef NS_ENUM(uint8_t, IMJSONToken) {
+    IMJSONTokenInvalid = 0,
+    IMJSONTokenObject,
+    IMJSONTokenArray,
+    IMJSONTokenString,
+    IMJSONTokenNumber,
+    IMJSONTokenTrue,
+    IMJSONTokenFalse,
+    IMJSONTokenNull
+};
+
+/**
+* @abstract Location of the contents of a JSON string (without the quotes) in the scanned buffer. escaped is set when
+* the contents contain backslash escapes and have to be unescaped before use.
+*/
+typedef struct {
+    size_t offset;
+    size_t length;
+    BOOL escaped;
+} IMJSONString;
+
+/**
+* @abstract Pull scanner reading JSON straight from a UTF-8 buffer without creating any objects. Values are read with
+* IMJSONScannerReadValue, objects and arrays are only opened by it and are either iterated with the member and element
+* functions or skipped with IMJSONScannerSkipValue. Once failed is set every function stops consuming input.
+* The buffer must outlive the scanner.
+*/
+typedef struct {
+    const uint8_t *__nullable bytes;
+    size_t length;
+    size_t position;
+    BOOL failed;
+
+    // contents of the last string token or member key
+    IMJSONString string;
+
+    // value of the last number token
+    double number;
+} IMJSONScanner;
+
+void IMJSONScannerInit(IMJSONScanner *__nonnull scanner, const void *__nullable bytes, size_t length);
+
+/**
+* @abstract Reads the next value. For IMJSONTokenString scanner->string is set, for IMJSONTokenNumber scanner->number.
+*/
+IMJSONToken IMJSONScannerReadValue(IMJSONScanner *__nonnull scanner);
+
+/**
+* @abstract Skips the remainder of a value whose token was just read, only objects and arrays consume input.
+*/
+void IMJSONScannerSkipValue(IMJSONScanner *__nonnull scanner, IMJSONToken token);
+
+/**
+* @abstract Moves to the first member of an object that was just opened. Sets scanner->string to its key and consumes
+* the colon so the member value can be read next.
+* @return NO if the object is empty or on malformed input
+*/
+BOOL IMJSONScannerFirstMember(IMJSONScanner *__nonnull scanner);
+
+/**
+* @abstract Moves to the next member of an object once the value of the previous one was consumed.
+* @return NO at the end of the object or on malformed input
+*/
+BOOL IMJSONScannerNextMember(IMJSONScanner *__nonnull scanner);
+
+/**
+* @abstract Moves to the first element of an array that was just opened.
+* @return NO if the array is empty or on malformed input
+*/
+BOOL IMJSONScannerFirstElement(IMJSONScanner *__nonnull scanner);
+
+/**
+* @abstract Moves to the next element of an array once the previous one was consumed.
+* @return NO at the end of the array or on malformed input
+*/
+BOOL IMJSONScannerNextElement(IMJSONScanner *__nonnull scanner);
+
+/**
+* @abstract Checks that only whitespace is left, marking the scanner as failed otherwise.
+*/
+BOOL IMJSONScannerFinish(IMJSONScanner *__nonnull scanner);
+
+/**
+* @abstract Compares the contents of string to a NUL terminated ASCII literal, unescaping if needed.
+*/
+BOOL IMJSONScannerStringEquals(const IMJSONScanner *__nonnull scanner, IMJSONString string, const char *__nonnull literal);
+
+/**
+* @abstract Unescapes the contents of string into buffer, which must hold at least string.length bytes. Unescaping never
+* grows a string.
+* @return The number of bytes written
+*/
+size_t IMJSONScannerUnescapeString(const IMJSONScanner *__nonnull scanner, IMJSONString string, uint8_t *__nonnull buffer);
+
+/**
+* @abstract Creates a string from the contents of string, nil if they are not valid UTF-8.
+*/
+NSString *__nullable IMJSONScannerCopyString(const IMJSONScanner *__nonnull scanner, IMJSONString string);
@@ -0,0 +1,464 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import "IMJSONScanner.h"
+
+// longest number literal handed to strtod, anything longer is not something the API sends
+static const size_t IMJSONScannerMaximumNumberLength = 64;
+
+// strings up to this size are unescaped on the stack
+static const size_t IMJSONScannerStackStringLength = 256;
+
+static inline BOOL IMJSONScannerFail(IMJSONScanner *scanner) {
+    scanner->failed = YES;
+    return NO;
+}
+
+static inline void IMJSONScannerSkipWhitespace(IMJSONScanner *scanner) {
+    const uint8_t *bytes = scanner->bytes;
+    size_t position = scanner->position, length = scanner->length;
+
+    while (position < length && (bytes[position] == ' ' || bytes[position] == '\n' || bytes[position] == '\r' || bytes[position] == '\t')) {
+        position++;
+    }
+
+    scanner->position = position;
+}
+
+// returns the next non whitespace byte without consuming it, 0 at the end of the buffer
+static inline uint8_t IMJSONScannerPeek(IMJSONScanner *scanner) {
+    IMJSONScannerSkipWhitespace(scanner);
+    return scanner->position < scanner->length ? scanner->bytes[scanner->position] : 0;
+}
+
+// scans the string starting after an opening quote that was already consumed
+static BOOL IMJSONScannerScanString(IMJSONScanner *scanner) {
+    const uint8_t *bytes = scanner->bytes;
+    size_t position = scanner->position, length = scanner->length;
+    BOOL escaped = NO;
+
+    scanner->string.offset = position;
+
+    while (position < length) {
+        uint8_t byte = bytes[position];
+
+        if (byte == '"') {
+            scanner->string.length = position - scanner->string.offset;
+            scanner->string.escaped = escaped;
+            scanner->position = position + 1;
+            return YES;
+        }
+
+        if (byte == '\\') {
+            escaped = YES;
+            position += 2;
+        } else if (byte < 0x20) {
+            break;
+        } else {
+            position++;
+        }
+    }
+
+    scanner->position = MIN(position, length);
+    return IMJSONScannerFail(scanner);
+}
+
+static BOOL IMJSONScannerScanNumber(IMJSONScanner *scanner) {
+    const uint8_t *bytes = scanner->bytes;
+    size_t start = scanner->position, position = start, length = scanner->length;
+    BOOL negative = NO, integral = YES;
+    uint64_t value = 0;
+    size_t digits = 0;
+
+    if (position < length && bytes[position] == '-') {
+        negative = YES;
+        position++;
+    }
+
+    while (position < length && bytes[position] >= '0' && bytes[position] <= '9') {
+        value = value * 10 + (bytes[position] - '0');
+        digits++;
+        position++;
+    }
+
+    if (digits == 0) {
+        return IMJSONScannerFail(scanner);
+    }
+
+    if (position < length && bytes[position] == '.') {
+        integral = NO;
+        position++;
+        while (position < length && bytes[position] >= '0' && bytes[position] <= '9') {
+            position++;
+        }
+    }
+
+    if (position < length && (bytes[position] == 'e' || bytes[position] == 'E')) {
+        integral = NO;
+        position++;
+        if (position < length && (bytes[position] == '+' || bytes[position] == '-')) {
+            position++;
+        }
+        while (position < length && bytes[position] >= '0' && bytes[position] <= '9') {
+            position++;
+        }
+    }
+
+    if (integral && digits <= 18) {
+        scanner->number = negative ? -(double) value : (double) value;
+    } else {
+        // the buffer isn't NUL terminated, strtod needs its own copy
+        char literal[IMJSONScannerMaximumNumberLength + 1];
+        size_t literalLength = position - start;
+        if (literalLength > IMJSONScannerMaximumNumberLength) {
+            return IMJSONScannerFail(scanner);
+        }
+
+        memcpy(literal, bytes + start, literalLength);
+        literal[literalLength] = 0;
+        scanner->number = strtod(literal, NULL);
+    }
+
+    scanner->position = position;
+    return YES;
+}
+
+static inline BOOL IMJSONScannerScanLiteral(IMJSONScanner *scanner, const char *literal, size_t length) {
+    if (scanner->length - scanner->position < length || memcmp(scanner->bytes + scanner->position, literal, length) != 0) {
+        return IMJSONScannerFail(scanner);
+    }
+
+    scanner->position += length;
+    return YES;
+}
+
+void IMJSONScannerInit(IMJSONScanner *scanner, const void *bytes, size_t length) {
+    memset(scanner, 0, sizeof(IMJSONScanner));
+    scanner->bytes = bytes;
+    scanner->length = bytes ? length : 0;
+}
+
+IMJSONToken IMJSONScannerReadValue(IMJSONScanner *scanner) {
+    if (scanner->failed) {
+        return IMJSONTokenInvalid;
+    }
+
+    switch (IMJSONScannerPeek(scanner)) {
+        case '{':
+            scanner->position++;
+            return IMJSONTokenObject;
+
+        case '[':
+            scanner->position++;
+            return IMJSONTokenArray;
+
+        case '"':
+            scanner->position++;
+            return IMJSONScannerScanString(scanner) ? IMJSONTokenString : IMJSONTokenInvalid;
+
+        case 't':
+            return IMJSONScannerScanLiteral(scanner, "true", 4) ? IMJSONTokenTrue : IMJSONTokenInvalid;
+
+        case 'f':
+            return IMJSONScannerScanLiteral(scanner, "false", 5) ? IMJSONTokenFalse : IMJSONTokenInvalid;
+
+        case 'n':
+            return IMJSONScannerScanLiteral(scanner, "null", 4) ? IMJSONTokenNull : IMJSONTokenInvalid;
+
+        case '-':
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            return IMJSONScannerScanNumber(scanner) ? IMJSONTokenNumber : IMJSONTokenInvalid;
+
+        default:
+            IMJSONScannerFail(scanner);
+            return IMJSONTokenInvalid;
+    }
+}
+
+void IMJSONScannerSkipValue(IMJSONScanner *scanner, IMJSONToken token) {
+    if (scanner->failed || (token != IMJSONTokenObject && token != IMJSONTokenArray)) {
+        return;
+    }
+
+    // brackets only need to balance, members and elements are validated by the scans that read them
+    const uint8_t *bytes = scanner->bytes;
+    size_t position = scanner->position, length = scanner->length;
+    NSUInteger depth = 1;
+
+    while (position < length) {
+        uint8_t byte = bytes[position++];
+
+        if (byte == '"') {
+            scanner->position = position;
+            if (!IMJSONScannerScanString(scanner)) {
+                return;
+            }
+            position = scanner->position;
+        } else if (byte == '{' || byte == '[') {
+            depth++;
+        } else if (byte == '}' || byte == ']') {
+            if (--depth == 0) {
+                scanner->position = position;
+                return;
+            }
+        }
+    }
+
+    scanner->position = length;
+    IMJSONScannerFail(scanner);
+}
+
+static BOOL IMJSONScannerReadMember(IMJSONScanner *scanner) {
+    if (IMJSONScannerPeek(scanner) != '"') {
+        return IMJSONScannerFail(scanner);
+    }
+
+    scanner->position++;
+    if (!IMJSONScannerScanString(scanner)) {
+        return NO;
+    }
+
+    if (IMJSONScannerPeek(scanner) != ':') {
+        return IMJSONScannerFail(scanner);
+    }
+
+    scanner->position++;
+    return YES;
+}
+
+BOOL IMJSONScannerFirstMember(IMJSONScanner *scanner) {
+    if (scanner->failed) {
+        return NO;
+    }
+
+    if (IMJSONScannerPeek(scanner) == '}') {
+        scanner->position++;
+        return NO;
+    }
+
+    return IMJSONScannerReadMember(scanner);
+}
+
+BOOL IMJSONScannerNextMember(IMJSONScanner *scanner) {
+    if (scanner->failed) {
+        return NO;
+    }
+
+    switch (IMJSONScannerPeek(scanner)) {
+        case '}':
+            scanner->position++;
+            return NO;
+
+        case ',':
+            scanner->position++;
+            return IMJSONScannerReadMember(scanner);
+
+        default:
+            return IMJSONScannerFail(scanner);
+    }
+}
+
+BOOL IMJSONScannerFirstElement(IMJSONScanner *scanner) {
+    if (scanner->failed) {
+        return NO;
+    }
+
+    if (IMJSONScannerPeek(scanner) == ']') {
+        scanner->position++;
+        return NO;
+    }
+
+    return YES;
+}
+
+BOOL IMJSONScannerNextElement(IMJSONScanner *scanner) {
+    if (scanner->failed) {
+        return NO;
+    }
+
+    switch (IMJSONScannerPeek(scanner)) {
+        case ']':
+            scanner->position++;
+            return NO;
+
+        case ',':
+            scanner->position++;
+            return YES;
+
+        default:
+            return IMJSONScannerFail(scanner);
+    }
+}
+
+BOOL IMJSONScannerFinish(IMJSONScanner *scanner) {
+    if (!scanner->failed && IMJSONScannerPeek(scanner) != 0) {
+        IMJSONScannerFail(scanner);
+    }
+
+    return !scanner->failed;
+}
+
+BOOL IMJSONScannerStringEquals(const IMJSONScanner *scanner, IMJSONString string, const char *literal) {
+    size_t literalLength = strlen(literal);
+
+    if (!string.escaped) {
+        return string.length == literalLength && memcmp(scanner->bytes + string.offset, literal, literalLength) == 0;
+    }
+
+    // escapes only shrink a string, anything shorter than the literal can't match
+    if (string.length < literalLength || string.length > IMJSONScannerStackStringLength) {
+        return NO;
+    }
+
+    uint8_t buffer[IMJSONScannerStackStringLength];
+    size_t length = IMJSONScannerUnescapeString(scanner, string, buffer);
+    return length == literalLength && memcmp(buffer, literal, literalLength) == 0;
+}
+
+static inline int IMJSONScannerHexValue(uint8_t byte) {
+    if (byte >= '0' && byte <= '9') {
+        return byte - '0';
+    } else if (byte >= 'a' && byte <= 'f') {
+        return byte - 'a' + 10;
+    } else if (byte >= 'A' && byte <= 'F') {
+        return byte - 'A' + 10;
+    }
+
+    return -1;
+}
+
+static inline int32_t IMJSONScannerReadCodeUnit(const uint8_t *bytes, size_t position, size_t end) {
+    if (end - position < 4) {
+        return -1;
+    }
+
+    int32_t value = 0;
+    for (size_t i = 0; i < 4; i++) {
+        int digit = IMJSONScannerHexValue(bytes[position + i]);
+        if (digit < 0) {
+            return -1;
+        }
+        value = (value << 4) | digit;
+    }
+
+    return value;
+}
+
+static inline size_t IMJSONScannerWriteUTF8(uint8_t *buffer, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        buffer[0] = (uint8_t) codePoint;
+        return 1;
+    } else if (codePoint < 0x800) {
+        buffer[0] = (uint8_t) (0xC0 | (codePoint >> 6));
+        buffer[1] = (uint8_t) (0x80 | (codePoint & 0x3F));
+        return 2;
+    } else if (codePoint < 0x10000) {
+        buffer[0] = (uint8_t) (0xE0 | (codePoint >> 12));
+        buffer[1] = (uint8_t) (0x80 | ((codePoint >> 6) & 0x3F));
+        buffer[2] = (uint8_t) (0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+
+    buffer[0] = (uint8_t) (0xF0 | (codePoint >> 18));
+    buffer[1] = (uint8_t) (0x80 | ((codePoint >> 12) & 0x3F));
+    buffer[2] = (uint8_t) (0x80 | ((codePoint >> 6) & 0x3F));
+    buffer[3] = (uint8_t) (0x80 | (codePoint & 0x3F));
+    return 4;
+}
+
+size_t IMJSONScannerUnescapeString(const IMJSONScanner *scanner, IMJSONString string, uint8_t *buffer) {
+    const uint8_t *bytes = scanner->bytes;
+    size_t position = string.offset, end = string.offset + string.length, length = 0;
+
+    if (!string.escaped) {
+        memcpy(buffer, bytes + position, string.length);
+        return string.length;
+    }
+
+    while (position < end) {
+        uint8_t byte = bytes[position++];
+        if (byte != '\\' || position == end) {
+            buffer[length++] = byte;
+            continue;
+        }
+
+        uint8_t escape = bytes[position++];
+        switch (escape) {
+            case 'b':
+                buffer[length++] = '\b';
+                break;
+            case 'f':
+                buffer[length++] = '\f';
+                break;
+            case 'n':
+                buffer[length++] = '\n';
+                break;
+            case 'r':
+                buffer[length++] = '\r';
+                break;
+            case 't':
+                buffer[length++] = '\t';
+                break;
+            case 'u': {
+                int32_t codeUnit = IMJSONScannerReadCodeUnit(bytes, position, end);
+                if (codeUnit < 0) {
+                    buffer[length++] = escape;
+                    break;
+                }
+                position += 4;
+
+                uint32_t codePoint = (uint32_t) codeUnit;
+                if (codeUnit >= 0xD800 && codeUnit <= 0xDBFF) {
+                    int32_t lowSurrogate = end - position >= 6 && bytes[position] == '\\' && bytes[position + 1] == 'u' ?
+                            IMJSONScannerReadCodeUnit(bytes, position + 2, end) : -1;
+
+                    if (lowSurrogate >= 0xDC00 && lowSurrogate <= 0xDFFF) {
+                        codePoint = 0x10000 + (((uint32_t) codeUnit - 0xD800) << 10) + ((uint32_t) lowSurrogate - 0xDC00);
+                        position += 6;
+                    } else {
+                        codePoint = 0xFFFD;
+                    }
+                } else if (codeUnit >= 0xDC00 && codeUnit <= 0xDFFF) {
+                    codePoint = 0xFFFD;
+                }
+
+                // a \uXXXX escape is 6 bytes and at most 3 once encoded, a surrogate pair is 12 bytes and 4 encoded
+                length += IMJSONScannerWriteUTF8(buffer + length, codePoint);
+                break;
+            }
+            default:
+                // \" \\ \/
+                buffer[length++] = escape;
+                break;
+        }
+    }
+
+    return length;
+}
+
+NSString *IMJSONScannerCopyString(const IMJSONScanner *scanner, IMJSONString string) {
+    if (!string.escaped) {
+        return [[NSString alloc] initWithBytes:scanner->bytes + string.offset length:string.length encoding:NSUTF8StringEncoding];
+    }
+
+    if (string.length <= IMJSONScannerStackStringLength) {
+        uint8_t buffer[IMJSONScannerStackStringLength];
+        size_t length = IMJSONScannerUnescapeString(scanner, string, buffer);
+        return [[NSString alloc] initWithBytes:buffer length:length encoding:NSUTF8StringEncoding];
+    }
+
+    NSMutableData *buffer = [NSMutableData dataWithLength:string.length];
+    size_t length = IMJSONScannerUnescapeString(scanner, string, buffer.mutableBytes);
+    return [[NSString alloc] initWithBytes:buffer.bytes length:length encoding:NSUTF8StringEncoding];
+}
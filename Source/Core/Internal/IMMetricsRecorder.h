@@ -0,0 +1,110 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "IMImojiSessionMetrics.h"
+
+#define IMMetricsHistogramBucketCount 16
+
+typedef NS_ENUM(NSUInteger, IMMetricsPhase) {
+    IMMetricsPhaseTokenValidation,
+    IMMetricsPhaseDomainLookup,
+    IMMetricsPhaseConnect,
+    IMMetricsPhaseSecureConnection,
+    IMMetricsPhaseTimeToFirstByte,
+    IMMetricsPhaseJSONParsing,
+    IMMetricsPhaseModelBuilding,
+    IMMetricsPhaseImageDecoding,
+    IMMetricsPhaseCount
+};
+
+extern NSString *__nonnull const IMMetricsCacheTierURLCache;
+extern NSString *__nonnull const IMMetricsCacheTierStickerArtifacts;
+extern NSString *__nonnull const IMMetricsCacheTierContentSnapshots;
+extern NSString *__nonnull const IMMetricsCacheTierCollectionMirror;
+extern NSString *__nonnull const IMMetricsCacheTierAttribution;
+extern NSString *__nonnull const IMMetricsCacheTierDecodedImages;
+
+/**
+* @abstract Monotonic timestamp in microseconds for measuring durations passed to IMMetricsRecorder
+*/
+uint64_t IMMetricsTimestamp(void);
+
+/**
+* @abstract Collects request, phase and cache metrics for a session. Counters are updated with relaxed atomics, looking
+* up an endpoint or cache tier takes a shared read lock and only the first use of one takes the write lock. Snapshots
+* are not taken atomically across counters.
+*/
+@interface IMMetricsRecorder : NSObject
+
+/**
+* @abstract Maps a request url to its endpoint name, the API path without version for API requests or the host name
+*/
++ (nonnull NSString *)endpointForURL:(nonnull NSURL *)url;
+
+- (void)recordRequestToURL:(nonnull NSURL *)url
+                 startTime:(uint64_t)startTime
+                 bytesSent:(unsigned long long)bytesSent
+             bytesReceived:(unsigned long long)bytesReceived
+                    failed:(BOOL)failed;
+
+- (void)recordRetryForURL:(nonnull NSURL *)url;
+
+- (void)recordPhase:(IMMetricsPhase)phase startTime:(uint64_t)startTime;
+
+- (void)recordPhase:(IMMetricsPhase)phase duration:(NSTimeInterval)duration;
+
+- (void)recordCacheTier:(nonnull NSString *)tier hit:(BOOL)hit;
+
+#if __IPHONE_OS_VERSION_MAX_ALLOWED >= 100000
+/**
+* @abstract Records connection phase timings and URL cache usage from the transactions of a finished task
+*/
+- (void)recordTaskMetrics:(nonnull NSURLSessionTaskMetrics *)metrics NS_AVAILABLE_IOS(10_0);
+#endif
+
+- (nonnull IMImojiSessionMetrics *)snapshot;
+
+- (void)reset;
+
+@end
+
+@interface IMImojiTimingMetrics (IMMetricsRecorder)
+
+- (nonnull instancetype)initWithCount:(NSUInteger)count
+                        totalDuration:(NSTimeInterval)totalDuration
+                            histogram:(nonnull NSArray<NSNumber *> *)histogram;
+
+- (nonnull NSDictionary *)dictionaryRepresentation;
+
+@end
+
+@interface IMImojiEndpointMetrics (IMMetricsRecorder)
+
+- (nonnull instancetype)initWithLatency:(nonnull IMImojiTimingMetrics *)latency
+                             errorCount:(NSUInteger)errorCount
+                             retryCount:(NSUInteger)retryCount
+                              bytesSent:(unsigned long long)bytesSent
+                          bytesReceived:(unsigned long long)bytesReceived;
+
+- (nonnull NSDictionary *)dictionaryRepresentation;
+
+@end
+
+@interface IMImojiCacheMetrics (IMMetricsRecorder)
+
+- (nonnull instancetype)initWithHits:(NSUInteger)hits misses:(NSUInteger)misses;
+
+- (nonnull NSDictionary *)dictionaryRepresentation;
+
+@end
+
+@interface IMImojiSessionMetrics (IMMetricsRecorder)
+
+- (nonnull instancetype)initWithEndpoints:(nonnull NSDictionary<NSString *, IMImojiEndpointMetrics *> *)endpoints
+                                   phases:(nonnull NSDictionary<NSString *, IMImojiTimingMetrics *> *)phases
+                                   caches:(nonnull NSDictionary<NSString *, IMImojiCacheMetrics *> *)caches;
+
+@end
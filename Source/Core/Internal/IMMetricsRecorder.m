@@ -0,0 +1,312 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <mach/mach_time.h>
+#import <pthread.h>
+#import <stdatomic.h>
+#import "IMMetricsRecorder.h"
+#import "ImojiSDKConstants.h"
+
+NSString *const IMMetricsCacheTierURLCache = @"urlCache";
+NSString *const IMMetricsCacheTierStickerArtifacts = @"stickerArtifacts";
+NSString *const IMMetricsCacheTierContentSnapshots = @"contentSnapshots";
+NSString *const IMMetricsCacheTierCollectionMirror = @"collectionMirror";
+NSString *const IMMetricsCacheTierAttribution = @"attribution";
+NSString *const IMMetricsCacheTierDecodedImages = @"decodedImages";
+
+typedef struct {
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t totalMicroseconds;
+    atomic_uint_fast64_t buckets[IMMetricsHistogramBucketCount];
+} IMMetricsTiming;
+
+typedef struct {
+    IMMetricsTiming latency;
+    atomic_uint_fast64_t errors;
+    atomic_uint_fast64_t retries;
+    atomic_uint_fast64_t bytesSent;
+    atomic_uint_fast64_t bytesReceived;
+} IMMetricsEndpoint;
+
+typedef struct {
+    atomic_uint_fast64_t hits;
+    atomic_uint_fast64_t misses;
+} IMMetricsCache;
+
+static NSString *const IMMetricsPhaseNames[IMMetricsPhaseCount] = {
+        @"tokenValidation",
+        @"domainLookup",
+        @"connect",
+        @"secureConnection",
+        @"timeToFirstByte",
+        @"jsonParsing",
+        @"modelBuilding",
+        @"imageDecoding"
+};
+
+uint64_t IMMetricsTimestamp(void) {
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+
+    return mach_absolute_time() * timebase.numer / timebase.denom / NSEC_PER_USEC;
+}
+
+static inline void IMMetricsIncrement(atomic_uint_fast64_t *counter, uint64_t value) {
+    atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
+
+static inline uint64_t IMMetricsLoad(atomic_uint_fast64_t *counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+static void IMMetricsTimingRecord(IMMetricsTiming *timing, uint64_t microseconds) {
+    uint64_t milliseconds = microseconds / 1000;
+
+    // bucket 0 holds sub-millisecond durations, bucket i holds [2^(i-1), 2^i) milliseconds
+    NSUInteger bucket = milliseconds == 0 ? 0 : (NSUInteger) (64 - __builtin_clzll(milliseconds));
+
+    IMMetricsIncrement(&timing->count, 1);
+    IMMetricsIncrement(&timing->totalMicroseconds, microseconds);
+    IMMetricsIncrement(&timing->buckets[MIN(bucket, IMMetricsHistogramBucketCount - 1)], 1);
+}
+
+static IMImojiTimingMetrics *IMMetricsTimingSnapshot(IMMetricsTiming *timing) {
+    NSMutableArray *histogram = [NSMutableArray arrayWithCapacity:IMMetricsHistogramBucketCount];
+    for (NSUInteger i = 0; i < IMMetricsHistogramBucketCount; ++i) {
+        [histogram addObject:@(IMMetricsLoad(&timing->buckets[i]))];
+    }
+
+    return [[IMImojiTimingMetrics alloc] initWithCount:(NSUInteger) IMMetricsLoad(&timing->count)
+                                         totalDuration:IMMetricsLoad(&timing->totalMicroseconds) / (NSTimeInterval) USEC_PER_SEC
+                                             histogram:histogram];
+}
+
+static void IMMetricsTimingReset(IMMetricsTiming *timing) {
+    atomic_store_explicit(&timing->count, 0, memory_order_relaxed);
+    atomic_store_explicit(&timing->totalMicroseconds, 0, memory_order_relaxed);
+    for (NSUInteger i = 0; i < IMMetricsHistogramBucketCount; ++i) {
+        atomic_store_explicit(&timing->buckets[i], 0, memory_order_relaxed);
+    }
+}
+
+@implementation IMMetricsRecorder {
+    IMMetricsTiming _phases[IMMetricsPhaseCount];
+
+    // endpoint and cache structs are allocated on first use and live as long as the recorder, so pointers handed out
+    // under the lock stay valid once it is released
+    pthread_rwlock_t _lock;
+    NSMutableDictionary<NSString *, NSValue *> *_endpoints;
+    NSMutableDictionary<NSString *, NSValue *> *_caches;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        pthread_rwlock_init(&_lock, NULL);
+        _endpoints = [NSMutableDictionary dictionary];
+        _caches = [NSMutableDictionary dictionary];
+
+        for (NSUInteger i = 0; i < IMMetricsPhaseCount; ++i) {
+            IMMetricsTimingReset(&_phases[i]);
+        }
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    for (NSValue *value in _endpoints.allValues) {
+        free(value.pointerValue);
+    }
+    for (NSValue *value in _caches.allValues) {
+        free(value.pointerValue);
+    }
+
+    pthread_rwlock_destroy(&_lock);
+}
+
++ (NSString *)endpointForURL:(NSURL *)url {
+    static NSString *apiHost, *apiPathPrefix, *renderHost;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSURL *serverURL = [NSURL URLWithString:ImojiSDKServerURL];
+        apiHost = serverURL.host;
+        apiPathPrefix = serverURL.path;
+        renderHost = [NSURL URLWithString:ImojiSDKRenderServerURL].host;
+    });
+
+    if ([url.host isEqualToString:apiHost]) {
+        NSString *path = url.path;
+        return [path hasPrefix:apiPathPrefix] ? [path substringFromIndex:apiPathPrefix.length] : path;
+    }
+
+    if ([url.host isEqualToString:renderHost]) {
+        return @"render";
+    }
+
+    return url.host ?: @"unknown";
+}
+
+#pragma mark Recording
+
+- (void)recordRequestToURL:(NSURL *)url
+                 startTime:(uint64_t)startTime
+                 bytesSent:(unsigned long long)bytesSent
+             bytesReceived:(unsigned long long)bytesReceived
+                    failed:(BOOL)failed {
+    IMMetricsEndpoint *endpoint = [self endpointStructForURL:url];
+
+    IMMetricsTimingRecord(&endpoint->latency, IMMetricsTimestamp() - startTime);
+    IMMetricsIncrement(&endpoint->bytesSent, bytesSent);
+    IMMetricsIncrement(&endpoint->bytesReceived, bytesReceived);
+
+    if (failed) {
+        IMMetricsIncrement(&endpoint->errors, 1);
+    }
+}
+
+- (void)recordRetryForURL:(NSURL *)url {
+    IMMetricsIncrement(&[self endpointStructForURL:url]->retries, 1);
+}
+
+- (void)recordPhase:(IMMetricsPhase)phase startTime:(uint64_t)startTime {
+    IMMetricsTimingRecord(&_phases[phase], IMMetricsTimestamp() - startTime);
+}
+
+- (void)recordPhase:(IMMetricsPhase)phase duration:(NSTimeInterval)duration {
+    if (duration >= 0) {
+        IMMetricsTimingRecord(&_phases[phase], (uint64_t) (duration * USEC_PER_SEC));
+    }
+}
+
+- (void)recordCacheTier:(NSString *)tier hit:(BOOL)hit {
+    IMMetricsCache *cache = [self structForKey:tier in:_caches size:sizeof(IMMetricsCache)];
+    IMMetricsIncrement(hit ? &cache->hits : &cache->misses, 1);
+}
+
+#if __IPHONE_OS_VERSION_MAX_ALLOWED >= 100000
+- (void)recordTaskMetrics:(NSURLSessionTaskMetrics *)metrics {
+    for (NSURLSessionTaskTransactionMetrics *transaction in metrics.transactionMetrics) {
+        if (transaction.resourceFetchType == NSURLSessionTaskMetricsResourceFetchTypeLocalCache) {
+            [self recordCacheTier:IMMetricsCacheTierURLCache hit:YES];
+            continue;
+        }
+
+        if (transaction.resourceFetchType != NSURLSessionTaskMetricsResourceFetchTypeNetworkLoad) {
+            continue;
+        }
+
+        // only requests the cache could have answered count as misses
+        if ([transaction.request.HTTPMethod isEqualToString:@"GET"]) {
+            [self recordCacheTier:IMMetricsCacheTierURLCache hit:NO];
+        }
+
+        // connection phases are only present for requests that opened a new connection
+        if (!transaction.reusedConnection) {
+            [self recordPhase:IMMetricsPhaseDomainLookup from:transaction.domainLookupStartDate to:transaction.domainLookupEndDate];
+            [self recordPhase:IMMetricsPhaseConnect from:transaction.connectStartDate to:transaction.secureConnectionStartDate ?: transaction.connectEndDate];
+            [self recordPhase:IMMetricsPhaseSecureConnection from:transaction.secureConnectionStartDate to:transaction.secureConnectionEndDate];
+        }
+
+        [self recordPhase:IMMetricsPhaseTimeToFirstByte from:transaction.requestStartDate to:transaction.responseStartDate];
+    }
+}
+
+- (void)recordPhase:(IMMetricsPhase)phase from:(NSDate *)startDate to:(NSDate *)endDate {
+    if (startDate && endDate) {
+        [self recordPhase:phase duration:[endDate timeIntervalSinceDate:startDate]];
+    }
+}
+#endif
+
+#pragma mark Snapshots
+
+- (IMImojiSessionMetrics *)snapshot {
+    NSMutableDictionary *endpoints = [NSMutableDictionary dictionary];
+    NSMutableDictionary *phases = [NSMutableDictionary dictionaryWithCapacity:IMMetricsPhaseCount];
+    NSMutableDictionary *caches = [NSMutableDictionary dictionary];
+
+    pthread_rwlock_rdlock(&_lock);
+
+    [_endpoints enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSValue *value, BOOL *stop) {
+        IMMetricsEndpoint *endpoint = value.pointerValue;
+        endpoints[key] = [[IMImojiEndpointMetrics alloc] initWithLatency:IMMetricsTimingSnapshot(&endpoint->latency)
+                                                              errorCount:(NSUInteger) IMMetricsLoad(&endpoint->errors)
+                                                              retryCount:(NSUInteger) IMMetricsLoad(&endpoint->retries)
+                                                               bytesSent:IMMetricsLoad(&endpoint->bytesSent)
+                                                           bytesReceived:IMMetricsLoad(&endpoint->bytesReceived)];
+    }];
+
+    [_caches enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSValue *value, BOOL *stop) {
+        IMMetricsCache *cache = value.pointerValue;
+        caches[key] = [[IMImojiCacheMetrics alloc] initWithHits:(NSUInteger) IMMetricsLoad(&cache->hits)
+                                                         misses:(NSUInteger) IMMetricsLoad(&cache->misses)];
+    }];
+
+    pthread_rwlock_unlock(&_lock);
+
+    for (NSUInteger i = 0; i < IMMetricsPhaseCount; ++i) {
+        phases[IMMetricsPhaseNames[i]] = IMMetricsTimingSnapshot(&_phases[i]);
+    }
+
+    return [[IMImojiSessionMetrics alloc] initWithEndpoints:endpoints phases:phases caches:caches];
+}
+
+- (void)reset {
+    pthread_rwlock_rdlock(&_lock);
+
+    for (NSValue *value in _endpoints.allValues) {
+        IMMetricsEndpoint *endpoint = value.pointerValue;
+        IMMetricsTimingReset(&endpoint->latency);
+        atomic_store_explicit(&endpoint->errors, 0, memory_order_relaxed);
+        atomic_store_explicit(&endpoint->retries, 0, memory_order_relaxed);
+        atomic_store_explicit(&endpoint->bytesSent, 0, memory_order_relaxed);
+        atomic_store_explicit(&endpoint->bytesReceived, 0, memory_order_relaxed);
+    }
+
+    for (NSValue *value in _caches.allValues) {
+        IMMetricsCache *cache = value.pointerValue;
+        atomic_store_explicit(&cache->hits, 0, memory_order_relaxed);
+        atomic_store_explicit(&cache->misses, 0, memory_order_relaxed);
+    }
+
+    pthread_rwlock_unlock(&_lock);
+
+    for (NSUInteger i = 0; i < IMMetricsPhaseCount; ++i) {
+        IMMetricsTimingReset(&_phases[i]);
+    }
+}
+
+#pragma mark Storage
+
+- (IMMetricsEndpoint *)endpointStructForURL:(NSURL *)url {
+    return [self structForKey:[IMMetricsRecorder endpointForURL:url] in:_endpoints size:sizeof(IMMetricsEndpoint)];
+}
+
+- (void *)structForKey:(NSString *)key in:(NSMutableDictionary<NSString *, NSValue *> *)structs size:(size_t)size {
+    pthread_rwlock_rdlock(&_lock);
+    void *pointer = structs[key].pointerValue;
+    pthread_rwlock_unlock(&_lock);
+
+    if (pointer) {
+        return pointer;
+    }
+
+    pthread_rwlock_wrlock(&_lock);
+    pointer = structs[key].pointerValue;
+    if (!pointer) {
+        // zeroed memory is a valid initial state for the atomic counters
+        pointer = calloc(1, size);
+        structs[key] = [NSValue valueWithPointer:pointer];
+    }
+    pthread_rwlock_unlock(&_lock);
+
+    return pointer;
+}
+
+@end
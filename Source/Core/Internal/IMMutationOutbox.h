@@ -0,0 +1,85 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class BFTask;
+
+extern NSString *__nonnull const IMMutationKindCollectionAdd;
+extern NSString *__nonnull const IMMutationKindRemove;
+extern NSString *__nonnull const IMMutationKindReport;
+extern NSString *__nonnull const IMMutationKindCreate;
+
+/**
+* @abstract A recorded user mutation (collection add, removal, abuse report or creation)
+*/
+@interface IMMutation : NSObject
+
+@property(nonatomic, copy, readonly, nonnull) NSString *identifier;
+
+@property(nonatomic, copy, readonly, nonnull) NSString *kind;
+
+@property(nonatomic, copy, readonly, nonnull) NSString *imojiIdentifier;
+
+@property(nonatomic, copy, readonly, nonnull) NSDictionary *parameters;
+
+@end
+
+/**
+* @abstract Handler used by the outbox for sending mutations. Cancelled tasks and transient failures (see im_isTransient
+* of NSError) are retried with a backoff, any other failure is treated as permanent and the mutation is dropped.
+*/
+typedef BFTask *__nonnull (^IMMutationOutboxHandler)(IMMutation *__nonnull mutation);
+
+/**
+* @abstract Durable outbox for user mutations. Mutations are appended to a JSON lines log before being acknowledged,
+* sent in the background with bounded concurrency (mutations on the same imoji are kept in order) and replayed from
+* the log after a relaunch. Mutations that cancel each other out are coalesced before they are sent.
+*/
+@interface IMMutationOutbox : NSObject
+
+@property(nonatomic, readonly, nonnull) NSURL *logURL;
+
+@property(nonatomic) NSUInteger maximumConcurrentMutations;
+
+- (nonnull instancetype)initWithLogURL:(nonnull NSURL *)logURL
+                               handler:(nonnull IMMutationOutboxHandler)handler;
+
+/**
+* @abstract Loads the log in the background and starts sending mutations recorded by a previous launch
+*/
+- (void)resume;
+
+/**
+* @abstract Durably records a mutation and schedules it for sending.
+* @param retained When YES the caller performs the mutation itself and must call finishMutation:retrying:, the
+* outbox only replays it if the process ends before that happens
+* @return A task resolving with the recorded IMMutation once it has been written to the log. Coalesced mutations
+* resolve with nil. Fails with an NSPOSIXErrorDomain error when the log cannot be written, the mutation is not recorded.
+*/
+- (nonnull BFTask *)enqueueMutationWithKind:(nonnull NSString *)kind
+                            imojiIdentifier:(nonnull NSString *)imojiIdentifier
+                                 parameters:(nonnull NSDictionary *)parameters
+                                   retained:(BOOL)retained;
+
+/**
+* @abstract Durably replaces the parameters of a mutation, replays after a relaunch use them. Used by retained
+* mutations to record the progress of a non idempotent request.
+* @return A task resolving once the parameters have been written to the log
+*/
+- (nonnull BFTask *)updateMutation:(nonnull IMMutation *)mutation parameters:(nonnull NSDictionary *)parameters;
+
+/**
+* @abstract Completes a retained mutation. When retrying is YES the mutation is handed to the outbox to be sent again,
+* otherwise it is removed from the log whether it succeeded or failed for good.
+*/
+- (void)finishMutation:(nonnull IMMutation *)mutation retrying:(BOOL)retrying;
+
+/**
+* @abstract Mutations recorded and not yet acknowledged, in the order they were recorded
+*/
+- (nonnull BFTask *)pendingMutations;
+
+@end
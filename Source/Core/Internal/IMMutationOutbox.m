@@ -0,0 +1,411 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Bolts/BFExecutor.h>
+#import <Bolts/BFTask.h>
+#import "IMMutationOutbox.h"
+#import "NSString+Utils.h"
+#import "NSError+Utils.h"
+
+NSString *const IMMutationKindCollectionAdd = @"collectionAdd";
+NSString *const IMMutationKindRemove = @"remove";
+NSString *const IMMutationKindReport = @"report";
+NSString *const IMMutationKindCreate = @"create";
+
+// number of acknowledgement records appended before the log is rewritten with only the pending mutations
+static const NSUInteger IMMutationOutboxCompactionThreshold = 128;
+static const NSTimeInterval IMMutationOutboxMaximumBackoff = 300.0;
+
+@interface IMMutation ()
+
+@property(nonatomic, copy, readwrite) NSString *identifier;
+@property(nonatomic, copy, readwrite) NSString *kind;
+@property(nonatomic, copy, readwrite) NSString *imojiIdentifier;
+@property(nonatomic, copy, readwrite) NSDictionary *parameters;
+
+@property(nonatomic) BOOL retained;
+@property(nonatomic) BOOL inFlight;
+@property(nonatomic) NSUInteger attempts;
+@property(nonatomic) NSTimeInterval notBefore;
+
+@end
+
+@implementation IMMutation
+
+- (NSDictionary *)logRecord {
+    return @{
+            @"type" : @"mutation",
+            @"id" : self.identifier,
+            @"kind" : self.kind,
+            @"imojiId" : self.imojiIdentifier,
+            @"parameters" : self.parameters
+    };
+}
+
+@end
+
+@implementation IMMutationOutbox {
+    dispatch_queue_t _queue;
+    BFExecutor *_executor;
+    IMMutationOutboxHandler _handler;
+
+    NSMutableArray<IMMutation *> *_pending;
+    NSFileHandle *_logHandle;
+    NSUInteger _acknowledgedRecords;
+    NSUInteger _inFlightCount;
+}
+
+- (instancetype)initWithLogURL:(NSURL *)logURL
+                       handler:(IMMutationOutboxHandler)handler {
+    self = [super init];
+    if (self) {
+        _logURL = logURL;
+        _handler = [handler copy];
+        _maximumConcurrentMutations = 4;
+        _queue = dispatch_queue_create("com.imoji.mutations", DISPATCH_QUEUE_SERIAL);
+        _executor = [BFExecutor executorWithDispatchQueue:_queue];
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    [_logHandle closeFile];
+}
+
+- (void)resume {
+    dispatch_async(_queue, ^{
+        [self loadIfNeeded];
+        [self drain];
+    });
+}
+
+- (BFTask *)enqueueMutationWithKind:(NSString *)kind
+                    imojiIdentifier:(NSString *)imojiIdentifier
+                         parameters:(NSDictionary *)parameters
+                           retained:(BOOL)retained {
+    return [[BFTask taskWithResult:nil] continueWithExecutor:_executor withBlock:^id(BFTask *task) {
+        [self loadIfNeeded];
+
+        if ([self coalesceMutationWithKind:kind imojiIdentifier:imojiIdentifier parameters:parameters]) {
+            return nil;
+        }
+
+        IMMutation *mutation = [IMMutation new];
+        mutation.identifier = [NSString im_stringWithRandomUUID];
+        mutation.kind = kind;
+        mutation.imojiIdentifier = imojiIdentifier;
+        mutation.parameters = parameters;
+        mutation.retained = retained;
+
+        // the mutation is only acknowledged once it is on disk
+        NSError *error = [self appendRecord:mutation.logRecord synchronize:YES];
+        if (error) {
+            return error;
+        }
+
+        [self->_pending addObject:mutation];
+        [self drain];
+
+        return mutation;
+    }];
+}
+
+- (BFTask *)updateMutation:(IMMutation *)mutation parameters:(NSDictionary *)parameters {
+    return [[BFTask taskWithResult:nil] continueWithExecutor:_executor withBlock:^id(BFTask *task) {
+        mutation.parameters = parameters;
+
+        // the record replaces the previous one with the same identifier when the log is loaded
+        return [self appendRecord:mutation.logRecord synchronize:YES] ?: mutation;
+    }];
+}
+
+- (void)finishMutation:(IMMutation *)mutation retrying:(BOOL)retrying {
+    dispatch_async(_queue, ^{
+        mutation.retained = NO;
+
+        if (retrying) {
+            [self drain];
+        } else {
+            [self acknowledgeMutation:mutation];
+        }
+    });
+}
+
+- (BFTask *)pendingMutations {
+    return [[BFTask taskWithResult:nil] continueWithExecutor:_executor withBlock:^id(BFTask *task) {
+        [self loadIfNeeded];
+        return [self->_pending copy];
+    }];
+}
+
+#pragma mark Coalescing
+
+- (BOOL)coalesceMutationWithKind:(NSString *)kind
+                 imojiIdentifier:(NSString *)imojiIdentifier
+                      parameters:(NSDictionary *)parameters {
+    if ([kind isEqualToString:IMMutationKindCreate]) {
+        return NO;
+    }
+
+    for (IMMutation *pending in [_pending copy]) {
+        if (pending.inFlight || pending.retained || ![pending.imojiIdentifier isEqualToString:imojiIdentifier]) {
+            continue;
+        }
+
+        if ([pending.kind isEqualToString:kind] && [pending.parameters isEqualToDictionary:parameters]) {
+            // identical to a mutation that hasn't been sent yet
+            return YES;
+        }
+
+        if ([kind isEqualToString:IMMutationKindRemove] && [pending.kind isEqualToString:IMMutationKindCollectionAdd]) {
+            // adding a removed imoji to the collection is pointless, drop the add
+            [self acknowledgeMutation:pending];
+        }
+    }
+
+    return NO;
+}
+
+#pragma mark Sending
+
+- (void)drain {
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    NSTimeInterval nextAttempt = DBL_MAX;
+    NSMutableSet<NSString *> *blockedImojiIdentifiers = [NSMutableSet set];
+
+    for (IMMutation *mutation in [_pending copy]) {
+        if (_inFlightCount >= self.maximumConcurrentMutations) {
+            break;
+        }
+
+        // mutations for the same imoji are sent one at a time and in the order they were recorded
+        if ([blockedImojiIdentifiers containsObject:mutation.imojiIdentifier]) {
+            continue;
+        }
+        [blockedImojiIdentifiers addObject:mutation.imojiIdentifier];
+
+        if (mutation.inFlight || mutation.retained) {
+            continue;
+        }
+
+        if (mutation.notBefore > now) {
+            nextAttempt = MIN(nextAttempt, mutation.notBefore);
+            continue;
+        }
+
+        [self sendMutation:mutation];
+    }
+
+    if (nextAttempt != DBL_MAX) {
+        __weak IMMutationOutbox *weakSelf = self;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t) ((nextAttempt - now) * NSEC_PER_SEC)), _queue, ^{
+            [weakSelf drain];
+        });
+    }
+}
+
+- (void)sendMutation:(IMMutation *)mutation {
+    mutation.inFlight = YES;
+    _inFlightCount++;
+
+    [_handler(mutation) continueWithExecutor:_executor withBlock:^id(BFTask *task) {
+        mutation.inFlight = NO;
+        self->_inFlightCount--;
+
+        BOOL transient = task.cancelled || task.error.im_isTransient;
+        if (task.error || task.cancelled) {
+            if (transient) {
+                mutation.attempts++;
+                mutation.notBefore = [NSDate timeIntervalSinceReferenceDate] + MIN(IMMutationOutboxMaximumBackoff, pow(2.0, mutation.attempts));
+            } else {
+                NSLog(@"WARNING: dropping %@ mutation for imoji %@: %@", mutation.kind, mutation.imojiIdentifier, task.error);
+                [self acknowledgeMutation:mutation];
+            }
+        } else {
+            [self acknowledgeMutation:mutation];
+        }
+
+        [self drain];
+        return nil;
+    }];
+}
+
+#pragma mark Log
+
+- (void)loadIfNeeded {
+    if (_pending) {
+        return;
+    }
+
+    _pending = [NSMutableArray array];
+
+    NSData *contents = [NSData dataWithContentsOfURL:self.logURL];
+    NSMutableDictionary<NSString *, IMMutation *> *mutations = [NSMutableDictionary dictionary];
+    NSUInteger recordCount = 0;
+    NSUInteger validLength = 0;
+    BOOL damaged = NO;
+
+    // lines are split on the raw bytes, a record cut inside a multibyte character only loses that record
+    const char *bytes = contents.bytes;
+    NSUInteger lineStart = 0;
+    while (lineStart < contents.length) {
+        const char *newline = memchr(bytes + lineStart, '\n', contents.length - lineStart);
+        NSUInteger lineEnd = newline ? (NSUInteger) (newline - bytes) : contents.length;
+        NSData *lineData = [contents subdataWithRange:NSMakeRange(lineStart, lineEnd - lineStart)];
+        lineStart = lineEnd + 1;
+
+        if (newline) {
+            validLength = lineStart;
+        }
+
+        if (lineData.length == 0) {
+            continue;
+        }
+
+        // an interrupted append leaves a partial last line without a newline
+        NSDictionary *record = newline ? [NSJSONSerialization JSONObjectWithData:lineData options:0 error:nil] : nil;
+        if (![record isKindOfClass:[NSDictionary class]] || ![record[@"id"] isKindOfClass:[NSString class]]) {
+            damaged = YES;
+            continue;
+        }
+
+        recordCount++;
+        if ([record[@"type"] isEqualToString:@"ack"]) {
+            IMMutation *mutation = mutations[record[@"id"]];
+            if (mutation) {
+                [_pending removeObject:mutation];
+                [mutations removeObjectForKey:record[@"id"]];
+            }
+        } else if ([record[@"kind"] isKindOfClass:[NSString class]] && [record[@"imojiId"] isKindOfClass:[NSString class]]) {
+            NSDictionary *parameters = [record[@"parameters"] isKindOfClass:[NSDictionary class]] ? record[@"parameters"] : @{};
+
+            // written by updateMutation:parameters:
+            IMMutation *mutation = mutations[record[@"id"]];
+            if (mutation) {
+                mutation.parameters = parameters;
+                continue;
+            }
+
+            mutation = [IMMutation new];
+            mutation.identifier = record[@"id"];
+            mutation.kind = record[@"kind"];
+            mutation.imojiIdentifier = record[@"imojiId"];
+            mutation.parameters = parameters;
+
+            mutations[mutation.identifier] = mutation;
+            [_pending addObject:mutation];
+        }
+    }
+
+    // rewriting the log drops damaged lines, which the next append would otherwise be written after
+    BOOL compacted = (damaged || recordCount != _pending.count) && [self compact];
+
+    [self openLog];
+
+    if (!compacted && validLength < contents.length) {
+        @try {
+            [_logHandle truncateFileAtOffset:validLength];
+        } @catch (NSException *exception) {
+            NSLog(@"WARNING: unable to truncate mutation log %@: %@", self.logURL.path, exception.reason);
+        }
+    }
+}
+
+- (NSError *)openLog {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+
+    if (![fileManager fileExistsAtPath:self.logURL.path]) {
+        [fileManager createDirectoryAtURL:[self.logURL URLByDeletingLastPathComponent] withIntermediateDirectories:YES attributes:nil error:nil];
+        [fileManager createFileAtPath:self.logURL.path contents:nil attributes:nil];
+    }
+
+    NSError *error;
+    _logHandle = [NSFileHandle fileHandleForWritingToURL:self.logURL error:&error];
+    [_logHandle seekToEndOfFile];
+
+    return error;
+}
+
+// returns an NSPOSIXErrorDomain error when the record could not be written
+- (NSError *)appendRecord:(NSDictionary *)record synchronize:(BOOL)synchronize {
+    NSMutableData *line = [[NSJSONSerialization dataWithJSONObject:record options:0 error:nil] mutableCopy];
+    if (!line) {
+        return [NSError errorWithDomain:NSPOSIXErrorDomain
+                                   code:EINVAL
+                               userInfo:@{
+                                       NSLocalizedDescriptionKey : @"Mutation cannot be encoded as JSON"
+                               }];
+    }
+
+    [line appendBytes:"\n" length:1];
+
+    NSError *openError = _logHandle ? nil : [self openLog];
+    if (!_logHandle) {
+        NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
+        userInfo[NSLocalizedDescriptionKey] = [NSString stringWithFormat:@"Unable to open mutation log %@", self.logURL.path];
+        userInfo[NSUnderlyingErrorKey] = openError;
+
+        return [NSError errorWithDomain:NSPOSIXErrorDomain code:EIO userInfo:userInfo];
+    }
+
+    @try {
+        [_logHandle writeData:line];
+
+        if (synchronize) {
+            [_logHandle synchronizeFile];
+        }
+    } @catch (NSException *exception) {
+        NSLog(@"WARNING: unable to write to mutation log %@: %@", self.logURL.path, exception.reason);
+
+        return [NSError errorWithDomain:NSPOSIXErrorDomain
+                                   code:EIO
+                               userInfo:@{
+                                       NSLocalizedDescriptionKey : [NSString stringWithFormat:@"Unable to write to mutation log %@", self.logURL.path]
+                               }];
+    }
+
+    return nil;
+}
+
+- (void)acknowledgeMutation:(IMMutation *)mutation {
+    if (![_pending containsObject:mutation]) {
+        return;
+    }
+
+    [_pending removeObject:mutation];
+
+    // losing the acknowledgement of an idempotent mutation only causes a resend, creations and reports would be
+    // performed twice
+    BOOL idempotent = ![mutation.kind isEqualToString:IMMutationKindCreate] && ![mutation.kind isEqualToString:IMMutationKindReport];
+    [self appendRecord:@{@"type" : @"ack", @"id" : mutation.identifier} synchronize:!idempotent];
+
+    if (++_acknowledgedRecords >= IMMutationOutboxCompactionThreshold) {
+        [_logHandle closeFile];
+        [self compact];
+        [self openLog];
+    }
+}
+
+- (BOOL)compact {
+    NSMutableData *contents = [NSMutableData data];
+    for (IMMutation *mutation in _pending) {
+        NSData *line = [NSJSONSerialization dataWithJSONObject:mutation.logRecord options:0 error:nil];
+        if (line) {
+            [contents appendData:line];
+            [contents appendBytes:"\n" length:1];
+        }
+    }
+
+    [[NSFileManager defaultManager] createDirectoryAtURL:[self.logURL URLByDeletingLastPathComponent] withIntermediateDirectories:YES attributes:nil error:nil];
+    if (![contents writeToURL:self.logURL options:NSDataWritingAtomic error:nil]) {
+        return NO;
+    }
+
+    _acknowledgedRecords = 0;
+    return YES;
+}
+
+@end
@@ -0,0 +1,54 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class IMImojiObject;
+@class IMImojiObjectRenderingOptions;
+
+/**
+* @abstract Chooses renditions for rendering options with a targetDownloadDuration. Download throughput is measured per
+* host as an exponentially weighted moving average of the bytes received while transfers to it were in progress, over
+* that wall time, and compared with the file sizes the server reports for each rendition. Shared by every IMImojiSession in the process since they use the same network link. Safe
+* to use from multiple threads.
+*/
+@interface IMRenditionSelector : NSObject
+
++ (nonnull instancetype)sharedSelector;
+
+/**
+* @abstract Adds a transfer of length bytes that took duration seconds to the throughput of host. Transfers completing
+* too fast to have used the network are ignored.
+*/
+- (void)recordTransferOfLength:(unsigned long long)length
+                      duration:(NSTimeInterval)duration
+                          host:(nonnull NSString *)host;
+
+/**
+* @abstract Marks the start of a transfer from host. Every call must be balanced by endTransferFromHost:length:.
+*/
+- (void)beginTransferFromHost:(nonnull NSString *)host;
+
+/**
+* @abstract Marks the end of a transfer from host that received length bytes, 0 when it failed. Concurrent transfers
+* are measured together, a sample is recorded once none are in progress or after a second of continuous transfers.
+*/
+- (void)endTransferFromHost:(nonnull NSString *)host length:(unsigned long long)length;
+
+/**
+* @abstract Estimated throughput of host in bytes per second, 0 when no transfer was measured yet
+*/
+- (double)throughputForHost:(nonnull NSString *)host;
+
+/**
+* @abstract Options for the highest quality rendition of imoji expected to download within the targetDownloadDuration
+* of options. Candidates are tried animated first when requested, then from options.renderSize down with the
+* requested format before WebP. The smallest rendition is used when none fits and options are returned as they are
+* when the throughput or file sizes are unknown.
+*/
+- (nonnull IMImojiObjectRenderingOptions *)renderingOptionsForImoji:(nonnull IMImojiObject *)imoji
+                                                            options:(nonnull IMImojiObjectRenderingOptions *)options;
+
+@end
@@ -0,0 +1,208 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import "IMRenditionSelector.h"
+#import "IMImojiObject.h"
+#import "IMImojiObjectRenderingOptions.h"
+#import "IMMetricsRecorder.h"
+
+// weight of the latest transfer, recent samples dominate so the estimate follows switches between wifi and cellular
+static const double IMRenditionSelectorSmoothingFactor = 0.3;
+
+// transfers shorter than this were answered from the URL cache
+static const NSTimeInterval IMRenditionSelectorMinimumTransferDuration = 0.01;
+
+// longest period of continuous transfers measured as a single sample
+static const NSTimeInterval IMRenditionSelectorMaximumSampleDuration = 1.0;
+
+// transfers in progress from a host since the start of the current sample
+@interface IMRenditionSelectorHostTransfers : NSObject
+
+@property(nonatomic) NSUInteger activeCount;
+@property(nonatomic) uint64_t sampleStartTime;
+@property(nonatomic) unsigned long long sampleLength;
+
+@end
+
+@implementation IMRenditionSelectorHostTransfers
+@end
+
+@implementation IMRenditionSelector {
+    NSMutableDictionary<NSString *, NSNumber *> *_throughputs;
+    NSMutableDictionary<NSString *, IMRenditionSelectorHostTransfers *> *_transfers;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _throughputs = [NSMutableDictionary dictionary];
+        _transfers = [NSMutableDictionary dictionary];
+    }
+
+    return self;
+}
+
++ (instancetype)sharedSelector {
+    static IMRenditionSelector *sharedSelector = nil;
+    static dispatch_once_t predicate;
+
+    dispatch_once(&predicate, ^{
+        sharedSelector = [IMRenditionSelector new];
+    });
+
+    return sharedSelector;
+}
+
+#pragma mark Throughput
+
+- (void)recordTransferOfLength:(unsigned long long)length
+                      duration:(NSTimeInterval)duration
+                          host:(NSString *)host {
+    if (length == 0 || duration < IMRenditionSelectorMinimumTransferDuration) {
+        return;
+    }
+
+    double throughput = length / duration;
+
+    @synchronized (self) {
+        NSNumber *previous = _throughputs[host];
+        _throughputs[host] = @(previous ?
+                previous.doubleValue + IMRenditionSelectorSmoothingFactor * (throughput - previous.doubleValue) :
+                throughput);
+    }
+}
+
+- (void)beginTransferFromHost:(NSString *)host {
+    @synchronized (self) {
+        IMRenditionSelectorHostTransfers *transfers = _transfers[host];
+        if (!transfers) {
+            transfers = [IMRenditionSelectorHostTransfers new];
+            _transfers[host] = transfers;
+        }
+
+        // queue waits before the first transfer starts aren't counted, while others are running the link is busy
+        if (transfers.activeCount++ == 0) {
+            transfers.sampleStartTime = IMMetricsTimestamp();
+            transfers.sampleLength = 0;
+        }
+    }
+}
+
+- (void)endTransferFromHost:(NSString *)host length:(unsigned long long)length {
+    unsigned long long sampleLength = 0;
+    NSTimeInterval sampleDuration = 0;
+
+    @synchronized (self) {
+        IMRenditionSelectorHostTransfers *transfers = _transfers[host];
+        if (!transfers || transfers.activeCount == 0) {
+            return;
+        }
+
+        uint64_t now = IMMetricsTimestamp();
+        NSTimeInterval duration = (now - transfers.sampleStartTime) / (double) USEC_PER_SEC;
+        transfers.activeCount--;
+        transfers.sampleLength += length;
+
+        if (transfers.activeCount == 0 || duration >= IMRenditionSelectorMaximumSampleDuration) {
+            sampleLength = transfers.sampleLength;
+            sampleDuration = duration;
+
+            transfers.sampleStartTime = now;
+            transfers.sampleLength = 0;
+        }
+    }
+
+    [self recordTransferOfLength:sampleLength duration:sampleDuration host:host];
+}
+
+- (double)throughputForHost:(NSString *)host {
+    @synchronized (self) {
+        return _throughputs[host].doubleValue;
+    }
+}
+
+#pragma mark Selection
+
+- (IMImojiObjectRenderingOptions *)renderingOptionsForImoji:(IMImojiObject *)imoji
+                                                    options:(IMImojiObjectRenderingOptions *)options {
+    BOOL animated = imoji.supportsAnimation && options.renderAnimatedIfSupported;
+    IMImojiObjectRenderingOptions *requestedOptions = animated ? [imoji supportedAnimatedRenderingOptionFromOption:options] ?: options : options;
+
+    NSString *host = [imoji getUrlForRenderingOptions:requestedOptions].host;
+    double throughput = host ? [self throughputForHost:host] : 0;
+    if (!options.targetDownloadDuration || throughput == 0) {
+        return requestedOptions;
+    }
+
+    long long maximumFileSize = (long long) (throughput * options.targetDownloadDuration.doubleValue);
+    IMImojiObjectRenderingOptions *smallestOptions = nil;
+
+    for (IMImojiObjectRenderingOptions *candidate in [self candidatesForOptions:options animated:animated]) {
+        id url = imoji.urls[candidate];
+        if (![url isKindOfClass:[NSURL class]]) {
+            continue;
+        }
+
+        id fileSize = imoji.fileSizes[candidate];
+        if (![fileSize isKindOfClass:[NSNumber class]]) {
+            // nothing to estimate with, the server reports sizes for all renditions of an imoji or none
+            return requestedOptions;
+        }
+
+        IMImojiObjectRenderingOptions *selectedOptions = [options copy];
+        selectedOptions.renderSize = candidate.renderSize;
+        selectedOptions.borderStyle = candidate.borderStyle;
+        selectedOptions.imageFormat = candidate.imageFormat;
+        selectedOptions.renderAnimatedIfSupported = candidate.imageFormat == IMImojiObjectImageFormatAnimatedGif ||
+                candidate.imageFormat == IMImojiObjectImageFormatAnimatedWebp;
+
+        if (((NSNumber *) fileSize).longLongValue <= maximumFileSize) {
+            return selectedOptions;
+        }
+
+        smallestOptions = selectedOptions;
+    }
+
+    return smallestOptions ?: requestedOptions;
+}
+
+// keys of imoji.urls from the highest quality allowed by options to the lowest
+- (NSArray<IMImojiObjectRenderingOptions *> *)candidatesForOptions:(IMImojiObjectRenderingOptions *)options animated:(BOOL)animated {
+    NSArray<NSNumber *> *renderSizes = @[
+            @(IMImojiObjectRenderSizeFullResolution),
+            @(IMImojiObjectRenderSize512),
+            @(IMImojiObjectRenderSize320),
+            @(IMImojiObjectRenderSizeThumbnail)
+    ];
+    NSUInteger largestIndex = [renderSizes indexOfObject:@(options.renderSize)];
+    renderSizes = [renderSizes subarrayWithRange:NSMakeRange(largestIndex, renderSizes.count - largestIndex)];
+
+    NSMutableArray<IMImojiObjectRenderingOptions *> *candidates = [NSMutableArray array];
+    void (^addCandidates)(IMImojiObjectBorderStyle, NSArray<NSNumber *> *) = ^(IMImojiObjectBorderStyle borderStyle, NSArray<NSNumber *> *imageFormats) {
+        for (NSNumber *renderSize in renderSizes) {
+            for (NSNumber *imageFormat in imageFormats) {
+                [candidates addObject:[IMImojiObjectRenderingOptions optionsWithRenderSize:(IMImojiObjectRenderSize) renderSize.unsignedIntegerValue
+                                                                               borderStyle:borderStyle
+                                                                               imageFormat:(IMImojiObjectImageFormat) imageFormat.unsignedIntegerValue]];
+            }
+        }
+    };
+
+    // animated renditions never have borders, animated WebP is only used when WebP was asked for
+    if (animated) {
+        addCandidates(IMImojiObjectBorderStyleNone, options.imageFormat == IMImojiObjectImageFormatWebP ?
+                @[@(IMImojiObjectImageFormatAnimatedWebp), @(IMImojiObjectImageFormatAnimatedGif)] :
+                @[@(IMImojiObjectImageFormatAnimatedGif)]);
+    }
+
+    // WebP has the same contents as PNG in fewer bytes
+    addCandidates(options.borderStyle, options.imageFormat == IMImojiObjectImageFormatPNG ?
+            @[@(IMImojiObjectImageFormatPNG), @(IMImojiObjectImageFormatWebP)] :
+            @[@(IMImojiObjectImageFormatWebP)]);
+
+    return candidates;
+}
+
+@end
@@ -0,0 +1,41 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+* @abstract Immutable description of an Imoji API endpoint: its absolute URL, HTTP method and the headers sent with
+* every request. Built once per endpoint so issuing a request only encodes its parameters. The headers depend on the
+* current locale, templates built before the locale changed report a stale localeGeneration and should be rebuilt.
+*/
+@interface IMRequestTemplate : NSObject
+
+@property(nonatomic, readonly, nonnull) NSURL *URL;
+
+@property(nonatomic, readonly, nonnull) NSString *method;
+
+@property(nonatomic, readonly, nonnull) NSDictionary<NSString *, NSString *> *headers;
+
+/**
+* @abstract Value of currentLocaleGeneration when the template was built
+*/
+@property(nonatomic, readonly) NSUInteger localeGeneration;
+
+/**
+* @abstract Incremented whenever NSCurrentLocaleDidChangeNotification is posted
+*/
++ (NSUInteger)currentLocaleGeneration;
+
+- (nonnull instancetype)initWithURLString:(nonnull NSString *)URLString
+                                   method:(nonnull NSString *)method;
+
+/**
+* @abstract Creates a request for the endpoint. Parameters are form encoded into the body of POST and PUT requests and
+* into the query string otherwise.
+*/
+- (nonnull NSMutableURLRequest *)requestWithParameters:(nullable NSDictionary *)parameters
+                                     additionalHeaders:(nullable NSDictionary<NSString *, NSString *> *)additionalHeaders;
+
+@end
@@ -0,0 +1,126 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <stdatomic.h>
+#import "IMRequestTemplate.h"
+#import "ImojiSDK.h"
+#import "RequestUtils.h"
+
+// rough size of an encoded key/value pair, only used to presize buffers
+static const NSUInteger IMRequestTemplateEstimatedParameterLength = 32;
+
+static atomic_uint IMRequestTemplateLocaleGeneration;
+
+@implementation IMRequestTemplate {
+    NSData *_URLBytes;
+    BOOL _parametersInBody;
+}
+
++ (void)observeLocaleChangesIfNeeded {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        [[NSNotificationCenter defaultCenter] addObserverForName:NSCurrentLocaleDidChangeNotification
+                                                          object:nil
+                                                           queue:nil
+                                                      usingBlock:^(NSNotification *notification) {
+                                                          atomic_fetch_add_explicit(&IMRequestTemplateLocaleGeneration, 1, memory_order_relaxed);
+                                                      }];
+    });
+}
+
++ (NSUInteger)currentLocaleGeneration {
+    [self observeLocaleChangesIfNeeded];
+    return atomic_load_explicit(&IMRequestTemplateLocaleGeneration, memory_order_relaxed);
+}
+
++ (NSDictionary<NSString *, NSString *> *)defaultHeaders {
+    static NSDictionary *defaultHeaders;
+    static NSUInteger defaultHeadersGeneration;
+
+    NSUInteger generation = [self currentLocaleGeneration];
+
+    @synchronized (self) {
+        if (!defaultHeaders || defaultHeadersGeneration != generation) {
+            NSMutableDictionary *headers = [NSMutableDictionary dictionary];
+
+            NSString *locale = [[NSLocale currentLocale] localeIdentifier];
+            NSRange startRange = [locale rangeOfString:@"_"];
+            NSString *language = [locale stringByReplacingCharactersInRange:NSMakeRange(0, startRange.length + 1)
+                                                                 withString:[NSLocale preferredLanguages][0]];
+
+            headers[@"Imoji-SDK-Version"] = [ImojiSDK sharedInstance].sdkVersion;
+
+            if (language != nil) {
+                headers[@"User-Locale"] = language;
+            }
+
+            defaultHeaders = [headers copy];
+            defaultHeadersGeneration = generation;
+        }
+
+        return defaultHeaders;
+    }
+}
+
+- (instancetype)initWithURLString:(NSString *)URLString
+                           method:(NSString *)method {
+    self = [super init];
+    if (self) {
+        _localeGeneration = [IMRequestTemplate currentLocaleGeneration];
+        _URL = [NSURL URLWithString:URLString];
+        _URLBytes = [URLString dataUsingEncoding:NSUTF8StringEncoding];
+        _method = [method copy];
+        _parametersInBody = [method isEqualToString:@"POST"] || [method isEqualToString:@"PUT"];
+
+        if (_parametersInBody) {
+            NSMutableDictionary *headers = [[IMRequestTemplate defaultHeaders] mutableCopy];
+            headers[@"Content-Type"] = @"application/x-www-form-urlencoded";
+            _headers = [headers copy];
+        } else {
+            _headers = [IMRequestTemplate defaultHeaders];
+        }
+    }
+
+    return self;
+}
+
+- (NSMutableURLRequest *)requestWithParameters:(NSDictionary *)parameters
+                             additionalHeaders:(NSDictionary<NSString *, NSString *> *)additionalHeaders {
+    NSMutableURLRequest *request;
+    NSMutableData *buffer = [NSMutableData dataWithCapacity:_URLBytes.length + 1 + parameters.count * IMRequestTemplateEstimatedParameterLength];
+
+    if (_parametersInBody) {
+        [buffer appendURLQueryWithParameters:parameters options:URLQueryOptionDefault];
+
+        request = [NSMutableURLRequest requestWithURL:self.URL];
+        request.HTTPBody = buffer;
+    } else {
+        // the query is encoded straight after the endpoint URL so the final URL is parsed from a single buffer
+        [buffer appendData:_URLBytes];
+        [buffer appendBytes:"?" length:1];
+        [buffer appendURLQueryWithParameters:parameters options:URLQueryOptionDefault];
+
+        if (buffer.length == _URLBytes.length + 1) {
+            request = [NSMutableURLRequest requestWithURL:self.URL];
+        } else {
+            NSURL *url = CFBridgingRelease(CFURLCreateWithBytes(kCFAllocatorDefault, buffer.bytes, (CFIndex) buffer.length, kCFStringEncodingUTF8, NULL));
+            request = [NSMutableURLRequest requestWithURL:url ?: self.URL];
+        }
+    }
+
+    request.HTTPMethod = self.method;
+
+    if (additionalHeaders.count > 0) {
+        NSMutableDictionary *headers = [self.headers mutableCopy];
+        [headers addEntriesFromDictionary:additionalHeaders];
+        request.allHTTPHeaderFields = headers;
+    } else {
+        request.allHTTPHeaderFields = self.headers;
+    }
+
+    return request;
+}
+
+@end
@@ -0,0 +1,89 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "IMMemoryGovernor.h"
+
+@class IMAnalyticsPipeline;
+@class IMImageMemoryCache;
+@class IMImojiSession;
+@class IMImojiSessionStoragePolicy;
+@class IMMutationOutbox;
+@class IMURLSessionTransport;
+
+/**
+* @abstract Connection pools and URL caches shared by the IMImojiSessions using the same cache path. API and image
+* requests use separate NSURLSessions configured for their traffic, see generateAPIURLSessionConfiguration and
+* generateImageURLSessionConfiguration of IMImojiSessionStoragePolicy. The sessions are invalidated once the last
+* reference to the resources is released. The memory used by the URL caches is accounted for by IMMemoryGovernor as
+* metadata, trimming it leaves their disk storage in place.
+*/
+@interface IMSharedResources : NSObject <IMMemoryConsumer>
+
+@property(nonatomic, readonly, nonnull) NSURLSession *apiURLSession;
+
+@property(nonatomic, readonly, nonnull) NSURLSession *imageURLSession;
+
+/**
+* @abstract Cache of API responses
+*/
+@property(nonatomic, readonly, nonnull) NSURLCache *metadataCache;
+
+/**
+* @abstract Cache of downloaded images
+*/
+@property(nonatomic, readonly, nonnull) NSURLCache *imageCache;
+
+/**
+* @abstract Decoded images of the renditions downloaded or loaded from disk
+*/
+@property(nonatomic, readonly, nonnull) IMImageMemoryCache *imageMemoryCache;
+
+/**
+* @abstract Creates a transport over the shared sessions for one IMImojiSession. Its metrics handler only receives the
+* metrics of its own requests.
+*/
+- (nonnull IMURLSessionTransport *)createTransport;
+
+@end
+
+/**
+* @abstract Durable state kept under a persistent path. Its files have a single writer in the process, every
+* IMImojiSession using the path attaches to it and recorded work is sent through any attached session still alive.
+*/
+@interface IMSharedPersistentResources : NSObject
+
+@property(nonatomic, readonly, nonnull) IMMutationOutbox *mutationOutbox;
+
+@property(nonatomic, readonly, nonnull) IMAnalyticsPipeline *analyticsPipeline;
+
+/**
+* @abstract Adds session to the sessions sending recorded work. Sessions are held weakly.
+*/
+- (void)attachSession:(nonnull IMImojiSession *)session;
+
+@end
+
+/**
+* @abstract Process wide registry of IMSharedResources keyed by cache path and IMSharedPersistentResources keyed by
+* persistent path
+*/
+@interface IMSharedResourceRegistry : NSObject
+
++ (nonnull instancetype)sharedRegistry;
+
+/**
+* @abstract Returns the resources of storagePolicy's cache path, creating them if no one holds them anymore. Callers
+* keep a strong reference for as long as they use them.
+*/
+- (nonnull IMSharedResources *)resourcesForStoragePolicy:(nonnull IMImojiSessionStoragePolicy *)storagePolicy;
+
+/**
+* @abstract Returns the persistent resources of storagePolicy's persistent path, creating them if no one holds them
+* anymore. Creating them doesn't touch the disk. Callers keep a strong reference for as long as they use them.
+*/
+- (nonnull IMSharedPersistentResources *)persistentResourcesForStoragePolicy:(nonnull IMImojiSessionStoragePolicy *)storagePolicy;
+
+@end
@@ -0,0 +1,174 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Bolts/BFTask.h>
+#import "IMSharedResourceRegistry.h"
+#import "IMAnalyticsPipeline.h"
+#import "IMImageMemoryCache.h"
+#import "IMImojiSession+Private.h"
+#import "IMImojiSessionStoragePolicy.h"
+#import "IMMutationOutbox.h"
+#import "IMURLSessionTransport+Private.h"
+
+@implementation IMSharedResources {
+    IMURLSessionTransportDelegate *_delegate;
+}
+
+- (instancetype)initWithStoragePolicy:(IMImojiSessionStoragePolicy *)storagePolicy {
+    self = [super init];
+    if (self) {
+        NSURLSessionConfiguration *apiConfiguration = [storagePolicy generateAPIURLSessionConfiguration];
+        NSURLSessionConfiguration *imageConfiguration = [storagePolicy generateImageURLSessionConfiguration];
+
+        _delegate = [IMURLSessionTransportDelegate new];
+        _metadataCache = apiConfiguration.URLCache;
+        _imageCache = imageConfiguration.URLCache;
+        _apiURLSession = [NSURLSession sessionWithConfiguration:apiConfiguration delegate:_delegate delegateQueue:nil];
+        _imageURLSession = [NSURLSession sessionWithConfiguration:imageConfiguration delegate:_delegate delegateQueue:nil];
+        _imageMemoryCache = [IMImageMemoryCache new];
+
+        [[IMMemoryGovernor sharedGovernor] registerConsumer:self];
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    [_apiURLSession finishTasksAndInvalidate];
+    [_imageURLSession finishTasksAndInvalidate];
+}
+
+- (IMURLSessionTransport *)createTransport {
+    return [[IMURLSessionTransport alloc] initWithURLSession:self.apiURLSession
+                                             imageURLSession:self.imageURLSession
+                                                    delegate:_delegate];
+}
+
+#pragma mark IMMemoryConsumer
+
+- (NSUInteger)memoryCostAtLevel:(IMMemoryTrimLevel)level {
+    if (level != IMMemoryTrimLevelMetadata) {
+        return 0;
+    }
+
+    return self.metadataCache.currentMemoryUsage + self.imageCache.currentMemoryUsage;
+}
+
+- (void)trimLevel:(IMMemoryTrimLevel)level toCost:(NSUInteger)cost {
+    if (level != IMMemoryTrimLevelMetadata) {
+        return;
+    }
+
+    // NSURLCache only releases its memory when its capacity shrinks, responses remain on disk
+    for (NSURLCache *cache in @[self.metadataCache, self.imageCache]) {
+        NSUInteger memoryCapacity = cache.memoryCapacity;
+        cache.memoryCapacity = 0;
+        cache.memoryCapacity = memoryCapacity;
+    }
+}
+
+@end
+
+@implementation IMSharedPersistentResources {
+    NSHashTable<IMImojiSession *> *_sessions;
+}
+
+- (instancetype)initWithStoragePolicy:(IMImojiSessionStoragePolicy *)storagePolicy {
+    self = [super init];
+    if (self) {
+        _sessions = [NSHashTable weakObjectsHashTable];
+
+        __weak IMSharedPersistentResources *weakSelf = self;
+        _mutationOutbox = [[IMMutationOutbox alloc] initWithLogURL:[storagePolicy.persistentPath URLByAppendingPathComponent:@"imoji.outbox"]
+                                                           handler:^BFTask *(IMMutation *mutation) {
+                                                               IMImojiSession *session = [weakSelf attachedSession];
+                                                               return session ? [session sendMutation:mutation] : [BFTask cancelledTask];
+                                                           }];
+
+        // the spool keeps its head and count in memory, a second writer would overwrite its slots
+        _analyticsPipeline = [[IMAnalyticsPipeline alloc] initWithDirectoryURL:[storagePolicy.persistentPath URLByAppendingPathComponent:@"analytics"]
+                                                                       handler:^BFTask *(NSString *method, NSString *path, NSDictionary *parameters) {
+                                                                           IMImojiSession *session = [weakSelf attachedSession];
+                                                                           return session ? [session runValidatedTaskWithPath:path
+                                                                                                                       method:method
+                                                                                                                   parameters:parameters
+                                                                                                                     priority:NSURLSessionTaskPriorityLow] : [BFTask cancelledTask];
+                                                                       }];
+    }
+
+    return self;
+}
+
+- (void)attachSession:(IMImojiSession *)session {
+    @synchronized (_sessions) {
+        [_sessions addObject:session];
+    }
+}
+
+// nil once every session was released, work is then retried by the next session attaching
+- (IMImojiSession *)attachedSession {
+    @synchronized (_sessions) {
+        return _sessions.anyObject;
+    }
+}
+
+@end
+
+@implementation IMSharedResourceRegistry {
+    // resources are released with the last session holding them
+    NSMapTable<NSString *, IMSharedResources *> *_resources;
+    NSMapTable<NSString *, IMSharedPersistentResources *> *_persistentResources;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _resources = [NSMapTable strongToWeakObjectsMapTable];
+        _persistentResources = [NSMapTable strongToWeakObjectsMapTable];
+    }
+
+    return self;
+}
+
++ (instancetype)sharedRegistry {
+    static IMSharedResourceRegistry *sharedRegistry = nil;
+    static dispatch_once_t predicate;
+
+    dispatch_once(&predicate, ^{
+        sharedRegistry = [IMSharedResourceRegistry new];
+    });
+
+    return sharedRegistry;
+}
+
+- (IMSharedResources *)resourcesForStoragePolicy:(IMImojiSessionStoragePolicy *)storagePolicy {
+    NSString *key = storagePolicy.cachePath.path.stringByStandardizingPath;
+
+    @synchronized (_resources) {
+        IMSharedResources *resources = [_resources objectForKey:key];
+        if (!resources) {
+            resources = [[IMSharedResources alloc] initWithStoragePolicy:storagePolicy];
+            [_resources setObject:resources forKey:key];
+        }
+
+        return resources;
+    }
+}
+
+- (IMSharedPersistentResources *)persistentResourcesForStoragePolicy:(IMImojiSessionStoragePolicy *)storagePolicy {
+    NSString *key = storagePolicy.persistentPath.path.stringByStandardizingPath;
+
+    @synchronized (_persistentResources) {
+        IMSharedPersistentResources *resources = [_persistentResources objectForKey:key];
+        if (!resources) {
+            resources = [[IMSharedPersistentResources alloc] initWithStoragePolicy:storagePolicy];
+            [_persistentResources setObject:resources forKey:key];
+        }
+
+        return resources;
+    }
+}
+
+@end
@@ -0,0 +1,54 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class IMImojiObject;
+@class IMImojiObjectRenderingOptions;
+
+/**
+* @abstract Size bounded store for exported sticker files (used for MSSticker rendering). Artifacts are keyed by the
+* imoji identifier and every rendering option, named by the SHA-256 of that key and evicted least recently used first
+* when the store grows past its size budget. Lookups are answered from an in-memory index, loaded from the directory on
+* first use, and access times are written to the files so the order survives relaunches.
+*/
+@interface IMStickerArtifactStore : NSObject
+
+@property(nonatomic, readonly, nonnull) NSURL *directoryURL;
+
+@property(nonatomic, readonly) unsigned long long maximumSize;
+
+- (nonnull instancetype)initWithDirectoryURL:(nonnull NSURL *)directoryURL
+                                 maximumSize:(unsigned long long)maximumSize;
+
+/**
+* @abstract Canonical key describing the exported artifact for an imoji with the given rendering options.
+*/
++ (nonnull NSString *)artifactKeyForImoji:(nonnull IMImojiObject *)imoji
+                         renderingOptions:(nonnull IMImojiObjectRenderingOptions *)renderingOptions;
+
+/**
+* @abstract Returns the file URL of a previously stored artifact and marks it as recently used, nil when not stored.
+* The first call lists the store directory and should not be made from the main thread.
+*/
+- (nullable NSURL *)artifactURLForKey:(nonnull NSString *)key;
+
+/**
+* @abstract Removes an artifact whose file turned out to be missing or unreadable.
+*/
+- (void)removeArtifactForKey:(nonnull NSString *)key;
+
+/**
+* @abstract Atomically writes the artifact to the store, evicting the least recently used artifacts when over budget.
+* @return The file URL of the stored artifact or nil if it could not be written
+*/
+- (nullable NSURL *)storeArtifactData:(nonnull NSData *)data
+                               forKey:(nonnull NSString *)key
+                        fileExtension:(nonnull NSString *)fileExtension
+                                error:(NSError *__nullable *__nullable)error;
+
+- (void)removeAllArtifacts;
+
+@end
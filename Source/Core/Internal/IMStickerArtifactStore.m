@@ -0,0 +1,239 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import "IMStickerArtifactStore.h"
+#import "IMImojiObject.h"
+#import "IMImojiObjectRenderingOptions.h"
+#import "NSString+Utils.h"
+
+// access times are written to the files at most this often, eviction order only needs to be approximate
+static const NSTimeInterval IMStickerArtifactAccessTimeResolution = 60.0;
+
+@interface IMStickerArtifact : NSObject
+
+@property(nonatomic, copy) NSString *fileName;
+@property(nonatomic) unsigned long long fileSize;
+@property(nonatomic) NSTimeInterval lastAccessTime;
+
+@end
+
+@implementation IMStickerArtifact
+@end
+
+@implementation IMStickerArtifactStore {
+    dispatch_queue_t _indexQueue;
+    NSMutableDictionary<NSString *, IMStickerArtifact *> *_artifacts;
+    unsigned long long _totalSize;
+}
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL
+                         maximumSize:(unsigned long long)maximumSize {
+    self = [super init];
+    if (self) {
+        _directoryURL = directoryURL;
+        _maximumSize = maximumSize;
+        _indexQueue = dispatch_queue_create("com.imoji.stickers.index", DISPATCH_QUEUE_SERIAL);
+    }
+
+    return self;
+}
+
++ (NSString *)artifactKeyForImoji:(IMImojiObject *)imoji
+                 renderingOptions:(IMImojiObjectRenderingOptions *)renderingOptions {
+    NSString *targetSize = renderingOptions.targetSize ? NSStringFromCGSize(renderingOptions.targetSize.CGSizeValue) : @"-";
+    NSString *aspectRatio = renderingOptions.aspectRatio ? NSStringFromCGSize(renderingOptions.aspectRatio.CGSizeValue) : @"-";
+    NSString *maximumFileSize = renderingOptions.maximumFileSize ? renderingOptions.maximumFileSize.stringValue : @"-";
+
+    NSString *key = [NSString stringWithFormat:@"%@|size=%@|border=%@|format=%@|animated=%@|target=%@|aspect=%@|maxFileSize=%@",
+                                               imoji.identifier,
+                                               @(renderingOptions.renderSize),
+                                               @(renderingOptions.borderStyle),
+                                               @(renderingOptions.imageFormat),
+                                               @(imoji.supportsAnimation && renderingOptions.renderAnimatedIfSupported),
+                                               targetSize,
+                                               aspectRatio,
+                                               maximumFileSize
+    ];
+
+    // adaptive renditions are kept apart from fixed ones, existing keys stay valid
+    if (renderingOptions.targetDownloadDuration) {
+        key = [key stringByAppendingFormat:@"|downloadDuration=%@", renderingOptions.targetDownloadDuration];
+    }
+
+    return key;
+}
+
+- (NSURL *)artifactURLForKey:(NSString *)key {
+    NSString *digest = key.im_sha256;
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    __block NSString *fileName;
+    __block BOOL persistAccessTime = NO;
+
+    dispatch_sync(_indexQueue, ^{
+        [self loadIndexIfNeeded];
+
+        IMStickerArtifact *artifact = self->_artifacts[digest];
+        persistAccessTime = artifact && now - artifact.lastAccessTime >= IMStickerArtifactAccessTimeResolution;
+        artifact.lastAccessTime = now;
+        fileName = artifact.fileName;
+    });
+
+    if (!fileName) {
+        return nil;
+    }
+
+    NSURL *fileURL = [self.directoryURL URLByAppendingPathComponent:fileName];
+    if (persistAccessTime) {
+        [fileURL setResourceValue:[NSDate dateWithTimeIntervalSinceReferenceDate:now] forKey:NSURLContentAccessDateKey error:nil];
+    }
+
+    return fileURL;
+}
+
+- (void)removeArtifactForKey:(NSString *)key {
+    NSString *digest = key.im_sha256;
+
+    dispatch_sync(_indexQueue, ^{
+        IMStickerArtifact *artifact = self->_artifacts[digest];
+        if (!artifact) {
+            return;
+        }
+
+        [[NSFileManager defaultManager] removeItemAtURL:[self.directoryURL URLByAppendingPathComponent:artifact.fileName]
+                                                  error:nil];
+
+        self->_totalSize -= artifact.fileSize;
+        [self->_artifacts removeObjectForKey:digest];
+    });
+}
+
+- (NSURL *)storeArtifactData:(NSData *)data
+                      forKey:(NSString *)key
+               fileExtension:(NSString *)fileExtension
+                       error:(NSError **)error {
+    NSString *digest = key.im_sha256;
+    NSString *fileName = [digest stringByAppendingPathExtension:fileExtension];
+    NSURL *fileURL = [self.directoryURL URLByAppendingPathComponent:fileName];
+
+    // the write goes to a temporary file that is renamed into place, readers never see a partial artifact
+    if (![data writeToURL:fileURL options:NSDataWritingAtomic error:error]) {
+        return nil;
+    }
+
+    dispatch_sync(_indexQueue, ^{
+        [self loadIndexIfNeeded];
+
+        IMStickerArtifact *artifact = self->_artifacts[digest];
+        if (artifact) {
+            self->_totalSize -= artifact.fileSize;
+
+            if (![artifact.fileName isEqualToString:fileName]) {
+                [[NSFileManager defaultManager] removeItemAtURL:[self.directoryURL URLByAppendingPathComponent:artifact.fileName]
+                                                          error:nil];
+            }
+        } else {
+            artifact = [IMStickerArtifact new];
+            self->_artifacts[digest] = artifact;
+        }
+
+        artifact.fileName = fileName;
+        artifact.fileSize = data.length;
+        artifact.lastAccessTime = [NSDate timeIntervalSinceReferenceDate];
+        self->_totalSize += data.length;
+
+        [self evictArtifactsExcluding:digest];
+    });
+
+    return fileURL;
+}
+
+- (void)removeAllArtifacts {
+    dispatch_sync(_indexQueue, ^{
+        [[NSFileManager defaultManager] removeItemAtURL:self.directoryURL error:nil];
+        [[NSFileManager defaultManager] createDirectoryAtURL:self.directoryURL
+                                 withIntermediateDirectories:YES
+                                                  attributes:nil
+                                                       error:nil];
+
+        self->_artifacts = [NSMutableDictionary dictionary];
+        self->_totalSize = 0;
+    });
+}
+
+#pragma mark Index Management
+
+- (void)loadIndexIfNeeded {
+    if (_artifacts) {
+        return;
+    }
+
+    _artifacts = [NSMutableDictionary dictionary];
+    _totalSize = 0;
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    [fileManager createDirectoryAtURL:self.directoryURL withIntermediateDirectories:YES attributes:nil error:nil];
+
+    // the directory is only listed once per store, afterwards the index is authoritative. files from previous
+    // launches are ordered by the time they were last used, or written when that is more recent
+    NSArray<NSURL *> *fileURLs = [fileManager contentsOfDirectoryAtURL:self.directoryURL
+                                            includingPropertiesForKeys:@[NSURLFileSizeKey, NSURLContentModificationDateKey, NSURLContentAccessDateKey]
+                                                               options:NSDirectoryEnumerationSkipsHiddenFiles
+                                                                 error:nil];
+
+    for (NSURL *fileURL in fileURLs) {
+        NSString *digest = fileURL.lastPathComponent.stringByDeletingPathExtension;
+        if (digest.length != 64) {
+            continue;
+        }
+
+        NSNumber *fileSize;
+        NSDate *modificationDate;
+        NSDate *accessDate;
+        [fileURL getResourceValue:&fileSize forKey:NSURLFileSizeKey error:nil];
+        [fileURL getResourceValue:&modificationDate forKey:NSURLContentModificationDateKey error:nil];
+        [fileURL getResourceValue:&accessDate forKey:NSURLContentAccessDateKey error:nil];
+
+        IMStickerArtifact *artifact = [IMStickerArtifact new];
+        artifact.fileName = fileURL.lastPathComponent;
+        artifact.fileSize = fileSize.unsignedLongLongValue;
+        artifact.lastAccessTime = MAX(modificationDate.timeIntervalSinceReferenceDate, accessDate.timeIntervalSinceReferenceDate);
+
+        _artifacts[digest] = artifact;
+        _totalSize += artifact.fileSize;
+    }
+
+    [self evictArtifactsExcluding:nil];
+}
+
+- (void)evictArtifactsExcluding:(NSString *)excludedDigest {
+    if (_totalSize <= self.maximumSize) {
+        return;
+    }
+
+    NSArray<NSString *> *digests = [_artifacts keysSortedByValueUsingComparator:^NSComparisonResult(IMStickerArtifact *artifact1, IMStickerArtifact *artifact2) {
+        return artifact1.lastAccessTime < artifact2.lastAccessTime ? NSOrderedAscending :
+                (artifact1.lastAccessTime > artifact2.lastAccessTime ? NSOrderedDescending : NSOrderedSame);
+    }];
+
+    for (NSString *digest in digests) {
+        if (_totalSize <= self.maximumSize) {
+            break;
+        }
+
+        if ([digest isEqualToString:excludedDigest]) {
+            continue;
+        }
+
+        IMStickerArtifact *artifact = _artifacts[digest];
+        [[NSFileManager defaultManager] removeItemAtURL:[self.directoryURL URLByAppendingPathComponent:artifact.fileName]
+                                                  error:nil];
+
+        _totalSize -= artifact.fileSize;
+        [_artifacts removeObjectForKey:digest];
+    }
+}
+
+@end
@@ -0,0 +1,71 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class BFExecutor;
+@class BFTask;
+
+/**
+* @abstract Identifies one traced public call, 0 when the call is not traced
+*/
+typedef uint32_t IMTraceSpan;
+
+/**
+* @abstract Records the stages of traced calls as they hop between queues. Each thread writes to its own fixed size
+* ring buffer without locking, the oldest records are overwritten once it is full. A thread has a current span which
+* stages and requests started on it are attributed to, traced executors carry it over to the thread their block runs
+* on. Names must be string literals, only the pointer is recorded.
+*/
+@interface IMTracer : NSObject
+
+/**
+* @abstract Identifier for a new trace, records are tagged with it so each session exports only its own spans
+*/
++ (uint32_t)newTraceIdentifier;
+
+/**
+* @abstract Starts a span for a public call. Returns 0 without recording anything when traceIdentifier is 0.
+*/
++ (IMTraceSpan)beginSpanWithName:(nonnull const char *)name traceIdentifier:(uint32_t)traceIdentifier;
+
++ (void)endSpan:(IMTraceSpan)span;
+
+/**
+* @abstract Ends span once task completes
+*/
++ (void)endSpan:(IMTraceSpan)span afterTask:(nonnull BFTask *)task;
+
++ (IMTraceSpan)currentSpan;
+
+/**
+* @abstract Sets the span of the calling thread
+* @return The previous span, which the caller restores when done
+*/
++ (IMTraceSpan)setCurrentSpan:(IMTraceSpan)span;
+
+/**
+* @abstract Wraps executor so that blocks run on it are recorded as stage of the current span, from the time they are
+* enqueued until they return, with the span set as current while they run. Returns executor itself when there is no
+* current span.
+*/
++ (nonnull BFExecutor *)executor:(nonnull BFExecutor *)executor stage:(nonnull const char *)stage;
+
+/**
+* @abstract Records a stage of span that started at startTime and ends now. Times are IMMetricsTimestamp values.
+*/
++ (void)recordStage:(nonnull const char *)stage
+               span:(IMTraceSpan)span
+        enqueueTime:(uint64_t)enqueueTime
+          startTime:(uint64_t)startTime;
+
+/**
+* @abstract Chrome trace event JSON (chrome://tracing, Perfetto) for the records of traceIdentifier still in the
+* buffers. Spans are async events, stages are complete events on the thread they ran on and queue waits are nested
+* async events.
+*/
++ (nonnull NSData *)chromeTraceDataWithTraceIdentifier:(uint32_t)traceIdentifier;
+
+@end
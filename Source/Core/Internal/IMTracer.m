@@ -0,0 +1,303 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Bolts/BFExecutor.h>
+#import <Bolts/BFTask.h>
+#import <pthread.h>
+#import <stdatomic.h>
+#import <unistd.h>
+#import "IMTracer.h"
+#import "IMMetricsRecorder.h"
+
+#define IMTraceBufferCapacity 1024
+
+typedef NS_ENUM(uint8_t, IMTraceRecordKind) {
+    IMTraceRecordKindSpanBegin,
+    IMTraceRecordKindSpanEnd,
+    IMTraceRecordKindStage
+};
+
+typedef struct {
+    const char *name;
+    uint64_t enqueueTime;
+    uint64_t startTime;
+    uint64_t endTime;
+    uint32_t traceIdentifier;
+    IMTraceSpan span;
+    uint32_t threadIdentifier;
+    IMTraceRecordKind kind;
+    bool mainThread;
+} IMTraceRecord;
+
+typedef struct IMTraceBuffer {
+    // total number of records written, only the owning thread stores to it
+    atomic_uint_fast64_t head;
+    atomic_bool inUse;
+    struct IMTraceBuffer *next;
+
+    IMTraceSpan currentSpan;
+    IMTraceRecord records[IMTraceBufferCapacity];
+} IMTraceBuffer;
+
+static pthread_key_t IMTraceBufferKey;
+static _Atomic(IMTraceBuffer *) IMTraceBuffers;
+static atomic_uint IMTraceNextSpan;
+static atomic_uint IMTraceNextIdentifier;
+
+// buffers outlive their threads so their records can still be exported, a new thread takes over a released buffer
+static void IMTraceReleaseBuffer(void *buffer) {
+    atomic_store(&((IMTraceBuffer *) buffer)->inUse, false);
+}
+
+static IMTraceBuffer *IMTraceCurrentBuffer(BOOL create) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_key_create(&IMTraceBufferKey, IMTraceReleaseBuffer);
+    });
+
+    IMTraceBuffer *buffer = pthread_getspecific(IMTraceBufferKey);
+    if (buffer || !create) {
+        return buffer;
+    }
+
+    for (IMTraceBuffer *candidate = atomic_load(&IMTraceBuffers); candidate; candidate = candidate->next) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&candidate->inUse, &expected, true)) {
+            buffer = candidate;
+            break;
+        }
+    }
+
+    if (!buffer) {
+        buffer = calloc(1, sizeof(IMTraceBuffer));
+        atomic_store(&buffer->inUse, true);
+
+        IMTraceBuffer *first = atomic_load(&IMTraceBuffers);
+        do {
+            buffer->next = first;
+        } while (!atomic_compare_exchange_weak(&IMTraceBuffers, &first, buffer));
+    }
+
+    buffer->currentSpan = 0;
+    pthread_setspecific(IMTraceBufferKey, buffer);
+
+    return buffer;
+}
+
+static void IMTraceAppend(IMTraceRecordKind kind, const char *name, uint32_t traceIdentifier, IMTraceSpan span,
+        uint64_t enqueueTime, uint64_t startTime, uint64_t endTime) {
+    IMTraceBuffer *buffer = IMTraceCurrentBuffer(YES);
+    uint_fast64_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+
+    buffer->records[head % IMTraceBufferCapacity] = (IMTraceRecord) {
+            .name = name,
+            .enqueueTime = enqueueTime,
+            .startTime = startTime,
+            .endTime = endTime,
+            .traceIdentifier = traceIdentifier,
+            .span = span,
+            .threadIdentifier = pthread_mach_thread_np(pthread_self()),
+            .kind = kind,
+            .mainThread = pthread_main_np() != 0
+    };
+
+    // publishes the record to exporting threads
+    atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+// spans carry the trace identifier in their top bits so stages don't have to look it up
+static inline uint32_t IMTraceIdentifierOfSpan(IMTraceSpan span) {
+    return span >> 24;
+}
+
+@implementation IMTracer
+
++ (uint32_t)newTraceIdentifier {
+    // 8 bits are available in a span, 0 is reserved for untraced calls
+    return (atomic_fetch_add(&IMTraceNextIdentifier, 1) % 0xff) + 1;
+}
+
++ (IMTraceSpan)beginSpanWithName:(const char *)name traceIdentifier:(uint32_t)traceIdentifier {
+    if (traceIdentifier == 0) {
+        return 0;
+    }
+
+    IMTraceSpan span = (traceIdentifier << 24) | ((atomic_fetch_add(&IMTraceNextSpan, 1) % 0xffffff) + 1);
+    IMTraceAppend(IMTraceRecordKindSpanBegin, name, traceIdentifier, span, 0, IMMetricsTimestamp(), 0);
+
+    return span;
+}
+
++ (void)endSpan:(IMTraceSpan)span {
+    if (span != 0) {
+        IMTraceAppend(IMTraceRecordKindSpanEnd, NULL, IMTraceIdentifierOfSpan(span), span, 0, IMMetricsTimestamp(), 0);
+    }
+}
+
++ (void)endSpan:(IMTraceSpan)span afterTask:(BFTask *)task {
+    if (span != 0) {
+        [task continueWithBlock:^id(BFTask *completedTask) {
+            [IMTracer endSpan:span];
+            return nil;
+        }];
+    }
+}
+
++ (IMTraceSpan)currentSpan {
+    IMTraceBuffer *buffer = IMTraceCurrentBuffer(NO);
+    return buffer ? buffer->currentSpan : 0;
+}
+
++ (IMTraceSpan)setCurrentSpan:(IMTraceSpan)span {
+    IMTraceBuffer *buffer = IMTraceCurrentBuffer(span != 0);
+    if (!buffer) {
+        return 0;
+    }
+
+    IMTraceSpan previous = buffer->currentSpan;
+    buffer->currentSpan = span;
+
+    return previous;
+}
+
++ (BFExecutor *)executor:(BFExecutor *)executor stage:(const char *)stage {
+    IMTraceSpan span = [IMTracer currentSpan];
+    if (span == 0) {
+        return executor;
+    }
+
+    return [BFExecutor executorWithBlock:^(void (^block)()) {
+        uint64_t enqueueTime = IMMetricsTimestamp();
+
+        [executor execute:^{
+            uint64_t startTime = IMMetricsTimestamp();
+            IMTraceSpan previous = [IMTracer setCurrentSpan:span];
+
+            block();
+
+            [IMTracer setCurrentSpan:previous];
+            [IMTracer recordStage:stage span:span enqueueTime:enqueueTime startTime:startTime];
+        }];
+    }];
+}
+
++ (void)recordStage:(const char *)stage
+               span:(IMTraceSpan)span
+        enqueueTime:(uint64_t)enqueueTime
+          startTime:(uint64_t)startTime {
+    if (span != 0) {
+        IMTraceAppend(IMTraceRecordKindStage, stage, IMTraceIdentifierOfSpan(span), span, enqueueTime, startTime, IMMetricsTimestamp());
+    }
+}
+
+#pragma mark Export
+
++ (NSData *)chromeTraceDataWithTraceIdentifier:(uint32_t)traceIdentifier {
+    NSMutableArray<NSValue *> *records = [NSMutableArray array];
+
+    for (IMTraceBuffer *buffer = atomic_load(&IMTraceBuffers); buffer; buffer = buffer->next) {
+        uint_fast64_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+        uint_fast64_t first = head > IMTraceBufferCapacity ? head - IMTraceBufferCapacity : 0;
+
+        IMTraceRecord *copy = malloc(sizeof(IMTraceRecord) * IMTraceBufferCapacity);
+        for (uint_fast64_t i = first; i < head; ++i) {
+            copy[i - first] = buffer->records[i % IMTraceBufferCapacity];
+        }
+
+        // the owning thread may have overwritten the oldest records while they were copied, and may be writing the
+        // slot of record newHead - IMTraceBufferCapacity before publishing it
+        uint_fast64_t newHead = atomic_load_explicit(&buffer->head, memory_order_acquire);
+        uint_fast64_t valid = newHead + 1 > IMTraceBufferCapacity ? MAX(first, newHead - IMTraceBufferCapacity + 1) : first;
+
+        for (uint_fast64_t i = valid; i < head; ++i) {
+            if (copy[i - first].traceIdentifier == traceIdentifier) {
+                [records addObject:[NSValue valueWithBytes:&copy[i - first] objCType:@encode(IMTraceRecord)]];
+            }
+        }
+
+        free(copy);
+    }
+
+    NSMutableDictionary<NSNumber *, NSString *> *spanNames = [NSMutableDictionary dictionary];
+    for (NSValue *value in records) {
+        IMTraceRecord record;
+        [value getValue:&record];
+
+        if (record.kind == IMTraceRecordKindSpanBegin) {
+            spanNames[@(record.span)] = record.name ? @(record.name) : @"?";
+        }
+    }
+
+    NSNumber *processIdentifier = @(getpid());
+    NSMutableArray *events = [NSMutableArray arrayWithCapacity:records.count];
+    NSMutableSet<NSNumber *> *mainThreads = [NSMutableSet set];
+
+    for (NSValue *value in records) {
+        IMTraceRecord record;
+        [value getValue:&record];
+
+        NSString *spanName = spanNames[@(record.span)];
+        NSString *spanIdentifier = [NSString stringWithFormat:@"0x%x", record.span];
+        if (!spanName) {
+            // the beginning of the span was overwritten
+            continue;
+        }
+
+        if (record.mainThread) {
+            [mainThreads addObject:@(record.threadIdentifier)];
+        }
+
+        switch (record.kind) {
+            case IMTraceRecordKindSpanBegin:
+            case IMTraceRecordKindSpanEnd:
+                [events addObject:@{
+                        @"name" : spanName,
+                        @"cat" : @"imoji",
+                        @"ph" : record.kind == IMTraceRecordKindSpanBegin ? @"b" : @"e",
+                        @"id" : spanIdentifier,
+                        @"ts" : @(record.startTime),
+                        @"pid" : processIdentifier,
+                        @"tid" : @(record.threadIdentifier)
+                }];
+                break;
+
+            case IMTraceRecordKindStage: {
+                NSString *stageName = record.name ? @(record.name) : @"?";
+
+                [events addObject:@{
+                        @"name" : stageName,
+                        @"cat" : @"imoji",
+                        @"ph" : @"X",
+                        @"ts" : @(record.startTime),
+                        @"dur" : @(record.endTime - record.startTime),
+                        @"pid" : processIdentifier,
+                        @"tid" : @(record.threadIdentifier),
+                        @"args" : @{@"span" : spanIdentifier, @"call" : spanName}
+                }];
+
+                if (record.enqueueTime > 0 && record.startTime > record.enqueueTime) {
+                    NSString *waitName = [NSString stringWithFormat:@"%@ (queued)", stageName];
+                    [events addObject:@{@"name" : waitName, @"cat" : @"imoji", @"ph" : @"b", @"id" : spanIdentifier, @"ts" : @(record.enqueueTime), @"pid" : processIdentifier, @"tid" : @(record.threadIdentifier)}];
+                    [events addObject:@{@"name" : waitName, @"cat" : @"imoji", @"ph" : @"e", @"id" : spanIdentifier, @"ts" : @(record.startTime), @"pid" : processIdentifier, @"tid" : @(record.threadIdentifier)}];
+                }
+                break;
+            }
+        }
+    }
+
+    for (NSNumber *threadIdentifier in mainThreads) {
+        [events addObject:@{
+                @"name" : @"thread_name",
+                @"ph" : @"M",
+                @"pid" : processIdentifier,
+                @"tid" : threadIdentifier,
+                @"args" : @{@"name" : @"main"}
+        }];
+    }
+
+    return [NSJSONSerialization dataWithJSONObject:@{@"traceEvents" : events, @"displayTimeUnit" : @"ms"} options:0 error:nil] ?: [NSData data];
+}
+
+@end
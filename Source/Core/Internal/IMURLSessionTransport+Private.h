@@ -0,0 +1,35 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "IMURLSessionTransport.h"
+
+/**
+* @abstract Delegate of the NSURLSessions used by IMURLSessionTransport. NSURLSession retains its delegate until
+* invalidated, a separate object keeps the transports themselves releasable.
+*/
+@interface IMURLSessionTransportDelegate : NSObject <NSURLSessionTaskDelegate>
+
+#if __IPHONE_OS_VERSION_MAX_ALLOWED >= 100000
+/**
+* @abstract Reports the metrics of task to metricsHandler once they are collected
+*/
+- (void)setMetricsHandler:(nonnull IMURLSessionTransportMetricsHandler)metricsHandler
+                  forTask:(nonnull NSURLSessionTask *)task NS_AVAILABLE_IOS(10_0);
+#endif
+
+@end
+
+@interface IMURLSessionTransport ()
+
+/**
+* @abstract Creates a transport over existing sessions, which are not invalidated when the transport is released.
+* @param delegate The delegate of both sessions
+*/
+- (nonnull instancetype)initWithURLSession:(nonnull NSURLSession *)urlSession
+                           imageURLSession:(nonnull NSURLSession *)imageURLSession
+                                  delegate:(nonnull IMURLSessionTransportDelegate *)delegate;
+
+@end
@@ -0,0 +1,56 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "IMImojiSession.h"
+#import "IMMemoryGovernor.h"
+
+@class IMImojiObject;
+
+/**
+* @abstract Local copy of the user's collections, one IMImojiCollectionArchive per IMImojiCollectionType. Collections
+* are read from disk on first access and kept in memory afterwards. Additions and removals are applied right away and
+* kept as pending changes until the outbox settles them, server lists received in the meantime are reconciled with them
+* so that a response issued before the change was sent does not revert it. IMMemoryGovernor trims the in-memory
+* collections as metadata, they are read from disk again on next access.
+*/
+@interface IMUserCollectionMirror : NSObject <IMMemoryConsumer>
+
+@property(nonatomic, readonly, nonnull) NSURL *directoryURL;
+
+- (nonnull instancetype)initWithDirectoryURL:(nonnull NSURL *)directoryURL;
+
+/**
+* @abstract Imojis of the collection in the order the server listed them, nil if the collection was never synchronized
+*/
+- (nullable NSArray<IMImojiObject *> *)imojisForCollectionType:(IMImojiCollectionType)collectionType;
+
+/**
+* @abstract Replaces the collection with the list fetched from the server after applying pending changes. The archive
+* is only rewritten when an imoji was added, removed, moved or has different URLs.
+* @return The reconciled collection, nil when it matches the mirrored one
+*/
+- (nullable NSArray<IMImojiObject *> *)reconcileCollectionType:(IMImojiCollectionType)collectionType
+                                                    withImojis:(nonnull NSArray<IMImojiObject *> *)imojis;
+
+/**
+* @abstract Adds imoji at the front of the Liked and All collections
+*/
+- (void)addImoji:(nonnull IMImojiObject *)imoji;
+
+/**
+* @abstract Removes the imoji from every collection
+*/
+- (void)removeImojiWithIdentifier:(nonnull NSString *)imojiIdentifier;
+
+/**
+* @abstract Drops the pending changes of an imoji once its mutation was sent or dropped, the server lists are
+* authoritative for it from then on
+*/
+- (void)settleChangesForImojiIdentifier:(nonnull NSString *)imojiIdentifier;
+
+- (void)removeAllCollections;
+
+@end
@@ -0,0 +1,279 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import "IMUserCollectionMirror.h"
+#import "IMImojiObject.h"
+#import "IMImojiCollectionArchive.h"
+
+// approximate size of an imoji held in memory with its rendition URLs
+static const NSUInteger IMUserCollectionMirrorImojiCost = 2 * 1024;
+
+// imojis added to the user's collection are listed under Liked as well as All
+static BOOL IMUserCollectionMirrorIncludesAdditions(IMImojiCollectionType collectionType) {
+    return collectionType == IMImojiCollectionTypeLiked || collectionType == IMImojiCollectionTypeAll;
+}
+
+@implementation IMUserCollectionMirror {
+    dispatch_queue_t _queue;
+    dispatch_queue_t _writeQueue;
+
+    // imojis of each collection type, NSNull for collections that were never synchronized
+    NSMutableDictionary<NSNumber *, id> *_collections;
+
+    // optimistic changes not yet confirmed by the server, most recent additions first
+    NSMutableArray<IMImojiObject *> *_pendingAdditions;
+    NSMutableSet<NSString *> *_pendingRemovals;
+}
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL {
+    self = [super init];
+    if (self) {
+        _directoryURL = directoryURL;
+        _queue = dispatch_queue_create("com.imoji.collections", DISPATCH_QUEUE_SERIAL);
+        _writeQueue = dispatch_queue_create("com.imoji.collections.write", DISPATCH_QUEUE_SERIAL);
+        dispatch_set_target_queue(_writeQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0));
+        _collections = [NSMutableDictionary dictionary];
+        _pendingAdditions = [NSMutableArray array];
+        _pendingRemovals = [NSMutableSet set];
+
+        [[IMMemoryGovernor sharedGovernor] registerConsumer:self];
+    }
+
+    return self;
+}
+
+- (NSURL *)fileURLForCollectionType:(IMImojiCollectionType)collectionType {
+    NSString *name;
+    switch (collectionType) {
+        case IMImojiCollectionTypeRecents:
+            name = @"recents";
+            break;
+        case IMImojiCollectionTypeCreated:
+            name = @"created";
+            break;
+        case IMImojiCollectionTypeLiked:
+            name = @"liked";
+            break;
+        case IMImojiCollectionTypeAll:
+            name = @"all";
+            break;
+    }
+
+    return [self.directoryURL URLByAppendingPathComponent:[name stringByAppendingPathExtension:@"imojis"]];
+}
+
+#pragma mark Reading
+
+- (NSArray<IMImojiObject *> *)imojisForCollectionType:(IMImojiCollectionType)collectionType {
+    __block id imojis;
+
+    __block BOOL loaded = NO;
+
+    dispatch_sync(_queue, ^{
+        loaded = self->_collections[@(collectionType)] == nil;
+        imojis = [self loadedImojisForCollectionType:collectionType];
+    });
+
+    if (loaded) {
+        [[IMMemoryGovernor sharedGovernor] enforceBudget];
+    }
+
+    return imojis != [NSNull null] ? imojis : nil;
+}
+
+// called on _queue, reads the archive the first time a collection is accessed
+- (id)loadedImojisForCollectionType:(IMImojiCollectionType)collectionType {
+    id imojis = _collections[@(collectionType)];
+    if (imojis) {
+        return imojis;
+    }
+
+    NSURL *fileURL = [self fileURLForCollectionType:collectionType];
+    IMImojiCollectionArchive *archive = [[NSFileManager defaultManager] fileExistsAtPath:fileURL.path] ?
+            [IMImojiCollectionArchive archiveWithFileURL:fileURL error:nil] : nil;
+
+    if (archive) {
+        NSUInteger count = archive.count;
+        NSMutableArray<IMImojiObject *> *archivedImojis = [NSMutableArray arrayWithCapacity:count];
+
+        for (NSUInteger i = 0; i < count; i++) {
+            IMImojiObject *imoji = [archive imojiAtIndex:i];
+            if (imoji) {
+                [archivedImojis addObject:imoji];
+            }
+        }
+
+        imojis = [archivedImojis copy];
+    } else {
+        imojis = [NSNull null];
+    }
+
+    _collections[@(collectionType)] = imojis;
+    return imojis;
+}
+
+#pragma mark Writing
+
+- (NSArray<IMImojiObject *> *)reconcileCollectionType:(IMImojiCollectionType)collectionType
+                                            withImojis:(NSArray<IMImojiObject *> *)imojis {
+    __block NSArray<IMImojiObject *> *reconciled = nil;
+
+    dispatch_sync(_queue, ^{
+        NSMutableArray<IMImojiObject *> *merged = [NSMutableArray arrayWithCapacity:imojis.count + self->_pendingAdditions.count];
+
+        if (IMUserCollectionMirrorIncludesAdditions(collectionType)) {
+            NSSet<NSString *> *identifiers = [NSSet setWithArray:[imojis valueForKey:@"identifier"]];
+            for (IMImojiObject *imoji in self->_pendingAdditions) {
+                if (![identifiers containsObject:imoji.identifier]) {
+                    [merged addObject:imoji];
+                }
+            }
+        }
+
+        for (IMImojiObject *imoji in imojis) {
+            if (![self->_pendingRemovals containsObject:imoji.identifier]) {
+                [merged addObject:imoji];
+            }
+        }
+
+        id mirrored = [self loadedImojisForCollectionType:collectionType];
+        if (mirrored != [NSNull null] && [self imojis:mirrored matchImojis:merged]) {
+            return;
+        }
+
+        reconciled = [merged copy];
+        [self storeImojis:reconciled forCollectionType:collectionType];
+    });
+
+    return reconciled;
+}
+
+- (void)addImoji:(IMImojiObject *)imoji {
+    dispatch_sync(_queue, ^{
+        // imojis are equal when their identifiers are
+        [self->_pendingRemovals removeObject:imoji.identifier];
+        [self->_pendingAdditions removeObject:imoji];
+        [self->_pendingAdditions insertObject:imoji atIndex:0];
+
+        for (IMImojiCollectionType collectionType = IMImojiCollectionTypeRecents; collectionType <= IMImojiCollectionTypeAll; collectionType++) {
+            if (!IMUserCollectionMirrorIncludesAdditions(collectionType)) {
+                continue;
+            }
+
+            // collections never synchronized get the addition from their first reconciliation
+            id mirrored = [self loadedImojisForCollectionType:collectionType];
+            if (mirrored == [NSNull null] || [mirrored containsObject:imoji]) {
+                continue;
+            }
+
+            [self storeImojis:[@[imoji] arrayByAddingObjectsFromArray:mirrored] forCollectionType:collectionType];
+        }
+    });
+}
+
+- (void)removeImojiWithIdentifier:(NSString *)imojiIdentifier {
+    dispatch_sync(_queue, ^{
+        [self->_pendingAdditions filterUsingPredicate:[NSPredicate predicateWithFormat:@"identifier != %@", imojiIdentifier]];
+        [self->_pendingRemovals addObject:imojiIdentifier];
+
+        for (IMImojiCollectionType collectionType = IMImojiCollectionTypeRecents; collectionType <= IMImojiCollectionTypeAll; collectionType++) {
+            id mirrored = [self loadedImojisForCollectionType:collectionType];
+            if (mirrored == [NSNull null]) {
+                continue;
+            }
+
+            NSIndexSet *indexes = [mirrored indexesOfObjectsPassingTest:^BOOL(IMImojiObject *imoji, NSUInteger idx, BOOL *stop) {
+                return [imoji.identifier isEqualToString:imojiIdentifier];
+            }];
+
+            if (indexes.count > 0) {
+                NSMutableArray<IMImojiObject *> *updated = [mirrored mutableCopy];
+                [updated removeObjectsAtIndexes:indexes];
+                [self storeImojis:[updated copy] forCollectionType:collectionType];
+            }
+        }
+    });
+}
+
+- (void)settleChangesForImojiIdentifier:(NSString *)imojiIdentifier {
+    dispatch_sync(_queue, ^{
+        [self->_pendingAdditions filterUsingPredicate:[NSPredicate predicateWithFormat:@"identifier != %@", imojiIdentifier]];
+        [self->_pendingRemovals removeObject:imojiIdentifier];
+    });
+}
+
+- (void)removeAllCollections {
+    dispatch_sync(_queue, ^{
+        [self->_collections removeAllObjects];
+        [self->_pendingAdditions removeAllObjects];
+        [self->_pendingRemovals removeAllObjects];
+    });
+
+    dispatch_sync(_writeQueue, ^{
+        [[NSFileManager defaultManager] removeItemAtURL:self.directoryURL error:nil];
+    });
+}
+
+// called on _queue, the archive is rewritten in the background
+- (void)storeImojis:(NSArray<IMImojiObject *> *)imojis forCollectionType:(IMImojiCollectionType)collectionType {
+    _collections[@(collectionType)] = imojis;
+
+    NSURL *fileURL = [self fileURLForCollectionType:collectionType];
+    dispatch_async(_writeQueue, ^{
+        IMImojiCollectionArchive *archive = [IMImojiCollectionArchive archiveWithFileURL:fileURL error:nil];
+        if (!archive) {
+            // written by an unsupported version, the mirror is rebuilt from the server anyway
+            [[NSFileManager defaultManager] removeItemAtURL:fileURL error:nil];
+            archive = [IMImojiCollectionArchive archiveWithFileURL:fileURL error:nil];
+        }
+
+        [archive replaceImojis:imojis error:nil];
+    });
+}
+
+#pragma mark IMMemoryConsumer
+
+- (NSUInteger)memoryCostAtLevel:(IMMemoryTrimLevel)level {
+    __block NSUInteger count = 0;
+
+    if (level == IMMemoryTrimLevelMetadata) {
+        dispatch_sync(_queue, ^{
+            for (id imojis in self->_collections.allValues) {
+                count += imojis != [NSNull null] ? ((NSArray *) imojis).count : 0;
+            }
+        });
+    }
+
+    return count * IMUserCollectionMirrorImojiCost;
+}
+
+- (void)trimLevel:(IMMemoryTrimLevel)level toCost:(NSUInteger)cost {
+    if (level != IMMemoryTrimLevelMetadata) {
+        return;
+    }
+
+    dispatch_sync(_queue, ^{
+        // collections are read back from their archives, which must be written out first
+        dispatch_sync(self->_writeQueue, ^{});
+
+        [self->_collections removeAllObjects];
+    });
+}
+
+- (BOOL)imojis:(NSArray<IMImojiObject *> *)imojis matchImojis:(NSArray<IMImojiObject *> *)otherImojis {
+    if (imojis.count != otherImojis.count) {
+        return NO;
+    }
+
+    for (NSUInteger i = 0; i < imojis.count; i++) {
+        if (![imojis[i].identifier isEqualToString:otherImojis[i].identifier] || ![imojis[i].urls isEqualToDictionary:otherImojis[i].urls]) {
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+@end
@@ -0,0 +1,46 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class BFTask;
+
+/**
+* @abstract Process wide stage for cache file writes. Writes are queued and applied by a single low priority writer
+* in batches, so they do not compete with decoding for the disk and CPU. A write to a file that is still queued
+* replaces the queued contents instead of writing twice. Files are written to a temporary file and renamed into place,
+* only durable writes are synced to storage. Directories are created and excluded from backups once, when the first
+* file is written to them. Safe to use from multiple threads.
+*/
+@interface IMWriteBehindQueue : NSObject
+
++ (nonnull instancetype)sharedQueue;
+
+/**
+* @abstract Queues writing data to fileURL. Durable writes are synced along with their directory before the task
+* completes, use them for files that cannot be recreated.
+* @return A task completing once the file is in place, or with an NSPOSIXErrorDomain error
+*/
+- (nonnull BFTask *)writeData:(nonnull NSData *)data
+                        toURL:(nonnull NSURL *)fileURL
+                      durable:(BOOL)durable;
+
+/**
+* @abstract Queues removing fileURL, dropping the queued writes to it or to files inside it
+*/
+- (void)removeItemAtURL:(nonnull NSURL *)fileURL;
+
+/**
+* @abstract Contents of fileURL, including queued writes that are not on disk yet. nil if the file does not exist or
+* is queued for removal.
+*/
+- (nullable NSData *)contentsOfURL:(nonnull NSURL *)fileURL;
+
+/**
+* @abstract Blocks until every queued write and removal was applied
+*/
+- (void)flush;
+
+@end
@@ -0,0 +1,288 @@
+//
+// Created by Nima on 10/18/16.
+// Copyright (c) 2016 Imoji. All rights reserved.
+//
+
+#import <fcntl.h>
+#import <unistd.h>
+#import <Bolts/Bolts.h>
+#import "IMWriteBehindQueue.h"
+
+@interface IMWriteBehindOperation : NSObject
+
+@property(nonatomic, strong) NSURL *fileURL;
+
+// standardized path of fileURL
+@property(nonatomic, copy) NSString *path;
+
+// nil for removals
+@property(nonatomic, strong) NSData *data;
+@property(nonatomic) BOOL durable;
+@property(nonatomic, strong) NSMutableArray<BFTaskCompletionSource *> *completionSources;
+
+@end
+
+@implementation IMWriteBehindOperation
+@end
+
+@implementation IMWriteBehindQueue {
+    dispatch_queue_t _writeQueue;
+
+    // operations not yet picked up by the writer keyed by path, _pendingPaths keeps their order
+    NSMutableDictionary<NSString *, IMWriteBehindOperation *> *_pendingOperations;
+    NSMutableArray<NSString *> *_pendingPaths;
+    BOOL _drainScheduled;
+
+    // operations of the batch being applied, still answered by contentsOfURL: until their files are in place
+    NSDictionary<NSString *, IMWriteBehindOperation *> *_applyingOperations;
+
+    // accessed on _writeQueue
+    NSMutableSet<NSString *> *_preparedDirectories;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _writeQueue = dispatch_queue_create("com.imoji.writebehind", DISPATCH_QUEUE_SERIAL);
+        dispatch_set_target_queue(_writeQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0));
+        _pendingOperations = [NSMutableDictionary dictionary];
+        _pendingPaths = [NSMutableArray array];
+        _preparedDirectories = [NSMutableSet set];
+    }
+
+    return self;
+}
+
++ (instancetype)sharedQueue {
+    static IMWriteBehindQueue *sharedQueue = nil;
+    static dispatch_once_t predicate;
+
+    dispatch_once(&predicate, ^{
+        sharedQueue = [IMWriteBehindQueue new];
+    });
+
+    return sharedQueue;
+}
+
+#pragma mark Queueing
+
+- (BFTask *)writeData:(NSData *)data toURL:(NSURL *)fileURL durable:(BOOL)durable {
+    BFTaskCompletionSource *completionSource = [BFTaskCompletionSource taskCompletionSource];
+    NSString *path = fileURL.path.stringByStandardizingPath;
+
+    @synchronized (self) {
+        IMWriteBehindOperation *operation = _pendingOperations[path];
+        if (!operation) {
+            operation = [IMWriteBehindOperation new];
+            operation.fileURL = fileURL;
+            operation.path = path;
+            operation.completionSources = [NSMutableArray array];
+
+            _pendingOperations[path] = operation;
+            [_pendingPaths addObject:path];
+        }
+
+        // callers of a replaced write complete along with the write replacing it
+        operation.data = [data copy];
+        operation.durable = operation.durable || durable;
+        [operation.completionSources addObject:completionSource];
+
+        [self scheduleDrain];
+    }
+
+    return completionSource.task;
+}
+
+- (void)removeItemAtURL:(NSURL *)fileURL {
+    NSString *path = fileURL.path.stringByStandardizingPath;
+    NSString *directoryPrefix = [path stringByAppendingString:@"/"];
+    NSMutableArray<BFTaskCompletionSource *> *droppedSources = [NSMutableArray array];
+
+    @synchronized (self) {
+        for (NSString *pendingPath in [_pendingPaths copy]) {
+            if ([pendingPath isEqualToString:path] || [pendingPath hasPrefix:directoryPrefix]) {
+                [droppedSources addObjectsFromArray:_pendingOperations[pendingPath].completionSources];
+                [_pendingOperations removeObjectForKey:pendingPath];
+                [_pendingPaths removeObject:pendingPath];
+            }
+        }
+
+        IMWriteBehindOperation *operation = [IMWriteBehindOperation new];
+        operation.fileURL = fileURL;
+        operation.path = path;
+        operation.completionSources = [NSMutableArray array];
+
+        _pendingOperations[path] = operation;
+        [_pendingPaths addObject:path];
+
+        [self scheduleDrain];
+    }
+
+    for (BFTaskCompletionSource *completionSource in droppedSources) {
+        [completionSource cancel];
+    }
+}
+
+- (NSData *)contentsOfURL:(NSURL *)fileURL {
+    @synchronized (self) {
+        NSString *path = fileURL.path.stringByStandardizingPath;
+        IMWriteBehindOperation *operation = _pendingOperations[path] ?: _applyingOperations[path];
+        if (operation) {
+            return operation.data;
+        }
+
+        // files inside a directory queued for removal are gone as well
+        for (NSString *directory = path.stringByDeletingLastPathComponent; directory.length > 1; directory = directory.stringByDeletingLastPathComponent) {
+            operation = _pendingOperations[directory] ?: _applyingOperations[directory];
+            if (operation && !operation.data) {
+                return nil;
+            }
+        }
+    }
+
+    return [NSData dataWithContentsOfURL:fileURL];
+}
+
+- (void)flush {
+    dispatch_sync(_writeQueue, ^{});
+}
+
+// called while synchronized
+- (void)scheduleDrain {
+    if (_drainScheduled) {
+        return;
+    }
+
+    _drainScheduled = YES;
+    dispatch_async(_writeQueue, ^{
+        [self drain];
+    });
+}
+
+#pragma mark Writing
+
+// called on _writeQueue, applies everything queued so far as one batch
+- (void)drain {
+    NSArray<IMWriteBehindOperation *> *operations;
+
+    @synchronized (self) {
+        operations = [_pendingOperations objectsForKeys:_pendingPaths notFoundMarker:[NSNull null]];
+        _applyingOperations = [_pendingOperations copy];
+        [_pendingOperations removeAllObjects];
+        [_pendingPaths removeAllObjects];
+        _drainScheduled = NO;
+    }
+
+    NSMutableSet<NSString *> *durableDirectories = [NSMutableSet set];
+    NSMutableArray<NSError *> *errors = [NSMutableArray arrayWithCapacity:operations.count];
+
+    for (IMWriteBehindOperation *operation in operations) {
+        NSError *error = nil;
+
+        if (operation.data) {
+            NSString *directory = operation.path.stringByDeletingLastPathComponent;
+            [self prepareDirectory:directory];
+
+            if ([self writeData:operation.data toPath:operation.path durable:operation.durable error:&error] && operation.durable) {
+                [durableDirectories addObject:directory];
+            }
+        } else {
+            [[NSFileManager defaultManager] removeItemAtPath:operation.path error:nil];
+
+            // removed directories are created again by the next write to them
+            NSString *directoryPrefix = [operation.path stringByAppendingString:@"/"];
+            for (NSString *directory in [_preparedDirectories copy]) {
+                if ([directory isEqualToString:operation.path] || [directory hasPrefix:directoryPrefix]) {
+                    [_preparedDirectories removeObject:directory];
+                }
+            }
+        }
+
+        [errors addObject:error ?: (id) [NSNull null]];
+    }
+
+    @synchronized (self) {
+        _applyingOperations = nil;
+    }
+
+    // the renames of durable files survive a crash once their directories are synced, one sync per directory
+    for (NSString *directory in durableDirectories) {
+        int descriptor = open(directory.fileSystemRepresentation, O_RDONLY);
+        if (descriptor >= 0) {
+            fsync(descriptor);
+            close(descriptor);
+        }
+    }
+
+    for (NSUInteger i = 0; i < operations.count; i++) {
+        for (BFTaskCompletionSource *completionSource in operations[i].completionSources) {
+            if (errors[i] != (id) [NSNull null]) {
+                completionSource.error = errors[i];
+            } else {
+                completionSource.result = operations[i].fileURL;
+            }
+        }
+    }
+}
+
+- (void)prepareDirectory:(NSString *)directory {
+    if ([_preparedDirectories containsObject:directory]) {
+        return;
+    }
+
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory
+                              withIntermediateDirectories:YES
+                                               attributes:nil
+                                                    error:nil];
+
+    // excluding the directory covers every file written to it
+    [[NSURL fileURLWithPath:directory isDirectory:YES] setResourceValue:@YES
+                                                                 forKey:NSURLIsExcludedFromBackupKey
+                                                                  error:nil];
+
+    [_preparedDirectories addObject:directory];
+}
+
+- (BOOL)writeData:(NSData *)data toPath:(NSString *)path durable:(BOOL)durable error:(NSError **)error {
+    NSString *temporaryPath = [path stringByAppendingFormat:@".%@.tmp", [NSUUID UUID].UUIDString];
+    int descriptor = open(temporaryPath.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    BOOL success = descriptor >= 0;
+
+    const uint8_t *bytes = data.bytes;
+    NSUInteger offset = 0;
+    while (success && offset < data.length) {
+        ssize_t written = write(descriptor, bytes + offset, data.length - offset);
+        if (written < 0 && errno != EINTR) {
+            success = NO;
+        } else if (written > 0) {
+            offset += (NSUInteger) written;
+        }
+    }
+
+    if (success && durable) {
+        success = fsync(descriptor) == 0;
+    }
+
+    // readers only see complete files, the temporary file is renamed into place
+    if (success) {
+        success = close(descriptor) == 0;
+        descriptor = -1;
+        success = success && rename(temporaryPath.fileSystemRepresentation, path.fileSystemRepresentation) == 0;
+    }
+
+    if (!success) {
+        if (error) {
+            *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{NSFilePathErrorKey : path}];
+        }
+
+        if (descriptor >= 0) {
+            close(descriptor);
+        }
+
+        unlink(temporaryPath.fileSystemRepresentation);
+    }
+
+    return success;
+}
+
+@end
@@ -29,6 +29,7 @@
 @interface ImojiSDKConstants : NSObject
 
 extern NSString *const ImojiSDKServerURL;
+extern NSString *const ImojiSDKRenderServerURL;
 extern NSString *const ImojiSDKAuthClientPayloadURLKey;
 extern NSString *const ImojiSDKAuthReferringAppSchemeURLKey;
 
@@ -40,5 +40,6 @@ NSString *const ImojiSDKMainAppStoreName = @"imojiapp";
 NSString *const ImojiSDKVersion = @"2.2.0";
 
 NSString *const ImojiSDKServerURL = @"https://api.imoji.io/v2";
+NSString *const ImojiSDKRenderServerURL = @"https://render.imoji.io";
 
 @end
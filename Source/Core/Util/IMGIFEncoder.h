@@ -0,0 +1,88 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+/**
+* @abstract Streaming GIF89a encoder used for exporting animated stickers.
+* Frames are supplied as fully composited premultiplied RGBA buffers. Each frame receives its own palette built with
+* median cut quantization (or an exact palette when the frame has 256 colors or less), transparent pixels are mapped
+* to a reserved palette index and only the region that changed from the previously displayed frame is encoded.
+*/
+@interface IMGIFEncoder : NSObject
+
+/**
+* @abstract Width of the logical GIF screen in pixels
+*/
+@property(nonatomic, readonly) NSUInteger width;
+
+/**
+* @abstract Height of the logical GIF screen in pixels
+*/
+@property(nonatomic, readonly) NSUInteger height;
+
+/**
+* @abstract Number of frames appended to the encoder
+*/
+@property(nonatomic, readonly) NSUInteger frameCount;
+
+/**
+* @abstract Creates an encoder for a GIF of the given dimensions.
+* @param width Width of every frame in pixels
+* @param height Height of every frame in pixels
+* @param loopCount Number of times the animation loops, 0 loops forever
+*/
+- (nonnull instancetype)initWithWidth:(NSUInteger)width
+                               height:(NSUInteger)height
+                            loopCount:(NSUInteger)loopCount;
+
+/**
+* @abstract Appends a frame from a premultiplied RGBA buffer that is width x height pixels in size.
+* @param pixels Premultiplied RGBA pixel data (kCGImageAlphaPremultipliedLast, 8 bits per component)
+* @param bytesPerRow Stride of the pixel buffer
+* @param delay Display duration of the frame in seconds
+* @return NO if the encoder has already been finished
+*/
+- (BOOL)appendFrameWithPremultipliedRGBA:(nonnull const uint8_t *)pixels
+                             bytesPerRow:(size_t)bytesPerRow
+                                   delay:(NSTimeInterval)delay;
+
+/**
+* @abstract Appends a frame from a CGImage. The image is drawn into a width x height RGBA canvas before encoding.
+* @param image The image to append
+* @param delay Display duration of the frame in seconds
+* @return NO if the frame could not be rasterized or the encoder has already been finished
+*/
+- (BOOL)appendFrameWithCGImage:(nonnull CGImageRef)image
+                         delay:(NSTimeInterval)delay;
+
+/**
+* @abstract Flushes any pending frames and returns the complete GIF data. Subsequent appends will fail.
+* @return The GIF data or nil if no frames were appended
+*/
+- (nullable NSData *)finish;
+
+@end
@@ -0,0 +1,110 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#import "IMGIFEncoder.h"
+#import "IMGIFEncoderCore.h"
+
+@implementation IMGIFEncoder {
+    IMGIFEncoderState *_state;
+    NSData *_data;
+}
+
+- (instancetype)initWithWidth:(NSUInteger)width
+                       height:(NSUInteger)height
+                    loopCount:(NSUInteger)loopCount {
+    self = [super init];
+    if (self) {
+        _width = width;
+        _height = height;
+        _state = IMGIFEncoderStateCreate(width, height, (uint16_t) MIN(loopCount, UINT16_MAX));
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    IMGIFEncoderStateDestroy(_state);
+}
+
+- (NSUInteger)frameCount {
+    return _state ? IMGIFEncoderStateFrameCount(_state) : 0;
+}
+
+- (BOOL)appendFrameWithPremultipliedRGBA:(const uint8_t *)pixels
+                             bytesPerRow:(size_t)bytesPerRow
+                                   delay:(NSTimeInterval)delay {
+    if (!_state || !pixels) {
+        return NO;
+    }
+
+    // most decoders treat delays under 20ms as 100ms, use that explicitly so the exported speed is consistent
+    long centiseconds = lround(delay * 100.0);
+    if (centiseconds < 2) {
+        centiseconds = 10;
+    }
+
+    return IMGIFEncoderStateAppend(_state, pixels, bytesPerRow, (uint16_t) MIN(centiseconds, UINT16_MAX));
+}
+
+- (BOOL)appendFrameWithCGImage:(CGImageRef)image
+                         delay:(NSTimeInterval)delay {
+    if (!_state) {
+        return NO;
+    }
+
+    size_t bytesPerRow = _width * 4;
+    NSMutableData *pixels = [NSMutableData dataWithLength:bytesPerRow * _height];
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(pixels.mutableBytes, _width, _height, 8, bytesPerRow, colorSpace,
+            kCGImageAlphaPremultipliedLast | kCGBitmapByteOrderDefault);
+    CGColorSpaceRelease(colorSpace);
+
+    if (!context) {
+        return NO;
+    }
+
+    CGContextDrawImage(context, CGRectMake(0, 0, _width, _height), image);
+    CGContextRelease(context);
+
+    return [self appendFrameWithPremultipliedRGBA:pixels.bytes bytesPerRow:bytesPerRow delay:delay];
+}
+
+- (NSData *)finish {
+    if (_data) {
+        return _data;
+    }
+
+    if (!_state || !IMGIFEncoderStateFinish(_state)) {
+        return nil;
+    }
+
+    size_t length;
+    uint8_t *bytes = IMGIFEncoderStateTakeOutput(_state, &length);
+    _data = [NSData dataWithBytesNoCopy:bytes length:length freeWhenDone:YES];
+
+    return _data;
+}
+
+@end
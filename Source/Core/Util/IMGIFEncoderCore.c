@@ -0,0 +1,824 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#include "IMGIFEncoderCore.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// The encoder core is plain C operating on RGBA buffers so it has no dependency on UIKit or ImageIO.
+// Pixels are normalized to straight (non premultiplied) RGBA words with binary alpha. Fully transparent pixels are
+// always stored as 0 which lets frame differencing compare whole words.
+
+#define IMGIFTransparentPixel 0u
+#define IMGIFAlphaThreshold 128
+#define IMGIFHistogramBins 32768
+#define IMGIFMaxColors 256
+#define IMGIFLZWTableLimit 4095
+#define IMGIFLZWHashSize 8192
+#define IMGIFExactPaletteHashSize 1024
+#define IMGIFDisposalNone 1
+#define IMGIFDisposalRestoreBackground 2
+
+#define IMGIFPixelR(p) ((p) & 0xFFu)
+#define IMGIFPixelG(p) (((p) >> 8) & 0xFFu)
+#define IMGIFPixelB(p) (((p) >> 16) & 0xFFu)
+#define IMGIFPixelBin(p) ((uint16_t) (((IMGIFPixelR(p) >> 3) << 10) | ((IMGIFPixelG(p) >> 3) << 5) | (IMGIFPixelB(p) >> 3)))
+
+typedef struct {
+    size_t x, y, width, height;
+} IMGIFRect;
+
+typedef struct {
+    uint8_t *bytes;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} IMGIFBuffer;
+
+typedef struct {
+    IMGIFBuffer *output;
+    uint8_t block[255];
+    size_t blockLength;
+    uint32_t bits;
+    int bitCount;
+} IMGIFBitWriter;
+
+typedef struct {
+    uint32_t start, end;
+    uint64_t pixelCount;
+    uint8_t min[3], max[3];
+} IMGIFBox;
+
+struct IMGIFEncoderState {
+    size_t width, height;
+    uint16_t loopCount;
+    size_t frameCount;
+    bool finished;
+
+    IMGIFBuffer output;
+
+    // pixels currently displayed by a decoder before the pending frame is drawn
+    uint32_t *canvas;
+    // the last appended frame, held back until the next frame determines its disposal method
+    uint32_t *pending;
+    uint32_t *incoming;
+    uint16_t pendingDelay;
+    bool hasPending;
+
+    uint8_t *indices;
+    uint32_t *colors;
+    uint32_t *histogram;
+    uint32_t *sums;
+    uint16_t *entries;
+    uint16_t *scratchEntries;
+    uint8_t *binToIndex;
+    IMGIFBox *boxes;
+    uint32_t *exactKeys;
+    uint8_t *exactIndices;
+    int32_t *lzwKeys;
+    uint16_t *lzwCodes;
+};
+
+#pragma mark Output
+
+static void IMGIFBufferReserve(IMGIFBuffer *buffer, size_t additional) {
+    if (buffer->failed || buffer->length + additional <= buffer->capacity) {
+        return;
+    }
+
+    size_t capacity = buffer->capacity > 0 ? buffer->capacity : 16384;
+    while (capacity < buffer->length + additional) {
+        capacity *= 2;
+    }
+
+    uint8_t *bytes = realloc(buffer->bytes, capacity);
+    if (!bytes) {
+        buffer->failed = true;
+        return;
+    }
+
+    buffer->bytes = bytes;
+    buffer->capacity = capacity;
+}
+
+static void IMGIFBufferAppend(IMGIFBuffer *buffer, const void *bytes, size_t length) {
+    IMGIFBufferReserve(buffer, length);
+    if (!buffer->failed) {
+        memcpy(buffer->bytes + buffer->length, bytes, length);
+        buffer->length += length;
+    }
+}
+
+static void IMGIFBufferAppendByte(IMGIFBuffer *buffer, uint8_t byte) {
+    IMGIFBufferAppend(buffer, &byte, 1);
+}
+
+static void IMGIFBufferAppendShort(IMGIFBuffer *buffer, uint16_t value) {
+    uint8_t bytes[2] = {(uint8_t) (value & 0xFF), (uint8_t) (value >> 8)};
+    IMGIFBufferAppend(buffer, bytes, 2);
+}
+
+static void IMGIFBitWriterFlushBlock(IMGIFBitWriter *writer) {
+    if (writer->blockLength > 0) {
+        IMGIFBufferAppendByte(writer->output, (uint8_t) writer->blockLength);
+        IMGIFBufferAppend(writer->output, writer->block, writer->blockLength);
+        writer->blockLength = 0;
+    }
+}
+
+static void IMGIFBitWriterWrite(IMGIFBitWriter *writer, uint32_t code, int codeSize) {
+    writer->bits |= code << writer->bitCount;
+    writer->bitCount += codeSize;
+
+    while (writer->bitCount >= 8) {
+        writer->block[writer->blockLength++] = (uint8_t) (writer->bits & 0xFF);
+        writer->bits >>= 8;
+        writer->bitCount -= 8;
+
+        if (writer->blockLength == 255) {
+            IMGIFBitWriterFlushBlock(writer);
+        }
+    }
+}
+
+static void IMGIFBitWriterFinish(IMGIFBitWriter *writer) {
+    if (writer->bitCount > 0) {
+        writer->block[writer->blockLength++] = (uint8_t) (writer->bits & 0xFF);
+        writer->bits = 0;
+        writer->bitCount = 0;
+    }
+
+    IMGIFBitWriterFlushBlock(writer);
+    IMGIFBufferAppendByte(writer->output, 0);
+}
+
+#pragma mark LZW
+
+static void IMGIFEncodeLZW(IMGIFEncoderState *state, const uint8_t *indices, size_t count, int minCodeSize) {
+    const uint32_t clearCode = 1u << minCodeSize;
+    const uint32_t endOfInformation = clearCode + 1;
+    int32_t *keys = state->lzwKeys;
+    uint16_t *codes = state->lzwCodes;
+
+    IMGIFBitWriter writer = {.output = &state->output};
+    int codeSize = minCodeSize + 1;
+    uint32_t nextCode = endOfInformation + 1;
+
+    IMGIFBufferAppendByte(&state->output, (uint8_t) minCodeSize);
+    memset(keys, 0xFF, sizeof(int32_t) * IMGIFLZWHashSize);
+    IMGIFBitWriterWrite(&writer, clearCode, codeSize);
+
+    uint32_t prefix = indices[0];
+    for (size_t i = 1; i < count; i++) {
+        uint8_t pixel = indices[i];
+        int32_t key = (int32_t) ((prefix << 8) | pixel);
+        uint32_t slot = ((uint32_t) key * 2654435761u) >> (32 - 13);
+
+        while (keys[slot] != -1 && keys[slot] != key) {
+            slot = (slot + 1) & (IMGIFLZWHashSize - 1);
+        }
+
+        if (keys[slot] == key) {
+            prefix = codes[slot];
+            continue;
+        }
+
+        IMGIFBitWriterWrite(&writer, prefix, codeSize);
+        if (nextCode >= (1u << codeSize) && codeSize < 12) {
+            codeSize++;
+        }
+
+        if (nextCode >= IMGIFLZWTableLimit) {
+            IMGIFBitWriterWrite(&writer, clearCode, codeSize);
+            memset(keys, 0xFF, sizeof(int32_t) * IMGIFLZWHashSize);
+            codeSize = minCodeSize + 1;
+            nextCode = endOfInformation + 1;
+        } else {
+            keys[slot] = key;
+            codes[slot] = (uint16_t) nextCode++;
+        }
+
+        prefix = pixel;
+    }
+
+    IMGIFBitWriterWrite(&writer, prefix, codeSize);
+    if (nextCode >= (1u << codeSize) && codeSize < 12) {
+        codeSize++;
+    }
+
+    IMGIFBitWriterWrite(&writer, endOfInformation, codeSize);
+    IMGIFBitWriterFinish(&writer);
+}
+
+#pragma mark Frame Analysis
+
+// 16.16 fixed point 255 / alpha used for unpremultiplying, entry a is (255 * 65536 + a / 2) / a
+static const uint32_t IMGIFAlphaReciprocals[256] = {
+        0, 16711680, 8355840, 5570560, 4177920, 3342336, 2785280, 2387383,
+        2088960, 1856853, 1671168, 1519244, 1392640, 1285514, 1193691, 1114112,
+        1044480, 983040, 928427, 879562, 835584, 795794, 759622, 726595,
+        696320, 668467, 642757, 618951, 596846, 576265, 557056, 539086,
+        522240, 506415, 491520, 477477, 464213, 451667, 439781, 428505,
+        417792, 407602, 397897, 388644, 379811, 371371, 363297, 355568,
+        348160, 341055, 334234, 327680, 321378, 315315, 309476, 303849,
+        298423, 293187, 288132, 283249, 278528, 273962, 269543, 265265,
+        261120, 257103, 253207, 249428, 245760, 242198, 238738, 235376,
+        232107, 228927, 225834, 222822, 219891, 217035, 214252, 211540,
+        208896, 206317, 203801, 201346, 198949, 196608, 194322, 192088,
+        189905, 187772, 185685, 183645, 181649, 179695, 177784, 175912,
+        174080, 172285, 170527, 168805, 167117, 165462, 163840, 162249,
+        160689, 159159, 157657, 156184, 154738, 153318, 151924, 150556,
+        149211, 147891, 146594, 145319, 144066, 142835, 141624, 140434,
+        139264, 138113, 136981, 135867, 134772, 133693, 132632, 131588,
+        130560, 129548, 128551, 127570, 126604, 125652, 124714, 123790,
+        122880, 121983, 121099, 120228, 119369, 118523, 117688, 116865,
+        116053, 115253, 114464, 113685, 112917, 112159, 111411, 110673,
+        109945, 109227, 108517, 107817, 107126, 106444, 105770, 105105,
+        104448, 103799, 103159, 102526, 101900, 101283, 100673, 100070,
+        99474, 98886, 98304, 97729, 97161, 96599, 96044, 95495,
+        94953, 94416, 93886, 93361, 92843, 92330, 91822, 91321,
+        90824, 90333, 89848, 89367, 88892, 88422, 87956, 87496,
+        87040, 86589, 86143, 85701, 85264, 84831, 84402, 83978,
+        83558, 83143, 82731, 82324, 81920, 81520, 81125, 80733,
+        80345, 79960, 79579, 79202, 78829, 78459, 78092, 77729,
+        77369, 77012, 76659, 76309, 75962, 75618, 75278, 74940,
+        74606, 74274, 73945, 73620, 73297, 72977, 72659, 72345,
+        72033, 71724, 71417, 71114, 70812, 70513, 70217, 69923,
+        69632, 69343, 69057, 68772, 68490, 68211, 67934, 67659,
+        67386, 67115, 66847, 66580, 66316, 66054, 65794, 65536
+};
+
+static void IMGIFNormalizeFrame(const uint8_t *source, size_t bytesPerRow, size_t width, size_t height, uint32_t *destination) {
+    for (size_t y = 0; y < height; y++) {
+        const uint8_t *row = source + y * bytesPerRow;
+        uint32_t *output = destination + y * width;
+
+        for (size_t x = 0; x < width; x++) {
+            uint32_t r = row[x * 4], g = row[x * 4 + 1], b = row[x * 4 + 2], a = row[x * 4 + 3];
+
+            if (a < IMGIFAlphaThreshold) {
+                output[x] = IMGIFTransparentPixel;
+                continue;
+            }
+
+            if (a != 255) {
+                uint32_t reciprocal = IMGIFAlphaReciprocals[a];
+                r = (r * reciprocal + 32768) >> 16;
+                g = (g * reciprocal + 32768) >> 16;
+                b = (b * reciprocal + 32768) >> 16;
+                r = r > 255 ? 255 : r;
+                g = g > 255 ? 255 : g;
+                b = b > 255 ? 255 : b;
+            }
+
+            output[x] = r | (g << 8) | (b << 16) | 0xFF000000u;
+        }
+    }
+}
+
+static bool IMGIFChangedRect(const uint32_t *before, const uint32_t *after, size_t width, size_t height, IMGIFRect *rect) {
+    size_t rowBytes = width * sizeof(uint32_t);
+    size_t top = 0, bottom = height;
+
+    while (top < height && memcmp(before + top * width, after + top * width, rowBytes) == 0) {
+        top++;
+    }
+
+    if (top == height) {
+        return false;
+    }
+
+    while (bottom > top && memcmp(before + (bottom - 1) * width, after + (bottom - 1) * width, rowBytes) == 0) {
+        bottom--;
+    }
+
+    size_t left = width, right = 0;
+    for (size_t y = top; y < bottom; y++) {
+        const uint32_t *a = before + y * width, *b = after + y * width;
+        size_t x = 0;
+
+        while (x < left && a[x] == b[x]) {
+            x++;
+        }
+        left = x < left ? x : left;
+
+        x = width;
+        while (x > right && a[x - 1] == b[x - 1]) {
+            x--;
+        }
+        right = x > right ? x : right;
+    }
+
+    *rect = (IMGIFRect) {left, top, right - left, bottom - top};
+    return true;
+}
+
+static bool IMGIFOpaqueRect(const uint32_t *pixels, size_t width, size_t height, IMGIFRect *rect) {
+    size_t left = width, right = 0, top = height, bottom = 0;
+
+    for (size_t y = 0; y < height; y++) {
+        const uint32_t *row = pixels + y * width;
+        size_t x = 0;
+
+        while (x < width && row[x] == IMGIFTransparentPixel) {
+            x++;
+        }
+
+        if (x == width) {
+            continue;
+        }
+
+        left = x < left ? x : left;
+
+        x = width;
+        while (row[x - 1] == IMGIFTransparentPixel) {
+            x--;
+        }
+        right = x > right ? x : right;
+
+        top = y < top ? y : top;
+        bottom = y + 1;
+    }
+
+    if (top == height) {
+        return false;
+    }
+
+    *rect = (IMGIFRect) {left, top, right - left, bottom - top};
+    return true;
+}
+
+static IMGIFRect IMGIFUnionRect(IMGIFRect a, IMGIFRect b) {
+    size_t left = a.x < b.x ? a.x : b.x;
+    size_t top = a.y < b.y ? a.y : b.y;
+    size_t right = a.x + a.width > b.x + b.width ? a.x + a.width : b.x + b.width;
+    size_t bottom = a.y + a.height > b.y + b.height ? a.y + a.height : b.y + b.height;
+
+    return (IMGIFRect) {left, top, right - left, bottom - top};
+}
+
+// A frame that turns a visible pixel transparent cannot be drawn on top of its predecessor, the predecessor has to
+// be cleared (restored to background) before it is drawn.
+static bool IMGIFRequiresClear(const uint32_t *previous, const uint32_t *next, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (previous[i] != IMGIFTransparentPixel && next[i] == IMGIFTransparentPixel) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#pragma mark Quantization
+
+static size_t IMGIFBuildExactPalette(IMGIFEncoderState *state, const uint32_t *colors, size_t colorCount, size_t maxColors, uint32_t *palette) {
+    uint32_t *keys = state->exactKeys;
+    uint8_t *paletteIndices = state->exactIndices;
+    size_t paletteCount = 0;
+
+    memset(keys, 0, sizeof(uint32_t) * IMGIFExactPaletteHashSize);
+
+    for (size_t i = 0; i < colorCount; i++) {
+        uint32_t color = colors[i];
+        uint32_t slot = (color * 2654435761u) >> (32 - 10);
+
+        while (keys[slot] != 0 && keys[slot] != color) {
+            slot = (slot + 1) & (IMGIFExactPaletteHashSize - 1);
+        }
+
+        if (keys[slot] == 0) {
+            if (paletteCount == maxColors) {
+                return 0;
+            }
+
+            keys[slot] = color;
+            paletteIndices[slot] = (uint8_t) paletteCount;
+            palette[paletteCount++] = color;
+        }
+    }
+
+    return paletteCount;
+}
+
+static uint8_t IMGIFExactPaletteIndex(IMGIFEncoderState *state, uint32_t color) {
+    uint32_t slot = (color * 2654435761u) >> (32 - 10);
+
+    while (state->exactKeys[slot] != color) {
+        slot = (slot + 1) & (IMGIFExactPaletteHashSize - 1);
+    }
+
+    return state->exactIndices[slot];
+}
+
+static void IMGIFUpdateBoxBounds(IMGIFEncoderState *state, IMGIFBox *box) {
+    box->min[0] = box->min[1] = box->min[2] = 31;
+    box->max[0] = box->max[1] = box->max[2] = 0;
+    box->pixelCount = 0;
+
+    for (uint32_t i = box->start; i < box->end; i++) {
+        uint16_t bin = state->entries[i];
+        uint8_t components[3] = {(uint8_t) (bin >> 10), (uint8_t) ((bin >> 5) & 31), (uint8_t) (bin & 31)};
+
+        for (int c = 0; c < 3; c++) {
+            box->min[c] = components[c] < box->min[c] ? components[c] : box->min[c];
+            box->max[c] = components[c] > box->max[c] ? components[c] : box->max[c];
+        }
+
+        box->pixelCount += state->histogram[bin];
+    }
+}
+
+static void IMGIFSplitBox(IMGIFEncoderState *state, IMGIFBox *box, IMGIFBox *newBox) {
+    int axis = 0;
+    for (int c = 1; c < 3; c++) {
+        if (box->max[c] - box->min[c] > box->max[axis] - box->min[axis]) {
+            axis = c;
+        }
+    }
+
+    int shift = axis == 0 ? 10 : (axis == 1 ? 5 : 0);
+
+    // counting sort of the box entries along the split axis, there are only 32 distinct component values
+    uint32_t offsets[33] = {0};
+    uint64_t populations[32] = {0};
+    for (uint32_t i = box->start; i < box->end; i++) {
+        uint16_t bin = state->entries[i];
+        uint32_t value = (bin >> shift) & 31;
+        offsets[value + 1]++;
+        populations[value] += state->histogram[bin];
+    }
+
+    for (int v = 0; v < 32; v++) {
+        offsets[v + 1] += offsets[v];
+    }
+
+    for (uint32_t i = box->start; i < box->end; i++) {
+        uint16_t bin = state->entries[i];
+        state->scratchEntries[box->start + offsets[(bin >> shift) & 31]++] = bin;
+    }
+
+    memcpy(state->entries + box->start, state->scratchEntries + box->start, sizeof(uint16_t) * (box->end - box->start));
+
+    // split at the component value holding the median pixel
+    uint64_t half = box->pixelCount / 2, accumulated = 0;
+    int splitValue = box->min[axis];
+    for (int v = box->min[axis]; v < box->max[axis]; v++) {
+        accumulated += populations[v];
+        splitValue = v;
+        if (accumulated >= half) {
+            break;
+        }
+    }
+
+    uint32_t split = box->start;
+    while (split < box->end && ((state->entries[split] >> shift) & 31) <= splitValue) {
+        split++;
+    }
+
+    newBox->start = split;
+    newBox->end = box->end;
+    box->end = split;
+
+    IMGIFUpdateBoxBounds(state, box);
+    IMGIFUpdateBoxBounds(state, newBox);
+}
+
+static size_t IMGIFBuildMedianCutPalette(IMGIFEncoderState *state, const uint32_t *colors, size_t colorCount, size_t maxColors, uint32_t *palette) {
+    uint32_t *histogram = state->histogram;
+    uint32_t *sums = state->sums;
+    uint32_t entryCount = 0;
+
+    memset(histogram, 0, sizeof(uint32_t) * IMGIFHistogramBins);
+    memset(sums, 0, sizeof(uint32_t) * IMGIFHistogramBins * 3);
+
+    for (size_t i = 0; i < colorCount; i++) {
+        uint32_t color = colors[i];
+        uint16_t bin = IMGIFPixelBin(color);
+
+        if (histogram[bin]++ == 0) {
+            state->entries[entryCount++] = bin;
+        }
+
+        sums[bin * 3] += IMGIFPixelR(color);
+        sums[bin * 3 + 1] += IMGIFPixelG(color);
+        sums[bin * 3 + 2] += IMGIFPixelB(color);
+    }
+
+    IMGIFBox *boxes = state->boxes;
+    size_t boxCount = 1;
+    boxes[0].start = 0;
+    boxes[0].end = entryCount;
+    IMGIFUpdateBoxBounds(state, &boxes[0]);
+
+    while (boxCount < maxColors) {
+        size_t candidate = SIZE_MAX;
+        uint64_t bestScore = 0;
+
+        for (size_t i = 0; i < boxCount; i++) {
+            IMGIFBox *box = &boxes[i];
+            if (box->end - box->start < 2) {
+                continue;
+            }
+
+            int range = 0;
+            for (int c = 0; c < 3; c++) {
+                range = box->max[c] - box->min[c] > range ? box->max[c] - box->min[c] : range;
+            }
+
+            uint64_t score = (uint64_t) range * box->pixelCount;
+            if (score > bestScore) {
+                bestScore = score;
+                candidate = i;
+            }
+        }
+
+        if (candidate == SIZE_MAX) {
+            break;
+        }
+
+        IMGIFSplitBox(state, &boxes[candidate], &boxes[boxCount++]);
+    }
+
+    for (size_t i = 0; i < boxCount; i++) {
+        uint64_t r = 0, g = 0, b = 0, count = 0;
+
+        for (uint32_t e = boxes[i].start; e < boxes[i].end; e++) {
+            uint16_t bin = state->entries[e];
+            r += sums[bin * 3];
+            g += sums[bin * 3 + 1];
+            b += sums[bin * 3 + 2];
+            count += histogram[bin];
+            state->binToIndex[bin] = (uint8_t) i;
+        }
+
+        count = count > 0 ? count : 1;
+        palette[i] = (uint32_t) ((r + count / 2) / count) |
+                ((uint32_t) ((g + count / 2) / count) << 8) |
+                ((uint32_t) ((b + count / 2) / count) << 16);
+    }
+
+    return boxCount;
+}
+
+#pragma mark Frame Encoding
+
+static void IMGIFWriteFrame(IMGIFEncoderState *state, const uint32_t *frame, int disposal, uint16_t delay) {
+    const size_t width = state->width;
+    const uint32_t *canvas = state->canvas;
+
+    IMGIFRect rect;
+    bool changed = IMGIFChangedRect(canvas, frame, width, state->height, &rect);
+
+    if (disposal == IMGIFDisposalRestoreBackground) {
+        // clearing only affects the frame rectangle, make sure it covers everything visible
+        IMGIFRect opaqueRect;
+        if (IMGIFOpaqueRect(frame, width, state->height, &opaqueRect)) {
+            rect = changed ? IMGIFUnionRect(rect, opaqueRect) : opaqueRect;
+            changed = true;
+        }
+    }
+
+    if (!changed) {
+        rect = (IMGIFRect) {0, 0, 1, 1};
+    }
+
+    // gather the visible pixels that actually need to be drawn, everything else becomes transparent
+    size_t colorCount = 0;
+    bool usesTransparency = false;
+    for (size_t y = rect.y; y < rect.y + rect.height; y++) {
+        for (size_t x = rect.x; x < rect.x + rect.width; x++) {
+            uint32_t pixel = frame[y * width + x];
+            if (pixel == IMGIFTransparentPixel || (pixel == canvas[y * width + x] && disposal == IMGIFDisposalNone)) {
+                usesTransparency = true;
+            } else {
+                state->colors[colorCount++] = pixel;
+            }
+        }
+    }
+
+    uint32_t palette[IMGIFMaxColors];
+    size_t maxColors = usesTransparency ? IMGIFMaxColors - 1 : IMGIFMaxColors;
+    size_t paletteCount = colorCount > 0 ? IMGIFBuildExactPalette(state, state->colors, colorCount, maxColors, palette) : 0;
+    bool exact = paletteCount > 0;
+
+    if (!exact && colorCount > 0) {
+        paletteCount = IMGIFBuildMedianCutPalette(state, state->colors, colorCount, maxColors, palette);
+    }
+
+    uint8_t transparentIndex = (uint8_t) paletteCount;
+    size_t indexCount = 0;
+    for (size_t y = rect.y; y < rect.y + rect.height; y++) {
+        for (size_t x = rect.x; x < rect.x + rect.width; x++) {
+            uint32_t pixel = frame[y * width + x];
+            if (pixel == IMGIFTransparentPixel || (pixel == canvas[y * width + x] && disposal == IMGIFDisposalNone)) {
+                state->indices[indexCount++] = transparentIndex;
+            } else {
+                state->indices[indexCount++] = exact ? IMGIFExactPaletteIndex(state, pixel) : state->binToIndex[IMGIFPixelBin(pixel)];
+            }
+        }
+    }
+
+    size_t tableEntries = paletteCount + (usesTransparency ? 1 : 0);
+    int tableBits = 1;
+    while ((1u << tableBits) < tableEntries) {
+        tableBits++;
+    }
+
+    // graphic control extension
+    IMGIFBufferAppendByte(&state->output, 0x21);
+    IMGIFBufferAppendByte(&state->output, 0xF9);
+    IMGIFBufferAppendByte(&state->output, 0x04);
+    IMGIFBufferAppendByte(&state->output, (uint8_t) ((disposal << 2) | (usesTransparency ? 1 : 0)));
+    IMGIFBufferAppendShort(&state->output, delay);
+    IMGIFBufferAppendByte(&state->output, usesTransparency ? transparentIndex : 0);
+    IMGIFBufferAppendByte(&state->output, 0x00);
+
+    // image descriptor with a local color table
+    IMGIFBufferAppendByte(&state->output, 0x2C);
+    IMGIFBufferAppendShort(&state->output, (uint16_t) rect.x);
+    IMGIFBufferAppendShort(&state->output, (uint16_t) rect.y);
+    IMGIFBufferAppendShort(&state->output, (uint16_t) rect.width);
+    IMGIFBufferAppendShort(&state->output, (uint16_t) rect.height);
+    IMGIFBufferAppendByte(&state->output, (uint8_t) (0x80 | (tableBits - 1)));
+
+    uint8_t colorTable[IMGIFMaxColors * 3] = {0};
+    for (size_t i = 0; i < paletteCount; i++) {
+        colorTable[i * 3] = (uint8_t) IMGIFPixelR(palette[i]);
+        colorTable[i * 3 + 1] = (uint8_t) IMGIFPixelG(palette[i]);
+        colorTable[i * 3 + 2] = (uint8_t) IMGIFPixelB(palette[i]);
+    }
+    IMGIFBufferAppend(&state->output, colorTable, (size_t) 3 << tableBits);
+
+    IMGIFEncodeLZW(state, state->indices, indexCount, tableBits < 2 ? 2 : tableBits);
+}
+
+static void IMGIFFlushPending(IMGIFEncoderState *state, int disposal) {
+    IMGIFWriteFrame(state, state->pending, disposal, state->pendingDelay);
+
+    if (disposal == IMGIFDisposalRestoreBackground) {
+        memset(state->canvas, 0, sizeof(uint32_t) * state->width * state->height);
+    } else {
+        uint32_t *canvas = state->canvas;
+        state->canvas = state->pending;
+        state->pending = canvas;
+    }
+
+    state->hasPending = false;
+}
+
+#pragma mark Encoder Lifecycle
+
+void IMGIFEncoderStateDestroy(IMGIFEncoderState *state) {
+    if (!state) {
+        return;
+    }
+
+    free(state->output.bytes);
+    free(state->canvas);
+    free(state->pending);
+    free(state->incoming);
+    free(state->indices);
+    free(state->colors);
+    free(state->histogram);
+    free(state->sums);
+    free(state->entries);
+    free(state->scratchEntries);
+    free(state->binToIndex);
+    free(state->boxes);
+    free(state->exactKeys);
+    free(state->exactIndices);
+    free(state->lzwKeys);
+    free(state->lzwCodes);
+    free(state);
+}
+
+IMGIFEncoderState *IMGIFEncoderStateCreate(size_t width, size_t height, uint16_t loopCount) {
+    if (width == 0 || height == 0 || width > UINT16_MAX || height > UINT16_MAX) {
+        return NULL;
+    }
+
+    IMGIFEncoderState *state = calloc(1, sizeof(IMGIFEncoderState));
+    if (!state) {
+        return NULL;
+    }
+
+    size_t pixelCount = width * height;
+    state->width = width;
+    state->height = height;
+    state->loopCount = loopCount;
+    state->canvas = calloc(pixelCount, sizeof(uint32_t));
+    state->pending = calloc(pixelCount, sizeof(uint32_t));
+    state->incoming = calloc(pixelCount, sizeof(uint32_t));
+    state->indices = malloc(pixelCount);
+    state->colors = malloc(pixelCount * sizeof(uint32_t));
+    state->histogram = malloc(IMGIFHistogramBins * sizeof(uint32_t));
+    state->sums = malloc(IMGIFHistogramBins * 3 * sizeof(uint32_t));
+    state->entries = malloc(IMGIFHistogramBins * sizeof(uint16_t));
+    state->scratchEntries = malloc(IMGIFHistogramBins * sizeof(uint16_t));
+    state->binToIndex = malloc(IMGIFHistogramBins);
+    state->boxes = malloc(IMGIFMaxColors * sizeof(IMGIFBox));
+    state->exactKeys = malloc(IMGIFExactPaletteHashSize * sizeof(uint32_t));
+    state->exactIndices = malloc(IMGIFExactPaletteHashSize);
+    state->lzwKeys = malloc(IMGIFLZWHashSize * sizeof(int32_t));
+    state->lzwCodes = malloc(IMGIFLZWHashSize * sizeof(uint16_t));
+
+    if (!state->canvas || !state->pending || !state->incoming || !state->indices || !state->colors ||
+            !state->histogram || !state->sums || !state->entries || !state->scratchEntries || !state->binToIndex ||
+            !state->boxes || !state->exactKeys || !state->exactIndices || !state->lzwKeys || !state->lzwCodes) {
+        IMGIFEncoderStateDestroy(state);
+        return NULL;
+    }
+
+    // header, logical screen descriptor without a global color table and the looping application extension
+    IMGIFBufferAppend(&state->output, "GIF89a", 6);
+    IMGIFBufferAppendShort(&state->output, (uint16_t) width);
+    IMGIFBufferAppendShort(&state->output, (uint16_t) height);
+    IMGIFBufferAppendByte(&state->output, 0x00);
+    IMGIFBufferAppendByte(&state->output, 0x00);
+    IMGIFBufferAppendByte(&state->output, 0x00);
+
+    IMGIFBufferAppendByte(&state->output, 0x21);
+    IMGIFBufferAppendByte(&state->output, 0xFF);
+    IMGIFBufferAppendByte(&state->output, 0x0B);
+    IMGIFBufferAppend(&state->output, "NETSCAPE2.0", 11);
+    IMGIFBufferAppendByte(&state->output, 0x03);
+    IMGIFBufferAppendByte(&state->output, 0x01);
+    IMGIFBufferAppendShort(&state->output, loopCount);
+    IMGIFBufferAppendByte(&state->output, 0x00);
+
+    return state;
+}
+
+bool IMGIFEncoderStateAppend(IMGIFEncoderState *state, const uint8_t *pixels, size_t bytesPerRow, uint16_t delay) {
+    if (state->finished) {
+        return false;
+    }
+
+    IMGIFNormalizeFrame(pixels, bytesPerRow, state->width, state->height, state->incoming);
+
+    if (state->hasPending) {
+        bool clear = IMGIFRequiresClear(state->pending, state->incoming, state->width * state->height);
+        IMGIFFlushPending(state, clear ? IMGIFDisposalRestoreBackground : IMGIFDisposalNone);
+    }
+
+    uint32_t *pending = state->pending;
+    state->pending = state->incoming;
+    state->incoming = pending;
+    state->pendingDelay = delay;
+    state->hasPending = true;
+    state->frameCount++;
+
+    return !state->output.failed;
+}
+
+bool IMGIFEncoderStateFinish(IMGIFEncoderState *state) {
+    if (!state->finished) {
+        if (state->hasPending) {
+            // decoders differ in whether the canvas is reset when the animation loops, clearing the last frame
+            // makes sure the first frame is always drawn over an empty canvas
+            IMGIFFlushPending(state, state->frameCount > 1 ? IMGIFDisposalRestoreBackground : IMGIFDisposalNone);
+        }
+
+        IMGIFBufferAppendByte(&state->output, 0x3B);
+        state->finished = true;
+    }
+
+    return !state->output.failed && state->frameCount > 0;
+}
+
+size_t IMGIFEncoderStateFrameCount(const IMGIFEncoderState *state) {
+    return state->frameCount;
+}
+
+uint8_t *IMGIFEncoderStateTakeOutput(IMGIFEncoderState *state, size_t *length) {
+    uint8_t *bytes = state->output.bytes;
+    *length = state->output.length;
+
+    state->output.bytes = NULL;
+    state->output.length = state->output.capacity = 0;
+
+    return bytes;
+}
@@ -0,0 +1,73 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#ifndef IMGIFEncoderCore_h
+#define IMGIFEncoderCore_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+* @abstract Plain C state of a streaming GIF89a encoder, wrapped by IMGIFEncoder. Frames are written as they are
+* appended with one frame of delay, the pending frame's disposal method depends on the frame that follows it.
+*/
+typedef struct IMGIFEncoderState IMGIFEncoderState;
+
+/**
+* @abstract Creates an encoder and writes the GIF header. Returns NULL for empty or oversized dimensions.
+*/
+IMGIFEncoderState *IMGIFEncoderStateCreate(size_t width, size_t height, uint16_t loopCount);
+
+void IMGIFEncoderStateDestroy(IMGIFEncoderState *state);
+
+/**
+* @abstract Appends a width x height premultiplied RGBA frame displayed for delay centiseconds.
+* @return false if the encoder has been finished or ran out of memory
+*/
+bool IMGIFEncoderStateAppend(IMGIFEncoderState *state, const uint8_t *pixels, size_t bytesPerRow, uint16_t delay);
+
+/**
+* @abstract Writes the pending frame and the GIF trailer.
+* @return false if no frames were appended or the encoder ran out of memory
+*/
+bool IMGIFEncoderStateFinish(IMGIFEncoderState *state);
+
+size_t IMGIFEncoderStateFrameCount(const IMGIFEncoderState *state);
+
+/**
+* @abstract Hands the encoded bytes over to the caller who frees them with free().
+*/
+uint8_t *IMGIFEncoderStateTakeOutput(IMGIFEncoderState *state, size_t *length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,359 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#include "IMImageResampler.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#endif
+
+// The resampler is plain C so it can be exercised without UIKit. Each pixel is processed as one four lane integer
+// vector, clang lowers the vector arithmetic to NEON on arm64 and SSE on x86_64.
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define IMResampleWeightBits 14
+#define IMResampleWeightOne (1 << IMResampleWeightBits)
+#define IMResampleBandRows 32
+#define IMResampleConcurrentPixelThreshold (256 * 256)
+
+typedef int32_t IMResampleVector __attribute__((vector_size(16)));
+
+typedef struct {
+    uint32_t start;
+    uint32_t count;
+    uint32_t offset;
+} IMResampleSpan;
+
+typedef struct {
+    IMResampleSpan *spans;
+    int16_t *weights;
+} IMResampleKernel;
+
+typedef struct {
+    const uint8_t *source;
+    size_t sourceBytesPerRow;
+    size_t sourceHeight;
+
+    uint8_t *intermediate;
+    size_t intermediateWidth;
+    size_t intermediateHeight;
+    size_t intermediateBytesPerRow;
+
+    IMResampleKernel horizontal;
+    IMResampleKernel vertical;
+
+    uint8_t *destinationOrigin;
+    ptrdiff_t destinationStepX;
+    ptrdiff_t destinationStepY;
+
+    bool failed;
+} IMResampleContext;
+
+static inline IMResampleVector IMResampleLoad(const uint8_t *pixel) {
+    return (IMResampleVector) {pixel[0], pixel[1], pixel[2], pixel[3]};
+}
+
+static inline void IMResampleStore(IMResampleVector accumulator, uint8_t *pixel) {
+    accumulator = (accumulator + (IMResampleWeightOne / 2)) >> IMResampleWeightBits;
+
+    int32_t a = accumulator[3] < 0 ? 0 : (accumulator[3] > 255 ? 255 : accumulator[3]);
+    for (int c = 0; c < 3; c++) {
+        // lanczos lobes can overshoot, keep the color components valid for premultiplied alpha
+        int32_t value = accumulator[c] < 0 ? 0 : (accumulator[c] > a ? a : accumulator[c]);
+        pixel[c] = (uint8_t) value;
+    }
+    pixel[3] = (uint8_t) a;
+}
+
+static double IMResampleLanczos3(double x) {
+    if (x == 0.0) {
+        return 1.0;
+    }
+
+    if (x <= -3.0 || x >= 3.0) {
+        return 0.0;
+    }
+
+    double px = M_PI * x;
+    return 3.0 * sin(px) * sin(px / 3.0) / (px * px);
+}
+
+static void IMResampleDestroyKernel(IMResampleKernel *kernel) {
+    free(kernel->spans);
+    free(kernel->weights);
+    kernel->spans = NULL;
+    kernel->weights = NULL;
+}
+
+static bool IMResampleBuildKernel(size_t sourceLength, size_t destinationLength, IMImageResamplingFilter filter, IMResampleKernel *kernel) {
+    double scale = (double) sourceLength / (double) destinationLength;
+    double filterScale = scale > 1.0 ? scale : 1.0;
+    double support = (filter == IMImageResamplingFilterLanczos3 ? 3.0 : 0.5) * filterScale;
+    size_t maximumTaps = (size_t) ceil(support) * 2 + 2;
+
+    kernel->spans = malloc(destinationLength * sizeof(IMResampleSpan));
+    kernel->weights = malloc(destinationLength * maximumTaps * sizeof(int16_t));
+    double *taps = malloc(maximumTaps * sizeof(double));
+
+    if (!kernel->spans || !kernel->weights || !taps) {
+        free(taps);
+        IMResampleDestroyKernel(kernel);
+        return false;
+    }
+
+    for (size_t i = 0; i < destinationLength; i++) {
+        double center = (i + 0.5) * scale;
+        double low = center - support, high = center + support;
+        long start = (long) floor(low), end = (long) ceil(high);
+
+        start = start < 0 ? 0 : start;
+        end = end > (long) sourceLength ? (long) sourceLength : end;
+
+        double total = 0.0;
+        for (long j = start; j < end; j++) {
+            double weight;
+            if (filter == IMImageResamplingFilterLanczos3) {
+                weight = IMResampleLanczos3((j + 0.5 - center) / filterScale);
+            } else {
+                // exact coverage of the source pixel by the destination pixel
+                double overlapLow = low > j ? low : j, overlapHigh = high < j + 1 ? high : j + 1;
+                weight = overlapHigh > overlapLow ? overlapHigh - overlapLow : 0.0;
+            }
+
+            taps[j - start] = weight;
+            total += weight;
+        }
+
+        // trim taps that don't contribute
+        while (end - start > 1 && taps[0] == 0.0) {
+            memmove(taps, taps + 1, sizeof(double) * (end - start - 1));
+            start++;
+        }
+        while (end - start > 1 && taps[end - start - 1] == 0.0) {
+            end--;
+        }
+
+        IMResampleSpan *span = &kernel->spans[i];
+        span->start = (uint32_t) start;
+        span->count = (uint32_t) (end - start);
+        span->offset = (uint32_t) (i * maximumTaps);
+
+        // edges are handled by renormalizing the clipped filter, the fixed point weights always sum to one
+        int16_t *weights = kernel->weights + span->offset;
+        int32_t fixedTotal = 0;
+        uint32_t largest = 0;
+        for (uint32_t k = 0; k < span->count; k++) {
+            weights[k] = (int16_t) lround(total != 0.0 ? taps[k] / total * IMResampleWeightOne : (k == 0 ? IMResampleWeightOne : 0));
+            fixedTotal += weights[k];
+            largest = weights[k] > weights[largest] ? k : largest;
+        }
+        weights[largest] += IMResampleWeightOne - fixedTotal;
+    }
+
+    free(taps);
+    return true;
+}
+
+static void IMResampleHorizontalBand(void *context, size_t band) {
+    IMResampleContext *resample = context;
+    size_t firstRow = band * IMResampleBandRows;
+    size_t lastRow = firstRow + IMResampleBandRows < resample->sourceHeight ? firstRow + IMResampleBandRows : resample->sourceHeight;
+
+    for (size_t y = firstRow; y < lastRow; y++) {
+        const uint8_t *sourceRow = resample->source + y * resample->sourceBytesPerRow;
+        uint8_t *outputRow = resample->intermediate + y * resample->intermediateBytesPerRow;
+
+        for (size_t x = 0; x < resample->intermediateWidth; x++) {
+            const IMResampleSpan span = resample->horizontal.spans[x];
+            const int16_t *weights = resample->horizontal.weights + span.offset;
+            const uint8_t *pixel = sourceRow + span.start * 4;
+            IMResampleVector accumulator = {0, 0, 0, 0};
+
+            for (uint32_t k = 0; k < span.count; k++) {
+                accumulator += IMResampleLoad(pixel + k * 4) * (int32_t) weights[k];
+            }
+
+            IMResampleStore(accumulator, outputRow + x * 4);
+        }
+    }
+}
+
+static void IMResampleVerticalBand(void *context, size_t band) {
+    IMResampleContext *resample = context;
+    size_t firstRow = band * IMResampleBandRows;
+    size_t lastRow = firstRow + IMResampleBandRows < resample->intermediateHeight ? firstRow + IMResampleBandRows : resample->intermediateHeight;
+    size_t width = resample->intermediateWidth;
+
+    IMResampleVector *accumulators = malloc(width * sizeof(IMResampleVector));
+    if (!accumulators) {
+        resample->failed = true;
+        return;
+    }
+
+    for (size_t y = firstRow; y < lastRow; y++) {
+        const IMResampleSpan span = resample->vertical.spans[y];
+        const int16_t *weights = resample->vertical.weights + span.offset;
+
+        memset(accumulators, 0, width * sizeof(IMResampleVector));
+
+        // accumulate whole rows at a time so the inner loop walks memory linearly
+        for (uint32_t k = 0; k < span.count; k++) {
+            const uint8_t *row = resample->intermediate + (span.start + k) * resample->intermediateBytesPerRow;
+            int32_t weight = weights[k];
+
+            for (size_t x = 0; x < width; x++) {
+                accumulators[x] += IMResampleLoad(row + x * 4) * weight;
+            }
+        }
+
+        // orientation is applied here by walking the destination with the rotated/mirrored strides
+        uint8_t *output = resample->destinationOrigin + (ptrdiff_t) y * resample->destinationStepY;
+        for (size_t x = 0; x < width; x++) {
+            IMResampleStore(accumulators[x], output + (ptrdiff_t) x * resample->destinationStepX);
+        }
+    }
+
+    free(accumulators);
+}
+
+static void IMResampleRunBands(IMResampleContext *context, size_t rows, size_t pixelCount, void (*function)(void *, size_t)) {
+    size_t bands = (rows + IMResampleBandRows - 1) / IMResampleBandRows;
+
+#if defined(__APPLE__)
+    if (pixelCount >= IMResampleConcurrentPixelThreshold && bands > 1) {
+        dispatch_apply_f(bands, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), context, function);
+        return;
+    }
+#else
+    (void) pixelCount;
+#endif
+
+    for (size_t band = 0; band < bands; band++) {
+        function(context, band);
+    }
+}
+
+bool IMImageResamplePremultipliedRGBA(const uint8_t *source,
+                                      size_t sourceWidth,
+                                      size_t sourceHeight,
+                                      size_t sourceBytesPerRow,
+                                      uint8_t *destination,
+                                      size_t destinationWidth,
+                                      size_t destinationHeight,
+                                      size_t destinationBytesPerRow,
+                                      IMImageResamplingOrientation orientation,
+                                      IMImageResamplingFilter filter) {
+    if (sourceWidth == 0 || sourceHeight == 0 || destinationWidth == 0 || destinationHeight == 0 ||
+            sourceWidth > UINT32_MAX || sourceHeight > UINT32_MAX) {
+        return false;
+    }
+
+    bool transposed = orientation == IMImageResamplingOrientationLeft || orientation == IMImageResamplingOrientationRight ||
+            orientation == IMImageResamplingOrientationLeftMirrored || orientation == IMImageResamplingOrientationRightMirrored;
+
+    // resampling happens in the orientation of the source, the intermediate is sized accordingly
+    IMResampleContext context = {
+            .source = source,
+            .sourceBytesPerRow = sourceBytesPerRow,
+            .sourceHeight = sourceHeight,
+            .intermediateWidth = transposed ? destinationHeight : destinationWidth,
+            .intermediateHeight = transposed ? destinationWidth : destinationHeight,
+    };
+
+    ptrdiff_t width = (ptrdiff_t) context.intermediateWidth, height = (ptrdiff_t) context.intermediateHeight;
+    ptrdiff_t rowBytes = (ptrdiff_t) destinationBytesPerRow;
+
+    switch (orientation) {
+        case IMImageResamplingOrientationUp:
+            context.destinationOrigin = destination;
+            context.destinationStepX = 4;
+            context.destinationStepY = rowBytes;
+            break;
+        case IMImageResamplingOrientationDown:
+            context.destinationOrigin = destination + (height - 1) * rowBytes + (width - 1) * 4;
+            context.destinationStepX = -4;
+            context.destinationStepY = -rowBytes;
+            break;
+        case IMImageResamplingOrientationLeft:
+            context.destinationOrigin = destination + (width - 1) * rowBytes;
+            context.destinationStepX = -rowBytes;
+            context.destinationStepY = 4;
+            break;
+        case IMImageResamplingOrientationRight:
+            context.destinationOrigin = destination + (height - 1) * 4;
+            context.destinationStepX = rowBytes;
+            context.destinationStepY = -4;
+            break;
+        case IMImageResamplingOrientationUpMirrored:
+            context.destinationOrigin = destination + (width - 1) * 4;
+            context.destinationStepX = -4;
+            context.destinationStepY = rowBytes;
+            break;
+        case IMImageResamplingOrientationDownMirrored:
+            context.destinationOrigin = destination + (height - 1) * rowBytes;
+            context.destinationStepX = 4;
+            context.destinationStepY = -rowBytes;
+            break;
+        case IMImageResamplingOrientationLeftMirrored:
+            context.destinationOrigin = destination;
+            context.destinationStepX = rowBytes;
+            context.destinationStepY = 4;
+            break;
+        case IMImageResamplingOrientationRightMirrored:
+            context.destinationOrigin = destination + (width - 1) * rowBytes + (height - 1) * 4;
+            context.destinationStepX = -rowBytes;
+            context.destinationStepY = -4;
+            break;
+        default:
+            return false;
+    }
+
+    context.intermediateBytesPerRow = context.intermediateWidth * 4;
+    context.intermediate = malloc(context.intermediateBytesPerRow * sourceHeight);
+
+    if (!context.intermediate ||
+            !IMResampleBuildKernel(sourceWidth, context.intermediateWidth, filter, &context.horizontal) ||
+            !IMResampleBuildKernel(sourceHeight, context.intermediateHeight, filter, &context.vertical)) {
+        free(context.intermediate);
+        IMResampleDestroyKernel(&context.horizontal);
+        return false;
+    }
+
+    IMResampleRunBands(&context, sourceHeight, context.intermediateWidth * sourceHeight, IMResampleHorizontalBand);
+    IMResampleRunBands(&context, context.intermediateHeight, context.intermediateWidth * context.intermediateHeight, IMResampleVerticalBand);
+
+    free(context.intermediate);
+    IMResampleDestroyKernel(&context.horizontal);
+    IMResampleDestroyKernel(&context.vertical);
+
+    return !context.failed;
+}
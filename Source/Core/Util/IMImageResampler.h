@@ -0,0 +1,90 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+#ifndef IMImageResampler_h
+#define IMImageResampler_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+* @abstract Filters supported by IMImageResamplePremultipliedRGBA
+*/
+typedef enum {
+    /**
+    * @abstract Three lobed Lanczos filter, sharpest results and best suited for small scale changes
+    */
+    IMImageResamplingFilterLanczos3,
+
+    /**
+    * @abstract Averages the source pixels covered by each destination pixel, fastest for large reductions
+    */
+    IMImageResamplingFilterArea
+} IMImageResamplingFilter;
+
+/**
+* @abstract Orientation of the source buffer. The values match UIImageOrientation so they can be cast directly.
+*/
+typedef enum {
+    IMImageResamplingOrientationUp,
+    IMImageResamplingOrientationDown,
+    IMImageResamplingOrientationLeft,
+    IMImageResamplingOrientationRight,
+    IMImageResamplingOrientationUpMirrored,
+    IMImageResamplingOrientationDownMirrored,
+    IMImageResamplingOrientationLeftMirrored,
+    IMImageResamplingOrientationRightMirrored
+} IMImageResamplingOrientation;
+
+/**
+* @abstract Resamples a premultiplied RGBA buffer (8 bits per component) with a separable filter. The orientation is
+* applied while writing the destination so the result is always upright. Large images are processed in row bands
+* concurrently.
+* @param destinationWidth Width of the upright destination, for Left and Right orientations this corresponds to the
+* height of the source
+* @param destinationHeight Height of the upright destination
+* @return false if the dimensions are invalid or the intermediate buffers could not be allocated
+*/
+bool IMImageResamplePremultipliedRGBA(const uint8_t *source,
+                                      size_t sourceWidth,
+                                      size_t sourceHeight,
+                                      size_t sourceBytesPerRow,
+                                      uint8_t *destination,
+                                      size_t destinationWidth,
+                                      size_t destinationHeight,
+                                      size_t destinationBytesPerRow,
+                                      IMImageResamplingOrientation orientation,
+                                      IMImageResamplingFilter filter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -116,6 +116,16 @@ typedef NS_ENUM(NSUInteger, URLQueryOptions)
 @end
 
 
+@interface NSMutableData (RequestUtils)
+
+#pragma mark URLEncoding
+
+- (void)appendURLEncodedString:(NSString *)string;
+- (void)appendURLQueryWithParameters:(NSDictionary *)parameters options:(URLQueryOptions)options;
+
+@end
+
+
 @interface NSURL (RequestUtils)
 
 + (instancetype)URLWithComponents:(NSDictionary *)components;
@@ -54,18 +54,152 @@
 @end
 
 
+//bytes left as is by the URL encoder, everything else is percent escaped
+static const BOOL RequestUtilsUnreservedBytes[256] =
+{
+    ['0'] = 1, ['1'] = 1, ['2'] = 1, ['3'] = 1, ['4'] = 1, ['5'] = 1, ['6'] = 1, ['7'] = 1, ['8'] = 1, ['9'] = 1,
+    ['A'] = 1, ['B'] = 1, ['C'] = 1, ['D'] = 1, ['E'] = 1, ['F'] = 1, ['G'] = 1, ['H'] = 1, ['I'] = 1, ['J'] = 1,
+    ['K'] = 1, ['L'] = 1, ['M'] = 1, ['N'] = 1, ['O'] = 1, ['P'] = 1, ['Q'] = 1, ['R'] = 1, ['S'] = 1, ['T'] = 1,
+    ['U'] = 1, ['V'] = 1, ['W'] = 1, ['X'] = 1, ['Y'] = 1, ['Z'] = 1,
+    ['a'] = 1, ['b'] = 1, ['c'] = 1, ['d'] = 1, ['e'] = 1, ['f'] = 1, ['g'] = 1, ['h'] = 1, ['i'] = 1, ['j'] = 1,
+    ['k'] = 1, ['l'] = 1, ['m'] = 1, ['n'] = 1, ['o'] = 1, ['p'] = 1, ['q'] = 1, ['r'] = 1, ['s'] = 1, ['t'] = 1,
+    ['u'] = 1, ['v'] = 1, ['w'] = 1, ['x'] = 1, ['y'] = 1, ['z'] = 1,
+    ['-'] = 1, ['_'] = 1, ['.'] = 1, ['~'] = 1
+};
+
+static const char RequestUtilsHexDigits[16] = "0123456789ABCDEF";
+
+
+@implementation NSMutableData (RequestUtils)
+
+#pragma mark URLEncoding
+
+- (void)appendURLEncodedString:(NSString *)string
+{
+    NSUInteger length = [string length];
+    if (!length)
+    {
+        return;
+    }
+    
+    //short strings are converted to UTF-8 on the stack, longer ones fall back to an autoreleased copy
+    char stackBytes[256];
+    const uint8_t *bytes = (const uint8_t *)stackBytes;
+    NSUInteger byteCount = 0;
+    NSRange remaining;
+    if (![string getBytes:stackBytes maxLength:sizeof(stackBytes) usedLength:&byteCount encoding:NSUTF8StringEncoding
+                  options:(NSStringEncodingConversionOptions)0 range:NSMakeRange(0, length) remainingRange:&remaining] ||
+        remaining.length)
+    {
+        bytes = (const uint8_t *)[string UTF8String];
+        byteCount = bytes ? strlen((const char *)bytes) : 0;
+    }
+    
+    //worst case every byte is escaped
+    NSUInteger offset = [self length];
+    [self increaseLengthBy:byteCount * 3];
+    uint8_t *output = (uint8_t *)[self mutableBytes] + offset;
+    uint8_t *cursor = output;
+    
+    for (NSUInteger i = 0; i < byteCount; i++)
+    {
+        uint8_t byte = bytes[i];
+        if (RequestUtilsUnreservedBytes[byte])
+        {
+            *cursor++ = byte;
+        }
+        else
+        {
+            *cursor++ = '%';
+            *cursor++ = (uint8_t)RequestUtilsHexDigits[byte >> 4];
+            *cursor++ = (uint8_t)RequestUtilsHexDigits[byte & 0x0F];
+        }
+    }
+    
+    [self setLength:offset + (NSUInteger)(cursor - output)];
+}
+
+- (void)appendURLQueryPairWithKey:(NSString *)key value:(id)value arraySyntax:(BOOL)arraySyntax start:(NSUInteger)start
+{
+    if ([self length] > start)
+    {
+        [self appendBytes:"&" length:1];
+    }
+    [self appendURLEncodedString:key];
+    if (arraySyntax)
+    {
+        [self appendBytes:"[]=" length:3];
+    }
+    else
+    {
+        [self appendBytes:"=" length:1];
+    }
+    [self appendURLEncodedString:[value description]];
+}
+
+- (void)appendURLQueryWithParameters:(NSDictionary *)parameters options:(URLQueryOptions)options
+{
+    options = options ?: URLQueryOptionUseArrays;
+    
+    BOOL sortKeys = !!(options & URLQueryOptionSortKeys);
+    if (sortKeys)
+    {
+        options -= URLQueryOptionSortKeys;
+    }
+    
+    BOOL useArraySyntax = !!(options & URLQueryOptionUseArraySyntax);
+    if (useArraySyntax)
+    {
+        options -= URLQueryOptionUseArraySyntax;
+        NSAssert(options == URLQueryOptionUseArrays || options == URLQueryOptionAlwaysUseArrays,
+                 @"URLQueryOptionUseArraySyntax has no effect unless combined with URLQueryOptionUseArrays or URLQueryOptionAlwaysUseArrays option");
+    }
+    
+    NSUInteger start = [self length];
+    NSArray *keys = [parameters allKeys];
+    if (sortKeys) keys = [keys sortedArrayUsingSelector:@selector(compare:)];
+    for (NSString *key in keys)
+    {
+        id value = parameters[key];
+        NSString *keyString = [key description];
+        if ([value isKindOfClass:[NSArray class]])
+        {
+            if (options == URLQueryOptionKeepFirstValue && [value count])
+            {
+                [self appendURLQueryPairWithKey:keyString value:[value firstObject] arraySyntax:NO start:start];
+            }
+            else if (options == URLQueryOptionKeepLastValue && [value count])
+            {
+                [self appendURLQueryPairWithKey:keyString value:[value lastObject] arraySyntax:NO start:start];
+            }
+            else
+            {
+                for (id element in value)
+                {
+                    [self appendURLQueryPairWithKey:keyString value:element arraySyntax:useArraySyntax start:start];
+                }
+            }
+        }
+        else
+        {
+            [self appendURLQueryPairWithKey:keyString value:value
+                                arraySyntax:useArraySyntax && options == URLQueryOptionAlwaysUseArrays start:start];
+        }
+    }
+}
+
+@end
+
+
 @implementation NSString (RequestUtils)
 
 #pragma mark URLEncoding
 
 - (NSString *)URLEncodedString
 {
-    CFStringRef encoded = CFURLCreateStringByAddingPercentEscapes(kCFAllocatorDefault,
-                                                                  (__bridge CFStringRef)[self description],
-                                                                  NULL,
-                                                                  CFSTR("!*'\"();:@&=+$,/?%#[]% "),
-                                                                  kCFStringEncodingUTF8);
-    return CFBridgingRelease(encoded);
+    NSMutableData *encoded = [NSMutableData dataWithCapacity:[self length] * 3];
+    [encoded appendURLEncodedString:[self description]];
+    return [[NSString alloc] initWithData:encoded encoding:NSASCIIStringEncoding];
 }
 
 - (NSString *)URLDecodedString:(BOOL)decodePlusAsSpace
@@ -180,84 +314,9 @@
 
 + (NSString *)URLQueryWithParameters:(NSDictionary *)parameters options:(URLQueryOptions)options
 {
-    options = options ?: URLQueryOptionUseArrays;
-    
-    BOOL sortKeys = !!(options & URLQueryOptionSortKeys);
-    if (sortKeys)
-    {
-        options -= URLQueryOptionSortKeys;
-    }
-    
-    BOOL useArraySyntax = !!(options & URLQueryOptionUseArraySyntax);
-    if (useArraySyntax)
-    {
-        options -= URLQueryOptionUseArraySyntax;
-        NSAssert(options == URLQueryOptionUseArrays || options == URLQueryOptionAlwaysUseArrays,
-                 @"URLQueryOptionUseArraySyntax has no effect unless combined with URLQueryOptionUseArrays or URLQueryOptionAlwaysUseArrays option");
-    }
-  
-    NSMutableString *result = [NSMutableString string];
-    NSArray *keys = [parameters allKeys];
-    if (sortKeys) keys = [keys sortedArrayUsingSelector:@selector(compare:)];
-    for (NSString *key in keys)
-    {
-        id value = parameters[key];
-        NSString *encodedKey = [[key description] URLEncodedString];
-        if ([value isKindOfClass:[NSArray class]])
-        {
-            if (options == URLQueryOptionKeepFirstValue && [value count])
-            {
-                if ([result length])
-                {
-                    [result appendString:@"&"];
-                }
-                [result appendFormat:@"%@=%@", encodedKey, [[[value firstObject] description] URLEncodedString]];
-            }
-            else if (options == URLQueryOptionKeepLastValue && [value count])
-            {
-                if ([result length])
-                {
-                    [result appendString:@"&"];
-                }
-                [result appendFormat:@"%@=%@", encodedKey, [[[value lastObject] description] URLEncodedString]];
-            }
-            else
-            {
-                for (NSString *element in value)
-                {
-                    if ([result length])
-                    {
-                        [result appendString:@"&"];
-                    }
-                    if (useArraySyntax)
-                    {
-                        [result appendFormat:@"%@[]=%@", encodedKey, [[element description] URLEncodedString]];
-                    }
-                    else
-                    {
-                        [result appendFormat:@"%@=%@", encodedKey, [[element description] URLEncodedString]];
-                    }
-                }
-            }
-        }
-        else
-        {
-            if ([result length])
-            {
-                [result appendString:@"&"];
-            }
-            if (useArraySyntax && options == URLQueryOptionAlwaysUseArrays)
-            {
-                [result appendFormat:@"%@[]=%@", encodedKey, [[value description] URLEncodedString]];
-            }
-            else
-            {
-                [result appendFormat:@"%@=%@", encodedKey, [[value description] URLEncodedString]];
-            }
-        }
-    }
-    
-    return result;
+    NSMutableData *query = [NSMutableData dataWithCapacity:[parameters count] * 32];
+    [query appendURLQueryWithParameters:parameters options:options];
+    return [[NSString alloc] initWithData:query encoding:NSASCIIStringEncoding];
 }
 
 - (NSRange)rangeOfURLQuery
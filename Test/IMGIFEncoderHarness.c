@@ -0,0 +1,402 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+// Off device check of the GIF encoder core against an independent decoder that composites frames the way
+// browsers and ImageIO do. It is not part of the Xcode test target, build and run it with any C99 compiler:
+//
+//   cc -std=c99 -O2 -ISource/Core/Util Source/Core/Util/IMGIFEncoderCore.c Test/IMGIFEncoderHarness.c -o gif-harness
+//   ./gif-harness
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "IMGIFEncoderCore.h"
+
+typedef struct {
+    const uint8_t *bytes;
+    size_t length, offset;
+} IMGIFReader;
+
+typedef struct {
+    size_t width, height;
+    size_t frameCount;
+    // straight RGBA of every composited frame, transparent pixels are 0
+    uint32_t *frames;
+} IMGIFDecodedImage;
+
+static int failures = 0;
+
+#define IMGIFCheck(condition, ...) do { \
+    if (!(condition)) { \
+        failures++; \
+        fprintf(stderr, "FAILED %s:%d: ", __FILE__, __LINE__); \
+        fprintf(stderr, __VA_ARGS__); \
+        fprintf(stderr, "\n"); \
+    } \
+} while (0)
+
+static int IMGIFReadByte(IMGIFReader *reader) {
+    return reader->offset < reader->length ? reader->bytes[reader->offset++] : -1;
+}
+
+static int IMGIFReadShort(IMGIFReader *reader) {
+    int low = IMGIFReadByte(reader), high = IMGIFReadByte(reader);
+    return low < 0 || high < 0 ? -1 : low | (high << 8);
+}
+
+// concatenates data sub-blocks, returns the number of bytes read into data
+static size_t IMGIFReadSubBlocks(IMGIFReader *reader, uint8_t *data, size_t capacity) {
+    size_t length = 0;
+    int blockLength;
+
+    while ((blockLength = IMGIFReadByte(reader)) > 0) {
+        for (int i = 0; i < blockLength; i++) {
+            int byte = IMGIFReadByte(reader);
+            if (byte < 0) {
+                return length;
+            }
+            if (data && length < capacity) {
+                data[length] = (uint8_t) byte;
+            }
+            length++;
+        }
+    }
+
+    return length;
+}
+
+static bool IMGIFDecodeLZW(const uint8_t *data, size_t length, int minCodeSize, uint8_t *indices, size_t count) {
+    uint16_t prefixes[4096];
+    uint8_t suffixes[4096], stack[4097];
+    int clearCode = 1 << minCodeSize, endOfInformation = clearCode + 1;
+    int codeSize = minCodeSize + 1, nextCode = endOfInformation + 1, previous = -1;
+    uint32_t bits = 0;
+    int bitCount = 0;
+    size_t offset = 0, written = 0;
+    uint8_t first = 0;
+
+    for (int i = 0; i < clearCode; i++) {
+        prefixes[i] = 0;
+        suffixes[i] = (uint8_t) i;
+    }
+
+    for (;;) {
+        while (bitCount < codeSize) {
+            if (offset == length) {
+                return false;
+            }
+            bits |= (uint32_t) data[offset++] << bitCount;
+            bitCount += 8;
+        }
+
+        int code = (int) (bits & ((1u << codeSize) - 1));
+        bits >>= codeSize;
+        bitCount -= codeSize;
+
+        if (code == clearCode) {
+            codeSize = minCodeSize + 1;
+            nextCode = endOfInformation + 1;
+            previous = -1;
+            continue;
+        }
+
+        if (code == endOfInformation) {
+            return written == count;
+        }
+
+        if (previous < 0) {
+            if (code >= clearCode || written == count) {
+                return false;
+            }
+            indices[written++] = (uint8_t) code;
+            first = (uint8_t) code;
+            previous = code;
+            continue;
+        }
+
+        int current = code, depth = 0;
+        if (code > nextCode || (code >= clearCode && code <= endOfInformation)) {
+            return false;
+        }
+        if (code == nextCode) {
+            stack[depth++] = first;
+            current = previous;
+        }
+        while (current > endOfInformation) {
+            stack[depth++] = suffixes[current];
+            current = prefixes[current];
+        }
+        stack[depth++] = (uint8_t) current;
+        first = (uint8_t) current;
+
+        while (depth > 0) {
+            if (written == count) {
+                return false;
+            }
+            indices[written++] = stack[--depth];
+        }
+
+        if (nextCode < 4096) {
+            prefixes[nextCode] = (uint16_t) previous;
+            suffixes[nextCode] = first;
+            nextCode++;
+            if (nextCode == (1 << codeSize) && codeSize < 12) {
+                codeSize++;
+            }
+        }
+        previous = code;
+    }
+}
+
+static bool IMGIFDecode(const uint8_t *bytes, size_t length, IMGIFDecodedImage *image) {
+    IMGIFReader reader = {bytes, length, 0};
+    memset(image, 0, sizeof(IMGIFDecodedImage));
+
+    if (length < 13 || memcmp(bytes, "GIF89a", 6) != 0) {
+        return false;
+    }
+    reader.offset = 6;
+    image->width = (size_t) IMGIFReadShort(&reader);
+    image->height = (size_t) IMGIFReadShort(&reader);
+    int flags = IMGIFReadByte(&reader);
+    IMGIFReadByte(&reader);
+    IMGIFReadByte(&reader);
+    if (flags & 0x80) {
+        return false;
+    }
+
+    size_t pixelCount = image->width * image->height;
+    uint32_t *canvas = calloc(pixelCount, sizeof(uint32_t));
+    uint8_t *data = malloc(pixelCount * 2 + 1024);
+    uint8_t *indices = malloc(pixelCount);
+    int disposal = 0, transparentIndex = -1;
+
+    for (;;) {
+        int introducer = IMGIFReadByte(&reader);
+
+        if (introducer == 0x3B) {
+            break;
+        } else if (introducer == 0x21) {
+            int label = IMGIFReadByte(&reader);
+            if (label == 0xF9) {
+                IMGIFReadByte(&reader);
+                int packed = IMGIFReadByte(&reader);
+                IMGIFReadShort(&reader);
+                int index = IMGIFReadByte(&reader);
+                IMGIFReadByte(&reader);
+                disposal = (packed >> 2) & 7;
+                transparentIndex = (packed & 1) ? index : -1;
+            } else {
+                IMGIFReadSubBlocks(&reader, NULL, 0);
+            }
+        } else if (introducer == 0x2C) {
+            size_t x = (size_t) IMGIFReadShort(&reader), y = (size_t) IMGIFReadShort(&reader);
+            size_t width = (size_t) IMGIFReadShort(&reader), height = (size_t) IMGIFReadShort(&reader);
+            int packed = IMGIFReadByte(&reader);
+            uint32_t palette[256] = {0};
+
+            if (!(packed & 0x80) || (packed & 0x40) || x + width > image->width || y + height > image->height) {
+                goto fail;
+            }
+            size_t paletteCount = (size_t) 2 << (packed & 7);
+            for (size_t i = 0; i < paletteCount; i++) {
+                uint32_t r = (uint32_t) IMGIFReadByte(&reader), g = (uint32_t) IMGIFReadByte(&reader), b = (uint32_t) IMGIFReadByte(&reader);
+                palette[i] = r | (g << 8) | (b << 16) | 0xFF000000u;
+            }
+
+            int minCodeSize = IMGIFReadByte(&reader);
+            size_t dataLength = IMGIFReadSubBlocks(&reader, data, pixelCount * 2 + 1024);
+            if (minCodeSize < 2 || minCodeSize > 8 || !IMGIFDecodeLZW(data, dataLength, minCodeSize, indices, width * height)) {
+                goto fail;
+            }
+
+            for (size_t row = 0; row < height; row++) {
+                for (size_t column = 0; column < width; column++) {
+                    int index = indices[row * width + column];
+                    if (index != transparentIndex) {
+                        canvas[(y + row) * image->width + x + column] = palette[index];
+                    }
+                }
+            }
+
+            image->frames = realloc(image->frames, (image->frameCount + 1) * pixelCount * sizeof(uint32_t));
+            memcpy(image->frames + image->frameCount * pixelCount, canvas, pixelCount * sizeof(uint32_t));
+            image->frameCount++;
+
+            if (disposal == 2) {
+                for (size_t row = 0; row < height; row++) {
+                    memset(canvas + (y + row) * image->width + x, 0, width * sizeof(uint32_t));
+                }
+            }
+            disposal = 0;
+            transparentIndex = -1;
+        } else {
+            goto fail;
+        }
+    }
+
+    free(canvas);
+    free(data);
+    free(indices);
+    return image->frameCount > 0;
+
+fail:
+    free(canvas);
+    free(data);
+    free(indices);
+    free(image->frames);
+    image->frames = NULL;
+    return false;
+}
+
+static uint8_t *IMGIFEncode(const uint8_t *frames, size_t width, size_t height, size_t frameCount, size_t *length) {
+    IMGIFEncoderState *state = IMGIFEncoderStateCreate(width, height, 0);
+    size_t frameLength = width * height * 4;
+
+    for (size_t i = 0; i < frameCount; i++) {
+        IMGIFCheck(IMGIFEncoderStateAppend(state, frames + i * frameLength, width * 4, 5), "append frame %zu", i);
+    }
+    IMGIFCheck(IMGIFEncoderStateFinish(state), "finish");
+    IMGIFCheck(IMGIFEncoderStateFrameCount(state) == frameCount, "frame count");
+
+    uint8_t *bytes = IMGIFEncoderStateTakeOutput(state, length);
+    IMGIFEncoderStateDestroy(state);
+    return bytes;
+}
+
+static void IMGIFFillRect(uint8_t *frame, size_t width, size_t x, size_t y, size_t rectWidth, size_t rectHeight, uint32_t rgba) {
+    for (size_t row = y; row < y + rectHeight; row++) {
+        for (size_t column = x; column < x + rectWidth; column++) {
+            uint8_t *pixel = frame + (row * width + column) * 4;
+            pixel[0] = (uint8_t) rgba;
+            pixel[1] = (uint8_t) (rgba >> 8);
+            pixel[2] = (uint8_t) (rgba >> 16);
+            pixel[3] = (uint8_t) (rgba >> 24);
+        }
+    }
+}
+
+static uint32_t IMGIFSourcePixel(const uint8_t *frame, size_t index) {
+    const uint8_t *pixel = frame + index * 4;
+    return pixel[3] < 128 ? 0 : pixel[0] | (pixel[1] << 8) | (pixel[2] << 16) | 0xFF000000u;
+}
+
+// frames with few colors have exact palettes and have to decode to the source pixels
+static void IMGIFTestExactRoundTrip(void) {
+    const size_t width = 48, height = 40, frameCount = 5, frameLength = width * height * 4;
+    uint8_t *frames = calloc(frameCount, frameLength);
+
+    for (size_t i = 0; i < frameCount; i++) {
+        uint8_t *frame = frames + i * frameLength;
+        // a static body with a transparent margin and a small moving square, only the square's area changes
+        IMGIFFillRect(frame, width, 4, 4, 40, 32, 0xFF2060C0u);
+        IMGIFFillRect(frame, width, 8 + i * 4, 12, 6, 6, 0xFFF0F0F0u);
+    }
+    // a visible pixel turning transparent requires restore to background on the previous frame
+    IMGIFFillRect(frames + 3 * frameLength, width, 4, 4, 40, 32, 0x00000000u);
+    IMGIFFillRect(frames + 3 * frameLength, width, 20, 20, 8, 8, 0xFF10A040u);
+    // a half transparent premultiplied edge is kept at full opacity with its color unpremultiplied
+    IMGIFFillRect(frames + 4 * frameLength, width, 0, 0, 2, 2, 0xC0600000u);
+
+    size_t length;
+    uint8_t *bytes = IMGIFEncode(frames, width, height, frameCount, &length);
+    IMGIFDecodedImage image;
+
+    IMGIFCheck(IMGIFDecode(bytes, length, &image), "decode exact round trip");
+    IMGIFCheck(image.frameCount == frameCount, "decoded %zu frames", image.frameCount);
+
+    for (size_t i = 0; i < image.frameCount && i < frameCount; i++) {
+        size_t mismatches = 0;
+        for (size_t p = 0; p < width * height; p++) {
+            uint32_t expected = IMGIFSourcePixel(frames + i * frameLength, p);
+            if (i == 4 && p % width < 2 && p / width < 2) {
+                expected = 0xFF800000u;
+            }
+            mismatches += image.frames[i * width * height + p] != expected;
+        }
+        IMGIFCheck(mismatches == 0, "frame %zu has %zu mismatching pixels", i, mismatches);
+    }
+
+    printf("exact round trip: %zu frames of %zux%zu in %zu bytes (%zu bytes uncompressed)\n", frameCount, width, height, length, frameCount * frameLength);
+
+    free(image.frames);
+    free(bytes);
+    free(frames);
+}
+
+// a gradient with more than 256 colors goes through median cut and has to stay close to the source
+static void IMGIFTestQuantizedRoundTrip(void) {
+    const size_t width = 128, height = 128, frameCount = 3, frameLength = width * height * 4;
+    uint8_t *frames = calloc(frameCount, frameLength);
+
+    for (size_t i = 0; i < frameCount; i++) {
+        for (size_t y = 0; y < height; y++) {
+            for (size_t x = 0; x < width; x++) {
+                uint8_t *pixel = frames + i * frameLength + (y * width + x) * 4;
+                pixel[0] = (uint8_t) (x * 2);
+                pixel[1] = (uint8_t) (y * 2);
+                pixel[2] = (uint8_t) ((x + y + i * 16) & 0xFF);
+                pixel[3] = 0xFF;
+            }
+        }
+    }
+
+    size_t length;
+    uint8_t *bytes = IMGIFEncode(frames, width, height, frameCount, &length);
+    IMGIFDecodedImage image;
+
+    IMGIFCheck(IMGIFDecode(bytes, length, &image), "decode quantized round trip");
+    IMGIFCheck(image.frameCount == frameCount, "decoded %zu frames", image.frameCount);
+
+    for (size_t i = 0; i < image.frameCount && i < frameCount; i++) {
+        uint64_t error = 0;
+        int maximumError = 0;
+        for (size_t p = 0; p < width * height; p++) {
+            uint32_t expected = IMGIFSourcePixel(frames + i * frameLength, p), actual = image.frames[i * width * height + p];
+            for (int shift = 0; shift < 24; shift += 8) {
+                int difference = abs((int) ((expected >> shift) & 0xFF) - (int) ((actual >> shift) & 0xFF));
+                error += (uint64_t) difference;
+                maximumError = difference > maximumError ? difference : maximumError;
+            }
+            IMGIFCheck((actual >> 24) == 0xFF, "frame %zu pixel %zu is opaque", i, p);
+        }
+        double meanError = (double) error / (width * height * 3);
+        IMGIFCheck(meanError < 6.0 && maximumError < 48, "frame %zu mean error %.2f maximum error %d", i, meanError, maximumError);
+    }
+
+    printf("quantized round trip: %zu frames of %zux%zu in %zu bytes\n", frameCount, width, height, length);
+
+    free(image.frames);
+    free(bytes);
+    free(frames);
+}
+
+int main(void) {
+    IMGIFTestExactRoundTrip();
+    IMGIFTestQuantizedRoundTrip();
+
+    printf(failures ? "%d checks FAILED\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
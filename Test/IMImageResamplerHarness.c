@@ -0,0 +1,195 @@
+//
+//  ImojiSDK
+//
+//  Created by Nima Khoshini
+//  Copyright (C) 2015 Imoji
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+//  IN THE SOFTWARE.
+//
+
+// Off device check of the resampler against a double precision reference. It is not part of the Xcode test target,
+// build and run it with any C99 compiler:
+//
+//   cc -std=c99 -O2 -ISource/Core/Util Source/Core/Util/IMImageResampler.c Test/IMImageResamplerHarness.c -lm -o resampler-harness
+//   ./resampler-harness
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "IMImageResampler.h"
+
+static int failures = 0;
+
+#define IMResampleCheck(condition, ...) do { \
+    if (!(condition)) { \
+        failures++; \
+        fprintf(stderr, "FAILED %s:%d: ", __FILE__, __LINE__); \
+        fprintf(stderr, __VA_ARGS__); \
+        fprintf(stderr, "\n"); \
+    } \
+} while (0)
+
+static const char *IMResampleOrientationNames[] = {
+        "Up", "Down", "Left", "Right", "UpMirrored", "DownMirrored", "LeftMirrored", "RightMirrored"
+};
+
+// maps an upright pixel to the source pixel it is displayed from, following the UIImageOrientation definitions
+static void IMResampleSourcePoint(IMImageResamplingOrientation orientation, size_t width, size_t height, size_t x, size_t y, size_t *sourceX, size_t *sourceY) {
+    switch (orientation) {
+        case IMImageResamplingOrientationUp: *sourceX = x; *sourceY = y; break;
+        case IMImageResamplingOrientationDown: *sourceX = width - 1 - x; *sourceY = height - 1 - y; break;
+        case IMImageResamplingOrientationLeft: *sourceX = width - 1 - y; *sourceY = x; break;
+        case IMImageResamplingOrientationRight: *sourceX = y; *sourceY = height - 1 - x; break;
+        case IMImageResamplingOrientationUpMirrored: *sourceX = width - 1 - x; *sourceY = y; break;
+        case IMImageResamplingOrientationDownMirrored: *sourceX = x; *sourceY = height - 1 - y; break;
+        case IMImageResamplingOrientationLeftMirrored: *sourceX = y; *sourceY = x; break;
+        case IMImageResamplingOrientationRightMirrored: *sourceX = width - 1 - y; *sourceY = height - 1 - x; break;
+    }
+}
+
+// rotates the source upright first and then averages the exact coverage of every destination pixel
+static void IMResampleReferenceArea(const uint8_t *source, size_t width, size_t height, IMImageResamplingOrientation orientation,
+        uint8_t *destination, size_t destinationWidth, size_t destinationHeight) {
+    bool transposed = orientation >= IMImageResamplingOrientationLeft && orientation != IMImageResamplingOrientationUpMirrored &&
+            orientation != IMImageResamplingOrientationDownMirrored;
+    size_t uprightWidth = transposed ? height : width, uprightHeight = transposed ? width : height;
+    uint8_t *upright = malloc(uprightWidth * uprightHeight * 4);
+
+    for (size_t y = 0; y < uprightHeight; y++) {
+        for (size_t x = 0; x < uprightWidth; x++) {
+            size_t sourceX, sourceY;
+            IMResampleSourcePoint(orientation, width, height, x, y, &sourceX, &sourceY);
+            memcpy(upright + (y * uprightWidth + x) * 4, source + (sourceY * width + sourceX) * 4, 4);
+        }
+    }
+
+    double scaleX = (double) uprightWidth / destinationWidth, scaleY = (double) uprightHeight / destinationHeight;
+    for (size_t y = 0; y < destinationHeight; y++) {
+        for (size_t x = 0; x < destinationWidth; x++) {
+            double low[2] = {x * scaleX, y * scaleY}, high[2] = {(x + 1) * scaleX, (y + 1) * scaleY};
+            double sums[4] = {0}, total = 0;
+
+            for (size_t sy = (size_t) low[1]; sy < uprightHeight && sy < high[1]; sy++) {
+                double coverageY = (sy + 1 < high[1] ? sy + 1 : high[1]) - (sy > low[1] ? sy : low[1]);
+                for (size_t sx = (size_t) low[0]; sx < uprightWidth && sx < high[0]; sx++) {
+                    double coverage = coverageY * ((sx + 1 < high[0] ? sx + 1 : high[0]) - (sx > low[0] ? sx : low[0]));
+                    for (int c = 0; c < 4; c++) {
+                        sums[c] += coverage * upright[(sy * uprightWidth + sx) * 4 + c];
+                    }
+                    total += coverage;
+                }
+            }
+
+            for (int c = 0; c < 4; c++) {
+                destination[(y * destinationWidth + x) * 4 + c] = (uint8_t) (sums[c] / total + 0.5);
+            }
+        }
+    }
+
+    free(upright);
+}
+
+// premultiplied noise over smooth gradients so both edges and flat areas are covered
+static uint8_t *IMResampleSourcePixels(size_t width, size_t height) {
+    uint8_t *pixels = malloc(width * height * 4);
+    uint32_t seed = 12345;
+
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            seed = seed * 1103515245u + 12345u;
+            uint8_t *pixel = pixels + (y * width + x) * 4;
+            uint32_t alpha = (x / 16 + y / 16) % 3 == 0 ? 255 : (seed >> 24);
+            pixel[0] = (uint8_t) ((x * 255 / width) * alpha / 255);
+            pixel[1] = (uint8_t) ((y * 255 / height) * alpha / 255);
+            pixel[2] = (uint8_t) (((seed >> 8) & 0xFF) * alpha / 255);
+            pixel[3] = (uint8_t) alpha;
+        }
+    }
+
+    return pixels;
+}
+
+static void IMResampleTestAreaOrientations(size_t width, size_t height, size_t destinationWidth, size_t destinationHeight) {
+    uint8_t *source = IMResampleSourcePixels(width, height);
+    size_t length = destinationWidth * destinationHeight * 4;
+    uint8_t *actual = malloc(length), *expected = malloc(length);
+
+    for (int orientation = IMImageResamplingOrientationUp; orientation <= IMImageResamplingOrientationRightMirrored; orientation++) {
+        IMResampleCheck(IMImageResamplePremultipliedRGBA(source, width, height, width * 4, actual, destinationWidth, destinationHeight,
+                destinationWidth * 4, (IMImageResamplingOrientation) orientation, IMImageResamplingFilterArea), "resample");
+        IMResampleReferenceArea(source, width, height, (IMImageResamplingOrientation) orientation, expected, destinationWidth, destinationHeight);
+
+        int maximumError = 0;
+        for (size_t i = 0; i < length; i++) {
+            int difference = abs((int) actual[i] - (int) expected[i]);
+            maximumError = difference > maximumError ? difference : maximumError;
+        }
+
+        // the horizontal pass is rounded to 8 bits before the vertical one
+        IMResampleCheck(maximumError <= 1, "%zux%zu to %zux%zu %s maximum error %d", width, height, destinationWidth, destinationHeight,
+                IMResampleOrientationNames[orientation], maximumError);
+    }
+
+    printf("area %zux%zu to %zux%zu matches the reference in all orientations\n", width, height, destinationWidth, destinationHeight);
+
+    free(source);
+    free(actual);
+    free(expected);
+}
+
+// Lanczos3 at the same size only samples at its zero crossings, the result has to be the oriented source
+static void IMResampleTestLanczosIdentity(void) {
+    const size_t width = 37, height = 23;
+    uint8_t *source = IMResampleSourcePixels(width, height);
+    uint8_t *actual = malloc(width * height * 4);
+
+    for (int orientation = IMImageResamplingOrientationUp; orientation <= IMImageResamplingOrientationRightMirrored; orientation++) {
+        bool transposed = orientation >= IMImageResamplingOrientationLeft && orientation != IMImageResamplingOrientationUpMirrored &&
+                orientation != IMImageResamplingOrientationDownMirrored;
+        size_t uprightWidth = transposed ? height : width, uprightHeight = transposed ? width : height;
+
+        IMResampleCheck(IMImageResamplePremultipliedRGBA(source, width, height, width * 4, actual, uprightWidth, uprightHeight,
+                uprightWidth * 4, (IMImageResamplingOrientation) orientation, IMImageResamplingFilterLanczos3), "resample");
+
+        size_t mismatches = 0;
+        for (size_t y = 0; y < uprightHeight; y++) {
+            for (size_t x = 0; x < uprightWidth; x++) {
+                size_t sourceX, sourceY;
+                IMResampleSourcePoint((IMImageResamplingOrientation) orientation, width, height, x, y, &sourceX, &sourceY);
+                mismatches += memcmp(actual + (y * uprightWidth + x) * 4, source + (sourceY * width + sourceX) * 4, 4) != 0;
+            }
+        }
+        IMResampleCheck(mismatches == 0, "Lanczos3 identity %s has %zu mismatching pixels", IMResampleOrientationNames[orientation], mismatches);
+    }
+
+    printf("Lanczos3 at the same size reproduces the source in all orientations\n");
+
+    free(source);
+    free(actual);
+}
+
+int main(void) {
+    IMResampleTestAreaOrientations(64, 48, 16, 12);
+    IMResampleTestAreaOrientations(300, 200, 70, 45);
+    IMResampleTestAreaOrientations(301, 199, 41, 97);
+    IMResampleTestLanczosIdentity();
+
+    printf(failures ? "%d checks FAILED\n" : "all checks passed\n", failures);
+    return failures ? 1 : 0;
+}
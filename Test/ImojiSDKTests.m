@@ -8,10 +8,32 @@
 
 #import <UIKit/UIKit.h>
 #import <XCTest/XCTest.h>
+#import <ImageIO/ImageIO.h>
+#import <MobileCoreServices/MobileCoreServices.h>
+#import <mach/mach.h>
+#import <YYImage_MagicNarwhal/YYImage.h>
 #import "ImojiSyncSDK.h"
 #import "IMImojiSession+Testing.h"
 #import "BFTask.h"
 #import "BFTaskCompletionSource.h"
+#import "IMGIFEncoder.h"
+#import "IMImageResampler.h"
+#import "UIImage+Extensions.h"
+#import "IMAnalyticsSpool.h"
+#import "IMAnalyticsPipeline.h"
+#import "IMRequestTemplate.h"
+#import "IMImojiResponse.h"
+#import "IMSharedResourceRegistry.h"
+#import "IMImageMemoryCache.h"
+#import "IMRenditionSelector.h"
+#import "IMWriteBehindQueue.h"
+#import "IMMutationOutbox.h"
+#import "IMImageUploadTask.h"
+#import "NSError+Utils.h"
+#import "IMMutableImojiObject.h"
+#import "IMImojiSession+Private.h"
+#import "IMImojiSessionCredentials.h"
+#import "RequestUtils.h"
 
 @interface ImojiSDKTestData : NSObject
 
@@ -243,6 +265,21 @@
     XCTAssert(error != nil, @"app is not installed, there should be an error");
 }
 
+- (void)test_1_11_prewarm {
+    BFTaskCompletionSource *source = [BFTaskCompletionSource taskCompletionSource];
+    IMImojiSession *session = [IMImojiSession imojiSession];
+
+    [session prewarmWithOptions:IMImojiSessionPrewarmOptionsFeatured | IMImojiSessionPrewarmOptionsCategories
+                       callback:^(BOOL successful, NSError *error) {
+                           XCTAssert(successful && error == nil, @"prewarm");
+                           XCTAssertEqual(session.sessionState, IMImojiSessionStateConnected, @"session connected after prewarm");
+
+                           source.result = @YES;
+                       }];
+
+    [self runTestWithTask:source.task];
+}
+
 - (void)test_2_1_RenderSingleImojiTest {
     [self measureBlock:^{
         IMImojiObject *imoji = self.testData.imojis.firstObject;
@@ -268,6 +305,1867 @@
     }];
 }
 
+- (void)test_3_1_GIFEncoderTest {
+    NSArray *frames = [self syntheticAnimationFramesWithSize:CGSizeMake(320, 320) frameCount:24];
+    __block NSUInteger gifLength = 0;
+
+    [self measureBlock:^{
+        IMGIFEncoder *encoder = [[IMGIFEncoder alloc] initWithWidth:320 height:320 loopCount:0];
+        for (UIImage *frame in frames) {
+            XCTAssert([encoder appendFrameWithCGImage:frame.CGImage delay:.05], @"append gif frame");
+        }
+
+        NSData *gifData = [encoder finish];
+        XCTAssertNotNil(gifData, @"gif data");
+        gifLength = gifData.length;
+
+        CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef) gifData, NULL);
+        XCTAssertEqual(CGImageSourceGetCount(source), frames.count, @"decoded gif frame count");
+        CFRelease(source);
+    }];
+
+    NSLog(@"IMGIFEncoder: %lu frames in %lu bytes", (unsigned long) frames.count, (unsigned long) gifLength);
+}
+
+- (void)test_3_2_ImageIOGIFEncoderBaselineTest {
+    NSArray *frames = [self syntheticAnimationFramesWithSize:CGSizeMake(320, 320) frameCount:24];
+    __block NSUInteger gifLength = 0;
+
+    [self measureBlock:^{
+        NSMutableData *gifData = [NSMutableData data];
+        CGImageDestinationRef destination = CGImageDestinationCreateWithData((__bridge CFMutableDataRef) gifData, kUTTypeGIF, frames.count, NULL);
+
+        for (UIImage *frame in frames) {
+            NSDictionary *frameProperties = @{(__bridge NSString *) kCGImagePropertyGIFDictionary : @{
+                    (__bridge NSString *) kCGImagePropertyGIFDelayTime : @.05
+            }};
+            CGImageDestinationAddImage(destination, frame.CGImage, (__bridge CFDictionaryRef) frameProperties);
+        }
+
+        XCTAssert(CGImageDestinationFinalize(destination), @"ImageIO gif export");
+        CFRelease(destination);
+        gifLength = gifData.length;
+    }];
+
+    NSLog(@"ImageIO: %lu frames in %lu bytes", (unsigned long) frames.count, (unsigned long) gifLength);
+}
+
+- (void)test_3_3_ResampleImageTest {
+    UIImage *image = [self syntheticPhotoWithSize:CGSizeMake(3000, 2000) orientation:UIImageOrientationRight];
+
+    UIImage *resizedImage = [image im_resizedImageToFitInSize:CGSizeMake(150.f, 150.f) scaleIfSmaller:NO];
+    XCTAssertEqual(resizedImage.size.width, 100.f, @"resized image is upright");
+    XCTAssertEqual(resizedImage.size.height, 150.f, @"resized image is upright");
+
+    [self measureBlock:^{
+        [image im_resizedImageToFitInSize:CGSizeMake(150.f, 150.f) scaleIfSmaller:NO];
+        [image im_resizedImageToFitInSize:CGSizeMake(1024.f, 1024.f) scaleIfSmaller:NO];
+    }];
+}
+
+- (void)test_3_4_RedrawImageBaselineTest {
+    UIImage *image = [self syntheticPhotoWithSize:CGSizeMake(3000, 2000) orientation:UIImageOrientationRight];
+
+    [self measureBlock:^{
+        [image im_redrawnImageToSize:CGSizeMake(150.f, 100.f)];
+        [image im_redrawnImageToSize:CGSizeMake(1024.f, 682.f)];
+    }];
+}
+
+- (void)test_3_5_AnalyticsSpoolTest {
+    NSURL *spoolURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"analytics-test.spool"]];
+    [[NSFileManager defaultManager] removeItemAtURL:spoolURL error:nil];
+
+    [self measureBlock:^{
+        IMAnalyticsSpool *spool = [[IMAnalyticsSpool alloc] initWithFileURL:spoolURL capacity:512 slotSize:256];
+        for (NSUInteger i = 0; i < 1000; i++) {
+            [spool appendRecord:@{@"m" : @"GET", @"p" : @"/analytics/imoji/sent", @"q" : @{@"imojiId" : [NSString stringWithFormat:@"%@", @(i)]}}];
+        }
+
+        XCTAssertEqual(spool.count, 512, @"spool wraps around once full");
+        XCTAssertEqualObjects([spool peekRecords:1].firstObject[@"q"][@"imojiId"], @"488", @"oldest records are overwritten");
+
+        while (spool.count > 0) {
+            [spool consumeRecords:[spool peekRecords:20].count];
+        }
+    }];
+}
+
+- (void)test_3_6_SessionStartupTest {
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 20; i++) {
+            IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:[IMImojiSessionStoragePolicy temporaryDiskStoragePolicy]];
+            XCTAssertNotNil(session, @"session construction");
+        }
+    }];
+}
+
+- (void)test_3_7_GIFEncoderRoundTripTest {
+    const size_t width = 48, height = 40, frameCount = 5, bytesPerRow = width * 4;
+    NSMutableArray<NSMutableData *> *frames = [NSMutableArray arrayWithCapacity:frameCount];
+
+    // a static body inside a transparent margin with a small moving square, later frames only encode the square
+    for (size_t i = 0; i < frameCount; i++) {
+        NSMutableData *frame = [NSMutableData dataWithLength:bytesPerRow * height];
+        [self fillPixels:frame bytesPerRow:bytesPerRow rect:CGRectMake(4, 4, 40, 32) rgba:0xFF2060C0u];
+        [self fillPixels:frame bytesPerRow:bytesPerRow rect:CGRectMake(8 + i * 4, 12, 6, 6) rgba:0xFFF0F0F0u];
+        [frames addObject:frame];
+    }
+    // visible pixels turning transparent have to be cleared by the previous frame's disposal
+    [self fillPixels:frames[3] bytesPerRow:bytesPerRow rect:CGRectMake(4, 4, 40, 32) rgba:0x00000000u];
+    [self fillPixels:frames[3] bytesPerRow:bytesPerRow rect:CGRectMake(20, 20, 8, 8) rgba:0xFF10A040u];
+
+    IMGIFEncoder *encoder = [[IMGIFEncoder alloc] initWithWidth:width height:height loopCount:0];
+    for (NSData *frame in frames) {
+        XCTAssert([encoder appendFrameWithPremultipliedRGBA:frame.bytes bytesPerRow:bytesPerRow delay:.05], @"append gif frame");
+    }
+    NSData *gifData = [encoder finish];
+
+    CGImageSourceRef source = CGImageSourceCreateWithData((__bridge CFDataRef) gifData, NULL);
+    XCTAssertEqual(CGImageSourceGetCount(source), frameCount, @"decoded gif frame count");
+
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    for (size_t i = 0; i < MIN(frameCount, CGImageSourceGetCount(source)); i++) {
+        NSMutableData *decoded = [NSMutableData dataWithLength:bytesPerRow * height];
+        CGImageRef image = CGImageSourceCreateImageAtIndex(source, i, NULL);
+        CGContextRef context = CGBitmapContextCreate(decoded.mutableBytes, width, height, 8, bytesPerRow, colorSpace,
+                kCGImageAlphaPremultipliedLast | kCGBitmapByteOrderDefault);
+        CGContextDrawImage(context, CGRectMake(0, 0, width, height), image);
+        CGContextRelease(context);
+        CGImageRelease(image);
+
+        // frames have few colors and binary alpha so every pixel has to survive, allowing for color matching
+        const uint8_t *expected = frames[i].bytes, *actual = decoded.bytes;
+        NSUInteger mismatches = 0;
+        for (size_t p = 0; p < width * height * 4; p++) {
+            mismatches += abs((int) expected[p] - (int) actual[p]) > 2;
+        }
+        XCTAssertEqual(mismatches, 0, @"frame %lu pixels", (unsigned long) i);
+    }
+    CGColorSpaceRelease(colorSpace);
+    CFRelease(source);
+}
+
+- (void)test_3_8_ResamplePixelsTest {
+    // a 64x32 source with a differently colored quadrant in each corner
+    const size_t width = 64, height = 32;
+    const uint32_t quadrants[4] = {0xFF0000FFu, 0xFF00FF00u, 0xFFFF0000u, 0xFFFFFFFFu};
+    NSMutableData *pixels = [NSMutableData dataWithLength:width * height * 4];
+    for (NSUInteger quadrant = 0; quadrant < 4; quadrant++) {
+        [self fillPixels:pixels bytesPerRow:width * 4
+                    rect:CGRectMake(quadrant % 2 * width / 2, quadrant / 2 * height / 2, width / 2, height / 2)
+                    rgba:quadrants[quadrant]];
+    }
+
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef sourceContext = CGBitmapContextCreate(pixels.mutableBytes, width, height, 8, width * 4, colorSpace,
+            kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big);
+    CGImageRef sourceImage = CGBitmapContextCreateImage(sourceContext);
+    CGContextRelease(sourceContext);
+
+    for (UIImageOrientation orientation = UIImageOrientationUp; orientation <= UIImageOrientationRightMirrored; orientation++) {
+        UIImage *image = [UIImage imageWithCGImage:sourceImage scale:1.f orientation:orientation];
+        UIImage *resizedImage = [image im_resizedImageToFitInSize:CGSizeMake(16.f, 16.f) scaleIfSmaller:NO];
+
+        BOOL transposed = orientation == UIImageOrientationLeft || orientation == UIImageOrientationRight ||
+                orientation == UIImageOrientationLeftMirrored || orientation == UIImageOrientationRightMirrored;
+        size_t resizedWidth = CGImageGetWidth(resizedImage.CGImage), resizedHeight = CGImageGetHeight(resizedImage.CGImage);
+        XCTAssertEqual(resizedImage.imageOrientation, UIImageOrientationUp);
+        XCTAssertEqual(resizedWidth, transposed ? 8 : 16, @"orientation %ld width", (long) orientation);
+        XCTAssertEqual(resizedHeight, transposed ? 16 : 8, @"orientation %ld height", (long) orientation);
+
+        NSMutableData *resized = [NSMutableData dataWithLength:resizedWidth * resizedHeight * 4];
+        CGContextRef context = CGBitmapContextCreate(resized.mutableBytes, resizedWidth, resizedHeight, 8, resizedWidth * 4, colorSpace,
+                kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big);
+        CGContextDrawImage(context, CGRectMake(0, 0, resizedWidth, resizedHeight), resizedImage.CGImage);
+        CGContextRelease(context);
+
+        // the center of each upright quadrant has to show the source quadrant UIImageOrientation maps it from
+        for (NSUInteger quadrant = 0; quadrant < 4; quadrant++) {
+            CGFloat u = quadrant % 2 ? .75f : .25f, v = quadrant / 2 ? .75f : .25f;
+            CGPoint sourcePoint = [self sourcePointForUprightPoint:CGPointMake(u, v) orientation:orientation];
+            uint32_t expected = quadrants[(sourcePoint.x > .5f ? 1 : 0) + (sourcePoint.y > .5f ? 2 : 0)];
+
+            const uint8_t *pixel = (const uint8_t *) resized.bytes + ((size_t) (v * resizedHeight) * resizedWidth + (size_t) (u * resizedWidth)) * 4;
+            uint32_t actual = pixel[0] | (pixel[1] << 8) | (pixel[2] << 16) | ((uint32_t) pixel[3] << 24);
+            XCTAssertEqual(actual, expected, @"orientation %ld quadrant %lu", (long) orientation, (unsigned long) quadrant);
+        }
+    }
+
+    CGImageRelease(sourceImage);
+    CGColorSpaceRelease(colorSpace);
+}
+
+- (void)test_4_1_LoopbackTransportTest {
+    BFTaskCompletionSource *source = [BFTaskCompletionSource taskCompletionSource];
+    IMLoopbackTransport *transport = [self loopbackTransportWithImojiCount:10];
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:[self isolatedStoragePolicy] transport:transport];
+
+    [session getImojiCategoriesWithOptions:[IMCategoryFetchOptions optionsWithClassification:IMImojiSessionCategoryClassificationGeneric]
+                                  callback:^(NSArray *imojiCategories, NSError *error) {
+                                      XCTAssertNil(error, @"categories from loopback transport");
+                                      XCTAssertEqual(imojiCategories.count, 10, @"categories from loopback transport");
+                                      XCTAssert(transport.requestCount > 0, @"requests served by loopback transport");
+
+                                      source.result = @YES;
+                                  }];
+
+    [self runTestWithTask:source.task];
+}
+
+- (void)test_4_2_SessionMetricsTest {
+    IMLoopbackTransport *transport = [self loopbackTransportWithImojiCount:10];
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:[self isolatedStoragePolicy] transport:transport];
+
+    [self runTestWithTask:[self firstSearchCallbackWithSession:session term:@"metrics"]];
+
+    IMImojiSessionMetrics *metrics = session.metricsSnapshot;
+    IMImojiEndpointMetrics *search = metrics.endpoints[@"/imoji/search"];
+    XCTAssertEqual(search.latency.count, 1, @"search request recorded");
+    XCTAssertEqual(search.errorCount, 0, @"search request succeeded");
+    XCTAssert(search.bytesReceived > 0, @"search response bytes recorded");
+    XCTAssertNotNil(metrics.endpoints[@"/oauth/token"], @"token request recorded");
+    XCTAssert(metrics.phases[@"jsonParsing"].count >= 2, @"response parsing recorded");
+    XCTAssert(metrics.phases[@"tokenValidation"].count >= 1, @"token validation recorded");
+    XCTAssertNotNil([NSJSONSerialization dataWithJSONObject:[metrics dictionaryRepresentation] options:0 error:nil], @"snapshot serializes to JSON");
+
+    [session resetMetrics];
+    XCTAssertEqual(session.metricsSnapshot.endpoints[@"/imoji/search"].latency.count, 0, @"metrics reset");
+}
+
+- (void)test_4_3_TracingTest {
+    IMLoopbackTransport *transport = [self loopbackTransportWithImojiCount:10];
+    transport.latency = .01;
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:[self isolatedStoragePolicy] transport:transport];
+    session.tracingEnabled = YES;
+
+    BFTaskCompletionSource *source = [BFTaskCompletionSource taskCompletionSource];
+    [session searchImojisWithTerm:@"trace"
+                           offset:nil
+              contributingImojiId:nil
+                  numberOfResults:@1
+        resultSetResponseCallback:^(IMImojiResultSetMetadata *metadata, NSError *error) {
+            if (error) {
+                [source trySetError:error];
+            }
+        }
+            imojiResponseCallback:^(IMImojiObject *imoji, NSUInteger index, NSError *error) {
+                [session renderImoji:imoji
+                             options:[IMImojiObjectRenderingOptions optionsWithRenderSize:IMImojiObjectRenderSizeThumbnail]
+                            callback:^(UIImage *image, NSError *renderError) {
+                                XCTAssertNotNil(image, @"traced render");
+                                [source trySetResult:@YES];
+                            }];
+            }];
+    [self runTestWithTask:source.task];
+
+    NSDictionary *trace = [NSJSONSerialization JSONObjectWithData:session.traceData options:0 error:nil];
+    NSArray *events = trace[@"traceEvents"];
+    NSSet *names = [NSSet setWithArray:[events valueForKey:@"name"]];
+
+    XCTAssert([names containsObject:@"searchImojis"], @"search span recorded");
+    XCTAssert([names containsObject:@"renderImoji"], @"render span recorded");
+    for (NSString *stage in @[@"validateSession", @"apiRequest", @"resultCallback", @"downloadImojiContents", @"downloadImojiImage", @"imageRequest", @"decodeImage", @"renderCallback"]) {
+        XCTAssert([names containsObject:stage], @"%@ stage recorded", stage);
+    }
+
+    IMImojiSession *untracedSession = [IMImojiSession imojiSessionWithStoragePolicy:[self isolatedStoragePolicy] transport:transport];
+    XCTAssertEqual([[NSJSONSerialization JSONObjectWithData:untracedSession.traceData options:0 error:nil][@"traceEvents"] count], 0, @"tracing is opt-in");
+}
+
+- (void)test_4_4_RequestTemplateTest {
+    XCTAssertEqualObjects([@"a-z_0.9~ &=+/?%#\u00e9" URLEncodedString], @"a-z_0.9~%20%26%3D%2B%2F%3F%25%23%C3%A9");
+    XCTAssertEqualObjects([NSString URLQueryWithParameters:@{@"ids" : @[@"1", @"2"], @"q" : @"cat"} options:URLQueryOptionSortKeys],
+            @"ids=1&ids=2&q=cat");
+
+    IMRequestTemplate *getTemplate = [[IMRequestTemplate alloc] initWithURLString:@"https://api.imoji.io/v2/imoji/search" method:@"GET"];
+    NSMutableURLRequest *getRequest = [getTemplate requestWithParameters:@{@"query" : @"happy cat"} additionalHeaders:@{@"Authorization" : @"Basic abc"}];
+    XCTAssertEqualObjects(getRequest.URL.absoluteString, @"https://api.imoji.io/v2/imoji/search?query=happy%20cat");
+    XCTAssertEqualObjects(getRequest.HTTPMethod, @"GET");
+    XCTAssertNotNil(getRequest.allHTTPHeaderFields[@"Imoji-SDK-Version"]);
+    XCTAssertEqualObjects(getRequest.allHTTPHeaderFields[@"Authorization"], @"Basic abc");
+    XCTAssertNil(getTemplate.headers[@"Authorization"], @"additional headers don't leak into the template");
+    XCTAssertEqualObjects([getTemplate requestWithParameters:@{} additionalHeaders:nil].URL, getTemplate.URL);
+
+    IMRequestTemplate *postTemplate = [[IMRequestTemplate alloc] initWithURLString:@"https://api.imoji.io/v2/imoji/reportAbusive" method:@"POST"];
+    NSMutableURLRequest *postRequest = [postTemplate requestWithParameters:@{@"imojiId" : @"a b"} additionalHeaders:nil];
+    XCTAssertEqualObjects(postRequest.URL, postTemplate.URL);
+    XCTAssertEqualObjects([[NSString alloc] initWithData:postRequest.HTTPBody encoding:NSUTF8StringEncoding], @"imojiId=a%20b");
+    XCTAssertEqualObjects(postRequest.allHTTPHeaderFields[@"Content-Type"], @"application/x-www-form-urlencoded");
+
+    NSUInteger localeGeneration = [IMRequestTemplate currentLocaleGeneration];
+    XCTAssertEqual(getTemplate.localeGeneration, localeGeneration);
+    [[NSNotificationCenter defaultCenter] postNotificationName:NSCurrentLocaleDidChangeNotification object:nil];
+    XCTAssertEqual([IMRequestTemplate currentLocaleGeneration], localeGeneration + 1, @"locale changes invalidate templates");
+}
+
+- (void)test_4_5_ResponseDecoderTest {
+    NSDictionary *attribution = @{
+            @"packId" : @"pack",
+            @"packURL" : @"https://imoji.io/pack",
+            @"packURLCategory" : @"instagram",
+            @"relatedTags" : @[@"related"],
+            @"licenseStyle" : @"commercialPrint",
+            @"id" : @"artist",
+            @"name" : @"Artist",
+            @"description" : @"Caf\u00e9 \"quoted\"",
+            @"images" : [self currentFormatImojiWithIdentifier:@"artist"][@"images"]
+    };
+
+    // pre v2.1 categories are imojis themselves, readCategories: only looks for that when an images key is present
+    NSMutableDictionary *legacyCategory = [[self loopbackImojiWithIdentifier:@"legacy-category"] mutableCopy];
+    [legacyCategory addEntriesFromDictionary:@{@"searchText" : @"legacy", @"title" : @"Legacy", @"priority" : @2, @"images" : [NSNull null]}];
+
+    NSArray *categories = @[
+            @{@"searchText" : @"happy", @"title" : @"Happy", @"priority" : @1, @"artist" : attribution,
+                    @"imojis" : @[[self currentFormatImojiWithIdentifier:@"preview1"], [self currentFormatImojiWithIdentifier:@"preview2"]]},
+            @{@"searchText" : @"sad", @"title" : @"Sad", @"artist" : [NSNull null], @"imojis" : @[]},
+            legacyCategory
+    ];
+
+    NSDictionary *payload = @{
+            @"status" : @"SUCCESS",
+            @"followupSearchTerm" : @"more \u2603",
+            @"results" : @[[self currentFormatImojiWithIdentifier:@"current"], [self loopbackImojiWithIdentifier:@"legacy-imoji"], @{@"id" : @"bare"}],
+            @"relatedCategories" : categories,
+            @"categories" : categories,
+            @"attribution" : @{@"current" : attribution},
+            @"unknown" : @{@"nested" : @[@1, @"]}", @{@"images" : @[]}]}
+    };
+
+    NSData *data = [NSJSONSerialization dataWithJSONObject:payload options:0 error:nil];
+    NSDictionary *json = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:[self isolatedStoragePolicy] transport:[IMLoopbackTransport new]];
+
+    NSError *error;
+    IMImojiResponse *response = [IMImojiResponse responseWithData:data error:&error];
+    XCTAssertNil(error, @"decodes");
+    XCTAssertEqualObjects(response.status, @"SUCCESS");
+    XCTAssertEqualObjects(response.followupSearchTerm, json[@"followupSearchTerm"]);
+
+    NSArray *expectedImojis = [session convertServerDataSetToImojiArray:json];
+    XCTAssertEqual(response.imojis.count, expectedImojis.count);
+    for (NSUInteger i = 0; i < MIN(response.imojis.count, expectedImojis.count); i++) {
+        [self assertImoji:response.imojis[i] matchesImoji:expectedImojis[i]];
+    }
+
+    [self assertCategories:response.categories matchCategories:[session readCategories:json[@"categories"]]];
+    [self assertCategories:response.relatedCategories matchCategories:[session readCategories:json[@"relatedCategories"]]];
+    [self assertAttribution:response.attribution[@"current"] matchesAttribution:[session readAttribution:json[@"attribution"][@"current"]]];
+
+    NSData *nullCategories = [@"{\"status\":\"SUCCESS\",\"categories\":null}" dataUsingEncoding:NSUTF8StringEncoding];
+    XCTAssertNil([IMImojiResponse responseWithData:nullCategories error:nil].categories, @"null categories");
+
+    for (NSString *malformed in @[@"{\"status\":\"SUCCESS\",\"results\":[", @"{\"status\" \"SUCCESS\"}", @"{} {}", @"[1,]"]) {
+        error = nil;
+        XCTAssertNil([IMImojiResponse responseWithData:[malformed dataUsingEncoding:NSUTF8StringEncoding] error:&error], @"%@ is rejected", malformed);
+        XCTAssertEqualObjects(error.domain, NSCocoaErrorDomain);
+    }
+}
+
+- (void)test_4_6_ContentSnapshotTest {
+    IMLoopbackTransport *transport = [self loopbackTransportWithImojiCount:10];
+    IMImojiSessionStoragePolicy *storagePolicy = [self isolatedStoragePolicy];
+    IMCategoryFetchOptions *options = [IMCategoryFetchOptions optionsWithClassification:IMImojiSessionCategoryClassificationGeneric];
+    NSURL *snapshotsURL = [storagePolicy.cachePath URLByAppendingPathComponent:@"snapshots"];
+
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:storagePolicy transport:transport];
+    session.contentSnapshotsEnabled = YES;
+    BFTaskCompletionSource *source = [BFTaskCompletionSource taskCompletionSource];
+    [session getImojiCategoriesWithOptions:options callback:^(NSArray *imojiCategories, NSError *error) {
+        XCTAssertEqual(imojiCategories.count, 10, @"categories without a snapshot");
+        source.result = @YES;
+    }];
+    [self runTestWithTask:source.task];
+
+    // snapshots are written in the background
+    for (NSUInteger i = 0; i < 100 && [[NSFileManager defaultManager] contentsOfDirectoryAtPath:snapshotsURL.path error:nil].count == 0; i++) {
+        [NSThread sleepForTimeInterval:.01];
+    }
+
+    // a new session serves the snapshot before returning and only calls back again once the content changed
+    IMImojiSession *coldSession = [IMImojiSession imojiSessionWithStoragePolicy:storagePolicy transport:transport];
+    coldSession.contentSnapshotsEnabled = YES;
+    NSMutableArray *deliveries = [NSMutableArray array];
+    [coldSession getImojiCategoriesWithOptions:options callback:^(NSArray *imojiCategories, NSError *error) {
+        [deliveries addObject:@(imojiCategories.count)];
+    }];
+    XCTAssertEqualObjects(deliveries, @[@10], @"snapshot served synchronously");
+    XCTAssertEqual(coldSession.metricsSnapshot.caches[@"contentSnapshots"].hits, 1);
+
+    while (coldSession.metricsSnapshot.endpoints[@"/imoji/categories/fetch"].latency.count == 0) {
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:.01]];
+    }
+    [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:.1]];
+    XCTAssertEqualObjects(deliveries, @[@10], @"unchanged content is not delivered twice");
+
+    NSArray *categories = @[@{@"searchText" : @"changed", @"title" : @"Changed", @"priority" : @1, @"imojis" : @[]}];
+    [transport setResponse:[IMLoopbackResponse responseWithJSONObject:@{@"status" : @"SUCCESS", @"categories" : categories}]
+                   forHost:@"api.imoji.io" path:@"/v2/imoji/categories/fetch"];
+
+    BFTaskCompletionSource *refreshSource = [BFTaskCompletionSource taskCompletionSource];
+    [coldSession getImojiCategoriesWithOptions:options callback:^(NSArray *imojiCategories, NSError *error) {
+        [deliveries addObject:@(imojiCategories.count)];
+        if (imojiCategories.count == 1) {
+            refreshSource.result = @YES;
+        }
+    }];
+    [self runTestWithTask:refreshSource.task];
+    XCTAssertEqualObjects(deliveries, (@[@10, @10, @1]), @"changed content is delivered after the snapshot");
+
+    IMImojiSession *disabledSession = [IMImojiSession imojiSessionWithStoragePolicy:storagePolicy transport:transport];
+    __block BOOL delivered = NO;
+    [disabledSession getImojiCategoriesWithOptions:options callback:^(NSArray *imojiCategories, NSError *error) {
+        delivered = YES;
+    }];
+    XCTAssertFalse(delivered, @"snapshots are opt-in");
+}
+
+- (void)test_4_7_CollectionArchiveTest {
+    NSMutableArray *results = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 20; i++) {
+        NSString *identifier = [NSString stringWithFormat:@"imoji-%02lu", (unsigned long) (19 - i)];
+        [results addObject:i % 2 == 0 ? [self currentFormatImojiWithIdentifier:identifier] : [self loopbackImojiWithIdentifier:identifier]];
+    }
+
+    NSData *data = [NSJSONSerialization dataWithJSONObject:@{@"status" : @"SUCCESS", @"results" : results} options:0 error:nil];
+    NSArray<IMImojiObject *> *imojis = [IMImojiResponse responseWithData:data error:nil].imojis;
+    IMImojiObject *localImoji = [IMMutableImojiObject imojiWithIdentifier:@"local"
+                                                                     tags:@[]
+                                                                     urls:@{[IMImojiObjectRenderingOptions optionsWithRenderSize:IMImojiObjectRenderSizeThumbnail] : [NSURL fileURLWithPath:@"/tmp/local.png"]}];
+
+    NSURL *fileURL = [[self isolatedStoragePolicy].persistentPath URLByAppendingPathComponent:@"favorites.imojis"];
+    NSError *error;
+    IMImojiCollectionArchive *archive = [IMImojiCollectionArchive archiveWithFileURL:fileURL error:&error];
+    XCTAssertNotNil(archive, @"%@", error);
+    XCTAssertEqual(archive.count, 0);
+
+    XCTAssert([archive appendImojis:[imojis subarrayWithRange:NSMakeRange(0, 12)] error:&error], @"%@", error);
+    XCTAssert([archive appendImojis:[[imojis subarrayWithRange:NSMakeRange(12, 8)] arrayByAddingObjectsFromArray:@[localImoji, imojis[3]]] error:&error], @"%@", error);
+
+    // reopening reads the appended segments from the mapped file
+    archive = [IMImojiCollectionArchive archiveWithFileURL:fileURL error:&error];
+    XCTAssertEqual(archive.count, imojis.count + 2);
+    for (NSUInteger i = 0; i < imojis.count; i++) {
+        [self assertImoji:[archive imojiAtIndex:i] matchesImoji:imojis[i]];
+        [self assertImoji:[archive imojiWithIdentifier:imojis[i].identifier] matchesImoji:imojis[i]];
+    }
+    [self assertImoji:[archive imojiWithIdentifier:@"local"] matchesImoji:localImoji];
+    XCTAssertNil([archive imojiWithIdentifier:@"imoji-20"]);
+    XCTAssertNil([archive imojiWithIdentifier:@""]);
+    XCTAssertNil([archive imojiAtIndex:archive.count]);
+
+    XCTAssert([archive compactWithError:&error], @"%@", error);
+    XCTAssertEqual(archive.count, imojis.count + 2, @"compaction keeps every imoji");
+    [self assertImoji:[archive imojiAtIndex:archive.count - 1] matchesImoji:imojis[3]];
+    [self assertImoji:[archive imojiWithIdentifier:imojis[7].identifier] matchesImoji:imojis[7]];
+
+    // appends interrupted before the header was updated are ignored
+    NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingToURL:fileURL error:nil];
+    [fileHandle seekToEndOfFile];
+    [fileHandle writeData:[NSMutableData dataWithLength:100]];
+    [fileHandle closeFile];
+    archive = [IMImojiCollectionArchive archiveWithFileURL:fileURL error:&error];
+    XCTAssertEqual(archive.count, imojis.count + 2);
+
+    NSURL *invalidURL = [fileURL URLByAppendingPathExtension:@"invalid"];
+    [data writeToURL:invalidURL atomically:YES];
+    error = nil;
+    XCTAssertNil([IMImojiCollectionArchive archiveWithFileURL:invalidURL error:&error]);
+    XCTAssertEqualObjects(error.domain, NSCocoaErrorDomain);
+}
+
+- (void)test_4_8_CollectionMirrorTest {
+    IMLoopbackTransport *transport = [self loopbackTransportWithImojiCount:1];
+    IMImojiSessionStoragePolicy *storagePolicy = [self isolatedStoragePolicy];
+    NSURL *likedURL = [storagePolicy.persistentPath URLByAppendingPathComponent:@"collections/liked.imojis"];
+
+    void (^setCollection)(NSArray *) = ^(NSArray *identifiers) {
+        NSMutableArray *results = [NSMutableArray array];
+        for (NSString *identifier in identifiers) {
+            [results addObject:[self loopbackImojiWithIdentifier:identifier]];
+        }
+
+        [transport setResponse:[IMLoopbackResponse responseWithJSONObject:@{@"status" : @"SUCCESS", @"results" : results}]
+                       forHost:@"api.imoji.io" path:@"/v2/user/imoji/fetch"];
+    };
+    for (NSString *path in @[@"/v2/user/imoji/collection/add", @"/v2/imoji/remove"]) {
+        [transport setResponse:[IMLoopbackResponse responseWithJSONObject:@{@"status" : @"SUCCESS"}] forHost:@"api.imoji.io" path:path];
+    }
+    setCollection(@[@"a", @"b", @"c"]);
+
+    NSMutableArray<NSMutableArray *> *deliveries = [NSMutableArray array];
+    void (^fetchLiked)(IMImojiSession *) = ^(IMImojiSession *session) {
+        [session fetchCollectedImojisWithType:IMImojiCollectionTypeLiked
+                    resultSetResponseCallback:^(IMImojiResultSetMetadata *metadata, NSError *error) {
+                        XCTAssertNil(error);
+                        [deliveries addObject:[NSMutableArray array]];
+                    }
+                        imojiResponseCallback:^(IMImojiObject *imoji, NSUInteger index, NSError *error) {
+                            [deliveries.lastObject addObject:imoji.identifier];
+                        }];
+    };
+    void (^waitForFetches)(IMImojiSession *, NSUInteger) = ^(IMImojiSession *session, NSUInteger count) {
+        while (session.metricsSnapshot.endpoints[@"/user/imoji/fetch"].latency.count < count) {
+            [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:.01]];
+        }
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:.1]];
+    };
+
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:storagePolicy transport:transport];
+    session.collectionMirrorEnabled = YES;
+    fetchLiked(session);
+    XCTAssertEqual(deliveries.count, 0, @"nothing mirrored yet");
+    waitForFetches(session, 1);
+    XCTAssertEqualObjects(deliveries, (@[@[@"a", @"b", @"c"]]));
+
+    // the mirror is written in the background
+    for (NSUInteger i = 0; i < 100 && [IMImojiCollectionArchive archiveWithFileURL:likedURL error:nil].count != 3; i++) {
+        [NSThread sleepForTimeInterval:.01];
+    }
+
+    // a new session serves the mirror before returning and only calls back again once the collection changed
+    IMImojiSession *coldSession = [IMImojiSession imojiSessionWithStoragePolicy:storagePolicy transport:transport];
+    coldSession.collectionMirrorEnabled = YES;
+    [deliveries removeAllObjects];
+    fetchLiked(coldSession);
+    XCTAssertEqualObjects(deliveries, (@[@[@"a", @"b", @"c"]]), @"mirror served synchronously");
+    XCTAssertEqual(coldSession.metricsSnapshot.caches[@"collectionMirror"].hits, 1);
+    waitForFetches(coldSession, 1);
+    XCTAssertEqual(deliveries.count, 1, @"unchanged collection is not delivered twice");
+
+    // additions and removals are mirrored before they are sent
+    NSData *addedData = [NSJSONSerialization dataWithJSONObject:@{@"status" : @"SUCCESS", @"results" : @[[self loopbackImojiWithIdentifier:@"d"]]} options:0 error:nil];
+    IMImojiObject *addedImoji = [IMImojiResponse responseWithData:addedData error:nil].imojis.firstObject;
+    setCollection(@[@"d", @"a", @"c"]);
+    [coldSession addImojiToUserCollection:addedImoji callback:^(BOOL successful, NSError *error) {
+    }];
+    [coldSession removeImoji:[IMMutableImojiObject imojiWithIdentifier:@"b" tags:@[] urls:@{}] callback:^(BOOL successful, NSError *error) {
+    }];
+
+    [deliveries removeAllObjects];
+    fetchLiked(coldSession);
+    XCTAssertEqualObjects(deliveries, (@[@[@"d", @"a", @"c"]]), @"optimistic changes served from the mirror");
+    waitForFetches(coldSession, 2);
+    XCTAssertEqual(deliveries.count, 1, @"server caught up with the optimistic changes");
+
+    setCollection(@[@"d", @"c"]);
+    [deliveries removeAllObjects];
+    fetchLiked(coldSession);
+    waitForFetches(coldSession, 3);
+    XCTAssertEqualObjects(deliveries, (@[@[@"d", @"a", @"c"], @[@"d", @"c"]]), @"changed collection delivered after the mirror");
+
+    IMImojiSession *disabledSession = [IMImojiSession imojiSessionWithStoragePolicy:storagePolicy transport:transport];
+    [deliveries removeAllObjects];
+    fetchLiked(disabledSession);
+    XCTAssertEqual(deliveries.count, 0, @"the mirror is opt-in");
+}
+
+- (void)test_4_9_AttributionCacheTest {
+    IMLoopbackTransport *transport = [self loopbackTransportWithImojiCount:1];
+    NSMutableArray<NSNumber *> *requestSizes = [NSMutableArray array];
+    [transport setHandler:^IMLoopbackResponse *(NSURLRequest *request, NSData *body) {
+        NSArray<NSString *> *identifiers = @[];
+        for (NSURLQueryItem *item in [NSURLComponents componentsWithURL:request.URL resolvingAgainstBaseURL:NO].queryItems) {
+            if ([item.name isEqualToString:@"imojiIds"]) {
+                identifiers = [item.value componentsSeparatedByString:@","];
+            }
+        }
+
+        @synchronized (requestSizes) {
+            [requestSizes addObject:@(identifiers.count)];
+        }
+
+        NSMutableDictionary *attribution = [NSMutableDictionary dictionary];
+        for (NSString *identifier in identifiers) {
+            if (![identifier hasPrefix:@"unattributed"]) {
+                attribution[identifier] = @{@"packId" : [@"pack-" stringByAppendingString:identifier], @"packURL" : @"https://imoji.io/pack", @"id" : @"artist", @"name" : @"Artist"};
+            }
+        }
+
+        return [IMLoopbackResponse responseWithJSONObject:@{@"status" : @"SUCCESS", @"attribution" : attribution}];
+    }             forHost:@"api.imoji.io" path:@"/v2/imoji/attribution"];
+
+    NSMutableArray<NSString *> *identifiers = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 120; i++) {
+        [identifiers addObject:[NSString stringWithFormat:@"imoji-%lu", (unsigned long) i]];
+    }
+    for (NSUInteger i = 0; i < 10; i++) {
+        [identifiers addObject:[NSString stringWithFormat:@"unattributed-%lu", (unsigned long) i]];
+    }
+
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:[self isolatedStoragePolicy] transport:transport];
+    BFTaskCompletionSource *source = [BFTaskCompletionSource taskCompletionSource];
+    [session fetchAttributionByImojiIdentifiers:identifiers callback:^(NSDictionary *attribution, NSError *error) {
+        XCTAssertNil(error);
+        XCTAssertEqual(attribution.count, 120, @"attribution merged from every request");
+        XCTAssertEqualObjects(((IMCategoryAttribution *) attribution[@"imoji-77"]).identifier, @"pack-imoji-77");
+        source.result = @YES;
+    }];
+    [self runTestWithTask:source.task];
+    XCTAssertEqualObjects([requestSizes sortedArrayUsingSelector:@selector(compare:)], (@[@30, @50, @50]), @"identifiers split into bounded requests");
+
+    // cached attribution, including the lack of it, is served without a request
+    __block NSDictionary *cachedAttribution;
+    [session fetchAttributionByImojiIdentifiers:identifiers callback:^(NSDictionary *attribution, NSError *error) {
+        cachedAttribution = attribution;
+    }];
+    XCTAssertEqual(cachedAttribution.count, 120, @"cached attribution delivered synchronously");
+    XCTAssertEqual(requestSizes.count, 3);
+    XCTAssertEqual(session.metricsSnapshot.caches[@"attribution"].hits, 1);
+
+    BFTaskCompletionSource *missingSource = [BFTaskCompletionSource taskCompletionSource];
+    [session fetchAttributionByImojiIdentifiers:@[@"imoji-1", @"imoji-new", @"imoji-new"] callback:^(NSDictionary *attribution, NSError *error) {
+        XCTAssertEqualObjects([attribution.allKeys sortedArrayUsingSelector:@selector(compare:)], (@[@"imoji-1", @"imoji-new"]));
+        missingSource.result = @YES;
+    }];
+    [self runTestWithTask:missingSource.task];
+    XCTAssertEqualObjects(requestSizes.lastObject, @1, @"only the missing identifier is requested");
+}
+
+- (void)test_4_10_SharedResourceRegistryTest {
+    IMImojiSessionStoragePolicy *storagePolicy = [self isolatedStoragePolicy];
+    IMSharedResourceRegistry *registry = [IMSharedResourceRegistry sharedRegistry];
+    __weak IMSharedResources *weakResources;
+
+    @autoreleasepool {
+        IMSharedResources *resources = [registry resourcesForStoragePolicy:storagePolicy];
+        weakResources = resources;
+
+        IMImojiSessionStoragePolicy *samePathPolicy = [IMImojiSessionStoragePolicy storagePolicyWithCachePath:storagePolicy.cachePath
+                                                                                               persistentPath:[self isolatedStoragePolicy].persistentPath];
+        XCTAssertEqual([registry resourcesForStoragePolicy:samePathPolicy], resources, @"one pool per cache path");
+        XCTAssertNotEqual([registry resourcesForStoragePolicy:[self isolatedStoragePolicy]], resources);
+        XCTAssertNotEqual(resources.apiURLSession, resources.imageURLSession, @"API and image traffic use separate sessions");
+        XCTAssertNotEqual(resources.metadataCache, resources.imageCache);
+        XCTAssertLessThan(resources.apiURLSession.configuration.HTTPMaximumConnectionsPerHost, resources.imageURLSession.configuration.HTTPMaximumConnectionsPerHost);
+
+        IMURLSessionTransport *transport = [resources createTransport];
+        IMURLSessionTransport *otherTransport = [resources createTransport];
+        XCTAssertEqual(transport.urlSession, otherTransport.urlSession, @"transports share connections");
+        XCTAssertEqual(transport.imageURLSession, resources.imageURLSession);
+    }
+
+    XCTAssertNil(weakResources, @"released with the last reference");
+}
+
+- (void)test_4_11_MemoryGovernorTest {
+    IMMemoryGovernor *governor = [IMMemoryGovernor sharedGovernor];
+    IMImageMemoryCache *cache = [IMImageMemoryCache new];
+    NSArray *frames = [self syntheticAnimationFramesWithSize:CGSizeMake(64, 64) frameCount:4];
+
+    IMGIFEncoder *encoder = [[IMGIFEncoder alloc] initWithWidth:64 height:64 loopCount:0];
+    for (UIImage *frame in frames) {
+        XCTAssert([encoder appendFrameWithCGImage:frame.CGImage delay:.05], @"append gif frame");
+    }
+
+    // images held by the other tests' sessions are released first so only this cache is accounted for
+    [governor trimToLevel:IMMemoryTrimLevelDecodedImages];
+
+    [cache setImage:[YYImage imageWithData:[encoder finish] scale:1] forKey:@"animated"];
+    [cache setImage:frames[0] forKey:@"first"];
+    [cache setImage:frames[1] forKey:@"second"];
+    XCTAssertGreaterThan([governor usageAtLevel:IMMemoryTrimLevelAnimationFrames], 0);
+    XCTAssertGreaterThan([governor usageAtLevel:IMMemoryTrimLevelDecodedImages], 0);
+
+    [governor trimToLevel:IMMemoryTrimLevelAnimationFrames];
+    XCTAssertNil([cache imageForKey:@"animated"], @"animated images are released first");
+    XCTAssertNotNil([cache imageForKey:@"second"]);
+    XCTAssertNotNil([cache imageForKey:@"first"]);
+
+    NSUInteger budget = governor.budget;
+    governor.budget = governor.currentUsage - 1;
+    [governor enforceBudget];
+    governor.budget = budget;
+    XCTAssertNil([cache imageForKey:@"second"], @"least recently used image is evicted over budget");
+    XCTAssertNotNil([cache imageForKey:@"first"]);
+
+    [governor trimToLevel:IMMemoryTrimLevelMetadata];
+    XCTAssertNil([cache imageForKey:@"first"]);
+    XCTAssertEqual([governor usageAtLevel:IMMemoryTrimLevelDecodedImages], 0);
+}
+
+- (void)test_4_12_RenditionSelectorTest {
+    NSMutableDictionary *urls = [NSMutableDictionary dictionary];
+    NSMutableDictionary *fileSizes = [NSMutableDictionary dictionary];
+    NSDictionary<NSNumber *, NSNumber *> *sizeScales = @{
+            @(IMImojiObjectRenderSizeThumbnail) : @1,
+            @(IMImojiObjectRenderSize320) : @4,
+            @(IMImojiObjectRenderSize512) : @10,
+            @(IMImojiObjectRenderSizeFullResolution) : @30
+    };
+    NSDictionary<NSNumber *, NSNumber *> *formatSizes = @{
+            @(IMImojiObjectImageFormatPNG) : @(20 * 1024),
+            @(IMImojiObjectImageFormatWebP) : @(10 * 1024),
+            @(IMImojiObjectImageFormatAnimatedGif) : @(100 * 1024),
+            @(IMImojiObjectImageFormatAnimatedWebp) : @(50 * 1024)
+    };
+
+    for (NSNumber *renderSize in sizeScales) {
+        for (NSNumber *imageFormat in formatSizes) {
+            BOOL animated = imageFormat.unsignedIntegerValue >= IMImojiObjectImageFormatAnimatedGif;
+            IMImojiObjectRenderingOptions *options = [IMImojiObjectRenderingOptions optionsWithRenderSize:(IMImojiObjectRenderSize) renderSize.unsignedIntegerValue
+                                                                                              borderStyle:animated ? IMImojiObjectBorderStyleNone : IMImojiObjectBorderStyleSticker
+                                                                                              imageFormat:(IMImojiObjectImageFormat) imageFormat.unsignedIntegerValue];
+            urls[options] = [NSURL URLWithString:[NSString stringWithFormat:@"https://render.imoji.io/ada/adaptive/%@-%@", renderSize, imageFormat]];
+            fileSizes[options] = @(sizeScales[renderSize].integerValue * formatSizes[imageFormat].integerValue);
+        }
+    }
+
+    IMMutableImojiObject *imoji = [IMMutableImojiObject imojiWithIdentifier:@"adaptive"
+                                                                       tags:@[]
+                                                                       urls:urls
+                                                            imageDimensions:@{}
+                                                                  fileSizes:fileSizes
+                                                               licenseStyle:IMImojiObjectLicenseStyleNonCommercial];
+    IMImojiObjectRenderingOptions *options = [IMImojiObjectRenderingOptions optionsWithRenderSize:IMImojiObjectRenderSizeFullResolution];
+    options.renderAnimatedIfSupported = YES;
+    options.targetDownloadDuration = @1;
+
+    IMImojiObjectRenderingOptions *(^selectWithThroughput)(double) = ^IMImojiObjectRenderingOptions *(double throughput) {
+        IMRenditionSelector *selector = [IMRenditionSelector new];
+        [selector recordTransferOfLength:(unsigned long long) throughput duration:1 host:@"render.imoji.io"];
+        return [selector renderingOptionsForImoji:imoji options:options];
+    };
+
+    IMImojiObjectRenderingOptions *selected = [[IMRenditionSelector new] renderingOptionsForImoji:imoji options:options];
+    XCTAssertEqual(selected.imageFormat, IMImojiObjectImageFormatAnimatedWebp, @"requested rendition until throughput is measured");
+    XCTAssertEqual(selected.renderSize, IMImojiObjectRenderSizeFullResolution);
+
+    selected = selectWithThroughput(2 * 1024 * 1024);
+    XCTAssertEqual(selected.imageFormat, IMImojiObjectImageFormatAnimatedWebp);
+    XCTAssertEqual(selected.renderSize, IMImojiObjectRenderSizeFullResolution);
+
+    selected = selectWithThroughput(300 * 1024);
+    XCTAssertEqual(selected.imageFormat, IMImojiObjectImageFormatAnimatedWebp);
+    XCTAssertEqual(selected.renderSize, IMImojiObjectRenderSize320, @"smaller animation on a slower link");
+    XCTAssert(selected.renderAnimatedIfSupported);
+
+    selected = selectWithThroughput(45 * 1024);
+    XCTAssertEqual(selected.imageFormat, IMImojiObjectImageFormatWebP, @"static rendition when no animation fits");
+    XCTAssertEqual(selected.renderSize, IMImojiObjectRenderSize320);
+    XCTAssertEqual(selected.borderStyle, IMImojiObjectBorderStyleSticker);
+    XCTAssertFalse(selected.renderAnimatedIfSupported);
+    XCTAssertEqualObjects([imoji getUrlForRenderingOptions:selected], urls[[IMImojiObjectRenderingOptions optionsWithRenderSize:IMImojiObjectRenderSize320]]);
+
+    selected = selectWithThroughput(1024);
+    XCTAssertEqual(selected.imageFormat, IMImojiObjectImageFormatWebP, @"smallest rendition when nothing fits");
+    XCTAssertEqual(selected.renderSize, IMImojiObjectRenderSizeThumbnail);
+
+    IMRenditionSelector *selector = [IMRenditionSelector new];
+    [selector recordTransferOfLength:1000 duration:1 host:@"render.imoji.io"];
+    [selector recordTransferOfLength:2000 duration:1 host:@"render.imoji.io"];
+    [selector recordTransferOfLength:1000000 duration:.001 host:@"render.imoji.io"];
+    XCTAssertEqualWithAccuracy([selector throughputForHost:@"render.imoji.io"], 1300, .01, @"moving average ignoring cached responses");
+    XCTAssertEqual([selector throughputForHost:@"other.imoji.io"], 0);
+
+    // concurrent transfers share the link, their bytes are measured over the time any of them was in progress
+    IMRenditionSelector *concurrentSelector = [IMRenditionSelector new];
+    [concurrentSelector beginTransferFromHost:@"render.imoji.io"];
+    [concurrentSelector beginTransferFromHost:@"render.imoji.io"];
+    [NSThread sleepForTimeInterval:.1];
+    [concurrentSelector endTransferFromHost:@"render.imoji.io" length:5000];
+    XCTAssertEqual([concurrentSelector throughputForHost:@"render.imoji.io"], 0, @"measured once no transfer is in progress");
+    [concurrentSelector endTransferFromHost:@"render.imoji.io" length:5000];
+
+    double concurrentThroughput = [concurrentSelector throughputForHost:@"render.imoji.io"];
+    XCTAssertGreaterThan(concurrentThroughput, 10000 / .5);
+    XCTAssertLessThanOrEqual(concurrentThroughput, 10000 / .1);
+}
+
+- (void)test_4_13_WriteBehindQueueTest {
+    IMWriteBehindQueue *writeQueue = [IMWriteBehindQueue new];
+    NSURL *directoryURL = [[self isolatedStoragePolicy].cachePath URLByAppendingPathComponent:@"writes"];
+    NSURL *firstURL = [directoryURL URLByAppendingPathComponent:@"first"];
+    NSURL *secondURL = [directoryURL URLByAppendingPathComponent:@"second"];
+    NSData *replacedData = [@"replaced" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *firstData = [@"first" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *secondData = [@"second" dataUsingEncoding:NSUTF8StringEncoding];
+
+    NSArray<BFTask *> *tasks = @[
+            [writeQueue writeData:replacedData toURL:firstURL durable:NO],
+            [writeQueue writeData:firstData toURL:firstURL durable:NO],
+            [writeQueue writeData:secondData toURL:secondURL durable:YES]
+    ];
+    XCTAssertEqualObjects([writeQueue contentsOfURL:secondURL], secondData, @"queued writes are visible to readers");
+
+    [self runTestWithTask:[BFTask taskForCompletionOfAllTasks:tasks]];
+    for (BFTask *task in tasks) {
+        XCTAssertNil(task.error);
+    }
+
+    XCTAssertEqualObjects([NSData dataWithContentsOfURL:firstURL], firstData, @"the last write to a file wins");
+    XCTAssertEqualObjects([NSData dataWithContentsOfURL:secondURL], secondData);
+    XCTAssertEqual([[NSFileManager defaultManager] contentsOfDirectoryAtPath:directoryURL.path error:nil].count, 2, @"no temporary files are left behind");
+
+    NSNumber *excludedFromBackup;
+    [directoryURL getResourceValue:&excludedFromBackup forKey:NSURLIsExcludedFromBackupKey error:nil];
+    XCTAssertEqualObjects(excludedFromBackup, @YES, @"the directory is excluded from backups");
+
+    [writeQueue removeItemAtURL:directoryURL];
+    XCTAssertNil([writeQueue contentsOfURL:firstURL], @"queued removals are visible to readers");
+    [writeQueue flush];
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:directoryURL.path]);
+
+    BFTask *rewriteTask = [writeQueue writeData:firstData toURL:firstURL durable:NO];
+    [self runTestWithTask:rewriteTask];
+    XCTAssertEqualObjects([NSData dataWithContentsOfURL:firstURL], firstData, @"removed directories are created again");
+}
+
+- (void)test_4_14_ImojiAtlasTest {
+    IMImojiAtlas *atlas = [IMImojiAtlas atlasWithCellSize:CGSizeMake(100, 100) capacity:10];
+    XCTAssertEqual(atlas.columns, 4);
+    XCTAssert(CGSizeEqualToSize(atlas.size, CGSizeMake(400, 300)));
+    XCTAssert(CGRectEqualToRect([atlas rectForImojiAtIndex:5], CGRectMake(100, 100, 100, 100)));
+    XCTAssertEqualWithAccuracy([atlas contentsRectForImojiAtIndex:5].origin.y, 1.0 / 3.0, .0001);
+
+    IMImojiSessionStoragePolicy *storagePolicy = [self isolatedStoragePolicy];
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:storagePolicy transport:[self loopbackTransportWithImojiCount:6]];
+    NSMutableArray<IMImojiObject *> *imojis = [NSMutableArray array];
+    BFTaskCompletionSource *fetchSource = [BFTaskCompletionSource taskCompletionSource];
+    [session searchImojisWithTerm:@"atlas"
+                           offset:nil
+              contributingImojiId:nil
+                  numberOfResults:@6
+        resultSetResponseCallback:^(IMImojiResultSetMetadata *metadata, NSError *error) {
+            if (error) {
+                [fetchSource trySetError:error];
+            }
+        }
+            imojiResponseCallback:^(IMImojiObject *imoji, NSUInteger index, NSError *error) {
+                [imojis addObject:imoji];
+                if (imojis.count == 6) {
+                    [fetchSource trySetResult:imojis];
+                }
+            }];
+    [self runTestWithTask:fetchSource.task];
+
+    BFTask *(^renderPage)(NSArray<IMImojiObject *> *) = ^BFTask *(NSArray<IMImojiObject *> *page) {
+        BFTaskCompletionSource *renderSource = [BFTaskCompletionSource taskCompletionSource];
+        NSMutableIndexSet *reportedIndexes = [NSMutableIndexSet indexSet];
+
+        [session renderImojis:page
+                    intoAtlas:atlas
+                      options:[IMImojiObjectRenderingOptions optionsWithRenderSize:IMImojiObjectRenderSizeThumbnail]
+                     callback:^(IMImojiAtlas *renderedAtlas, NSIndexSet *drawnIndexes, BOOL finished, NSError *error) {
+                         XCTAssertNil(error);
+                         [reportedIndexes addIndexes:drawnIndexes];
+                         if (finished) {
+                             renderSource.result = reportedIndexes;
+                         }
+                     }];
+
+        return renderSource.task;
+    };
+
+    BFTask *renderTask = renderPage(imojis);
+    [self runTestWithTask:renderTask];
+    XCTAssertEqualObjects(renderTask.result, [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, 6)]);
+    XCTAssertEqualObjects(atlas.drawnIndexes, renderTask.result);
+    XCTAssert([self atlas:atlas hasPixelsInCellAtIndex:5]);
+    XCTAssertFalse([self atlas:atlas hasPixelsInCellAtIndex:6], @"unused cells stay empty");
+
+    NSURL *thumbnailURL = [(IMMutableImojiObject *) imojis[5] getUrlForRenderingOptions:[IMImojiObjectRenderingOptions optionsWithRenderSize:IMImojiObjectRenderSizeThumbnail]];
+    IMImageMemoryCache *imageMemoryCache = [[IMSharedResourceRegistry sharedRegistry] resourcesForStoragePolicy:storagePolicy].imageMemoryCache;
+    XCTAssertNil([imageMemoryCache imageForKey:thumbnailURL.absoluteString], @"cells are decoded into the atlas without creating images");
+
+    renderTask = renderPage([imojis subarrayWithRange:NSMakeRange(0, 2)]);
+    [self runTestWithTask:renderTask];
+    XCTAssertEqualObjects(renderTask.result, [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, 2)]);
+    XCTAssert([self atlas:atlas hasPixelsInCellAtIndex:1]);
+    XCTAssertFalse([self atlas:atlas hasPixelsInCellAtIndex:5], @"the previous page is cleared");
+
+    __block NSError *capacityError;
+    [session renderImojis:[imojis arrayByAddingObjectsFromArray:imojis]
+                intoAtlas:atlas
+                  options:[IMImojiObjectRenderingOptions optionsWithRenderSize:IMImojiObjectRenderSizeThumbnail]
+                 callback:^(IMImojiAtlas *renderedAtlas, NSIndexSet *drawnIndexes, BOOL finished, NSError *error) {
+                     capacityError = error;
+                 }];
+    XCTAssertEqual(capacityError.code, IMImojiSessionErrorCodeInvalidArgument);
+}
+
+- (void)test_4_15_ExecutorTopologyTest {
+    IMImojiExecutor *executor = [IMImojiExecutor executorWithName:@"com.imoji.executor.test"
+                                                 qualityOfService:NSQualityOfServiceUtility
+                                                            width:2];
+    dispatch_semaphore_t releaseSemaphore = dispatch_semaphore_create(0);
+    dispatch_group_t group = dispatch_group_create();
+    NSObject *lock = [NSObject new];
+    __block NSUInteger runningCount = 0;
+    __block NSUInteger peakRunningCount = 0;
+
+    for (NSUInteger i = 0; i < 6; i++) {
+        dispatch_group_enter(group);
+        [executor execute:^{
+            @synchronized (lock) {
+                peakRunningCount = MAX(peakRunningCount, ++runningCount);
+            }
+
+            dispatch_semaphore_wait(releaseSemaphore, DISPATCH_TIME_FOREVER);
+
+            @synchronized (lock) {
+                runningCount--;
+            }
+            dispatch_group_leave(group);
+        }];
+    }
+
+    IMImojiExecutorStatistics *statistics = executor.statistics;
+    XCTAssertEqual(statistics.runningCount, 2);
+    XCTAssertEqual(statistics.pendingCount, 4, @"blocks past the width wait for a slot");
+
+    for (NSUInteger i = 0; i < 6; i++) {
+        dispatch_semaphore_signal(releaseSemaphore);
+    }
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, (int64_t) (10 * NSEC_PER_SEC))), 0);
+
+    statistics = executor.statistics;
+    XCTAssertEqual(peakRunningCount, 2);
+    XCTAssertEqual(statistics.pendingCount, 0);
+    XCTAssertEqual(statistics.peakPendingCount, 4);
+    XCTAssertGreaterThan(statistics.averageQueueWait, 0);
+
+    IMImojiExecutors *executors = [[IMImojiExecutors alloc] initWithNetworkExecutor:[IMImojiExecutor executorWithName:@"com.imoji.executor.test.network" qualityOfService:NSQualityOfServiceUserInitiated width:2]
+                                                                        imageExecutor:[IMImojiExecutor executorWithName:@"com.imoji.executor.test.image" qualityOfService:NSQualityOfServiceUserInitiated width:2]
+                                                                         diskExecutor:[IMImojiExecutor executorWithName:@"com.imoji.executor.test.disk" qualityOfService:NSQualityOfServiceUtility width:1]
+                                                                      controlExecutor:[IMImojiExecutor executorWithName:@"com.imoji.executor.test.control" qualityOfService:NSQualityOfServiceUserInitiated width:1]];
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:[self isolatedStoragePolicy] transport:[self loopbackTransportWithImojiCount:1]];
+    XCTAssertEqual(session.executors, [IMImojiExecutors defaultExecutors]);
+    session.executors = executors;
+
+    BFTaskCompletionSource *renderSource = [BFTaskCompletionSource taskCompletionSource];
+    [session searchImojisWithTerm:@"executors"
+                           offset:nil
+              contributingImojiId:nil
+                  numberOfResults:@1
+        resultSetResponseCallback:^(IMImojiResultSetMetadata *metadata, NSError *error) {
+            if (error) {
+                [renderSource trySetError:error];
+            }
+        }
+            imojiResponseCallback:^(IMImojiObject *imoji, NSUInteger index, NSError *error) {
+                [session renderImoji:imoji
+                             options:[IMImojiObjectRenderingOptions optionsWithRenderSize:IMImojiObjectRenderSizeThumbnail]
+                            callback:^(UIImage *image, NSError *renderError) {
+                                if (renderError) {
+                                    [renderSource trySetError:renderError];
+                                } else {
+                                    [renderSource trySetResult:image];
+                                }
+                            }];
+            }];
+    [self runTestWithTask:renderSource.task];
+    XCTAssertNotNil(renderSource.task.result);
+
+    // the block that delivered a result may not have returned yet
+    NSUInteger (^submittedCount)(IMImojiExecutor *) = ^NSUInteger(IMImojiExecutor *sessionExecutor) {
+        IMImojiExecutorStatistics *executorStatistics = sessionExecutor.statistics;
+        return executorStatistics.completedCount + executorStatistics.runningCount;
+    };
+    XCTAssertGreaterThan(submittedCount(executors.controlExecutor), 0, @"readiness and credential validation");
+    XCTAssertGreaterThan(submittedCount(executors.networkExecutor), 0, @"search response");
+    XCTAssertGreaterThan(submittedCount(executors.imageExecutor), 0, @"image decoding");
+}
+
+- (void)test_4_16_CredentialSnapshotTest {
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:[self isolatedStoragePolicy] transport:[self loopbackTransportWithImojiCount:1]];
+    [self runTestWithTask:[session validateSession]];
+
+    IMImojiSessionCredentials *credentials = [IMImojiSession credentials];
+    BFTask *validationTask = [session validateSession];
+    XCTAssert(validationTask.completed, @"valid tokens are returned without a queue hop");
+    XCTAssertEqual(validationTask, credentials.accessTokenTask, @"nor a task allocation");
+    XCTAssertEqualObjects(validationTask.result, credentials.accessToken);
+
+    BFTaskCompletionSource *renewSource = [BFTaskCompletionSource taskCompletionSource];
+    [session renewCredentials:^(BOOL successful, NSError *error) {
+        renewSource.result = @(successful);
+    }];
+    [self runTestWithTask:renewSource.task];
+    XCTAssertEqualObjects(renewSource.task.result, @YES);
+    XCTAssertNotEqual([IMImojiSession credentials], credentials, @"renewals publish a new snapshot");
+    XCTAssertEqualObjects([IMImojiSession credentials].accessToken, @"loopback-access-token");
+    XCTAssertNotNil(credentials.accessToken, @"published snapshots are never modified");
+
+    NSUUID *clientId = [ImojiSDK sharedInstance].clientId;
+    IMImojiSessionCredentials *expiredCredentials = [[IMImojiSessionCredentials alloc] initWithAccessToken:@"token"
+                                                                                              refreshToken:@"refresh"
+                                                                                            expirationDate:[NSDate dateWithTimeIntervalSinceNow:-1]
+                                                                                                  clientId:clientId.UUIDString
+                                                                                       accountSynchronized:NO];
+    XCTAssertFalse([expiredCredentials isValidForClientId:clientId]);
+
+    IMImojiSessionCredentials *otherClientCredentials = [[IMImojiSessionCredentials alloc] initWithAccessToken:@"token"
+                                                                                                  refreshToken:@"refresh"
+                                                                                                expirationDate:[NSDate dateWithTimeIntervalSinceNow:60]
+                                                                                                      clientId:[NSUUID UUID].UUIDString
+                                                                                           accountSynchronized:NO];
+    XCTAssertFalse([otherClientCredentials isValidForClientId:clientId]);
+    XCTAssert([otherClientCredentials isValidForClientId:[[NSUUID alloc] initWithUUIDString:otherClientCredentials.clientId]]);
+}
+
+- (void)test_4_17_MutationOutboxReplayTest {
+    NSURL *logURL = [[self isolatedStoragePolicy].persistentPath URLByAppendingPathComponent:@"mutations.log"];
+    IMMutationOutboxHandler pendingHandler = ^BFTask *(IMMutation *mutation) {
+        return [BFTaskCompletionSource taskCompletionSource].task;
+    };
+
+    IMMutationOutbox *outbox = [[IMMutationOutbox alloc] initWithLogURL:logURL handler:pendingHandler];
+    outbox.maximumConcurrentMutations = 0;
+
+    BFTask *addTask = [outbox enqueueMutationWithKind:IMMutationKindCollectionAdd imojiIdentifier:@"first" parameters:@{@"imojiId" : @"first"} retained:NO];
+    BFTask *createTask = [outbox enqueueMutationWithKind:IMMutationKindCreate imojiIdentifier:@"second" parameters:@{@"tags" : @[@"café"]} retained:YES];
+    BFTask *discardedTask = [outbox enqueueMutationWithKind:IMMutationKindReport imojiIdentifier:@"third" parameters:@{@"imojiId" : @"third"} retained:YES];
+    [self runTestWithTask:[BFTask taskForCompletionOfAllTasks:@[addTask, createTask, discardedTask]]];
+
+    NSDictionary *createParameters = @{@"tags" : @[@"café"], @"createResponse" : @{@"imojiId" : @"server"}};
+    [self runTestWithTask:[outbox updateMutation:createTask.result parameters:createParameters]];
+    [outbox finishMutation:discardedTask.result retrying:NO];
+    [self runTestWithTask:[outbox pendingMutations]];
+
+    // an append interrupted inside a multibyte character
+    NSFileHandle *logHandle = [NSFileHandle fileHandleForWritingToURL:logURL error:nil];
+    [logHandle seekToEndOfFile];
+    [logHandle writeData:[@"{\"type\":\"mutation\",\"id\":\"partial\",\"kind\":\"collectionAdd\",\"imojiId\":\"café" dataUsingEncoding:NSUTF8StringEncoding]];
+    [logHandle truncateFileAtOffset:logHandle.offsetInFile - 1];
+    [logHandle closeFile];
+
+    IMMutationOutbox *reopenedOutbox = [[IMMutationOutbox alloc] initWithLogURL:logURL handler:pendingHandler];
+    reopenedOutbox.maximumConcurrentMutations = 0;
+    BFTask *pendingTask = [reopenedOutbox pendingMutations];
+    [self runTestWithTask:pendingTask];
+
+    NSArray<IMMutation *> *pending = pendingTask.result;
+    XCTAssertEqual(pending.count, 2, @"acknowledged and partial records are not replayed");
+    XCTAssertEqualObjects(pending.firstObject.identifier, ((IMMutation *) addTask.result).identifier);
+    XCTAssertEqualObjects(pending.lastObject.kind, IMMutationKindCreate);
+    XCTAssertEqualObjects(pending.lastObject.parameters, createParameters, @"updated parameters are replayed");
+
+    BFTask *appendedTask = [reopenedOutbox enqueueMutationWithKind:IMMutationKindRemove imojiIdentifier:@"fourth" parameters:@{@"imojiId" : @"fourth"} retained:NO];
+    [self runTestWithTask:appendedTask];
+    XCTAssertNil(appendedTask.error);
+
+    IMMutationOutbox *lastOutbox = [[IMMutationOutbox alloc] initWithLogURL:logURL handler:pendingHandler];
+    lastOutbox.maximumConcurrentMutations = 0;
+    pendingTask = [lastOutbox pendingMutations];
+    [self runTestWithTask:pendingTask];
+
+    pending = pendingTask.result;
+    XCTAssertEqual(pending.count, 3, @"records appended after a damaged tail are kept");
+    XCTAssertEqualObjects(pending.lastObject.identifier, ((IMMutation *) appendedTask.result).identifier);
+
+    IMMutationOutbox *unwritableOutbox = [[IMMutationOutbox alloc] initWithLogURL:[NSURL fileURLWithPath:@"/dev/null/mutations.log"] handler:pendingHandler];
+    BFTask *failedTask = [unwritableOutbox enqueueMutationWithKind:IMMutationKindCollectionAdd imojiIdentifier:@"first" parameters:@{} retained:NO];
+    [self runTestWithTask:failedTask];
+    XCTAssertEqualObjects(failedTask.error.domain, NSPOSIXErrorDomain, @"mutations that can't be recorded fail");
+}
+
+- (void)test_4_18_MutationOutboxCoalescingTest {
+    NSURL *logURL = [[self isolatedStoragePolicy].persistentPath URLByAppendingPathComponent:@"mutations.log"];
+    IMMutationOutbox *outbox = [[IMMutationOutbox alloc] initWithLogURL:logURL handler:^BFTask *(IMMutation *mutation) {
+        return [BFTaskCompletionSource taskCompletionSource].task;
+    }];
+    outbox.maximumConcurrentMutations = 0;
+
+    NSDictionary *parameters = @{@"imojiId" : @"coalesced"};
+    BFTask *addTask = [outbox enqueueMutationWithKind:IMMutationKindCollectionAdd imojiIdentifier:@"coalesced" parameters:parameters retained:NO];
+    BFTask *duplicateTask = [outbox enqueueMutationWithKind:IMMutationKindCollectionAdd imojiIdentifier:@"coalesced" parameters:parameters retained:NO];
+    [self runTestWithTask:[BFTask taskForCompletionOfAllTasks:@[addTask, duplicateTask]]];
+    XCTAssertNotNil(addTask.result);
+    XCTAssertNil(duplicateTask.result, @"identical pending mutations are coalesced");
+
+    BFTask *removeTask = [outbox enqueueMutationWithKind:IMMutationKindRemove imojiIdentifier:@"coalesced" parameters:parameters retained:NO];
+    BFTask *pendingTask = [outbox pendingMutations];
+    [self runTestWithTask:pendingTask];
+    XCTAssertEqualObjects(pendingTask.result, @[removeTask.result], @"removals drop pending collection adds");
+
+    NSURL *sentLogURL = [[self isolatedStoragePolicy].persistentPath URLByAppendingPathComponent:@"mutations.log"];
+    NSUInteger mutationCount = 130;
+    __block NSUInteger sentCount = 0;
+    IMMutationOutbox *sentOutbox = [[IMMutationOutbox alloc] initWithLogURL:sentLogURL handler:^BFTask *(IMMutation *mutation) {
+        sentCount++;
+        return [BFTask taskWithResult:@YES];
+    }];
+
+    NSMutableArray<BFTask *> *tasks = [NSMutableArray array];
+    for (NSUInteger i = 0; i < mutationCount; ++i) {
+        NSString *imojiIdentifier = [NSString stringWithFormat:@"imoji-%@", @(i)];
+        [tasks addObject:[sentOutbox enqueueMutationWithKind:IMMutationKindCollectionAdd imojiIdentifier:imojiIdentifier parameters:@{@"imojiId" : imojiIdentifier} retained:NO]];
+    }
+    [self runTestWithTask:[BFTask taskForCompletionOfAllTasks:tasks]];
+
+    // acknowledgements are written once the handler's tasks complete
+    for (NSUInteger attempt = 0; attempt < 100; ++attempt) {
+        pendingTask = [sentOutbox pendingMutations];
+        [self runTestWithTask:pendingTask];
+        if ([pendingTask.result count] == 0) {
+            break;
+        }
+        [NSThread sleepForTimeInterval:0.01];
+    }
+
+    XCTAssertEqual(sentCount, mutationCount);
+    XCTAssertEqual([pendingTask.result count], 0);
+
+    NSString *contents = [NSString stringWithContentsOfURL:sentLogURL encoding:NSUTF8StringEncoding error:nil];
+    XCTAssertLessThan([contents componentsSeparatedByString:@"\n"].count, 2 * (mutationCount - 128) + 2, @"the log is compacted");
+
+    IMMutationOutbox *reopenedOutbox = [[IMMutationOutbox alloc] initWithLogURL:sentLogURL handler:^BFTask *(IMMutation *mutation) {
+        XCTFail(@"acknowledged mutations are not replayed");
+        return [BFTask taskWithResult:nil];
+    }];
+    pendingTask = [reopenedOutbox pendingMutations];
+    [self runTestWithTask:pendingTask];
+    XCTAssertEqual([pendingTask.result count], 0);
+}
+
+- (void)test_4_19_ResumableUploadTest {
+    NSUInteger fileSize = 10000;
+    NSMutableData *contents = [NSMutableData dataWithLength:fileSize];
+    arc4random_buf(contents.mutableBytes, fileSize);
+
+    NSURL *fileURL = [[self isolatedStoragePolicy].cachePath URLByAppendingPathComponent:@"upload.png"];
+    [[NSFileManager defaultManager] createDirectoryAtURL:[fileURL URLByDeletingLastPathComponent] withIntermediateDirectories:YES attributes:nil error:nil];
+    [contents writeToURL:fileURL atomically:YES];
+
+    // the endpoint only keeps the start of the whole file, fails the next chunk once and only acknowledges part of
+    // every chunk after that
+    NSMutableData *received = [NSMutableData data];
+    NSMutableArray<NSNumber *> *chunkOffsets = [NSMutableArray array];
+    __block NSUInteger probeCount = 0;
+    __block BOOL failedChunk = NO;
+
+    IMLoopbackTransport *transport = [IMLoopbackTransport new];
+    [transport setHandler:^IMLoopbackResponse *(NSURLRequest *request, NSData *body) {
+        NSString *contentRange = [request valueForHTTPHeaderField:@"Content-Range"];
+
+        if ([contentRange hasPrefix:@"bytes */"]) {
+            probeCount++;
+        } else {
+            unsigned long long offset = strtoull([contentRange substringFromIndex:@"bytes ".length].UTF8String, NULL, 10);
+            [chunkOffsets addObject:@(offset)];
+
+            if (offset != received.length) {
+                return [IMLoopbackResponse responseWithStatusCode:400 headerFields:nil body:nil];
+            }
+
+            if (body.length == fileSize) {
+                [received appendData:[body subdataWithRange:NSMakeRange(0, 1500)]];
+            } else if (!failedChunk) {
+                failedChunk = YES;
+                return [IMLoopbackResponse responseWithStatusCode:503 headerFields:nil body:nil];
+            } else {
+                NSUInteger acknowledged = received.length + body.length == fileSize ? body.length : MIN(body.length, 3000);
+                [received appendData:[body subdataWithRange:NSMakeRange(0, acknowledged)]];
+            }
+        }
+
+        if (received.length == fileSize) {
+            return [IMLoopbackResponse responseWithStatusCode:200 headerFields:nil body:nil];
+        }
+
+        return [IMLoopbackResponse responseWithStatusCode:308
+                                             headerFields:@{@"Range" : [NSString stringWithFormat:@"bytes=0-%@", @(received.length - 1)]}
+                                                     body:nil];
+    }                     forHost:@"upload.imoji.io" path:@"*"];
+
+    IMImageUploadTask *uploadTask = [[IMImageUploadTask alloc] initWithTransport:transport
+                                                                         fileURL:fileURL
+                                                                       uploadURL:[NSURL URLWithString:@"https://upload.imoji.io/image"]
+                                                                     contentType:@"image/png"];
+    uploadTask.resumableThreshold = 1;
+    uploadTask.chunkSize = 4000;
+    uploadTask.retryDelay = .2;
+
+    NSDate *startDate = [NSDate date];
+    BFTask *task = [uploadTask uploadWithRetries:3];
+    [self runTestWithTask:task];
+
+    XCTAssertNil(task.error);
+    XCTAssertEqualObjects(task.result, @YES);
+    XCTAssertEqual(uploadTask.attemptCount, 2);
+    XCTAssertGreaterThanOrEqual(-startDate.timeIntervalSinceNow, uploadTask.retryDelay, @"retries are delayed");
+    XCTAssertEqual(probeCount, 1, @"only the retry after a 308 queries the offset");
+    XCTAssertEqualObjects(chunkOffsets, (@[@0, @1500, @1500, @4500, @7500]), @"chunks start at the acknowledged Range");
+    XCTAssertEqualObjects(received, contents);
+
+    // a plain PUT endpoint never answers with 308 and only ever receives the whole file, without offset queries
+    NSMutableArray<NSString *> *plainContentRanges = [NSMutableArray array];
+    __block BOOL failedPlainUpload = NO;
+
+    IMLoopbackTransport *plainTransport = [IMLoopbackTransport new];
+    [plainTransport setHandler:^IMLoopbackResponse *(NSURLRequest *request, NSData *body) {
+        [plainContentRanges addObject:[request valueForHTTPHeaderField:@"Content-Range"] ?: @""];
+        XCTAssertEqualObjects(body, contents);
+
+        if (!failedPlainUpload) {
+            failedPlainUpload = YES;
+            return [IMLoopbackResponse responseWithStatusCode:503 headerFields:nil body:nil];
+        }
+
+        return [IMLoopbackResponse responseWithStatusCode:200 headerFields:nil body:nil];
+    }                          forHost:@"upload.imoji.io" path:@"*"];
+
+    IMImageUploadTask *plainUploadTask = [[IMImageUploadTask alloc] initWithTransport:plainTransport
+                                                                              fileURL:fileURL
+                                                                            uploadURL:[NSURL URLWithString:@"https://upload.imoji.io/image"]
+                                                                          contentType:@"image/png"];
+    plainUploadTask.resumableThreshold = 1;
+    plainUploadTask.retryDelay = .2;
+
+    task = [plainUploadTask uploadWithRetries:3];
+    [self runTestWithTask:task];
+
+    XCTAssertNil(task.error);
+    XCTAssertEqual(plainUploadTask.attemptCount, 2);
+    XCTAssertEqualObjects(plainContentRanges, (@[@"bytes 0-9999/10000", @"bytes 0-9999/10000"]));
+}
+
+- (void)test_4_20_SharedMutationOutboxTest {
+    IMImojiSessionStoragePolicy *storagePolicy = [self isolatedStoragePolicy];
+
+    // a report left unsent by a previous launch
+    @autoreleasepool {
+        IMMutationOutbox *previousOutbox = [[IMMutationOutbox alloc] initWithLogURL:[storagePolicy.persistentPath URLByAppendingPathComponent:@"imoji.outbox"]
+                                                                            handler:^BFTask *(IMMutation *mutation) {
+                                                                                return [BFTaskCompletionSource taskCompletionSource].task;
+                                                                            }];
+        previousOutbox.maximumConcurrentMutations = 0;
+        [self runTestWithTask:[previousOutbox enqueueMutationWithKind:IMMutationKindReport
+                                                      imojiIdentifier:@"replayed"
+                                                           parameters:@{@"imojiId" : @"replayed"}
+                                                             retained:NO]];
+    }
+
+    NSMutableArray<NSString *> *reportedIdentifiers = [NSMutableArray array];
+    IMLoopbackTransport *(^reportingTransport)(void) = ^IMLoopbackTransport * {
+        IMLoopbackTransport *transport = [self loopbackTransportWithImojiCount:1];
+        [transport setHandler:^IMLoopbackResponse *(NSURLRequest *request, NSData *body) {
+            NSString *parameters = [[NSString alloc] initWithData:body encoding:NSUTF8StringEncoding];
+            @synchronized (reportedIdentifiers) {
+                [reportedIdentifiers addObject:[parameters containsString:@"replayed"] ? @"replayed" : @"reported"];
+            }
+
+            return [IMLoopbackResponse responseWithJSONObject:@{@"status" : @"SUCCESS"}];
+        }             forHost:@"api.imoji.io" path:@"/v2/imoji/reportAbusive"];
+
+        return transport;
+    };
+
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:storagePolicy transport:reportingTransport()];
+    IMImojiSession *otherSession = [IMImojiSession imojiSessionWithStoragePolicy:storagePolicy transport:reportingTransport()];
+    IMSharedPersistentResources *persistentResources = [[IMSharedResourceRegistry sharedRegistry] persistentResourcesForStoragePolicy:storagePolicy];
+    XCTAssertEqual([[IMSharedResourceRegistry sharedRegistry] persistentResourcesForStoragePolicy:storagePolicy], persistentResources, @"one outbox per persistent path");
+
+    [self runTestWithTask:[BFTask taskForCompletionOfAllTasks:@[[session validateSession], [otherSession validateSession]]]];
+
+    BFTaskCompletionSource *reportSource = [BFTaskCompletionSource taskCompletionSource];
+    [otherSession reportImojiAsAbusiveWithIdentifier:@"reported" reason:nil callback:^(BOOL successful, NSError *error) {
+        reportSource.result = @(successful);
+    }];
+    [self runTestWithTask:reportSource.task];
+
+    BFTask *pendingTask;
+    for (NSUInteger attempt = 0; attempt < 100; ++attempt) {
+        pendingTask = [persistentResources.mutationOutbox pendingMutations];
+        [self runTestWithTask:pendingTask];
+        if ([pendingTask.result count] == 0) {
+            break;
+        }
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    [NSThread sleepForTimeInterval:0.2];
+
+    XCTAssertEqual([pendingTask.result count], 0);
+    @synchronized (reportedIdentifiers) {
+        XCTAssertEqualObjects([reportedIdentifiers sortedArrayUsingSelector:@selector(compare:)], (@[@"replayed", @"reported"]), @"each mutation is sent once");
+    }
+}
+
+- (void)test_4_21_TransientErrorTest {
+    NSError *offlineError = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNotConnectedToInternet userInfo:nil];
+    XCTAssert(offlineError.im_isTransient);
+    XCTAssert([NSError errorWithDomain:IMImojiSessionErrorDomain code:IMImojiSessionErrorCodeServerError userInfo:@{IMImojiSessionErrorHTTPStatusCodeKey : @503}].im_isTransient);
+    XCTAssert([NSError errorWithDomain:IMImojiSessionErrorDomain code:IMImojiSessionErrorCodeServerError userInfo:@{NSUnderlyingErrorKey : offlineError}].im_isTransient);
+    XCTAssertFalse([NSError errorWithDomain:IMImojiSessionErrorDomain code:IMImojiSessionErrorCodeServerError userInfo:@{IMImojiSessionErrorHTTPStatusCodeKey : @400}].im_isTransient);
+    XCTAssertFalse([NSError errorWithDomain:IMImojiSessionErrorDomain code:IMImojiSessionErrorCodeServerError userInfo:nil].im_isTransient, @"failure statuses in responses are final");
+
+    // an expired token can't be renewed while offline, the mutation waits for the next attempt
+    [IMImojiSession setCredentials:[[IMImojiSessionCredentials alloc] initWithAccessToken:nil
+                                                                             refreshToken:nil
+                                                                           expirationDate:nil
+                                                                                 clientId:[ImojiSDK sharedInstance].clientId.UUIDString
+                                                                      accountSynchronized:NO]];
+
+    IMImojiSessionStoragePolicy *storagePolicy = [self isolatedStoragePolicy];
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:storagePolicy transport:[IMLoopbackTransport new]];
+
+    BFTask *validationTask = [session validateSession];
+    [self runTestWithTask:validationTask];
+    XCTAssert(validationTask.error.im_isTransient, @"token request failures are transient");
+
+    BFTaskCompletionSource *reportSource = [BFTaskCompletionSource taskCompletionSource];
+    [session reportImojiAsAbusiveWithIdentifier:@"offline" reason:nil callback:^(BOOL successful, NSError *error) {
+        reportSource.result = @(successful);
+    }];
+    [self runTestWithTask:reportSource.task];
+    [NSThread sleepForTimeInterval:0.5];
+
+    BFTask *pendingTask = [[[IMSharedResourceRegistry sharedRegistry] persistentResourcesForStoragePolicy:storagePolicy].mutationOutbox pendingMutations];
+    [self runTestWithTask:pendingTask];
+    XCTAssertEqual([pendingTask.result count], 1, @"mutations aren't dropped while a token can't be fetched");
+}
+
+- (void)test_4_22_SharedAnalyticsPipelineTest {
+    IMImojiSessionStoragePolicy *storagePolicy = [self isolatedStoragePolicy];
+
+    NSMutableArray<NSString *> *sentIdentifiers = [NSMutableArray array];
+    IMLoopbackTransport *(^analyticsTransport)(void) = ^IMLoopbackTransport * {
+        IMLoopbackTransport *transport = [self loopbackTransportWithImojiCount:1];
+        [transport setHandler:^IMLoopbackResponse *(NSURLRequest *request, NSData *body) {
+            for (NSURLQueryItem *item in [NSURLComponents componentsWithURL:request.URL resolvingAgainstBaseURL:NO].queryItems) {
+                if ([item.name isEqualToString:@"imojiId"]) {
+                    @synchronized (sentIdentifiers) {
+                        [sentIdentifiers addObject:item.value];
+                    }
+                }
+            }
+
+            return [IMLoopbackResponse responseWithJSONObject:@{@"status" : @"SUCCESS"}];
+        }             forHost:@"api.imoji.io" path:@"/v2/analytics/imoji/sent"];
+
+        return transport;
+    };
+
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:storagePolicy transport:analyticsTransport()];
+    IMImojiSession *otherSession = [IMImojiSession imojiSessionWithStoragePolicy:storagePolicy transport:analyticsTransport()];
+    [self runTestWithTask:[BFTask taskForCompletionOfAllTasks:@[[session validateSession], [otherSession validateSession]]]];
+
+    NSMutableArray<NSString *> *expectedIdentifiers = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 10; ++i) {
+        NSString *identifier = [NSString stringWithFormat:@"event%02lu", (unsigned long) i];
+        [expectedIdentifiers addObject:identifier];
+        [(i % 2 == 0 ? session : otherSession) markImojiUsageWithIdentifier:identifier originIdentifier:nil];
+    }
+
+    IMSharedPersistentResources *persistentResources = [[IMSharedResourceRegistry sharedRegistry] persistentResourcesForStoragePolicy:storagePolicy];
+    [persistentResources.analyticsPipeline flush];
+
+    for (NSUInteger attempt = 0; attempt < 100; ++attempt) {
+        @synchronized (sentIdentifiers) {
+            if (sentIdentifiers.count >= expectedIdentifiers.count) {
+                break;
+            }
+        }
+        [NSThread sleepForTimeInterval:0.02];
+    }
+    [NSThread sleepForTimeInterval:0.2];
+
+    @synchronized (sentIdentifiers) {
+        XCTAssertEqualObjects([sentIdentifiers sortedArrayUsingSelector:@selector(compare:)], expectedIdentifiers, @"each event is spooled and sent once");
+    }
+}
+
+- (void)test_4_23_PrewarmContentSnapshotTest {
+    IMLoopbackTransport *transport = [self loopbackTransportWithImojiCount:10];
+    IMImojiSessionStoragePolicy *storagePolicy = [self isolatedStoragePolicy];
+    NSURL *snapshotsURL = [storagePolicy.cachePath URLByAppendingPathComponent:@"snapshots"];
+
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:storagePolicy transport:transport];
+    session.contentSnapshotsEnabled = YES;
+    BFTaskCompletionSource *source = [BFTaskCompletionSource taskCompletionSource];
+    [session prewarmWithOptions:IMImojiSessionPrewarmOptionsFeatured | IMImojiSessionPrewarmOptionsCategories
+                       callback:^(BOOL successful, NSError *error) {
+                           XCTAssert(successful && error == nil, @"prewarm");
+                           source.result = @YES;
+                       }];
+    [self runTestWithTask:source.task];
+
+    // featured, trending and generic snapshots are written in the background
+    for (NSUInteger i = 0; i < 100 && [[NSFileManager defaultManager] contentsOfDirectoryAtPath:snapshotsURL.path error:nil].count < 3; i++) {
+        [NSThread sleepForTimeInterval:.01];
+    }
+
+    IMImojiSession *coldSession = [IMImojiSession imojiSessionWithStoragePolicy:storagePolicy transport:transport];
+    coldSession.contentSnapshotsEnabled = YES;
+    __block NSUInteger categoryCount = 0;
+    [coldSession getImojiCategoriesWithClassification:IMImojiSessionCategoryClassificationTrending callback:^(NSArray *imojiCategories, NSError *error) {
+        categoryCount = imojiCategories.count;
+    }];
+
+    XCTAssertEqual(categoryCount, 10, @"prewarmed categories are served from the snapshot");
+    XCTAssertEqual(coldSession.metricsSnapshot.caches[@"contentSnapshots"].hits, 1);
+}
+
+- (void)test_5_1_SearchLatencyBenchmark {
+    IMLoopbackTransport *transport = [self loopbackTransportWithImojiCount:60];
+    transport.latency = .05;
+    transport.bandwidth = 512 * 1024;
+
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:[self isolatedStoragePolicy] transport:transport];
+
+    // keep token acquisition out of the measurements
+    [self runTestWithTask:[self firstSearchCallbackWithSession:session term:@"warmup"]];
+    [transport resetCounters];
+
+    NSMutableArray<NSNumber *> *latencies = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 20; i++) {
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        BFTask *searchTask = [self firstSearchCallbackWithSession:session term:[NSString stringWithFormat:@"term%@", @(i)]];
+        [self runTestWithTask:searchTask];
+
+        XCTAssertNil(searchTask.error, @"loopback search");
+        [latencies addObject:@([searchTask.result doubleValue] - start)];
+    }
+
+    [latencies sortUsingSelector:@selector(compare:)];
+    [self recordBenchmark:@"search" metrics:@{
+            @"searchToFirstCallbackP50Ms" : @(latencies[latencies.count / 2].doubleValue * 1000.0),
+            @"searchToFirstCallbackP95Ms" : @(latencies[(latencies.count * 95) / 100].doubleValue * 1000.0),
+            @"requests" : @(transport.requestCount),
+            @"bytesSent" : @(transport.bytesSent),
+            @"bytesReceived" : @(transport.bytesReceived)
+    }];
+}
+
+- (void)test_5_2_RenderThroughputBenchmark {
+    IMLoopbackTransport *transport = [self loopbackTransportWithImojiCount:100];
+    transport.latency = .02;
+    transport.bandwidth = 2 * 1024 * 1024;
+
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:[self isolatedStoragePolicy] transport:transport];
+
+    NSMutableArray<IMImojiObject *> *imojis = [NSMutableArray array];
+    BFTaskCompletionSource *fetchSource = [BFTaskCompletionSource taskCompletionSource];
+    [session searchImojisWithTerm:@"render"
+                           offset:nil
+              contributingImojiId:nil
+                  numberOfResults:@100
+        resultSetResponseCallback:^(IMImojiResultSetMetadata *metadata, NSError *error) {
+            if (error) {
+                [fetchSource trySetError:error];
+            }
+        }
+            imojiResponseCallback:^(IMImojiObject *imoji, NSUInteger index, NSError *error) {
+                [imojis addObject:imoji];
+                if (imojis.count == 100) {
+                    [fetchSource trySetResult:imojis];
+                }
+            }];
+    [self runTestWithTask:fetchSource.task];
+    XCTAssertEqual(imojis.count, 100, @"imojis for rendering");
+    [transport resetCounters];
+
+    BFTaskCompletionSource *renderSource = [BFTaskCompletionSource taskCompletionSource];
+    __block NSUInteger remaining = imojis.count, failures = 0;
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+
+    for (IMImojiObject *imoji in imojis) {
+        [session renderImoji:imoji
+                     options:[IMImojiObjectRenderingOptions optionsWithRenderSize:IMImojiObjectRenderSizeThumbnail]
+                    callback:^(UIImage *image, NSError *error) {
+                        @synchronized (renderSource) {
+                            failures += image == nil ? 1 : 0;
+                            if (--remaining == 0) {
+                                renderSource.result = @(CFAbsoluteTimeGetCurrent());
+                            }
+                        }
+                    }];
+    }
+    [self runTestWithTask:renderSource.task];
+
+    XCTAssertEqual(failures, 0, @"loopback renders");
+    [self recordBenchmark:@"render" metrics:@{
+            @"rendersPerSecond" : @(imojis.count / ([renderSource.task.result doubleValue] - start)),
+            @"requests" : @(transport.requestCount),
+            @"bytesSent" : @(transport.bytesSent),
+            @"bytesReceived" : @(transport.bytesReceived)
+    }];
+}
+
+- (void)test_5_3_ResponseDecodingBenchmark {
+    NSMutableArray *imojis = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 100; i++) {
+        NSString *identifier = [[NSUUID UUID] UUIDString].lowercaseString;
+        [imojis addObject:i % 2 == 0 ? [self currentFormatImojiWithIdentifier:identifier] : [self loopbackImojiWithIdentifier:identifier]];
+    }
+
+    NSData *data = [NSJSONSerialization dataWithJSONObject:@{@"status" : @"SUCCESS", @"results" : imojis} options:0 error:nil];
+    IMImojiSession *session = [IMImojiSession imojiSessionWithStoragePolicy:[self isolatedStoragePolicy] transport:[IMLoopbackTransport new]];
+    const NSUInteger iterations = 50;
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            NSDictionary *json = [NSJSONSerialization JSONObjectWithData:data options:NSJSONReadingAllowFragments error:nil];
+            XCTAssertEqual([session convertServerDataSetToImojiArray:json].count, imojis.count);
+        }
+    }
+    CFAbsoluteTime serializationDuration = (CFAbsoluteTimeGetCurrent() - start) / iterations;
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            XCTAssertEqual([IMImojiResponse responseWithData:data error:nil].imojis.count, imojis.count);
+        }
+    }
+    CFAbsoluteTime decoderDuration = (CFAbsoluteTimeGetCurrent() - start) / iterations;
+
+    [self recordBenchmark:@"responseDecoding" metrics:@{
+            @"responseBytes" : @(data.length),
+            @"imojisPerResponse" : @(imojis.count),
+            @"serializationMs" : @(serializationDuration * 1000.0),
+            @"decoderMs" : @(decoderDuration * 1000.0),
+            @"speedup" : @(serializationDuration / decoderDuration)
+    }];
+}
+
+- (void)test_5_4_CollectionArchiveBenchmark {
+    NSMutableArray *results = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 3000; i++) {
+        [results addObject:[self currentFormatImojiWithIdentifier:[[NSUUID UUID] UUIDString].lowercaseString]];
+    }
+
+    NSData *data = [NSJSONSerialization dataWithJSONObject:@{@"status" : @"SUCCESS", @"results" : results} options:0 error:nil];
+    NSArray<IMImojiObject *> *imojis = [IMImojiResponse responseWithData:data error:nil].imojis;
+    NSURL *directory = [self isolatedStoragePolicy].persistentPath;
+    [[NSFileManager defaultManager] createDirectoryAtURL:directory withIntermediateDirectories:YES attributes:nil error:nil];
+
+    NSURL *keyedArchiveURL = [directory URLByAppendingPathComponent:@"favorites.plist"];
+    [NSKeyedArchiver archiveRootObject:imojis toFile:keyedArchiveURL.path];
+
+    NSURL *archiveURL = [directory URLByAppendingPathComponent:@"favorites.imojis"];
+    [[IMImojiCollectionArchive archiveWithFileURL:archiveURL error:nil] appendImojis:imojis error:nil];
+
+    NSString *identifier = imojis[imojis.count / 2].identifier;
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    @autoreleasepool {
+        NSArray *unarchived = [NSKeyedUnarchiver unarchiveObjectWithFile:keyedArchiveURL.path];
+        XCTAssertEqual(unarchived.count, imojis.count);
+    }
+    CFAbsoluteTime keyedArchiveDuration = CFAbsoluteTimeGetCurrent() - start;
+
+    start = CFAbsoluteTimeGetCurrent();
+    IMImojiCollectionArchive *archive = [IMImojiCollectionArchive archiveWithFileURL:archiveURL error:nil];
+    XCTAssertEqual(archive.count, imojis.count);
+    XCTAssertNotNil([archive imojiWithIdentifier:identifier]);
+    CFAbsoluteTime archiveOpenDuration = CFAbsoluteTimeGetCurrent() - start;
+
+    start = CFAbsoluteTimeGetCurrent();
+    @autoreleasepool {
+        for (NSUInteger i = 0; i < archive.count; i++) {
+            XCTAssertNotNil([archive imojiAtIndex:i]);
+        }
+    }
+    CFAbsoluteTime archiveReadDuration = CFAbsoluteTimeGetCurrent() - start;
+
+    NSNumber *keyedArchiveSize, *archiveSize;
+    [keyedArchiveURL getResourceValue:&keyedArchiveSize forKey:NSURLFileSizeKey error:nil];
+    [archiveURL getResourceValue:&archiveSize forKey:NSURLFileSizeKey error:nil];
+
+    [self recordBenchmark:@"collectionArchive" metrics:@{
+            @"imojis" : @(imojis.count),
+            @"keyedArchiveBytes" : keyedArchiveSize ?: @0,
+            @"archiveBytes" : archiveSize ?: @0,
+            @"keyedUnarchiveMs" : @(keyedArchiveDuration * 1000.0),
+            @"openAndLookupMs" : @(archiveOpenDuration * 1000.0),
+            @"materializeAllMs" : @(archiveReadDuration * 1000.0)
+    }];
+}
+
+// results in the CFAbsoluteTime of the first imoji callback
+- (BFTask *)firstSearchCallbackWithSession:(IMImojiSession *)session term:(NSString *)term {
+    BFTaskCompletionSource *source = [BFTaskCompletionSource taskCompletionSource];
+
+    [session searchImojisWithTerm:term
+                           offset:nil
+              contributingImojiId:nil
+                  numberOfResults:@60
+        resultSetResponseCallback:^(IMImojiResultSetMetadata *metadata, NSError *error) {
+            if (error) {
+                [source trySetError:error];
+            }
+        }
+            imojiResponseCallback:^(IMImojiObject *imoji, NSUInteger index, NSError *error) {
+                [source trySetResult:@(CFAbsoluteTimeGetCurrent())];
+            }];
+
+    return source.task;
+}
+
+// merges metrics into a JSON report, IMOJI_BENCHMARK_OUTPUT overrides its location
+- (void)recordBenchmark:(NSString *)name metrics:(NSDictionary *)metrics {
+    NSMutableDictionary *benchmarkMetrics = [metrics mutableCopy];
+
+    struct mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) == KERN_SUCCESS) {
+        benchmarkMetrics[@"peakResidentBytes"] = @(info.resident_size_max);
+    }
+
+    NSString *reportPath = [NSProcessInfo processInfo].environment[@"IMOJI_BENCHMARK_OUTPUT"];
+    if (!reportPath) {
+        reportPath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"ImojiSDKBenchmarks.json"];
+    }
+
+    NSData *existingReport = [NSData dataWithContentsOfFile:reportPath];
+    NSMutableDictionary *report = existingReport ? [[NSJSONSerialization JSONObjectWithData:existingReport options:NSJSONReadingMutableContainers error:nil] mutableCopy] : nil;
+    if (![report isKindOfClass:[NSMutableDictionary class]]) {
+        report = [NSMutableDictionary dictionary];
+    }
+
+    report[@"sdkVersion"] = [ImojiSDK sharedInstance].sdkVersion;
+    report[name] = benchmarkMetrics;
+    [[NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted error:nil] writeToFile:reportPath atomically:YES];
+
+    NSData *line = [NSJSONSerialization dataWithJSONObject:@{name : benchmarkMetrics} options:0 error:nil];
+    NSLog(@"IMOJI_BENCHMARK %@", [[NSString alloc] initWithData:line encoding:NSUTF8StringEncoding]);
+}
+
+- (UIImage *)syntheticPhotoWithSize:(CGSize)size orientation:(UIImageOrientation)orientation {
+    UIGraphicsBeginImageContextWithOptions(size, YES, 1.0f);
+    CGContextRef context = UIGraphicsGetCurrentContext();
+
+    for (NSUInteger i = 0; i < 64; i++) {
+        CGContextSetFillColorWithColor(context, [UIColor colorWithHue:i / 64.f saturation:.8f brightness:.9f alpha:1.f].CGColor);
+        CGContextFillEllipseInRect(context, CGRectMake((i * 97) % (NSUInteger) size.width, (i * 61) % (NSUInteger) size.height, 400, 300));
+    }
+
+    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+
+    return [UIImage imageWithCGImage:image.CGImage scale:1.0f orientation:orientation];
+}
+
+// maps a point of the displayed image in unit coordinates to the point of the backing image it shows
+- (CGPoint)sourcePointForUprightPoint:(CGPoint)point orientation:(UIImageOrientation)orientation {
+    switch (orientation) {
+        case UIImageOrientationDown:
+            return CGPointMake(1.f - point.x, 1.f - point.y);
+        case UIImageOrientationLeft:
+            return CGPointMake(1.f - point.y, point.x);
+        case UIImageOrientationRight:
+            return CGPointMake(point.y, 1.f - point.x);
+        case UIImageOrientationUpMirrored:
+            return CGPointMake(1.f - point.x, point.y);
+        case UIImageOrientationDownMirrored:
+            return CGPointMake(point.x, 1.f - point.y);
+        case UIImageOrientationLeftMirrored:
+            return CGPointMake(point.y, point.x);
+        case UIImageOrientationRightMirrored:
+            return CGPointMake(1.f - point.y, 1.f - point.x);
+        default:
+            return point;
+    }
+}
+
+// fills rect of a premultiplied RGBA buffer with rgba, red in the low byte
+- (void)fillPixels:(NSMutableData *)pixels bytesPerRow:(size_t)bytesPerRow rect:(CGRect)rect rgba:(uint32_t)rgba {
+    uint8_t *bytes = pixels.mutableBytes;
+    for (size_t y = (size_t) CGRectGetMinY(rect); y < (size_t) CGRectGetMaxY(rect); y++) {
+        for (size_t x = (size_t) CGRectGetMinX(rect); x < (size_t) CGRectGetMaxX(rect); x++) {
+            uint8_t *pixel = bytes + y * bytesPerRow + x * 4;
+            pixel[0] = (uint8_t) rgba;
+            pixel[1] = (uint8_t) (rgba >> 8);
+            pixel[2] = (uint8_t) (rgba >> 16);
+            pixel[3] = (uint8_t) (rgba >> 24);
+        }
+    }
+}
+
+- (NSArray *)syntheticAnimationFramesWithSize:(CGSize)size frameCount:(NSUInteger)frameCount {
+    NSMutableArray *frames = [NSMutableArray arrayWithCapacity:frameCount];
+
+    // a transparent sticker-like animation: a static gradient body with a small moving highlight
+    for (NSUInteger i = 0; i < frameCount; i++) {
+        UIGraphicsBeginImageContextWithOptions(size, NO, 1.0f);
+        CGContextRef context = UIGraphicsGetCurrentContext();
+
+        CGFloat components[] = {1.0f, .4f, .2f, 1.0f, .2f, .3f, 1.0f, 1.0f};
+        CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+        CGGradientRef gradient = CGGradientCreateWithColorComponents(colorSpace, components, NULL, 2);
+
+        CGContextAddEllipseInRect(context, CGRectInset((CGRect) {CGPointZero, size}, 20, 20));
+        CGContextClip(context);
+        CGContextDrawLinearGradient(context, gradient, CGPointZero, CGPointMake(size.width, size.height), 0);
+
+        CGContextSetFillColorWithColor(context, [UIColor whiteColor].CGColor);
+        CGContextFillEllipseInRect(context, CGRectMake(60 + i * 6, size.height / 2 - 20, 40, 40));
+
+        CGGradientRelease(gradient);
+        CGColorSpaceRelease(colorSpace);
+
+        [frames addObject:UIGraphicsGetImageFromCurrentImageContext()];
+        UIGraphicsEndImageContext();
+    }
+
+    return frames;
+}
+
+- (IMImojiSessionStoragePolicy *)isolatedStoragePolicy {
+    NSURL *directory = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]]];
+
+    return [IMImojiSessionStoragePolicy storagePolicyWithCachePath:[directory URLByAppendingPathComponent:@"cache"]
+                                                    persistentPath:[directory URLByAppendingPathComponent:@"persistent"]];
+}
+
+// an imoji in the current images format with every size, format and border style
+- (NSDictionary *)currentFormatImojiWithIdentifier:(NSString *)identifier {
+    NSMutableDictionary *images = [NSMutableDictionary dictionary];
+    NSUInteger fileSize = 1000;
+
+    for (NSString *group in @[@"bordered", @"unbordered", @"animated"]) {
+        NSMutableDictionary *formats = [NSMutableDictionary dictionary];
+        for (NSString *format in [group isEqualToString:@"animated"] ? @[@"gif", @"webp"] : @[@"png", @"webp"]) {
+            NSMutableDictionary *sizes = [NSMutableDictionary dictionary];
+            for (NSString *size in @[@"150", @"320", @"512", @"1200"]) {
+                sizes[size] = @{
+                        @"url" : [NSString stringWithFormat:@"https://render.imoji.io/%@/%@-%@.%@", identifier, group, size, format],
+                        @"width" : @(size.integerValue),
+                        @"height" : @(size.integerValue / 2),
+                        @"fileSize" : @(fileSize++)
+                };
+            }
+            formats[format] = sizes;
+        }
+        images[group] = formats;
+    }
+
+    return @{
+            @"id" : identifier,
+            @"tags" : @[@"current", @"caf\u00e9"],
+            @"licenseStyle" : @"commercialPrint",
+            @"images" : images
+    };
+}
+
+- (void)assertImoji:(IMImojiObject *)imoji matchesImoji:(IMImojiObject *)expected {
+    XCTAssertEqualObjects(imoji.identifier, expected.identifier);
+    XCTAssertEqualObjects(imoji.tags, expected.tags);
+    XCTAssertEqualObjects(imoji.urls, expected.urls, @"urls of %@", expected.identifier);
+    XCTAssertEqualObjects(imoji.imageDimensions, expected.imageDimensions, @"dimensions of %@", expected.identifier);
+    XCTAssertEqualObjects(imoji.fileSizes, expected.fileSizes, @"file sizes of %@", expected.identifier);
+    XCTAssertEqual(imoji.licenseStyle, expected.licenseStyle);
+}
+
+- (void)assertAttribution:(IMCategoryAttribution *)attribution matchesAttribution:(IMCategoryAttribution *)expected {
+    XCTAssertEqual(attribution == nil, expected == nil);
+    XCTAssertEqualObjects(attribution.identifier, expected.identifier);
+    XCTAssertEqualObjects(attribution.URL, expected.URL);
+    XCTAssertEqual(attribution.urlCategory, expected.urlCategory);
+    XCTAssertEqualObjects(attribution.relatedTags, expected.relatedTags);
+    XCTAssertEqual(attribution.licenseStyle, expected.licenseStyle);
+    XCTAssertEqualObjects(attribution.artist.identifier, expected.artist.identifier);
+    XCTAssertEqualObjects(attribution.artist.name, expected.artist.name);
+    XCTAssertEqualObjects(attribution.artist.summary, expected.artist.summary);
+    if (expected.artist.previewImoji) {
+        [self assertImoji:attribution.artist.previewImoji matchesImoji:expected.artist.previewImoji];
+    }
+}
+
+- (void)assertCategories:(NSArray<IMImojiCategoryObject *> *)categories matchCategories:(NSArray<IMImojiCategoryObject *> *)expected {
+    XCTAssertEqual(categories.count, expected.count);
+    for (NSUInteger i = 0; i < MIN(categories.count, expected.count); i++) {
+        XCTAssertEqualObjects(categories[i].identifier, expected[i].identifier);
+        XCTAssertEqualObjects(categories[i].title, expected[i].title);
+        XCTAssertEqual(categories[i].order, expected[i].order);
+        XCTAssertEqual(categories[i].priority, expected[i].priority);
+        XCTAssertEqual(categories[i].previewImojis.count, expected[i].previewImojis.count);
+        for (NSUInteger j = 0; j < MIN(categories[i].previewImojis.count, expected[i].previewImojis.count); j++) {
+            [self assertImoji:categories[i].previewImojis[j] matchesImoji:expected[i].previewImojis[j]];
+        }
+        [self assertAttribution:categories[i].attribution matchesAttribution:expected[i].attribution];
+    }
+}
+
+- (NSDictionary *)loopbackImojiWithIdentifier:(NSString *)identifier {
+    NSString *baseUrl = [NSString stringWithFormat:@"https://render.imoji.io/%@/%@", [identifier substringToIndex:3], identifier];
+    NSDictionary *(^sizes)(NSString *) = ^NSDictionary *(NSString *style) {
+        return @{
+                @"thumb" : [NSString stringWithFormat:@"%@/%@-thumb.png", baseUrl, style],
+                @"full" : [NSString stringWithFormat:@"%@/%@-full.png", baseUrl, style],
+                @"320" : [NSString stringWithFormat:@"%@/%@-320.png", baseUrl, style],
+                @"512" : [NSString stringWithFormat:@"%@/%@-512.png", baseUrl, style]
+        };
+    };
+
+    NSMutableDictionary *png = [sizes(@"bordered") mutableCopy];
+    png[@"raw"] = sizes(@"unbordered");
+
+    return @{
+            @"imojiId" : identifier,
+            @"tags" : @[@"loopback"],
+            @"urls" : @{@"png" : png, @"webp" : png}
+    };
+}
+
+// serves the endpoints used by fetching and rendering with imojiCount results each, images are 320x320 PNGs
+- (IMLoopbackTransport *)loopbackTransportWithImojiCount:(NSUInteger)imojiCount {
+    IMLoopbackTransport *transport = [IMLoopbackTransport new];
+
+    NSMutableArray *imojis = [NSMutableArray arrayWithCapacity:imojiCount];
+    NSMutableArray *categories = [NSMutableArray arrayWithCapacity:imojiCount];
+    for (NSUInteger i = 0; i < imojiCount; i++) {
+        NSDictionary *imoji = [self loopbackImojiWithIdentifier:[[NSUUID UUID] UUIDString].lowercaseString];
+        [imojis addObject:imoji];
+        [categories addObject:@{
+                @"searchText" : [NSString stringWithFormat:@"category%@", @(i)],
+                @"title" : [NSString stringWithFormat:@"Category %@", @(i)],
+                @"priority" : @(i),
+                @"artist" : [NSNull null],
+                @"imojis" : @[imoji]
+        }];
+    }
+
+    NSDictionary *results = @{@"status" : @"SUCCESS", @"results" : imojis};
+
+    [transport setResponse:[IMLoopbackResponse responseWithJSONObject:@{
+            @"access_token" : @"loopback-access-token",
+            @"refresh_token" : @"loopback-refresh-token",
+            @"expires_in" : @3600
+    }]             forHost:@"api.imoji.io" path:@"/v2/oauth/token"];
+    [transport setResponse:[IMLoopbackResponse responseWithJSONObject:@{@"status" : @"SUCCESS", @"categories" : categories}]
+                   forHost:@"api.imoji.io" path:@"/v2/imoji/categories/fetch"];
+    for (NSString *path in @[@"/v2/imoji/search", @"/v2/imoji/featured/fetch", @"/v2/imoji/fetchMultiple"]) {
+        [transport setResponse:[IMLoopbackResponse responseWithJSONObject:results] forHost:@"api.imoji.io" path:path];
+    }
+    [transport setResponse:[IMLoopbackResponse responseWithJSONObject:@{@"status" : @"SUCCESS"}]
+                   forHost:@"api.imoji.io" path:@"/v2/analytics/*"];
+
+    UIImage *image = [self syntheticAnimationFramesWithSize:CGSizeMake(320, 320) frameCount:1].firstObject;
+    [transport setResponse:[IMLoopbackResponse responseWithStatusCode:200
+                                                         headerFields:@{@"Content-Type" : @"image/png"}
+                                                                 body:UIImagePNGRepresentation(image)]
+                   forHost:@"render.imoji.io" path:@"*"];
+
+    return transport;
+}
+
+- (BOOL)atlas:(IMImojiAtlas *)atlas hasPixelsInCellAtIndex:(NSUInteger)index {
+    CGRect rect = [atlas rectForImojiAtIndex:index];
+    CGImageRef cellImage = CGImageCreateWithImageInRect(atlas.image.CGImage, rect);
+    size_t width = (size_t) rect.size.width, height = (size_t) rect.size.height;
+    NSMutableData *pixels = [NSMutableData dataWithLength:width * height * 4];
+
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(pixels.mutableBytes, width, height, 8, width * 4, colorSpace, kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big);
+    CGContextDrawImage(context, CGRectMake(0, 0, width, height), cellImage);
+    CGContextRelease(context);
+    CGColorSpaceRelease(colorSpace);
+    CGImageRelease(cellImage);
+
+    const uint8_t *bytes = pixels.bytes;
+    for (NSUInteger i = 3; i < pixels.length; i += 4) {
+        if (bytes[i] != 0) {
+            return YES;
+        }
+    }
+
+    return NO;
+}
+
 - (void)runTestWithTask:(BFTask *)task {
     dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
 